@@ -30,6 +30,29 @@
 #include <linux/dvb/dmx.h>
 #include "dvbdemux.h"
 
+#ifndef DMX_GET_PID_STATS
+/* per-PID statistics interface, for building against older kernel headers */
+struct dmx_pid_stats_entry {
+	__u16 pid;
+	__u16 reserved;
+	__u32 packets;
+	__u32 cc_errors;
+	__u32 tei;
+	__u32 scrambled;
+};
+
+struct dmx_pid_stats {
+	__u64 packets;
+	__u32 bitrate;
+	__u32 msecs;
+	__u32 count;
+	__u32 pids;
+	__u64 entries;
+};
+
+#define DMX_GET_PID_STATS        _IOWR('o', 53, struct dmx_pid_stats)
+#endif
+
 
 int dvbdemux_open_demux(int adapter, int demuxdevice, int nonblocking)
 {
@@ -253,3 +276,24 @@ int dvbdemux_set_buffer(int fd, int bufsize)
 {
 	return ioctl(fd, DMX_SET_BUFFER_SIZE, bufsize);
 }
+
+int dvbdemux_get_pid_stats(int fd, struct dvbdemux_stats *stats,
+			   struct dvbdemux_pid_stats *pids, int count)
+{
+	struct dmx_pid_stats _stats;
+	int result;
+
+	// struct dvbdemux_pid_stats has the kernel layout, so no copying
+	memset(&_stats, 0, sizeof(_stats));
+	_stats.count = count;
+	_stats.entries = (uintptr_t) pids;
+	if ((result = ioctl(fd, DMX_GET_PID_STATS, &_stats)) != 0) {
+		return result;
+	}
+
+	stats->packets = _stats.packets;
+	stats->bitrate = _stats.bitrate;
+	stats->msecs = _stats.msecs;
+	stats->pids = _stats.pids;
+	return _stats.count;
+}
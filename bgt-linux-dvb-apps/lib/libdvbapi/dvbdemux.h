@@ -197,6 +197,44 @@ extern int dvbdemux_get_stc(int fd, uint64_t *stc);
  */
 extern int dvbdemux_set_buffer(int fd, int bufsize);
 
+/**
+ * Per-PID counters kept by the kernel demux, see dvbdemux_get_pid_stats().
+ */
+struct dvbdemux_pid_stats {
+	uint16_t pid;
+	uint16_t reserved;
+	uint32_t packets;
+	uint32_t cc_errors;
+	uint32_t tei;
+	uint32_t scrambled;
+};
+
+/**
+ * Demux-wide values from dvbdemux_get_pid_stats().
+ */
+struct dvbdemux_stats {
+	uint64_t packets;	/* packets seen by the demux */
+	uint32_t bitrate;	/* bits/s, measured by the kernel over about a second */
+	uint32_t msecs;		/* time of the snapshot, in ms */
+	int pids;		/* PIDs seen, may be more than were returned */
+};
+
+/**
+ * Read the per-PID packet, continuity error, TEI and scrambled packet counters
+ * the demux keeps for the whole stream, without reading the stream itself.
+ * Only PIDs which have been seen are returned, in PID order. The counters
+ * count up from when the demux was created; compare two snapshots for rates.
+ *
+ * @param fd FD as opened with dvbdemux_open_demux() above.
+ * @param stats Where to put the demux-wide values.
+ * @param pids Where to put the per-PID counters.
+ * @param count Number of entries in pids.
+ * @return Number of entries filled in on success, or -1 on failure (e.g. the
+ * kernel does not support it).
+ */
+extern int dvbdemux_get_pid_stats(int fd, struct dvbdemux_stats *stats,
+				  struct dvbdemux_pid_stats *pids, int count);
+
 #ifdef __cplusplus
 }
 #endif
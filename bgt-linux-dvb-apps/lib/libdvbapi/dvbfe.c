@@ -36,6 +36,44 @@
 #include <libdvbmisc/dvbmisc.h>
 #include "dvbfe.h"
 
+#ifndef FE_BLIND_SCAN
+/* blind scan interface, for building against older kernel headers */
+#define DVB_BLINDSCAN_MAX_CARRIERS	128
+
+struct dvb_blindscan_carrier {
+	__u32	frequency;
+	__u32	symbol_rate;
+	__u32	delivery_system;
+	__u32	modulation;
+	__u32	fec_inner;
+	__u32	inversion;
+};
+
+struct dvb_blindscan {
+	__u32	frequency_min;
+	__u32	frequency_max;
+	__u32	frequency_step;
+	__u32	symbol_rate_min;
+	__u32	symbol_rate_max;
+	__u32	count;
+	struct dvb_blindscan_carrier carriers[DVB_BLINDSCAN_MAX_CARRIERS];
+};
+
+#define FE_BLIND_SCAN		_IOWR('o', 84, struct dvb_blindscan)
+#endif
+
+#ifndef DTV_PRIVATE_BASE
+#define DTV_PRIVATE_BASE	0x10000
+#endif
+
+#ifndef DTV_STAT_LOCK_TIME
+#define DTV_STAT_LOCK_TIME	(DTV_PRIVATE_BASE + 0)
+#endif
+
+#ifndef DTV_STAT_STATUS_READS
+#define DTV_STAT_STATUS_READS	(DTV_PRIVATE_BASE + 1)
+#endif
+
 int verbose = 0;
 
 static int dvbfe_spectral_inversion_to_kapi[][2] =
@@ -61,6 +99,15 @@ static int dvbfe_code_rate_to_kapi[][2] =
 	{ -1, -1 }
 };
 
+static int dvbfe_dvbs_mod_to_kapi[][2] =
+{
+	{ DVBFE_DVBS_MOD_QPSK, QPSK },
+	{ DVBFE_DVBS_MOD_8PSK, PSK_8 },
+	{ DVBFE_DVBS_MOD_16APSK, APSK_16 },
+	{ DVBFE_DVBS_MOD_32APSK, APSK_32 },
+	{ -1, -1 }
+};
+
 static int dvbfe_dvbt_const_to_kapi[][2] =
 {
 	{ DVBFE_DVBT_CONST_QPSK, FE_QPSK },
@@ -293,6 +340,8 @@ extern int dvbfe_get_info(struct dvbfe_handle *fehandle,
 			result->feparams.u.dvbs.symbol_rate = kevent.parameters.u.qpsk.symbol_rate;
 			result->feparams.u.dvbs.fec_inner =
 				lookupval(kevent.parameters.u.qpsk.fec_inner, 1, dvbfe_code_rate_to_kapi);
+			result->feparams.u.dvbs.dvbs2 = 0;
+			result->feparams.u.dvbs.modulation = DVBFE_DVBS_MOD_QPSK;
 			break;
 
 		case FE_QAM:
@@ -343,11 +392,72 @@ extern int dvbfe_get_info(struct dvbfe_handle *fehandle,
 		if (!ioctl(fehandle->fd, FE_READ_UNCORRECTED_BLOCKS, &result->ucblocks))
 			returnval |= DVBFE_INFO_UNCORRECTED_BLOCKS;
 	}
+	if (querymask & DVBFE_INFO_LOCK_TIME) {
+		struct dtv_property prop;
+		struct dtv_properties props;
+
+		memset(&prop, 0, sizeof(prop));
+		prop.cmd = DTV_STAT_LOCK_TIME;
+		props.num = 1;
+		props.props = &prop;
+		if ((!ioctl(fehandle->fd, FE_GET_PROPERTY, &props)) &&
+		    (prop.u.st.len > 0) &&
+		    (prop.u.st.stat[0].scale == FE_SCALE_COUNTER)) {
+			result->lock_time = prop.u.st.stat[0].uvalue;
+			returnval |= DVBFE_INFO_LOCK_TIME;
+		}
+	}
+	if (querymask & DVBFE_INFO_STATUS_READS) {
+		struct dtv_property prop;
+		struct dtv_properties props;
+
+		memset(&prop, 0, sizeof(prop));
+		prop.cmd = DTV_STAT_STATUS_READS;
+		props.num = 1;
+		props.props = &prop;
+		if ((!ioctl(fehandle->fd, FE_GET_PROPERTY, &props)) &&
+		    (prop.u.st.len > 0) &&
+		    (prop.u.st.stat[0].scale == FE_SCALE_COUNTER)) {
+			result->status_reads = prop.u.st.stat[0].uvalue;
+			returnval |= DVBFE_INFO_STATUS_READS;
+		}
+	}
 
 	// done
 	return returnval;
 }
 
+static int dvbfe_set_dvbs2(struct dvbfe_handle *fehandle,
+			   struct dvbfe_parameters *params)
+{
+	struct dtv_property prop[9];
+	struct dtv_properties props;
+	int i = 0;
+
+	// DVB-S2 can only be tuned through the property interface
+	memset(prop, 0, sizeof(prop));
+	prop[i++].cmd = DTV_CLEAR;
+	prop[i].cmd = DTV_DELIVERY_SYSTEM;
+	prop[i++].u.data = SYS_DVBS2;
+	prop[i].cmd = DTV_FREQUENCY;
+	prop[i++].u.data = params->frequency;
+	prop[i].cmd = DTV_SYMBOL_RATE;
+	prop[i++].u.data = params->u.dvbs.symbol_rate;
+	prop[i].cmd = DTV_INNER_FEC;
+	prop[i++].u.data = lookupval(params->u.dvbs.fec_inner, 0, dvbfe_code_rate_to_kapi);
+	prop[i].cmd = DTV_MODULATION;
+	prop[i++].u.data = lookupval(params->u.dvbs.modulation, 0, dvbfe_dvbs_mod_to_kapi);
+	prop[i].cmd = DTV_INVERSION;
+	prop[i++].u.data = lookupval(params->inversion, 0, dvbfe_spectral_inversion_to_kapi);
+	prop[i].cmd = DTV_PILOT;
+	prop[i++].u.data = PILOT_AUTO;
+	prop[i++].cmd = DTV_TUNE;
+	props.num = i;
+	props.props = prop;
+
+	return ioctl(fehandle->fd, FE_SET_PROPERTY, &props);
+}
+
 int dvbfe_set(struct dvbfe_handle *fehandle,
 	      struct dvbfe_parameters *params,
 	      int timeout)
@@ -393,7 +503,10 @@ int dvbfe_set(struct dvbfe_handle *fehandle,
 	}
 
 	// set it and check for error
-	res = ioctl(fehandle->fd, FE_SET_FRONTEND, &kparams);
+	if ((fehandle->type == DVBFE_TYPE_DVBS) && params->u.dvbs.dvbs2)
+		res = dvbfe_set_dvbs2(fehandle, params);
+	else
+		res = ioctl(fehandle->fd, FE_SET_FRONTEND, &kparams);
 	if (res)
 		return res;
 
@@ -572,3 +685,50 @@ int dvbfe_diseqc_read(struct dvbfe_handle *fehandle, int timeout, unsigned char
 
 	return len;
 }
+
+int dvbfe_blind_scan(struct dvbfe_handle *fehandle,
+		     uint32_t frequency_min, uint32_t frequency_max,
+		     uint32_t frequency_step,
+		     uint32_t symbol_rate_min, uint32_t symbol_rate_max,
+		     struct dvbfe_carrier *carriers, int max_carriers)
+{
+	struct dvb_blindscan *scan;
+	int i;
+	int val;
+
+	scan = malloc(sizeof(struct dvb_blindscan));
+	if (scan == NULL)
+		return -ENOMEM;
+	memset(scan, 0, sizeof(struct dvb_blindscan));
+	scan->frequency_min = frequency_min;
+	scan->frequency_max = frequency_max;
+	scan->frequency_step = frequency_step;
+	scan->symbol_rate_min = symbol_rate_min;
+	scan->symbol_rate_max = symbol_rate_max;
+
+	if (ioctl(fehandle->fd, FE_BLIND_SCAN, scan)) {
+		val = -errno;
+		print(verbose, ERROR, 1, "IOCTL failed");
+		free(scan);
+		return val;
+	}
+
+	for(i=0; (i < (int) scan->count) && (i < max_carriers); i++) {
+		struct dvb_blindscan_carrier *kcarrier = &scan->carriers[i];
+
+		memset(&carriers[i], 0, sizeof(struct dvbfe_carrier));
+		carriers[i].frequency = kcarrier->frequency;
+		carriers[i].symbol_rate = kcarrier->symbol_rate;
+		carriers[i].dvbs2 = (kcarrier->delivery_system == SYS_DVBS2);
+
+		val = lookupval(kcarrier->modulation, 1, dvbfe_dvbs_mod_to_kapi);
+		carriers[i].modulation = (val == -1) ? DVBFE_DVBS_MOD_QPSK : val;
+		val = lookupval(kcarrier->fec_inner, 1, dvbfe_code_rate_to_kapi);
+		carriers[i].fec_inner = (val == -1) ? DVBFE_FEC_AUTO : val;
+		val = lookupval(kcarrier->inversion, 1, dvbfe_spectral_inversion_to_kapi);
+		carriers[i].inversion = (val == -1) ? DVBFE_INVERSION_AUTO : val;
+	}
+
+	free(scan);
+	return i;
+}
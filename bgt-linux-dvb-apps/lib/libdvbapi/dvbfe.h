@@ -115,8 +115,17 @@ enum dvbfe_dvbt_hierarchy {
 	DVBFE_DVBT_HIERARCHY_AUTO
 };
 
+enum dvbfe_dvbs_mod {
+	DVBFE_DVBS_MOD_QPSK,
+	DVBFE_DVBS_MOD_8PSK,
+	DVBFE_DVBS_MOD_16APSK,
+	DVBFE_DVBS_MOD_32APSK,
+};
+
 /**
- * Structure used to store and communicate frontend parameters.
+ * Structure used to store and communicate frontend parameters. For DVB-S,
+ * dvbs2 must be cleared unless the transponder is DVB-S2; modulation is
+ * only used for DVB-S2.
  */
 struct dvbfe_parameters {
 	uint32_t frequency;
@@ -125,6 +134,8 @@ struct dvbfe_parameters {
 		struct {
 			uint32_t			symbol_rate;
 			enum dvbfe_code_rate		fec_inner;
+			int				dvbs2;
+			enum dvbfe_dvbs_mod		modulation;
 		} dvbs;
 
 		struct {
@@ -165,6 +176,18 @@ enum dvbfe_sec_mini_cmd {
 	DVBFE_SEC_MINI_B
 };
 
+/**
+ * A carrier found by dvbfe_blind_scan().
+ */
+struct dvbfe_carrier {
+	uint32_t frequency;			/* IF in kHz */
+	uint32_t symbol_rate;
+	unsigned int dvbs2 : 1;
+	enum dvbfe_dvbs_mod modulation;
+	enum dvbfe_code_rate fec_inner;		/* DVBFE_FEC_AUTO if not representable */
+	enum dvbfe_spectral_inversion inversion;
+};
+
 /**
  * Mask of values used in the dvbfe_get_info() call.
  */
@@ -175,6 +198,8 @@ enum dvbfe_info_mask {
 	DVBFE_INFO_SIGNAL_STRENGTH		= 0x08,
 	DVBFE_INFO_SNR				= 0x10,
 	DVBFE_INFO_UNCORRECTED_BLOCKS		= 0x20,
+	DVBFE_INFO_LOCK_TIME			= 0x40,
+	DVBFE_INFO_STATUS_READS			= 0x80,
 };
 
 /**
@@ -193,6 +218,10 @@ struct dvbfe_info {
 	uint16_t signal_strength;		/* DVBFE_INFO_SIGNAL_STRENGTH */
 	uint16_t snr;				/* DVBFE_INFO_SNR */
 	uint32_t ucblocks;			/* DVBFE_INFO_UNCORRECTED_BLOCKS */
+	uint32_t lock_time;			/* DVBFE_INFO_LOCK_TIME: ms from tuning to lock,
+						   if the driver measures it */
+	uint32_t status_reads;			/* DVBFE_INFO_STATUS_READS: hardware status
+						   reads by the kernel in the last minute */
 };
 
 /**
@@ -326,6 +355,28 @@ extern int dvbfe_do_diseqc_command(struct dvbfe_handle *handle, uint8_t *data, u
  */
 extern int dvbfe_diseqc_read(struct dvbfe_handle *fehandle, int timeout, unsigned char *buf, unsigned int len);
 
+/**
+ * Run the frontend's blind search over a range of a satellite IF, returning
+ * the carriers found. LNB power and band must already be set up. This can
+ * take several seconds for a full band; the frontend must be retuned after.
+ *
+ * @param fehandle Handle opened with dvbfe_open().
+ * @param frequency_min Start of the range, IF in kHz.
+ * @param frequency_max End of the range, IF in kHz.
+ * @param frequency_step Search step in kHz.
+ * @param symbol_rate_min Lowest symbol rate to report.
+ * @param symbol_rate_max Highest symbol rate to report.
+ * @param carriers Where to put the carriers found.
+ * @param max_carriers Number of entries in carriers.
+ * @return Number of carriers found, or <0 on failure (-EOPNOTSUPP if the
+ * frontend has no blind search).
+ */
+extern int dvbfe_blind_scan(struct dvbfe_handle *fehandle,
+			    uint32_t frequency_min, uint32_t frequency_max,
+			    uint32_t frequency_step,
+			    uint32_t symbol_rate_min, uint32_t symbol_rate_max,
+			    struct dvbfe_carrier *carriers, int max_carriers);
+
 #ifdef __cplusplus
 }
 #endif
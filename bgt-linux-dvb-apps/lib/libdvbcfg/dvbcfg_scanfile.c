@@ -187,6 +187,9 @@ int dvbcfg_scanfile_parse(FILE *file, dvbcfg_scancallback callback, void *privat
 
 		case DVBFE_TYPE_DVBS:
 
+			/* DVB-S2 is not described by scan files */
+			tmp.fe_params.u.dvbs.dvbs2 = 0;
+
 			/* parse frequency */
 			tmp.fe_params.frequency = dvbcfg_parse_int(&line_pos, " ");
 			if (!line_pos)
@@ -202,6 +202,9 @@ int dvbcfg_zapchannel_parse(FILE *file, dvbcfg_zapcallback callback, void *priva
 			/* fec */
 			tmp.fe_params.u.dvbs.fec_inner = DVBFE_FEC_AUTO;
 
+			/* DVB-S2 is not described by channels.conf */
+			tmp.fe_params.u.dvbs.dvbs2 = 0;
+
 			/* polarization */
 			tmp.polarization = tolower(dvbcfg_parse_char(&line_pos, ":"));
 			if (!line_pos)
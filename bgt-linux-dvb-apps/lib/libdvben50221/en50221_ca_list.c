@@ -0,0 +1,377 @@
+/*
+	en50221 encoder An implementation for libdvb
+	an implementation for the en50221 transport layer
+
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as
+	published by the Free Software Foundation; either version 2.1 of
+	the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+*/
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <libdvbmisc/dvbmisc.h>
+#include "en50221_ca_list.h"
+
+// a PMT section is at most 1024 bytes, and the ca_pmt is never larger
+#define CA_LIST_MAX_CA_PMT 4096
+
+struct en50221_ca_list_service {
+	uint16_t program_number;
+	int version;			// version_number << 1 | current_next, -1 if unused
+	int selected;
+	uint32_t last_used;
+
+	uint8_t *ca_pmt;
+	uint32_t ca_pmt_length;
+};
+
+struct en50221_ca_list {
+	struct en50221_ca_list_service *services;
+	uint32_t max_services;
+	uint32_t selected_count;
+	uint32_t clock;
+
+	int move_ca_descriptors;
+	uint8_t ca_pmt_cmd_id;
+	int connected;
+
+	en50221_ca_list_send_callback callback;
+	void *callback_arg;
+
+	struct en50221_ca_list_stats stats;
+
+	pthread_mutex_t lock;
+};
+
+static struct en50221_ca_list_service *en50221_ca_list_find(struct en50221_ca_list *list,
+							    uint16_t program_number);
+static struct en50221_ca_list_service *en50221_ca_list_alloc(struct en50221_ca_list *list);
+static void en50221_ca_list_set_cmd_id(uint8_t *ca_pmt, uint32_t ca_pmt_length,
+				       uint8_t ca_pmt_cmd_id);
+static int en50221_ca_list_send(struct en50221_ca_list *list,
+				struct en50221_ca_list_service *service,
+				uint8_t ca_pmt_list_management,
+				uint8_t ca_pmt_cmd_id);
+
+
+
+struct en50221_ca_list *en50221_ca_list_create(uint32_t max_services,
+					       int move_ca_descriptors,
+					       uint8_t ca_pmt_cmd_id,
+					       en50221_ca_list_send_callback callback,
+					       void *arg)
+{
+	struct en50221_ca_list *list = NULL;
+	uint32_t i;
+
+	if (max_services == 0)
+		return NULL;
+
+	// create structure and set it up
+	list = malloc(sizeof(struct en50221_ca_list));
+	if (list == NULL) {
+		return NULL;
+	}
+	memset(list, 0, sizeof(struct en50221_ca_list));
+
+	list->services = malloc(sizeof(struct en50221_ca_list_service) * max_services);
+	if (list->services == NULL) {
+		free(list);
+		return NULL;
+	}
+	memset(list->services, 0, sizeof(struct en50221_ca_list_service) * max_services);
+	for (i = 0; i < max_services; i++)
+		list->services[i].version = -1;
+
+	list->max_services = max_services;
+	list->move_ca_descriptors = move_ca_descriptors;
+	list->ca_pmt_cmd_id = ca_pmt_cmd_id;
+	list->callback = callback;
+	list->callback_arg = arg;
+
+	pthread_mutex_init(&list->lock, NULL);
+
+	// done
+	return list;
+}
+
+void en50221_ca_list_destroy(struct en50221_ca_list *list)
+{
+	uint32_t i;
+
+	for (i = 0; i < list->max_services; i++)
+		free(list->services[i].ca_pmt);
+	free(list->services);
+
+	pthread_mutex_destroy(&list->lock);
+	free(list);
+}
+
+int en50221_ca_list_set_pmt(struct en50221_ca_list *list,
+			    struct mpeg_pmt_section *pmt)
+{
+	struct en50221_ca_list_service *service;
+	uint16_t program_number = mpeg_pmt_section_program_number(pmt);
+	int version = (pmt->head.version_number << 1) | pmt->head.current_next_indicator;
+	uint8_t buf[CA_LIST_MAX_CA_PMT];
+	uint8_t list_management;
+	int size;
+	int result = 0;
+
+	pthread_mutex_lock(&list->lock);
+
+	// find the service, or somewhere to keep it
+	service = en50221_ca_list_find(list, program_number);
+	if (service == NULL) {
+		if ((service = en50221_ca_list_alloc(list)) == NULL) {
+			print(LOG_LEVEL, ERROR, 1, "No room for service %i\n", program_number);
+			result = -1;
+			goto exit;
+		}
+		service->program_number = program_number;
+	}
+	service->last_used = ++list->clock;
+
+	// nothing changed?
+	if (service->selected && (service->version == version))
+		goto exit;
+
+	// format the ca_pmt unless the cached one is for this version
+	if (service->version != version) {
+		if ((size = en50221_ca_format_pmt(pmt, buf, sizeof(buf),
+						  list->move_ca_descriptors,
+						  CA_LIST_MANAGEMENT_ONLY,
+						  list->ca_pmt_cmd_id)) < 0) {
+			print(LOG_LEVEL, ERROR, 1, "Failed to format PMT for service %i\n", program_number);
+			service->version = -1;
+			result = -1;
+			goto exit;
+		}
+
+		if ((uint32_t) size != service->ca_pmt_length) {
+			free(service->ca_pmt);
+			service->ca_pmt_length = 0;
+			if ((service->ca_pmt = malloc(size)) == NULL) {
+				service->version = -1;
+				if (service->selected) {
+					service->selected = 0;
+					list->selected_count--;
+				}
+				result = -1;
+				goto exit;
+			}
+		}
+		memcpy(service->ca_pmt, buf, size);
+		service->ca_pmt_length = size;
+		service->version = version;
+		list->stats.formatted++;
+	} else {
+		list->stats.reused++;
+	}
+
+	// work out how to tell the CAM
+	if (service->selected) {
+		list_management = CA_LIST_MANAGEMENT_UPDATE;
+	} else {
+		list_management = list->selected_count ? CA_LIST_MANAGEMENT_ADD : CA_LIST_MANAGEMENT_ONLY;
+		service->selected = 1;
+		list->selected_count++;
+	}
+
+	if (list->connected)
+		result = en50221_ca_list_send(list, service, list_management, list->ca_pmt_cmd_id);
+
+exit:
+	pthread_mutex_unlock(&list->lock);
+	return result;
+}
+
+int en50221_ca_list_remove(struct en50221_ca_list *list,
+			   uint16_t program_number)
+{
+	struct en50221_ca_list_service *service;
+	int result = 0;
+
+	pthread_mutex_lock(&list->lock);
+
+	service = en50221_ca_list_find(list, program_number);
+	if ((service == NULL) || (!service->selected)) {
+		result = -1;
+		goto exit;
+	}
+	service->selected = 0;
+	service->last_used = ++list->clock;
+	list->selected_count--;
+
+	// keep the ca_pmt in the cache in case the service comes back
+	if (list->connected) {
+		list->stats.reused++;
+		result = en50221_ca_list_send(list, service, CA_LIST_MANAGEMENT_UPDATE,
+					      CA_PMT_CMD_ID_NOT_SELECTED);
+	}
+
+exit:
+	pthread_mutex_unlock(&list->lock);
+	return result;
+}
+
+int en50221_ca_list_connect(struct en50221_ca_list *list)
+{
+	uint32_t i;
+	uint32_t pos = 0;
+	uint8_t list_management;
+	int result = 0;
+
+	pthread_mutex_lock(&list->lock);
+
+	list->connected = 1;
+	for (i = 0; i < list->max_services; i++) {
+		struct en50221_ca_list_service *service = &list->services[i];
+
+		if (!service->selected)
+			continue;
+
+		if (list->selected_count == 1)
+			list_management = CA_LIST_MANAGEMENT_ONLY;
+		else if (pos == 0)
+			list_management = CA_LIST_MANAGEMENT_FIRST;
+		else if (pos == list->selected_count - 1)
+			list_management = CA_LIST_MANAGEMENT_LAST;
+		else
+			list_management = CA_LIST_MANAGEMENT_MORE;
+		pos++;
+
+		list->stats.reused++;
+		if (en50221_ca_list_send(list, service, list_management, list->ca_pmt_cmd_id) < 0) {
+			result = -1;
+			break;
+		}
+		result++;
+	}
+
+	pthread_mutex_unlock(&list->lock);
+	return result;
+}
+
+void en50221_ca_list_disconnect(struct en50221_ca_list *list)
+{
+	pthread_mutex_lock(&list->lock);
+	list->connected = 0;
+	pthread_mutex_unlock(&list->lock);
+}
+
+int en50221_ca_list_count(struct en50221_ca_list *list)
+{
+	int count;
+
+	pthread_mutex_lock(&list->lock);
+	count = list->selected_count;
+	pthread_mutex_unlock(&list->lock);
+
+	return count;
+}
+
+void en50221_ca_list_get_stats(struct en50221_ca_list *list,
+			       struct en50221_ca_list_stats *stats)
+{
+	pthread_mutex_lock(&list->lock);
+	memcpy(stats, &list->stats, sizeof(struct en50221_ca_list_stats));
+	pthread_mutex_unlock(&list->lock);
+}
+
+static struct en50221_ca_list_service *en50221_ca_list_find(struct en50221_ca_list *list,
+							    uint16_t program_number)
+{
+	uint32_t i;
+
+	for (i = 0; i < list->max_services; i++) {
+		if ((list->services[i].ca_pmt != NULL) &&
+		    (list->services[i].program_number == program_number))
+			return &list->services[i];
+	}
+
+	return NULL;
+}
+
+static struct en50221_ca_list_service *en50221_ca_list_alloc(struct en50221_ca_list *list)
+{
+	struct en50221_ca_list_service *lru = NULL;
+	uint32_t i;
+
+	// use a free entry, or else the least recently used unselected one
+	for (i = 0; i < list->max_services; i++) {
+		struct en50221_ca_list_service *service = &list->services[i];
+
+		if (service->ca_pmt == NULL)
+			return service;
+		if (service->selected)
+			continue;
+		if ((lru == NULL) || (service->last_used < lru->last_used))
+			lru = service;
+	}
+	if (lru == NULL)
+		return NULL;
+
+	free(lru->ca_pmt);
+	lru->ca_pmt = NULL;
+	lru->ca_pmt_length = 0;
+	lru->version = -1;
+	return lru;
+}
+
+static void en50221_ca_list_set_cmd_id(uint8_t *ca_pmt, uint32_t ca_pmt_length,
+				       uint8_t ca_pmt_cmd_id)
+{
+	uint32_t pos = 6;
+	uint32_t info_length;
+
+	// the ca_pmt_cmd_id leads each non-empty descriptor loop
+	info_length = ((ca_pmt[4] & 0x0f) << 8) | ca_pmt[5];
+	if (info_length)
+		ca_pmt[pos] = ca_pmt_cmd_id;
+	pos += info_length;
+
+	while ((pos + 5) <= ca_pmt_length) {
+		info_length = ((ca_pmt[pos + 3] & 0x0f) << 8) | ca_pmt[pos + 4];
+		pos += 5;
+		if (info_length && (pos < ca_pmt_length))
+			ca_pmt[pos] = ca_pmt_cmd_id;
+		pos += info_length;
+	}
+}
+
+static int en50221_ca_list_send(struct en50221_ca_list *list,
+				struct en50221_ca_list_service *service,
+				uint8_t ca_pmt_list_management,
+				uint8_t ca_pmt_cmd_id)
+{
+	int result;
+
+	service->ca_pmt[0] = ca_pmt_list_management;
+	if (ca_pmt_cmd_id != list->ca_pmt_cmd_id)
+		en50221_ca_list_set_cmd_id(service->ca_pmt, service->ca_pmt_length, ca_pmt_cmd_id);
+
+	result = list->callback(list->callback_arg, service->ca_pmt, service->ca_pmt_length);
+
+	// the cached copy always holds the ca_pmt_cmd_id of selected services
+	if (ca_pmt_cmd_id != list->ca_pmt_cmd_id)
+		en50221_ca_list_set_cmd_id(service->ca_pmt, service->ca_pmt_length, list->ca_pmt_cmd_id);
+
+	if (result)
+		return -1;
+	list->stats.sent++;
+	return 1;
+}
@@ -0,0 +1,158 @@
+/*
+	en50221 encoder An implementation for libdvb
+	an implementation for the en50221 transport layer
+
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as
+	published by the Free Software Foundation; either version 2.1 of
+	the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+*/
+
+#ifndef EN50221_CA_LIST_H
+#define EN50221_CA_LIST_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <libdvben50221/en50221_app_ca.h>
+#include <libucsi/mpeg/pmt_section.h>
+
+/**
+ * The CA list keeps the set of services a CAM slot should descramble, and
+ * turns changes to that set into ca_pmt objects using the list management
+ * modes of EN50221 8.4.3.4:
+ *
+ * - connecting sends the whole set, as ONLY or as FIRST, MORE..., LAST.
+ * - a service joining a non-empty set is sent with ADD.
+ * - a new PMT version for a service in the set is sent with UPDATE.
+ * - a service leaving the set is sent with UPDATE and the NOT_SELECTED
+ *   ca_pmt_cmd_id.
+ *
+ * Each service's ca_pmt is formatted once per PMT version and kept, so that
+ * resending it, or re-adding a service that was removed, only patches the
+ * list management and ca_pmt_cmd_id fields. Removed services stay cached
+ * until their entry is needed for another service.
+ *
+ * All functions may be called from any thread.
+ */
+struct en50221_ca_list;
+
+/**
+ * Type definition for send - called to pass a ca_pmt object to the CAM,
+ * normally with en50221_app_ca_pmt().
+ *
+ * @param arg Private argument.
+ * @param ca_pmt The ca_pmt object, as formatted by en50221_ca_format_pmt().
+ * @param ca_pmt_length Length of the object in bytes.
+ * @return 0 on success, -1 on failure.
+ */
+typedef int (*en50221_ca_list_send_callback) (void *arg,
+					      uint8_t *ca_pmt,
+					      uint32_t ca_pmt_length);
+
+/**
+ * Counters kept by a CA list.
+ */
+struct en50221_ca_list_stats {
+	uint32_t formatted;	/* ca_pmt objects formatted from a PMT */
+	uint32_t reused;	/* ca_pmt objects sent from the cache */
+	uint32_t sent;		/* ca_pmt objects passed to the send callback */
+};
+
+/**
+ * Create a CA list.
+ *
+ * @param max_services Number of services to keep, including removed ones
+ * kept in the cache.
+ * @param move_ca_descriptors Passed to en50221_ca_format_pmt().
+ * @param ca_pmt_cmd_id One of the CA_PMT_CMD_ID_*, used for selected services.
+ * @param callback Callback used to send ca_pmt objects.
+ * @param arg Private argument for the callback.
+ * @return The new instance, or NULL on error.
+ */
+extern struct en50221_ca_list *en50221_ca_list_create(uint32_t max_services,
+						      int move_ca_descriptors,
+						      uint8_t ca_pmt_cmd_id,
+						      en50221_ca_list_send_callback callback,
+						      void *arg);
+
+/**
+ * Destroy a CA list.
+ *
+ * @param list The instance.
+ */
+extern void en50221_ca_list_destroy(struct en50221_ca_list *list);
+
+/**
+ * Add a service to the set, or pass a new PMT for one already in it. Nothing
+ * is sent if the PMT version is the one already sent, or if the list is not
+ * connected.
+ *
+ * @param list The instance.
+ * @param pmt The PMT of the service.
+ * @return 1 if a ca_pmt was sent, 0 if there was nothing to send, or -1 on
+ * error.
+ */
+extern int en50221_ca_list_set_pmt(struct en50221_ca_list *list,
+				   struct mpeg_pmt_section *pmt);
+
+/**
+ * Remove a service from the set.
+ *
+ * @param list The instance.
+ * @param program_number Program number of the service.
+ * @return 1 if a ca_pmt was sent, 0 if there was nothing to send, or -1 on
+ * error (including the service not being in the set).
+ */
+extern int en50221_ca_list_remove(struct en50221_ca_list *list,
+				  uint16_t program_number);
+
+/**
+ * Mark the CA resource as connected, and send it the whole set. Call this
+ * whenever a new CA session is opened.
+ *
+ * @param list The instance.
+ * @return Number of ca_pmt objects sent, or -1 on error.
+ */
+extern int en50221_ca_list_connect(struct en50221_ca_list *list);
+
+/**
+ * Mark the CA resource as gone. Changes are tracked but not sent until the
+ * next en50221_ca_list_connect().
+ *
+ * @param list The instance.
+ */
+extern void en50221_ca_list_disconnect(struct en50221_ca_list *list);
+
+/**
+ * @param list The instance.
+ * @return Number of services in the set.
+ */
+extern int en50221_ca_list_count(struct en50221_ca_list *list);
+
+/**
+ * Retrieve the counters.
+ *
+ * @param list The instance.
+ * @param stats Where to put them.
+ */
+extern void en50221_ca_list_get_stats(struct en50221_ca_list *list,
+				      struct en50221_ca_list_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,1120 @@
+/*
+	libdvbepg - an EPG store for libucsi
+
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This library is free software; you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as
+	published by the Free Software Foundation; either version 2.1 of
+	the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libucsi/dvb/descriptor.h>
+#include <libucsi/dvb/text.h>
+#include <libucsi/atsc/types.h>
+#include "dvbepg_store.h"
+
+#define SNAPSHOT_MAGIC "DVBEPGS\n"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_ALIGN(x) (((x) + 7) & ~((uint64_t) 7))
+
+#define POOL_MIN 4096
+#define POOL_HASH_MIN 1024
+
+/* a DVB string is at most 255 bytes, and expands to at most 3 bytes each */
+#define TEXT_MAX ((255 * 3) + 1)
+
+enum epg_column {
+	COL_START,
+	COL_DURATION,
+	COL_TITLE,
+	COL_TEXT,
+	COL_EVENT_ID,
+	COL_VERSION,
+	COLUMNS,
+};
+
+static const size_t column_size[COLUMNS] = {
+	sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t),
+	sizeof(uint32_t), sizeof(uint16_t), sizeof(uint16_t),
+};
+
+struct epg_service {
+	struct dvbepg_service_key key;
+	uint32_t count;
+	uint32_t max;			// 0 while the columns are in the snapshot
+
+	// sorted by start, the events never overlap
+	uint32_t *start;
+	uint32_t *duration;
+	uint32_t *title;		// string pool offsets, 0 is ""
+	uint32_t *text;
+	uint16_t *event_id;
+	uint16_t *version;		// table_id << 8 | version_number
+};
+
+struct epg_pool {
+	char *buf;
+	uint32_t size;
+	uint32_t max;			// 0 while the pool is in the snapshot
+
+	// offsets of the strings, 0 for a free slot; built on first use
+	uint32_t *hash;
+	uint32_t hash_size;
+	uint32_t hash_count;
+};
+
+struct dvbepg_store {
+	struct epg_service *services;	// sorted by key
+	uint32_t service_count;
+	uint32_t service_max;
+	uint32_t last;			// index of the service used most recently
+
+	struct epg_pool pool;
+	int changed;			// since it was loaded or saved
+
+	struct dvbepg_store_stats stats;
+
+	struct dvb_text_decoder *decoder;
+	uint8_t *atsc_buf;
+	size_t atsc_buf_size;
+
+	void *map;
+	size_t map_size;
+};
+
+/*
+ * Snapshot layout: the header, the service table, then each column for
+ * all events (service after service), then the string pool. Every part
+ * starts 8 byte aligned.
+ */
+struct snapshot_header {
+	char magic[8];
+	uint32_t byte_order;
+	uint32_t version;
+	uint32_t service_count;
+	uint32_t event_count;
+	uint32_t pool_size;
+	uint32_t reserved;
+	uint64_t services_offset;
+	uint64_t column_offset[COLUMNS];
+	uint64_t pool_offset;
+	uint64_t file_size;
+};
+
+struct snapshot_service {
+	uint16_t original_network_id;
+	uint16_t transport_stream_id;
+	uint16_t service_id;
+	uint16_t reserved;
+	uint32_t first;
+	uint32_t count;
+};
+
+static int pool_init(struct epg_pool *pool);
+static void pool_free(struct epg_pool *pool);
+static int pool_intern(struct epg_pool *pool, const char *str, uint32_t *offset);
+static uint32_t pool_find(struct epg_pool *pool, const char *str);
+static struct epg_service *store_find_service(struct dvbepg_store *store,
+					      struct dvbepg_service_key *key,
+					      int create);
+static int store_compact(struct dvbepg_store *store);
+static int key_cmp(struct dvbepg_service_key *a, struct dvbepg_service_key *b);
+static void *service_column(struct epg_service *svc, int col);
+static void service_set_column(struct epg_service *svc, int col, void *column);
+static int service_reserve(struct epg_service *svc, uint32_t max);
+static void service_remove(struct epg_service *svc, uint32_t pos, uint32_t count);
+static void service_insert(struct epg_service *svc, uint32_t pos);
+static int service_find_event(struct epg_service *svc, uint16_t event_id, uint32_t start);
+static uint32_t service_upper_bound(struct epg_service *svc, int64_t when);
+static void event_info(struct dvbepg_store *store, struct epg_service *svc, uint32_t idx,
+		       struct dvbepg_event_info *info);
+static void no_event(struct dvbepg_event_info *info);
+static int write_at(FILE *f, uint64_t *pos, uint64_t offset, const void *buf, size_t len);
+
+
+
+struct dvbepg_store *dvbepg_store_create(void)
+{
+	struct dvbepg_store *store;
+
+	if ((store = malloc(sizeof(struct dvbepg_store))) == NULL)
+		return NULL;
+	memset(store, 0, sizeof(struct dvbepg_store));
+
+	if (pool_init(&store->pool)) {
+		free(store);
+		return NULL;
+	}
+
+	return store;
+}
+
+void dvbepg_store_destroy(struct dvbepg_store *store)
+{
+	uint32_t i;
+	int col;
+
+	for (i = 0; i < store->service_count; i++) {
+		if (store->services[i].max == 0)
+			continue;
+		for (col = 0; col < COLUMNS; col++)
+			free(service_column(&store->services[i], col));
+	}
+	free(store->services);
+	pool_free(&store->pool);
+
+	if (store->decoder)
+		dvb_text_decoder_destroy(store->decoder);
+	free(store->atsc_buf);
+
+	if (store->map)
+		munmap(store->map, store->map_size);
+	free(store);
+}
+
+int dvbepg_store_add_event(struct dvbepg_store *store,
+			   struct dvbepg_service_key *key,
+			   uint8_t table_id,
+			   uint8_t version,
+			   uint16_t event_id,
+			   time_t start_time,
+			   uint32_t duration,
+			   const char *title,
+			   const char *text)
+{
+	struct epg_service *svc;
+	uint16_t table_version = (table_id << 8) | version;
+	uint32_t start;
+	uint32_t title_offset;
+	uint32_t text_offset;
+	uint64_t end;
+	uint32_t pos, last;
+	int idx;
+
+	// the store keeps 32 bit unsigned times
+	if ((start_time < 0) || ((uint64_t) start_time > UINT32_MAX))
+		return 0;
+	start = start_time;
+
+	if ((svc = store_find_service(store, key, 1)) == NULL)
+		return -1;
+
+	// the carousel came round again?
+	idx = service_find_event(svc, event_id, start);
+	if ((idx >= 0) && (svc->version[idx] == table_version)) {
+		store->stats.unchanged++;
+		return 0;
+	}
+
+	if (pool_intern(&store->pool, title, &title_offset) ||
+	    pool_intern(&store->pool, text, &text_offset))
+		return -1;
+	if (service_reserve(svc, svc->count + 1))
+		return -1;
+	store->changed = 1;
+
+	// the same event from another table, or a new version not changing it
+	if ((idx >= 0) &&
+	    (svc->start[idx] == start) &&
+	    (svc->duration[idx] == duration) &&
+	    (svc->title[idx] == title_offset) &&
+	    (svc->text[idx] == text_offset)) {
+		svc->version[idx] = table_version;
+		store->stats.unchanged++;
+		return 0;
+	}
+
+	if (idx >= 0) {
+		service_remove(svc, idx, 1);
+		store->stats.updated++;
+	} else {
+		store->stats.added++;
+	}
+
+	// drop the events this one overlaps; zero length events take a second
+	end = (uint64_t) start + (duration ? duration : 1);
+	pos = service_upper_bound(svc, start);
+	while ((pos > 0) &&
+	       (((uint64_t) svc->start[pos - 1] + (svc->duration[pos - 1] ? svc->duration[pos - 1] : 1)) > start))
+		pos--;
+	for (last = pos; (last < svc->count) && (svc->start[last] < end); last++)
+		;
+	if (last > pos) {
+		service_remove(svc, pos, last - pos);
+		store->stats.overlapped += last - pos;
+	}
+
+	service_insert(svc, pos);
+	svc->start[pos] = start;
+	svc->duration[pos] = duration;
+	svc->title[pos] = title_offset;
+	svc->text[pos] = text_offset;
+	svc->event_id[pos] = event_id;
+	svc->version[pos] = table_version;
+
+	return 1;
+}
+
+int dvbepg_store_add_dvb_eit(struct dvbepg_store *store,
+			     struct dvb_eit_section *eit)
+{
+	struct dvbepg_service_key key;
+	struct dvb_eit_event *cur_event;
+	struct descriptor *curd;
+	char title[TEXT_MAX];
+	char text[TEXT_MAX];
+	int changed = 0;
+	int result;
+
+	if ((store->decoder == NULL) &&
+	    ((store->decoder = dvb_text_decoder_create(NULL)) == NULL))
+		return -1;
+
+	key.original_network_id = eit->original_network_id;
+	key.transport_stream_id = eit->transport_stream_id;
+	key.service_id = dvb_eit_section_service_id(eit);
+
+	dvb_eit_section_events_for_each(eit, cur_event) {
+		title[0] = 0;
+		text[0] = 0;
+
+		dvb_eit_event_descriptors_for_each(cur_event, curd) {
+			struct dvb_short_event_descriptor *dx;
+			struct dvb_short_event_descriptor_part2 *part2;
+
+			if (curd->tag != dtag_dvb_short_event)
+				continue;
+			if ((dx = dvb_short_event_descriptor_codec(curd)) == NULL)
+				continue;
+			part2 = dvb_short_event_descriptor_part2(dx);
+
+			if (dvb_text_decode(store->decoder,
+					    dvb_short_event_descriptor_event_name(dx), dx->event_name_length,
+					    title, sizeof(title), 0) < 0)
+				title[0] = 0;
+			if (dvb_text_decode(store->decoder,
+					    dvb_short_event_descriptor_text(part2), part2->text_length,
+					    text, sizeof(text), 0) < 0)
+				text[0] = 0;
+			break;
+		}
+
+		result = dvbepg_store_add_event(store, &key,
+						eit->head.table_id,
+						eit->head.version_number,
+						cur_event->event_id,
+						dvbdate_to_unixtime(cur_event->start_time),
+						dvbduration_to_seconds(cur_event->duration),
+						title, text);
+		if (result < 0)
+			return -1;
+		changed += result;
+	}
+
+	return changed;
+}
+
+int dvbepg_store_add_atsc_eit(struct dvbepg_store *store,
+			      uint16_t transport_stream_id,
+			      struct atsc_eit_section *eit)
+{
+	struct dvbepg_service_key key;
+	struct atsc_eit_event *cur_event;
+	struct atsc_text *title_text;
+	struct atsc_text_string *str;
+	struct atsc_text_string_segment *seg;
+	size_t pos;
+	int changed = 0;
+	int result;
+	int idx, i, j;
+
+	key.original_network_id = 0;
+	key.transport_stream_id = transport_stream_id;
+	key.service_id = atsc_eit_section_source_id(eit);
+
+	atsc_eit_section_events_for_each(eit, cur_event, idx) {
+		pos = 0;
+
+		// only the first string; the others are other languages
+		if ((title_text = atsc_eit_event_name_title_text(cur_event)) != NULL) {
+			atsc_text_strings_for_each(title_text, str, i) {
+				atsc_text_string_segments_for_each(str, seg, j) {
+					if (atsc_text_segment_decode(seg, &store->atsc_buf,
+								     &store->atsc_buf_size, &pos) < 0) {
+						pos = 0;
+						break;
+					}
+				}
+				break;
+			}
+		}
+
+		// the decoder does not terminate the string
+		if (store->atsc_buf_size <= pos) {
+			uint8_t *buf = realloc(store->atsc_buf, pos + 1);
+
+			if (buf == NULL)
+				return -1;
+			store->atsc_buf = buf;
+			store->atsc_buf_size = pos + 1;
+		}
+		store->atsc_buf[pos] = 0;
+
+		result = dvbepg_store_add_event(store, &key,
+						eit->head.ext_head.table_id,
+						eit->head.ext_head.version_number,
+						cur_event->event_id,
+						atsctime_to_unixtime(cur_event->start_time),
+						cur_event->length_in_seconds,
+						(char *) store->atsc_buf, NULL);
+		if (result < 0)
+			return -1;
+		changed += result;
+	}
+
+	return changed;
+}
+
+int dvbepg_store_now_next(struct dvbepg_store *store,
+			  struct dvbepg_service_key *key,
+			  time_t when,
+			  struct dvbepg_event_info *now,
+			  struct dvbepg_event_info *next)
+{
+	struct epg_service *svc;
+	uint32_t pos;
+
+	no_event(now);
+	no_event(next);
+	if ((svc = store_find_service(store, key, 0)) == NULL)
+		return -1;
+
+	// pos is the first event starting after when; the one before may be running
+	pos = service_upper_bound(svc, when);
+	if ((pos > 0) &&
+	    (((int64_t) svc->start[pos - 1] + (svc->duration[pos - 1] ? svc->duration[pos - 1] : 1)) > when))
+		event_info(store, svc, pos - 1, now);
+	if (pos < svc->count)
+		event_info(store, svc, pos, next);
+
+	return 0;
+}
+
+int dvbepg_store_range(struct dvbepg_store *store,
+		       struct dvbepg_service_key *key,
+		       time_t from,
+		       time_t to,
+		       struct dvbepg_event_info *events,
+		       int max)
+{
+	struct epg_service *svc;
+	uint32_t pos;
+	int count = 0;
+
+	if ((svc = store_find_service(store, key, 0)) == NULL)
+		return -1;
+
+	pos = service_upper_bound(svc, from);
+	if ((pos > 0) &&
+	    (((int64_t) svc->start[pos - 1] + (svc->duration[pos - 1] ? svc->duration[pos - 1] : 1)) > from))
+		pos--;
+
+	for (; (pos < svc->count) && ((int64_t) svc->start[pos] < to); pos++) {
+		if (count < max)
+			event_info(store, svc, pos, &events[count]);
+		count++;
+	}
+
+	return count;
+}
+
+int dvbepg_store_service_count(struct dvbepg_store *store)
+{
+	return store->service_count;
+}
+
+int dvbepg_store_service_key(struct dvbepg_store *store,
+			     int idx,
+			     struct dvbepg_service_key *key)
+{
+	if ((idx < 0) || ((uint32_t) idx >= store->service_count))
+		return -1;
+
+	*key = store->services[idx].key;
+	return 0;
+}
+
+void dvbepg_store_get_stats(struct dvbepg_store *store,
+			    struct dvbepg_store_stats *stats)
+{
+	uint32_t i;
+
+	memcpy(stats, &store->stats, sizeof(struct dvbepg_store_stats));
+
+	stats->services = store->service_count;
+	stats->events = 0;
+	for (i = 0; i < store->service_count; i++)
+		stats->events += store->services[i].count;
+	stats->string_bytes = store->pool.size;
+}
+
+int dvbepg_store_save(struct dvbepg_store *store,
+		      const char *filename)
+{
+	struct snapshot_header header;
+	struct snapshot_service entry;
+	struct epg_service *svc;
+	char *tmpname;
+	FILE *f;
+	uint64_t offset;
+	uint64_t pos = 0;
+	uint32_t events = 0;
+	uint32_t i;
+	int col;
+
+	// a loaded snapshot is already compact
+	if (store->changed && store_compact(store))
+		return -1;
+
+	for (i = 0; i < store->service_count; i++)
+		events += store->services[i].count;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.byte_order = SNAPSHOT_BYTE_ORDER;
+	header.version = SNAPSHOT_VERSION;
+	header.service_count = store->service_count;
+	header.event_count = events;
+	header.pool_size = store->pool.size;
+
+	offset = SNAPSHOT_ALIGN(sizeof(header));
+	header.services_offset = offset;
+	offset = SNAPSHOT_ALIGN(offset + store->service_count * sizeof(struct snapshot_service));
+	for (col = 0; col < COLUMNS; col++) {
+		header.column_offset[col] = offset;
+		offset = SNAPSHOT_ALIGN(offset + (uint64_t) events * column_size[col]);
+	}
+	header.pool_offset = offset;
+	header.file_size = offset + store->pool.size;
+
+	if ((tmpname = malloc(strlen(filename) + 5)) == NULL)
+		return -1;
+	sprintf(tmpname, "%s.tmp", filename);
+	if ((f = fopen(tmpname, "w")) == NULL) {
+		free(tmpname);
+		return -1;
+	}
+
+	if (write_at(f, &pos, 0, &header, sizeof(header)))
+		goto error;
+
+	offset = header.services_offset;
+	events = 0;
+	for (i = 0; i < store->service_count; i++) {
+		svc = &store->services[i];
+
+		memset(&entry, 0, sizeof(entry));
+		entry.original_network_id = svc->key.original_network_id;
+		entry.transport_stream_id = svc->key.transport_stream_id;
+		entry.service_id = svc->key.service_id;
+		entry.first = events;
+		entry.count = svc->count;
+		if (write_at(f, &pos, offset, &entry, sizeof(entry)))
+			goto error;
+		offset += sizeof(entry);
+		events += svc->count;
+	}
+
+	for (col = 0; col < COLUMNS; col++) {
+		offset = header.column_offset[col];
+		for (i = 0; i < store->service_count; i++) {
+			svc = &store->services[i];
+			if (write_at(f, &pos, offset, service_column(svc, col), svc->count * column_size[col]))
+				goto error;
+			offset += svc->count * column_size[col];
+		}
+	}
+
+	if (write_at(f, &pos, header.pool_offset, store->pool.buf, store->pool.size))
+		goto error;
+
+	if (fflush(f) || fsync(fileno(f)))
+		goto error;
+	if (fclose(f)) {
+		f = NULL;
+		goto error;
+	}
+	f = NULL;
+	if (rename(tmpname, filename))
+		goto error;
+
+	free(tmpname);
+	store->changed = 0;
+	return 0;
+
+error:
+	if (f)
+		fclose(f);
+	unlink(tmpname);
+	free(tmpname);
+	return -1;
+}
+
+struct dvbepg_store *dvbepg_store_load(const char *filename)
+{
+	struct dvbepg_store *store = NULL;
+	struct snapshot_header *header;
+	struct snapshot_service *entries;
+	struct epg_service *svc;
+	struct stat st;
+	uint8_t *map;
+	uint32_t *offsets;
+	uint32_t i, j;
+	int col;
+	int fd;
+
+	if ((fd = open(filename, O_RDONLY)) < 0)
+		return NULL;
+	if (fstat(fd, &st) || ((size_t) st.st_size < sizeof(struct snapshot_header))) {
+		close(fd);
+		return NULL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	// check the layout, so that nothing can point outside the file
+	header = (struct snapshot_header *) map;
+	if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) ||
+	    (header->byte_order != SNAPSHOT_BYTE_ORDER) ||
+	    (header->version != SNAPSHOT_VERSION) ||
+	    (header->file_size != (uint64_t) st.st_size))
+		goto error;
+	if ((header->services_offset & 7) ||
+	    (header->services_offset > header->file_size) ||
+	    ((header->file_size - header->services_offset) / sizeof(struct snapshot_service) < header->service_count))
+		goto error;
+	for (col = 0; col < COLUMNS; col++) {
+		if ((header->column_offset[col] & 7) ||
+		    (header->column_offset[col] > header->file_size) ||
+		    ((header->file_size - header->column_offset[col]) / column_size[col] < header->event_count))
+			goto error;
+	}
+	if ((header->pool_size == 0) ||
+	    (header->pool_offset > header->file_size) ||
+	    (header->file_size - header->pool_offset < header->pool_size) ||
+	    (map[header->pool_offset] != 0) ||
+	    (map[header->pool_offset + header->pool_size - 1] != 0))
+		goto error;
+
+	entries = (struct snapshot_service *) (map + header->services_offset);
+	for (i = 0; i < header->service_count; i++) {
+		if ((entries[i].first > header->event_count) ||
+		    (entries[i].count > header->event_count - entries[i].first))
+			goto error;
+	}
+	for (col = COL_TITLE; col <= COL_TEXT; col++) {
+		offsets = (uint32_t *) (map + header->column_offset[col]);
+		for (j = 0; j < header->event_count; j++) {
+			if (offsets[j] >= header->pool_size)
+				goto error;
+		}
+	}
+
+	if ((store = dvbepg_store_create()) == NULL)
+		goto error;
+	if (header->service_count) {
+		if ((store->services = malloc(header->service_count * sizeof(struct epg_service))) == NULL)
+			goto error;
+		memset(store->services, 0, header->service_count * sizeof(struct epg_service));
+		store->service_max = header->service_count;
+	}
+
+	for (i = 0; i < header->service_count; i++) {
+		struct dvbepg_service_key key;
+
+		key.original_network_id = entries[i].original_network_id;
+		key.transport_stream_id = entries[i].transport_stream_id;
+		key.service_id = entries[i].service_id;
+
+		// the lookups depend on the order
+		if (i && (key_cmp(&store->services[i - 1].key, &key) >= 0))
+			goto error;
+
+		svc = &store->services[i];
+		svc->key = key;
+		svc->count = entries[i].count;
+		for (col = 0; col < COLUMNS; col++)
+			service_set_column(svc, col, map + header->column_offset[col] +
+					   (uint64_t) entries[i].first * column_size[col]);
+		store->service_count++;
+	}
+
+	pool_free(&store->pool);
+	store->pool.buf = (char *) map + header->pool_offset;
+	store->pool.size = header->pool_size;
+
+	store->map = map;
+	store->map_size = st.st_size;
+	return store;
+
+error:
+	if (store)
+		dvbepg_store_destroy(store);
+	munmap(map, st.st_size);
+	return NULL;
+}
+
+static int key_cmp(struct dvbepg_service_key *a, struct dvbepg_service_key *b)
+{
+	if (a->original_network_id != b->original_network_id)
+		return a->original_network_id - b->original_network_id;
+	if (a->transport_stream_id != b->transport_stream_id)
+		return a->transport_stream_id - b->transport_stream_id;
+	return a->service_id - b->service_id;
+}
+
+static struct epg_service *store_find_service(struct dvbepg_store *store,
+					      struct dvbepg_service_key *key,
+					      int create)
+{
+	struct epg_service *svc;
+	uint32_t lo = 0;
+	uint32_t hi = store->service_count;
+	uint32_t mid;
+	int cmp;
+
+	// sections tend to come in runs for the same service
+	if ((store->last < store->service_count) &&
+	    (key_cmp(&store->services[store->last].key, key) == 0))
+		return &store->services[store->last];
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		cmp = key_cmp(&store->services[mid].key, key);
+		if (cmp == 0) {
+			store->last = mid;
+			return &store->services[mid];
+		}
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!create)
+		return NULL;
+
+	if (store->service_count == store->service_max) {
+		uint32_t max = store->service_max ? store->service_max * 2 : 64;
+
+		if ((svc = realloc(store->services, max * sizeof(struct epg_service))) == NULL)
+			return NULL;
+		store->services = svc;
+		store->service_max = max;
+	}
+	memmove(&store->services[lo + 1], &store->services[lo],
+		(store->service_count - lo) * sizeof(struct epg_service));
+	store->service_count++;
+
+	svc = &store->services[lo];
+	memset(svc, 0, sizeof(struct epg_service));
+	svc->key = *key;
+	store->last = lo;
+	return svc;
+}
+
+static int store_compact(struct dvbepg_store *store)
+{
+	struct epg_pool pool;
+	struct epg_service *svc;
+	uint32_t i, j;
+
+	if (pool_init(&pool))
+		return -1;
+
+	// collect the strings still in use first, so a failure changes nothing
+	for (i = 0; i < store->service_count; i++) {
+		svc = &store->services[i];
+		for (j = 0; j < svc->count; j++) {
+			uint32_t offset;
+
+			if (pool_intern(&pool, store->pool.buf + svc->title[j], &offset) ||
+			    pool_intern(&pool, store->pool.buf + svc->text[j], &offset))
+				goto error;
+		}
+		if (service_reserve(svc, svc->count))
+			goto error;
+	}
+
+	for (i = 0; i < store->service_count; i++) {
+		svc = &store->services[i];
+		for (j = 0; j < svc->count; j++) {
+			svc->title[j] = pool_find(&pool, store->pool.buf + svc->title[j]);
+			svc->text[j] = pool_find(&pool, store->pool.buf + svc->text[j]);
+		}
+	}
+
+	pool_free(&store->pool);
+	store->pool = pool;
+	return 0;
+
+error:
+	pool_free(&pool);
+	return -1;
+}
+
+static void *service_column(struct epg_service *svc, int col)
+{
+	switch(col) {
+	case COL_START:
+		return svc->start;
+	case COL_DURATION:
+		return svc->duration;
+	case COL_TITLE:
+		return svc->title;
+	case COL_TEXT:
+		return svc->text;
+	case COL_EVENT_ID:
+		return svc->event_id;
+	default:
+		return svc->version;
+	}
+}
+
+static void service_set_column(struct epg_service *svc, int col, void *column)
+{
+	switch(col) {
+	case COL_START:
+		svc->start = column;
+		break;
+	case COL_DURATION:
+		svc->duration = column;
+		break;
+	case COL_TITLE:
+		svc->title = column;
+		break;
+	case COL_TEXT:
+		svc->text = column;
+		break;
+	case COL_EVENT_ID:
+		svc->event_id = column;
+		break;
+	default:
+		svc->version = column;
+		break;
+	}
+}
+
+/*
+ * Make room for max events, copying the columns out of the snapshot if they
+ * are still there.
+ */
+static int service_reserve(struct epg_service *svc, uint32_t max)
+{
+	void *columns[COLUMNS];
+	uint32_t new_max;
+	int col;
+
+	if ((max <= svc->max) || ((svc->max == 0) && (max == 0)))
+		return 0;
+
+	new_max = svc->max ? svc->max * 2 : 16;
+	while (new_max < max)
+		new_max *= 2;
+
+	for (col = 0; col < COLUMNS; col++) {
+		if ((columns[col] = malloc(new_max * column_size[col])) == NULL) {
+			while (col--)
+				free(columns[col]);
+			return -1;
+		}
+	}
+
+	for (col = 0; col < COLUMNS; col++) {
+		void *column = service_column(svc, col);
+
+		if (svc->count)
+			memcpy(columns[col], column, svc->count * column_size[col]);
+		if (svc->max)
+			free(column);
+		service_set_column(svc, col, columns[col]);
+	}
+	svc->max = new_max;
+
+	return 0;
+}
+
+static void service_remove(struct epg_service *svc, uint32_t pos, uint32_t count)
+{
+	int col;
+
+	for (col = 0; col < COLUMNS; col++) {
+		uint8_t *column = service_column(svc, col);
+
+		memmove(column + (pos * column_size[col]),
+			column + ((pos + count) * column_size[col]),
+			(svc->count - pos - count) * column_size[col]);
+	}
+	svc->count -= count;
+}
+
+static void service_insert(struct epg_service *svc, uint32_t pos)
+{
+	int col;
+
+	for (col = 0; col < COLUMNS; col++) {
+		uint8_t *column = service_column(svc, col);
+
+		memmove(column + ((pos + 1) * column_size[col]),
+			column + (pos * column_size[col]),
+			(svc->count - pos) * column_size[col]);
+	}
+	svc->count++;
+}
+
+static int service_find_event(struct epg_service *svc, uint16_t event_id, uint32_t start)
+{
+	uint32_t pos;
+	uint32_t i;
+
+	// usually the event has not moved
+	pos = service_upper_bound(svc, start);
+	if ((pos > 0) && (svc->start[pos - 1] == start) && (svc->event_id[pos - 1] == event_id))
+		return pos - 1;
+
+	for (i = 0; i < svc->count; i++) {
+		if (svc->event_id[i] == event_id)
+			return i;
+	}
+
+	return -1;
+}
+
+/* index of the first event starting after when */
+static uint32_t service_upper_bound(struct epg_service *svc, int64_t when)
+{
+	uint32_t lo = 0;
+	uint32_t hi = svc->count;
+	uint32_t mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if ((int64_t) svc->start[mid] <= when)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static void event_info(struct dvbepg_store *store, struct epg_service *svc, uint32_t idx,
+		       struct dvbepg_event_info *info)
+{
+	info->event_id = svc->event_id[idx];
+	info->start_time = svc->start[idx];
+	info->duration = svc->duration[idx];
+	info->title = store->pool.buf + svc->title[idx];
+	info->text = store->pool.buf + svc->text[idx];
+}
+
+static void no_event(struct dvbepg_event_info *info)
+{
+	info->event_id = 0;
+	info->start_time = -1;
+	info->duration = 0;
+	info->title = "";
+	info->text = "";
+}
+
+static uint32_t pool_hash(const char *str)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*str)
+		hash = (hash ^ (uint8_t) *str++) * 16777619U;
+
+	return hash;
+}
+
+static int pool_init(struct epg_pool *pool)
+{
+	memset(pool, 0, sizeof(struct epg_pool));
+
+	if ((pool->buf = malloc(POOL_MIN)) == NULL)
+		return -1;
+	pool->buf[0] = 0;
+	pool->size = 1;
+	pool->max = POOL_MIN;
+
+	return 0;
+}
+
+static void pool_free(struct epg_pool *pool)
+{
+	if (pool->max)
+		free(pool->buf);
+	free(pool->hash);
+	memset(pool, 0, sizeof(struct epg_pool));
+}
+
+static int pool_rehash(struct epg_pool *pool, uint32_t hash_size)
+{
+	uint32_t *hash;
+	uint32_t mask = hash_size - 1;
+	uint32_t offset;
+	uint32_t slot;
+
+	if ((hash = malloc(hash_size * sizeof(uint32_t))) == NULL)
+		return -1;
+	memset(hash, 0, hash_size * sizeof(uint32_t));
+
+	// every string after the initial "" is in the table
+	for (offset = 1; offset < pool->size; offset += strlen(pool->buf + offset) + 1) {
+		for (slot = pool_hash(pool->buf + offset) & mask; hash[slot]; slot = (slot + 1) & mask)
+			;
+		hash[slot] = offset;
+	}
+
+	free(pool->hash);
+	pool->hash = hash;
+	pool->hash_size = hash_size;
+	return 0;
+}
+
+static int pool_intern(struct epg_pool *pool, const char *str, uint32_t *offset)
+{
+	uint32_t mask;
+	uint32_t slot;
+	uint32_t hash;
+	size_t len;
+
+	if ((str == NULL) || (*str == 0)) {
+		*offset = 0;
+		return 0;
+	}
+
+	// the first string added to a loaded pool copies it and indexes it
+	if (pool->max == 0) {
+		uint32_t max = POOL_MIN;
+		char *buf;
+
+		while (max < pool->size * 2)
+			max *= 2;
+		if ((buf = malloc(max)) == NULL)
+			return -1;
+		memcpy(buf, pool->buf, pool->size);
+		pool->buf = buf;
+		pool->max = max;
+	}
+	if (pool->hash == NULL) {
+		uint32_t hash_size = POOL_HASH_MIN;
+
+		pool->hash_count = 0;
+		for (slot = 1; slot < pool->size; slot++) {
+			if (pool->buf[slot] == 0)
+				pool->hash_count++;
+		}
+		while (hash_size < pool->hash_count * 2)
+			hash_size *= 2;
+		if (pool_rehash(pool, hash_size))
+			return -1;
+	}
+
+	hash = pool_hash(str);
+	mask = pool->hash_size - 1;
+	for (slot = hash & mask; pool->hash[slot]; slot = (slot + 1) & mask) {
+		if (!strcmp(pool->buf + pool->hash[slot], str)) {
+			*offset = pool->hash[slot];
+			return 0;
+		}
+	}
+
+	// add it, keeping the table at most half full
+	len = strlen(str) + 1;
+	if (pool->size + len > pool->max) {
+		uint32_t max = pool->max;
+		char *buf;
+
+		while (max < pool->size + len) {
+			if (max > (UINT32_MAX / 2))
+				return -1;
+			max *= 2;
+		}
+		if ((buf = realloc(pool->buf, max)) == NULL)
+			return -1;
+		pool->buf = buf;
+		pool->max = max;
+	}
+	if (((pool->hash_count + 1) * 2) > pool->hash_size) {
+		if (pool_rehash(pool, pool->hash_size * 2))
+			return -1;
+		mask = pool->hash_size - 1;
+		for (slot = hash & mask; pool->hash[slot]; slot = (slot + 1) & mask)
+			;
+	}
+
+	memcpy(pool->buf + pool->size, str, len);
+	pool->hash[slot] = pool->size;
+	pool->hash_count++;
+	*offset = pool->size;
+	pool->size += len;
+
+	return 0;
+}
+
+/* offset of a string known to be in the pool */
+static uint32_t pool_find(struct epg_pool *pool, const char *str)
+{
+	uint32_t mask = pool->hash_size - 1;
+	uint32_t slot;
+
+	if (*str == 0)
+		return 0;
+
+	for (slot = pool_hash(str) & mask; pool->hash[slot]; slot = (slot + 1) & mask) {
+		if (!strcmp(pool->buf + pool->hash[slot], str))
+			return pool->hash[slot];
+	}
+
+	return 0;
+}
+
+static int write_at(FILE *f, uint64_t *pos, uint64_t offset, const void *buf, size_t len)
+{
+	static const uint8_t zero[8];
+
+	// pad up to the alignment of the next part
+	while (*pos < offset) {
+		size_t pad = (offset - *pos) < sizeof(zero) ? (offset - *pos) : sizeof(zero);
+
+		if (fwrite(zero, 1, pad, f) != pad)
+			return -1;
+		*pos += pad;
+	}
+
+	if (len && (fwrite(buf, 1, len, f) != len))
+		return -1;
+	*pos += len;
+
+	return 0;
+}
@@ -0,0 +1,247 @@
+/*
+	libdvbepg - an EPG store for libucsi
+
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This library is free software; you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as
+	published by the Free Software Foundation; either version 2.1 of
+	the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public
+	License along with this library; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+*/
+
+#ifndef DVBEPG_STORE_H
+#define DVBEPG_STORE_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h>
+#include <libucsi/dvb/eit_section.h>
+#include <libucsi/atsc/eit_section.h>
+
+/**
+ * The EPG store keeps the schedule of each service as columns (start time,
+ * duration, event_id, table version and title/text string offsets) sorted
+ * by start time, so that finding the event running at a given time, or the
+ * events in a time range, is a binary search over the start times.
+ *
+ * Titles and texts are kept once each in a string pool, however many events
+ * (or services) share them.
+ *
+ * A service's events never overlap: an event replaces any earlier received
+ * events whose time it covers, as happens when a schedule is changed. An
+ * event that is received again with an unchanged table_id and version is
+ * skipped without looking at its strings.
+ *
+ * The store can be saved to a snapshot file and loaded back with mmap(); a
+ * loaded store is used directly from the file, and only the services which
+ * are later changed are copied into memory.
+ *
+ * A store is not thread safe.
+ */
+struct dvbepg_store;
+
+/**
+ * Identifies a service. ATSC services use an original_network_id of 0, and
+ * the source_id as the service_id.
+ */
+struct dvbepg_service_key {
+	uint16_t original_network_id;
+	uint16_t transport_stream_id;
+	uint16_t service_id;
+};
+
+/**
+ * An event returned by a query. The strings are UTF-8, "" if not known, and
+ * remain valid until the store is next changed.
+ */
+struct dvbepg_event_info {
+	uint16_t event_id;
+	time_t start_time;		/* -1 if there is no such event */
+	uint32_t duration;		/* seconds */
+	const char *title;
+	const char *text;
+};
+
+/**
+ * Counters kept by a store.
+ */
+struct dvbepg_store_stats {
+	uint32_t added;			/* events added */
+	uint32_t updated;		/* events changed by a new version */
+	uint32_t unchanged;		/* events received again unchanged */
+	uint32_t overlapped;		/* events replaced by an overlapping one */
+	uint32_t services;		/* services in the store */
+	uint32_t events;		/* events in the store */
+	uint32_t string_bytes;		/* size of the string pool */
+};
+
+/**
+ * Create an empty store.
+ *
+ * @return The new instance, or NULL on error.
+ */
+extern struct dvbepg_store *dvbepg_store_create(void);
+
+/**
+ * Destroy a store, unmapping its snapshot file if it has one.
+ *
+ * @param store The instance.
+ */
+extern void dvbepg_store_destroy(struct dvbepg_store *store);
+
+/**
+ * Add or update an event.
+ *
+ * @param store The instance.
+ * @param key The service.
+ * @param table_id table_id of the section the event came from.
+ * @param version version_number of the section the event came from.
+ * @param event_id The event_id.
+ * @param start_time Start time of the event. Events with an undefined start
+ * time (-1) are ignored.
+ * @param duration Duration in seconds.
+ * @param title UTF-8 title, or NULL.
+ * @param text UTF-8 description, or NULL.
+ * @return 1 if the store was changed, 0 if not, or -1 on error.
+ */
+extern int dvbepg_store_add_event(struct dvbepg_store *store,
+				  struct dvbepg_service_key *key,
+				  uint8_t table_id,
+				  uint8_t version,
+				  uint16_t event_id,
+				  time_t start_time,
+				  uint32_t duration,
+				  const char *title,
+				  const char *text);
+
+/**
+ * Add the events of a DVB EIT section, with the title and text of their
+ * first short_event_descriptor.
+ *
+ * @param store The instance.
+ * @param eit The decoded section.
+ * @return Number of events which changed the store, or -1 on error.
+ */
+extern int dvbepg_store_add_dvb_eit(struct dvbepg_store *store,
+				    struct dvb_eit_section *eit);
+
+/**
+ * Add the events of an ATSC EIT section, with the first string of their
+ * title. ATSC descriptions are carried in the ETT, and are not stored.
+ *
+ * @param store The instance.
+ * @param transport_stream_id transport_stream_id of the multiplex, as
+ * the EIT does not carry it.
+ * @param eit The decoded section.
+ * @return Number of events which changed the store, or -1 on error.
+ */
+extern int dvbepg_store_add_atsc_eit(struct dvbepg_store *store,
+				     uint16_t transport_stream_id,
+				     struct atsc_eit_section *eit);
+
+/**
+ * Find the event running at a given time, and the event after it.
+ *
+ * @param store The instance.
+ * @param key The service.
+ * @param when The time.
+ * @param now Where to put the running event. Its start_time is -1 if no
+ * event is running.
+ * @param next Where to put the next event. Its start_time is -1 if there
+ * is none.
+ * @return 0 on success, or -1 if the service is not known.
+ */
+extern int dvbepg_store_now_next(struct dvbepg_store *store,
+				 struct dvbepg_service_key *key,
+				 time_t when,
+				 struct dvbepg_event_info *now,
+				 struct dvbepg_event_info *next);
+
+/**
+ * Find the events of a service which overlap a time range, in start time
+ * order.
+ *
+ * @param store The instance.
+ * @param key The service.
+ * @param from Start of the range.
+ * @param to End of the range (exclusive).
+ * @param events Where to put the events.
+ * @param max Number of entries in events; the first max events are returned.
+ * @return Number of events in the range (which may be more than max), or -1
+ * if the service is not known.
+ */
+extern int dvbepg_store_range(struct dvbepg_store *store,
+			      struct dvbepg_service_key *key,
+			      time_t from,
+			      time_t to,
+			      struct dvbepg_event_info *events,
+			      int max);
+
+/**
+ * @param store The instance.
+ * @return Number of services in the store.
+ */
+extern int dvbepg_store_service_count(struct dvbepg_store *store);
+
+/**
+ * Retrieve the key of a service. Services are kept in
+ * original_network_id, transport_stream_id, service_id order.
+ *
+ * @param store The instance.
+ * @param idx Index of the service, from 0 to dvbepg_store_service_count() - 1.
+ * @param key Where to put the key.
+ * @return 0 on success, or -1 if idx is out of range.
+ */
+extern int dvbepg_store_service_key(struct dvbepg_store *store,
+				    int idx,
+				    struct dvbepg_service_key *key);
+
+/**
+ * Retrieve the counters.
+ *
+ * @param store The instance.
+ * @param stats Where to put them.
+ */
+extern void dvbepg_store_get_stats(struct dvbepg_store *store,
+				   struct dvbepg_store_stats *stats);
+
+/**
+ * Save the store to a snapshot file. The file is written under a temporary
+ * name and renamed, so an existing snapshot is only replaced by a complete
+ * one. Strings no longer used by any event are dropped first.
+ *
+ * Snapshots use the byte order of the machine which wrote them.
+ *
+ * @param store The instance.
+ * @param filename Name of the file.
+ * @return 0 on success, or -1 on error.
+ */
+extern int dvbepg_store_save(struct dvbepg_store *store,
+			     const char *filename);
+
+/**
+ * Create a store from a snapshot file. The file is mapped, not read, and
+ * must not be changed while the store exists.
+ *
+ * @param filename Name of the file.
+ * @return The new instance, or NULL if the file could not be mapped or is
+ * not a valid snapshot.
+ */
+extern struct dvbepg_store *dvbepg_store_load(const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -23,6 +23,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <time.h>
 #include <linux/types.h>
 #include <libdvbapi/dvbfe.h>
 #include "dvbsec_api.h"
@@ -30,6 +31,121 @@
 // uncomment this to make dvbsec_command print out debug instead of talking to a frontend
 // #define TEST_SEC_COMMAND 1
 
+// minimum gap between SEC steps on the bus (DiSEqC bus specification 4.2)
+#define DVBSEC_STEP_GAP_MS 15
+
+struct dvbsec_state {
+	struct dvbfe_handle *fe;
+
+	// what the bus was last set to, -1 if unknown
+	int voltage;
+	int tone;
+	int burst;
+	int committed;		// address << 8 | data byte
+	int uncommitted;	// address << 8 | data byte
+
+	struct timespec last_step;	// when the last step was issued
+	int pending;			// steps issued since the last wait
+
+	struct dvbsec_state_stats stats;
+};
+
+static int sec_set(struct dvbfe_handle *fe,
+		   struct dvbsec_state *state,
+		   struct dvbsec_config *sec_config,
+		   enum dvbsec_diseqc_polarization polarization,
+		   enum dvbsec_diseqc_switch sat_pos,
+		   enum dvbsec_diseqc_switch switch_option,
+		   struct dvbfe_parameters *params,
+		   int timeout);
+static int sec_std_sequence(struct dvbsec_state *state,
+			    enum dvbsec_diseqc_oscillator oscillator,
+			    enum dvbsec_diseqc_polarization polarization,
+			    enum dvbsec_diseqc_switch sat_pos,
+			    enum dvbsec_diseqc_switch switch_option);
+static int sec_command(struct dvbfe_handle *fe, struct dvbsec_state *state, char *command);
+static int sec_set_voltage(struct dvbfe_handle *fe, struct dvbsec_state *state,
+			   enum dvbfe_sec_voltage voltage);
+static int sec_set_tone(struct dvbfe_handle *fe, struct dvbsec_state *state,
+			enum dvbfe_sec_tone_mode tone);
+static int sec_set_burst(struct dvbfe_handle *fe, struct dvbsec_state *state,
+			 enum dvbfe_sec_mini_cmd burst);
+static int sec_diseqc(struct dvbfe_handle *fe, struct dvbsec_state *state,
+		      uint8_t *data, uint8_t len);
+static int sec_committed_switches(struct dvbfe_handle *fe,
+				  struct dvbsec_state *state,
+				  enum dvbsec_diseqc_address address,
+				  enum dvbsec_diseqc_oscillator oscillator,
+				  enum dvbsec_diseqc_polarization polarization,
+				  enum dvbsec_diseqc_switch sat_pos,
+				  enum dvbsec_diseqc_switch switch_option);
+static int sec_uncommitted_switches(struct dvbfe_handle *fe,
+				    struct dvbsec_state *state,
+				    enum dvbsec_diseqc_address address,
+				    enum dvbsec_diseqc_switch s1,
+				    enum dvbsec_diseqc_switch s2,
+				    enum dvbsec_diseqc_switch s3,
+				    enum dvbsec_diseqc_switch s4);
+static void sec_wait(struct dvbsec_state *state, int ms);
+static void sec_step_start(struct dvbsec_state *state);
+static void sec_step_done(struct dvbsec_state *state);
+static void sec_step_skipped(struct dvbsec_state *state);
+static void sec_forget(struct dvbsec_state *state);
+static uint32_t sec_elapsed_us(struct timespec *since);
+
+struct dvbsec_state *dvbsec_state_create(struct dvbfe_handle *fe)
+{
+	struct dvbsec_state *state;
+
+	state = malloc(sizeof(struct dvbsec_state));
+	if (state == NULL)
+		return NULL;
+	memset(state, 0, sizeof(struct dvbsec_state));
+
+	state->fe = fe;
+	dvbsec_state_reset(state);
+
+	return state;
+}
+
+void dvbsec_state_destroy(struct dvbsec_state *state)
+{
+	free(state);
+}
+
+void dvbsec_state_reset(struct dvbsec_state *state)
+{
+	state->voltage = -1;
+	state->tone = -1;
+	state->burst = -1;
+	state->committed = -1;
+	state->uncommitted = -1;
+	state->pending = 0;
+}
+
+void dvbsec_state_get_stats(struct dvbsec_state *state,
+			    struct dvbsec_state_stats *stats)
+{
+	memcpy(stats, &state->stats, sizeof(struct dvbsec_state_stats));
+}
+
+int dvbsec_state_set(struct dvbsec_state *state,
+		     struct dvbsec_config *sec_config,
+		     enum dvbsec_diseqc_polarization polarization,
+		     enum dvbsec_diseqc_switch sat_pos,
+		     enum dvbsec_diseqc_switch switch_option,
+		     struct dvbfe_parameters *params,
+		     int timeout)
+{
+	return sec_set(state->fe, state, sec_config, polarization,
+		       sat_pos, switch_option, params, timeout);
+}
+
+int dvbsec_state_command(struct dvbsec_state *state, char *command)
+{
+	return sec_command(state->fe, state, command);
+}
+
 int dvbsec_set(struct dvbfe_handle *fe,
 		   struct dvbsec_config *sec_config,
 		   enum dvbsec_diseqc_polarization polarization,
@@ -37,10 +153,31 @@ int dvbsec_set(struct dvbfe_handle *fe,
 		   enum dvbsec_diseqc_switch switch_option,
 		   struct dvbfe_parameters *params,
 		   int timeout)
+{
+	return sec_set(fe, NULL, sec_config, polarization,
+		       sat_pos, switch_option, params, timeout);
+}
+
+static int sec_set(struct dvbfe_handle *fe,
+		   struct dvbsec_state *state,
+		   struct dvbsec_config *sec_config,
+		   enum dvbsec_diseqc_polarization polarization,
+		   enum dvbsec_diseqc_switch sat_pos,
+		   enum dvbsec_diseqc_switch switch_option,
+		   struct dvbfe_parameters *params,
+		   int timeout)
 {
 	int tmp;
 	struct dvbfe_parameters localparams;
 	struct dvbfe_parameters *topass = params;
+	struct timespec start;
+
+	if (state) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		state->stats.last_us = 0;
+		state->stats.last_sent = 0;
+		state->stats.last_skipped = 0;
+	}
 
 	// perform SEC
 	if (sec_config != NULL) {
@@ -49,7 +186,7 @@ int dvbsec_set(struct dvbfe_handle *fe,
 			break;
 
 		case DVBSEC_CONFIG_POWER:
-			dvbfe_set_voltage(fe, DVBFE_SEC_VOLTAGE_13);
+			sec_set_voltage(fe, state, DVBFE_SEC_VOLTAGE_13);
 			break;
 
 		case DVBSEC_CONFIG_STANDARD:
@@ -59,11 +196,13 @@ int dvbsec_set(struct dvbfe_handle *fe,
 			if (sec_config->switch_frequency && (sec_config->switch_frequency < params->frequency))
 				osc = DISEQC_OSCILLATOR_HIGH;
 
-			if ((tmp = dvbsec_std_sequence(fe,
-			     				  osc,
-							  polarization,
-							  sat_pos,
-							  switch_option)) < 0)
+			if (state)
+				tmp = sec_std_sequence(state, osc, polarization,
+						       sat_pos, switch_option);
+			else
+				tmp = dvbsec_std_sequence(fe, osc, polarization,
+							  sat_pos, switch_option);
+			if (tmp < 0)
 				return tmp;
 			break;
 		}
@@ -108,12 +247,15 @@ int dvbsec_set(struct dvbfe_handle *fe,
 
 			// do it
 			if (cmd)
-				if ((tmp = dvbsec_command(fe, cmd)) < 0)
+				if ((tmp = sec_command(fe, state, cmd)) < 0)
 					return tmp;
 			break;
 		}
 		}
 
+		if (state)
+			state->stats.last_us = sec_elapsed_us(&start);
+
 		// work out the correct LOF value
 		uint32_t lof = 0;
 		if ((sec_config->switch_frequency == 0) || (params->frequency < sec_config->switch_frequency)) {
@@ -228,6 +370,250 @@ int dvbsec_std_sequence(struct dvbfe_handle *fe,
 	return 0;
 }
 
+/*
+ * The standard sequence against what the bus was last set to: steps which
+ * would not change anything are skipped, and the others only wait for what
+ * is left of the minimum gap since the step before them.
+ */
+static int sec_std_sequence(struct dvbsec_state *state,
+			    enum dvbsec_diseqc_oscillator oscillator,
+			    enum dvbsec_diseqc_polarization polarization,
+			    enum dvbsec_diseqc_switch sat_pos,
+			    enum dvbsec_diseqc_switch switch_option)
+{
+	struct dvbfe_handle *fe = state->fe;
+	enum dvbfe_sec_voltage voltage;
+	enum dvbfe_sec_tone_mode tone;
+	enum dvbfe_sec_mini_cmd burst = DVBFE_SEC_MINI_A;
+	int committed;
+	int send_committed;
+	int send_burst;
+
+	switch(polarization) {
+	case DISEQC_POLARIZATION_V:
+	case DISEQC_POLARIZATION_R:
+		voltage = DVBFE_SEC_VOLTAGE_13;
+		break;
+	case DISEQC_POLARIZATION_H:
+	case DISEQC_POLARIZATION_L:
+		voltage = DVBFE_SEC_VOLTAGE_18;
+		break;
+	default:
+		return -EINVAL;
+	}
+	tone = DVBFE_SEC_TONE_OFF;
+	if (oscillator == DISEQC_OSCILLATOR_HIGH)
+		tone = DVBFE_SEC_TONE_ON;
+	if (sat_pos == DISEQC_SWITCH_B)
+		burst = DVBFE_SEC_MINI_B;
+
+	// work out the whole sequence before touching the bus
+	committed = (DISEQC_ADDRESS_ANY_DEVICE << 8) |
+		    0xf0 | ((oscillator == DISEQC_OSCILLATOR_HIGH) ? 0x01 : 0) |
+		    ((voltage == DVBFE_SEC_VOLTAGE_18) ? 0x02 : 0) |
+		    ((sat_pos == DISEQC_SWITCH_B) ? 0x04 : 0) |
+		    ((switch_option == DISEQC_SWITCH_B) ? 0x08 : 0);
+	if ((oscillator == DISEQC_OSCILLATOR_UNCHANGED) ||
+	    (sat_pos == DISEQC_SWITCH_UNCHANGED) ||
+	    (switch_option == DISEQC_SWITCH_UNCHANGED))
+		committed = -1;
+	send_committed = (committed == -1) || (committed != state->committed);
+
+	// a toneburst switch may take a DiSEqC message for burst B, so the
+	// burst has to follow any message
+	send_burst = (sat_pos != DISEQC_SWITCH_UNCHANGED) &&
+		     (send_committed || (state->burst != (int) burst));
+
+	if (send_committed || send_burst)
+		sec_set_tone(fe, state, DVBFE_SEC_TONE_OFF);
+	sec_set_voltage(fe, state, voltage);
+	if (send_committed)
+		sec_committed_switches(fe, state,
+				       DISEQC_ADDRESS_ANY_DEVICE,
+				       oscillator,
+				       polarization,
+				       sat_pos,
+				       switch_option);
+	else
+		sec_step_skipped(state);
+	if (send_burst)
+		sec_set_burst(fe, state, burst);
+	else if (sat_pos != DISEQC_SWITCH_UNCHANGED)
+		sec_step_skipped(state);
+	sec_set_tone(fe, state, tone);
+
+	return 0;
+}
+
+static int sec_set_voltage(struct dvbfe_handle *fe, struct dvbsec_state *state,
+			   enum dvbfe_sec_voltage voltage)
+{
+	int ret;
+
+	if (state == NULL)
+		return dvbfe_set_voltage(fe, voltage);
+	if (state->voltage == (int) voltage) {
+		sec_step_skipped(state);
+		return 0;
+	}
+
+	// voltage changes are not DiSEqC signalling, so need no gap
+	ret = dvbfe_set_voltage(fe, voltage);
+	state->voltage = ret ? -1 : (int) voltage;
+	sec_step_done(state);
+	return ret;
+}
+
+static int sec_set_tone(struct dvbfe_handle *fe, struct dvbsec_state *state,
+			enum dvbfe_sec_tone_mode tone)
+{
+	int ret;
+
+	if (state == NULL)
+		return dvbfe_set_22k_tone(fe, tone);
+	if (state->tone == (int) tone) {
+		sec_step_skipped(state);
+		return 0;
+	}
+
+	// the bus must be quiet before the tone comes on, not before it stops
+	if (tone == DVBFE_SEC_TONE_ON)
+		sec_step_start(state);
+	ret = dvbfe_set_22k_tone(fe, tone);
+	state->tone = ret ? -1 : (int) tone;
+	sec_step_done(state);
+	return ret;
+}
+
+static int sec_set_burst(struct dvbfe_handle *fe, struct dvbsec_state *state,
+			 enum dvbfe_sec_mini_cmd burst)
+{
+	int ret;
+
+	if (state == NULL)
+		return dvbfe_set_tone_data_burst(fe, burst);
+	if (state->burst == (int) burst) {
+		sec_step_skipped(state);
+		return 0;
+	}
+
+	sec_step_start(state);
+	ret = dvbfe_set_tone_data_burst(fe, burst);
+	state->burst = ret ? -1 : (int) burst;
+	sec_step_done(state);
+	return ret;
+}
+
+static int sec_diseqc(struct dvbfe_handle *fe, struct dvbsec_state *state,
+		      uint8_t *data, uint8_t len)
+{
+	int *last = NULL;
+	int ret;
+
+	if (state == NULL)
+		return dvbfe_do_diseqc_command(fe, data, len);
+
+	// only write N0/N1 commands setting all four switches can be tracked
+	if ((len == 4) && (data[2] == 0x38) && ((data[3] & 0xf0) == 0xf0))
+		last = &state->committed;
+	if ((len == 4) && (data[2] == 0x39) && ((data[3] & 0xf0) == 0xf0))
+		last = &state->uncommitted;
+	if (last && (*last == ((data[1] << 8) | data[3]))) {
+		sec_step_skipped(state);
+		return 0;
+	}
+
+	sec_step_start(state);
+	ret = dvbfe_do_diseqc_command(fe, data, len);
+	sec_step_done(state);
+
+	// a toneburst switch may take the message for burst B, so the burst
+	// has to be sent again after it
+	state->burst = -1;
+
+	// anything else may have moved a switch: forget what we knew
+	if (last == NULL) {
+		state->committed = -1;
+		state->uncommitted = -1;
+	} else {
+		*last = ret ? -1 : ((data[1] << 8) | data[3]);
+	}
+	return ret;
+}
+
+static void sec_wait(struct dvbsec_state *state, int ms)
+{
+	uint32_t elapsed;
+
+	if (state == NULL) {
+		if (ms)
+			usleep(ms * 1000);
+		return;
+	}
+
+	// a wait after steps that were all skipped has nothing to wait for
+	if (!state->pending)
+		return;
+	state->pending = 0;
+
+	elapsed = sec_elapsed_us(&state->last_step);
+	if (elapsed < (uint32_t) ms * 1000)
+		usleep((ms * 1000) - elapsed);
+}
+
+static void sec_step_start(struct dvbsec_state *state)
+{
+	uint32_t elapsed;
+
+	if (state == NULL)
+		return;
+
+	elapsed = sec_elapsed_us(&state->last_step);
+	if (elapsed < DVBSEC_STEP_GAP_MS * 1000)
+		usleep((DVBSEC_STEP_GAP_MS * 1000) - elapsed);
+}
+
+static void sec_step_done(struct dvbsec_state *state)
+{
+	if (state == NULL)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &state->last_step);
+	state->pending = 1;
+	state->stats.last_sent++;
+	state->stats.sent++;
+}
+
+// a command we do not track may have changed the switches or the voltage
+static void sec_forget(struct dvbsec_state *state)
+{
+	if (state == NULL)
+		return;
+
+	state->voltage = -1;
+	state->committed = -1;
+	state->uncommitted = -1;
+}
+
+static void sec_step_skipped(struct dvbsec_state *state)
+{
+	state->stats.last_skipped++;
+	state->stats.skipped++;
+}
+
+static uint32_t sec_elapsed_us(struct timespec *since)
+{
+	struct timespec now;
+	int64_t us;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	us = ((int64_t) (now.tv_sec - since->tv_sec) * 1000000) +
+	     ((now.tv_nsec - since->tv_nsec) / 1000);
+	if (us > 0xffffffff)
+		return 0xffffffff;
+	return us;
+}
+
 int dvbsec_diseqc_set_reset(struct dvbfe_handle *fe,
 			   enum dvbsec_diseqc_address address,
 			   enum dvbsec_diseqc_reset state)
@@ -270,6 +656,18 @@ int dvbsec_diseqc_set_committed_switches(struct dvbfe_handle *fe,
 					enum dvbsec_diseqc_polarization polarization,
 					enum dvbsec_diseqc_switch sat_pos,
 					enum dvbsec_diseqc_switch switch_option)
+{
+	return sec_committed_switches(fe, NULL, address, oscillator,
+				      polarization, sat_pos, switch_option);
+}
+
+static int sec_committed_switches(struct dvbfe_handle *fe,
+				  struct dvbsec_state *state,
+				  enum dvbsec_diseqc_address address,
+				  enum dvbsec_diseqc_oscillator oscillator,
+				  enum dvbsec_diseqc_polarization polarization,
+				  enum dvbsec_diseqc_switch sat_pos,
+				  enum dvbsec_diseqc_switch switch_option)
 {
 	uint8_t data[] = { DISEQC_FRAMING_MASTER_NOREPLY, address, 0x38, 0x00 };
 
@@ -319,7 +717,7 @@ int dvbsec_diseqc_set_committed_switches(struct dvbfe_handle *fe,
 	if (data[3] == 0)
 		return 0;
 
-	return dvbfe_do_diseqc_command(fe, data, sizeof(data));
+	return sec_diseqc(fe, state, data, sizeof(data));
 }
 
 int dvbsec_diseqc_set_uncommitted_switches(struct dvbfe_handle *fe,
@@ -328,6 +726,17 @@ int dvbsec_diseqc_set_uncommitted_switches(struct dvbfe_handle *fe,
 					  enum dvbsec_diseqc_switch s2,
 					  enum dvbsec_diseqc_switch s3,
 					  enum dvbsec_diseqc_switch s4)
+{
+	return sec_uncommitted_switches(fe, NULL, address, s1, s2, s3, s4);
+}
+
+static int sec_uncommitted_switches(struct dvbfe_handle *fe,
+				    struct dvbsec_state *state,
+				    enum dvbsec_diseqc_address address,
+				    enum dvbsec_diseqc_switch s1,
+				    enum dvbsec_diseqc_switch s2,
+				    enum dvbsec_diseqc_switch s3,
+				    enum dvbsec_diseqc_switch s4)
 {
 	uint8_t data[] = { DISEQC_FRAMING_MASTER_NOREPLY, address, 0x39, 0x00 };
 
@@ -375,7 +784,7 @@ int dvbsec_diseqc_set_uncommitted_switches(struct dvbfe_handle *fe,
 	if (data[3] == 0)
 		return 0;
 
-	return dvbfe_do_diseqc_command(fe, data, sizeof(data));
+	return sec_diseqc(fe, state, data, sizeof(data));
 }
 
 int dvbsec_diseqc_set_analog_value(struct dvbfe_handle *fe,
@@ -689,6 +1098,11 @@ static enum dvbsec_diseqc_switch parse_switch(int c)
 }
 
 int dvbsec_command(struct dvbfe_handle *fe, char *command)
+{
+	return sec_command(fe, NULL, command);
+}
+
+static int sec_command(struct dvbfe_handle *fe, struct dvbsec_state *state, char *command)
 {
 	char *name;
 	char *args;
@@ -712,9 +1126,9 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 			printf("tone: %c\n", iarg);
 #else
 			if (toupper(iarg) == 'B') {
-				dvbfe_set_22k_tone(fe, DVBFE_SEC_TONE_ON);
+				sec_set_tone(fe, state, DVBFE_SEC_TONE_ON);
 			} else {
-				dvbfe_set_22k_tone(fe, DVBFE_SEC_TONE_OFF);
+				sec_set_tone(fe, state, DVBFE_SEC_TONE_OFF);
 			}
 #endif
 		} else if (!strncasecmp(name, "voltage", namelen)) {
@@ -726,13 +1140,13 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 #else
 			switch(iarg) {
 			case 0:
-				dvbfe_set_voltage(fe, DVBFE_SEC_VOLTAGE_OFF);
+				sec_set_voltage(fe, state, DVBFE_SEC_VOLTAGE_OFF);
 				break;
 			case 13:
-				dvbfe_set_voltage(fe, DVBFE_SEC_VOLTAGE_13);
+				sec_set_voltage(fe, state, DVBFE_SEC_VOLTAGE_13);
 				break;
 			case 18:
-				dvbfe_set_voltage(fe, DVBFE_SEC_VOLTAGE_18);
+				sec_set_voltage(fe, state, DVBFE_SEC_VOLTAGE_18);
 				break;
 			default:
 				return -1;
@@ -746,9 +1160,9 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 			printf("toneburst: %c\n", iarg);
 #else
 			if (toupper(iarg) == 'B') {
-				dvbfe_set_tone_data_burst(fe, DVBFE_SEC_MINI_B);
+				sec_set_burst(fe, state, DVBFE_SEC_MINI_B);
 			} else {
-				dvbfe_set_tone_data_burst(fe, DVBFE_SEC_MINI_A);
+				sec_set_burst(fe, state, DVBFE_SEC_MINI_A);
 			}
 #endif
 		} else if (!strncasecmp(name, "highvoltage", namelen)) {
@@ -759,6 +1173,7 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 			printf("highvoltage: %i\n", iarg);
 #else
 			dvbfe_set_high_lnb_voltage(fe, iarg ? 1 : 0);
+			sec_step_done(state);
 #endif
 		} else if (!strncasecmp(name, "dishnetworks", namelen)) {
 			if (parseintarg(&args, argsend, &iarg))
@@ -767,7 +1182,10 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 #ifdef TEST_SEC_COMMAND
 			printf("dishnetworks: %i\n", iarg);
 #else
+			sec_step_start(state);
 			dvbfe_do_dishnetworks_legacy_command(fe, iarg);
+			sec_step_done(state);
+			sec_forget(state);
 #endif
 		} else if (!strncasecmp(name, "wait", namelen)) {
 			if (parseintarg(&args, argsend, &iarg))
@@ -776,8 +1194,7 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 #ifdef TEST_SEC_COMMAND
 			printf("wait: %i\n", iarg);
 #else
-			if (iarg)
-				usleep(iarg * 1000);
+			sec_wait(state, iarg);
 #endif
 		} else if (!strncasecmp(name, "Dreset", namelen)) {
 			if (parseintarg(&args, argsend, &address))
@@ -788,11 +1205,14 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 #ifdef TEST_SEC_COMMAND
 			printf("Dreset: %i %i\n", address, iarg);
 #else
+			sec_step_start(state);
 			if (iarg) {
 				dvbsec_diseqc_set_reset(fe, address, DISEQC_RESET);
 			} else {
 				dvbsec_diseqc_set_reset(fe, address, DISEQC_RESET_CLEAR);
 			}
+			sec_step_done(state);
+			sec_forget(state);
 #endif
 		} else if (!strncasecmp(name, "Dpower", namelen)) {
 			if (parseintarg(&args, argsend, &address))
@@ -803,11 +1223,14 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 #ifdef TEST_SEC_COMMAND
 			printf("Dpower: %i %i\n", address, iarg);
 #else
+			sec_step_start(state);
 			if (iarg) {
 				dvbsec_diseqc_set_power(fe, address, DISEQC_POWER_ON);
 			} else {
 				dvbsec_diseqc_set_power(fe, address, DISEQC_POWER_OFF);
 			}
+			sec_step_done(state);
+			sec_forget(state);
 #endif
 		} else if (!strncasecmp(name, "Dcommitted", namelen)) {
 			if (parseintarg(&args, argsend, &address))
@@ -860,7 +1283,7 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 			       parse_switch(iarg3),
 			       parse_switch(iarg4));
 #else
-			dvbsec_diseqc_set_committed_switches(fe, address,
+			sec_committed_switches(fe, state, address,
 							    oscillator,
 							    polarization,
 							    parse_switch(iarg3),
@@ -885,7 +1308,7 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 			       parse_switch(iarg3),
 			       parse_switch(iarg4));
 #else
-			dvbsec_diseqc_set_uncommitted_switches(fe, address,
+			sec_uncommitted_switches(fe, state, address,
 					parse_switch(iarg),
 					parse_switch(iarg2),
 					parse_switch(iarg3),
@@ -900,7 +1323,9 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 #ifdef TEST_SEC_COMMAND
 			printf("Dfrequency: %i %i\n", address, iarg);
 #else
+			sec_step_start(state);
 			dvbsec_diseqc_set_frequency(fe, address, iarg);
+			sec_step_done(state);
 #endif
 		} else if (!strncasecmp(name, "Dchannel", namelen)) {
 			if (parseintarg(&args, argsend, &address))
@@ -911,7 +1336,9 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 #ifdef TEST_SEC_COMMAND
 			printf("Dchannel: %i %i\n", address, iarg);
 #else
+			sec_step_start(state);
 			dvbsec_diseqc_set_channel(fe, address, iarg);
+			sec_step_done(state);
 #endif
 		} else if (!strncasecmp(name, "Dgotopreset", namelen)) {
 			if (parseintarg(&args, argsend, &address))
@@ -922,7 +1349,9 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 #ifdef TEST_SEC_COMMAND
 			printf("Dgotopreset: %i %i\n", address, iarg);
 #else
+			sec_step_start(state);
 			dvbsec_diseqc_goto_satpos_preset(fe, address, iarg);
+			sec_step_done(state);
 #endif
 		} else if (!strncasecmp(name, "Dgotobearing", namelen)) {
 			if (parseintarg(&args, argsend, &address))
@@ -933,7 +1362,9 @@ int dvbsec_command(struct dvbfe_handle *fe, char *command)
 #ifdef TEST_SEC_COMMAND
 			printf("Dgotobearing: %i %f\n", address, farg);
 #else
+			sec_step_start(state);
 			dvbsec_diseqc_goto_rotator_bearing(fe, address, farg);
+			sec_step_done(state);
 #endif
 		} else {
 			return -1;
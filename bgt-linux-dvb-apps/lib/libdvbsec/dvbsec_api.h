@@ -192,6 +192,100 @@ extern int dvbsec_set(struct dvbfe_handle *fe,
 			  struct dvbfe_parameters *params,
 			  int timeout);
 
+/**
+ * SEC state of a frontend. This remembers what the voltage, tone, toneburst and
+ * DISEQC switches were last set to, so that tuning with dvbsec_state_set()
+ * only issues the steps which change something. The remaining steps are
+ * separated by the minimum gaps of the DISEQC specification, measured from the
+ * previous step rather than added after it.
+ *
+ * The state assumes nothing else drives the SEC of the frontend: call
+ * dvbsec_state_reset() if something might have.
+ */
+struct dvbsec_state;
+
+/**
+ * Counters kept by an SEC state.
+ */
+struct dvbsec_state_stats {
+	uint32_t last_us;	/* time spent on SEC by the last dvbsec_state_set() */
+	uint32_t last_sent;	/* steps it issued */
+	uint32_t last_skipped;	/* steps it skipped as already applied */
+	uint32_t sent;		/* steps issued in total */
+	uint32_t skipped;	/* steps skipped in total */
+};
+
+/**
+ * Create an SEC state for a frontend. Nothing is known about the SEC at first,
+ * so the first tune issues the full sequence.
+ *
+ * @param fe Frontend concerned.
+ * @return The new instance, or NULL on error.
+ */
+extern struct dvbsec_state *dvbsec_state_create(struct dvbfe_handle *fe);
+
+/**
+ * Destroy an SEC state.
+ *
+ * @param state The instance.
+ */
+extern void dvbsec_state_destroy(struct dvbsec_state *state);
+
+/**
+ * Forget what the SEC was set to, so that the next tune issues the full
+ * sequence.
+ *
+ * @param state The instance.
+ */
+extern void dvbsec_state_reset(struct dvbsec_state *state);
+
+/**
+ * As dvbsec_set(), skipping the SEC steps which would not change anything.
+ *
+ * In ADVANCED configurations, tone, voltage, toneburst and DISEQC switch
+ * commands are skipped the same way - except that a toneburst is always resent
+ * after a DISEQC message, which a toneburst switch may have taken for burst B.
+ * A wait() only waits for what is left of its time since the last command
+ * issued - and not at all if every command since the previous wait() was
+ * skipped.
+ *
+ * @param state The instance.
+ * @param sec_config SEC configuration structure. May be NULL to disable SEC/frequency adjustment.
+ * @param polarization Polarization of signal.
+ * @param sat_pos Satellite position - only used if type == DISEQC_SEC_CONFIG_STANDARD.
+ * @param switch_option Switch option - only used if type == DISEQC_SEC_CONFIG_STANDARD.
+ * @param params Tuning parameters.
+ * @param timeout <0 => wait forever for lock. 0=>return immediately, >0=>
+ * number of milliseconds to wait for a lock.
+ * @return 0 on locked (or if timeout==0 and everything else worked), or
+ * nonzero on failure (including no lock).
+ */
+extern int dvbsec_state_set(struct dvbsec_state *state,
+			    struct dvbsec_config *sec_config,
+			    enum dvbsec_diseqc_polarization polarization,
+			    enum dvbsec_diseqc_switch sat_pos,
+			    enum dvbsec_diseqc_switch switch_option,
+			    struct dvbfe_parameters *params,
+			    int timeout);
+
+/**
+ * As dvbsec_command(), skipping steps as dvbsec_state_set() does.
+ *
+ * @param state The instance.
+ * @param command The command to execute.
+ * @return 0 on success, or nonzero on error.
+ */
+extern int dvbsec_state_command(struct dvbsec_state *state, char *command);
+
+/**
+ * Retrieve the counters.
+ *
+ * @param state The instance.
+ * @param stats Where to put them.
+ */
+extern void dvbsec_state_get_stats(struct dvbsec_state *state,
+				   struct dvbsec_state_stats *stats);
+
 /**
  * This will issue the standardised back-compatable DISEQC/SEC command
  * sequence as defined in the DISEQC spec:
@@ -28,7 +28,7 @@
 #include <libesg/representation/init_message.h>
 #include <libesg/transport/session_partition_declaration.h>
 
-struct esg_container *esg_container_decode(uint8_t *buffer, uint32_t size) {
+static struct esg_container *esg_container_decode_internal(uint8_t *buffer, uint32_t size, int referenced) {
 	uint32_t pos;
 	struct esg_container *container;
 	struct esg_container_structure *structure;
@@ -43,6 +43,7 @@ struct esg_container *esg_container_decode(uint8_t *buffer, uint32_t size) {
 
 	container = (struct esg_container *) malloc(sizeof(struct esg_container));
 	memset(container, 0, sizeof(struct esg_container));
+	container->_referenced = referenced;
 
 	// Container header
 	container->header = (struct esg_container_header *) malloc(sizeof(struct esg_container_header));
@@ -104,7 +105,11 @@ struct esg_container *esg_container_decode(uint8_t *buffer, uint32_t size) {
 			case 0x02: {
 				switch (structure->id) {
 					case 0x00: {
-						structure->data = (void *) esg_string_repository_decode(buffer + structure->ptr, structure->length);
+						if (referenced) {
+							structure->data = (void *) esg_string_repository_decode_ref(buffer + structure->ptr, structure->length);
+						} else {
+							structure->data = (void *) esg_string_repository_decode(buffer + structure->ptr, structure->length);
+						}
 						break;
 					}
 					default: {
@@ -129,7 +134,11 @@ struct esg_container *esg_container_decode(uint8_t *buffer, uint32_t size) {
 			case 0xE0: {
 				switch (structure->id) {
 					case 0x00: {
-						structure->data = (void *) esg_data_repository_decode(buffer + structure->ptr, structure->length);
+						if (referenced) {
+							structure->data = (void *) esg_data_repository_decode_ref(buffer + structure->ptr, structure->length);
+						} else {
+							structure->data = (void *) esg_data_repository_decode(buffer + structure->ptr, structure->length);
+						}
 						break;
 					}
 					default: {
@@ -175,12 +184,53 @@ struct esg_container *esg_container_decode(uint8_t *buffer, uint32_t size) {
 	// Container structure body
 	container->structure_body_ptr = pos;
 	container->structure_body_length = size - pos;
-	container->structure_body = (uint8_t *) malloc(size - pos);
-	memcpy(container->structure_body, buffer + pos, size - pos);
+	if (referenced) {
+		container->structure_body = buffer + pos;
+	} else {
+		container->structure_body = (uint8_t *) malloc(size - pos);
+		memcpy(container->structure_body, buffer + pos, size - pos);
+	}
 
 	return container;
 }
 
+struct esg_container *esg_container_decode(uint8_t *buffer, uint32_t size) {
+	return esg_container_decode_internal(buffer, size, 0);
+}
+
+struct esg_container *esg_container_decode_ref(uint8_t *buffer, uint32_t size) {
+	return esg_container_decode_internal(buffer, size, 1);
+}
+
+static void esg_container_structure_data_free(struct esg_container_structure *structure) {
+	if (structure->data == NULL) {
+		return;
+	}
+
+	switch (structure->type) {
+		case 0x01: {
+			esg_encapsulation_structure_free((struct esg_encapsulation_structure *) structure->data);
+			break;
+		}
+		case 0x02: {
+			esg_string_repository_free((struct esg_string_repository *) structure->data);
+			break;
+		}
+		case 0xE0: {
+			esg_data_repository_free((struct esg_data_repository *) structure->data);
+			break;
+		}
+		case 0xE1: {
+			esg_session_partition_declaration_free((struct esg_session_partition_declaration *) structure->data);
+			break;
+		}
+		case 0xE2: {
+			esg_init_message_free((struct esg_init_message *) structure->data);
+			break;
+		}
+	}
+}
+
 void esg_container_free(struct esg_container *container) {
 	struct esg_container_structure *structure;
 	struct esg_container_structure *next_structure;
@@ -192,13 +242,14 @@ void esg_container_free(struct esg_container *container) {
 	if (container->header) {
 		for(structure = container->header->structure_list; structure; structure = next_structure) {
 			next_structure = structure->_next;
+			esg_container_structure_data_free(structure);
 			free(structure);
 		}
 
 		free(container->header);
 	}
 
-	if (container->structure_body) {
+	if (container->structure_body && !container->_referenced) {
 		free(container->structure_body);
 	}
 
@@ -58,6 +58,8 @@ struct esg_container {
 	uint32_t structure_body_ptr;
 	uint32_t structure_body_length;
 	uint8_t *structure_body;
+
+	uint8_t _referenced;
 };
 
 /**
@@ -70,7 +72,19 @@ struct esg_container {
 extern struct esg_container *esg_container_decode(uint8_t *buffer, uint32_t size);
 
 /**
- * Free an esg_container.
+ * Process an esg_container without copying its structure body or
+ * repositories: they point into the buffer, which must stay valid until the
+ * container is freed. Use this when the buffer already outlives the
+ * decoded container, e.g. a reassembled FLUTE object.
+ *
+ * @param buffer Binary buffer to decode.
+ * @param size Binary buffer size.
+ * @return Pointer to an esg_container structure, or NULL on error.
+ */
+extern struct esg_container *esg_container_decode_ref(uint8_t *buffer, uint32_t size);
+
+/**
+ * Free an esg_container, including the decoded data of its structures.
  *
  * @param container Pointer to an esg_container structure.
  */
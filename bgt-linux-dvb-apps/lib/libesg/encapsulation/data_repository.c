@@ -23,7 +23,7 @@
 
 #include <libesg/encapsulation/data_repository.h>
 
-struct esg_data_repository *esg_data_repository_decode(uint8_t *buffer, uint32_t size) {
+static struct esg_data_repository *esg_data_repository_decode_internal(uint8_t *buffer, uint32_t size, int referenced) {
 	struct esg_data_repository *data_repository;
 
 	if ((buffer == NULL) || (size <= 0)) {
@@ -34,18 +34,31 @@ struct esg_data_repository *esg_data_repository_decode(uint8_t *buffer, uint32_t
 	memset(data_repository, 0, sizeof(struct esg_data_repository));
 
 	data_repository->length = size;
-	data_repository->data = (uint8_t *) malloc(size);
-	memcpy(data_repository->data, buffer, size);
+	if (referenced) {
+		data_repository->data = buffer;
+		data_repository->_referenced = 1;
+	} else {
+		data_repository->data = (uint8_t *) malloc(size);
+		memcpy(data_repository->data, buffer, size);
+	}
 
 	return data_repository;
 }
 
+struct esg_data_repository *esg_data_repository_decode(uint8_t *buffer, uint32_t size) {
+	return esg_data_repository_decode_internal(buffer, size, 0);
+}
+
+struct esg_data_repository *esg_data_repository_decode_ref(uint8_t *buffer, uint32_t size) {
+	return esg_data_repository_decode_internal(buffer, size, 1);
+}
+
 void esg_data_repository_free(struct esg_data_repository *data_repository) {
 	if (data_repository == NULL) {
 		return;
 	}
 
-	if (data_repository->data) {
+	if (data_repository->data && !data_repository->_referenced) {
 		free(data_repository->data);
 	}
 
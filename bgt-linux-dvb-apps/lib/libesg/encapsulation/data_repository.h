@@ -34,6 +34,8 @@ extern "C"
 struct esg_data_repository {
 	uint32_t length;
 	uint8_t *data;
+
+	uint8_t _referenced;
 };
 
 /**
@@ -45,6 +47,16 @@ struct esg_data_repository {
  */
 extern struct esg_data_repository *esg_data_repository_decode(uint8_t *buffer, uint32_t size);
 
+/**
+ * Process an esg_data_repository, referencing the buffer instead of copying
+ * it. The buffer must stay valid until the structure is freed.
+ *
+ * @param buffer Binary buffer to decode.
+ * @param size Binary buffer size.
+ * @return Pointer to an esg_data_repository structure, or NULL on error.
+ */
+extern struct esg_data_repository *esg_data_repository_decode_ref(uint8_t *buffer, uint32_t size);
+
 /**
  * Free an esg_data_repository.
  *
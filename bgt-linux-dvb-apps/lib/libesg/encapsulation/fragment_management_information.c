@@ -47,7 +47,7 @@ struct esg_encapsulation_structure *esg_encapsulation_structure_decode(uint8_t *
 
 	// Encapsulation entry list
 	last_entry = NULL;
-	while (size > pos) {
+	while (size >= pos + 8) {
 		entry = (struct esg_encapsulation_entry *) malloc(sizeof(struct esg_encapsulation_entry));
 		memset(entry, 0, sizeof(struct esg_encapsulation_entry));
 		entry->_next = NULL;
@@ -110,8 +110,6 @@ void esg_encapsulation_structure_free(struct esg_encapsulation_structure *struct
 			}
 			free(entry);
 		}
-
-		free(structure->entry_list);
 	}
 
 	free(structure);
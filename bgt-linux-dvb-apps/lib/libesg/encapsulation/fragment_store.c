@@ -0,0 +1,269 @@
+/*
+ * ESG parser
+ *
+ * Copyright (C) 2006 Stephane Este-Gracias (sestegra@free.fr)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libesg/encapsulation/fragment_store.h>
+#include <libesg/encapsulation/fragment_management_information.h>
+#include <libesg/encapsulation/data_repository.h>
+#include <libesg/representation/init_message.h>
+#include <libesg/representation/encapsulated_textual_esg_xml_fragment.h>
+
+static uint32_t esg_fragment_store_hash(uint32_t id) {
+	return (id ^ (id >> 8) ^ (id >> 16)) & (ESG_FRAGMENT_STORE_HASH_SIZE - 1);
+}
+
+static void esg_fragment_free(struct esg_fragment *fragment) {
+	if (fragment->data) {
+		free(fragment->data);
+	}
+
+	free(fragment);
+}
+
+static void esg_fragment_store_unhash(struct esg_fragment_store *store, struct esg_fragment *fragment) {
+	struct esg_fragment **hash_fragment;
+
+	for (hash_fragment = &store->_hash[esg_fragment_store_hash(fragment->id)]; *hash_fragment; hash_fragment = &(*hash_fragment)->_hash_next) {
+		if (*hash_fragment == fragment) {
+			*hash_fragment = fragment->_hash_next;
+			break;
+		}
+	}
+}
+
+/*
+ * Decode the fragment at the given offset of the data repository into an
+ * owned, NUL terminated copy. The textual fragment is decoded by reference,
+ * so the data is copied only once, or not at all before inflating.
+ */
+static int esg_fragment_store_decode(struct esg_fragment_store *store, struct esg_data_repository *data_repository,
+				     uint32_t offset, uint16_t *esg_xml_fragment_type, uint8_t **data, uint32_t *length) {
+	struct esg_encapsulated_textual_esg_xml_fragment *esg_xml_fragment;
+	int result = 0;
+
+	if (offset >= data_repository->length) {
+		return -1;
+	}
+
+	esg_xml_fragment = esg_encapsulated_textual_esg_xml_fragment_decode_ref(data_repository->data + offset, data_repository->length - offset);
+	if (esg_xml_fragment == NULL) {
+		return -1;
+	}
+	*esg_xml_fragment_type = esg_xml_fragment->esg_xml_fragment_type;
+
+	switch (store->encoding_version) {
+		case 0xF2: {
+			if (store->_gzip_decoder == NULL) {
+				store->_gzip_decoder = esg_gzip_decoder_create();
+			}
+			if ((store->_gzip_decoder == NULL) ||
+			    esg_gzip_decoder_inflate(store->_gzip_decoder, esg_xml_fragment->data, esg_xml_fragment->data_length, data, length)) {
+				result = -1;
+			}
+			break;
+		}
+		case 0xF3: {
+			*data = (uint8_t *) malloc(esg_xml_fragment->data_length + 1);
+			if (*data == NULL) {
+				result = -1;
+				break;
+			}
+			memcpy(*data, esg_xml_fragment->data, esg_xml_fragment->data_length);
+			(*data)[esg_xml_fragment->data_length] = 0;
+			*length = esg_xml_fragment->data_length;
+			break;
+		}
+		default: {
+			// BiM : not supported
+			result = -1;
+			break;
+		}
+	}
+
+	esg_encapsulated_textual_esg_xml_fragment_free(esg_xml_fragment);
+
+	return result;
+}
+
+struct esg_fragment_store *esg_fragment_store_create(void) {
+	struct esg_fragment_store *store;
+
+	store = (struct esg_fragment_store *) malloc(sizeof(struct esg_fragment_store));
+	if (store == NULL) {
+		return NULL;
+	}
+	memset(store, 0, sizeof(struct esg_fragment_store));
+
+	store->encoding_version = 0xF3;
+
+	return store;
+}
+
+void esg_fragment_store_free(struct esg_fragment_store *store) {
+	struct esg_fragment *fragment;
+	struct esg_fragment *next_fragment;
+
+	if (store == NULL) {
+		return;
+	}
+
+	for (fragment = store->fragment_list; fragment; fragment = next_fragment) {
+		next_fragment = fragment->_next;
+		esg_fragment_free(fragment);
+	}
+
+	esg_gzip_decoder_free(store->_gzip_decoder);
+
+	free(store);
+}
+
+struct esg_fragment *esg_fragment_store_find(struct esg_fragment_store *store, uint32_t id) {
+	struct esg_fragment *fragment;
+
+	for (fragment = store->_hash[esg_fragment_store_hash(id)]; fragment; fragment = fragment->_hash_next) {
+		if (fragment->id == id) {
+			return fragment;
+		}
+	}
+
+	return NULL;
+}
+
+int esg_fragment_store_update(struct esg_fragment_store *store, uint8_t container_id,
+			      struct esg_container *container, struct esg_fragment_store_stats *stats) {
+	struct esg_container_structure *structure;
+	struct esg_encapsulation_structure *fragment_management_information = NULL;
+	struct esg_data_repository *data_repository = NULL;
+	struct esg_encapsulation_entry *entry;
+	struct esg_fragment *fragment;
+	struct esg_fragment **list_fragment;
+	struct esg_fragment_store_stats update_stats;
+	uint16_t esg_xml_fragment_type;
+	uint8_t *data;
+	uint32_t length;
+	uint32_t hash;
+
+	memset(&update_stats, 0, sizeof(struct esg_fragment_store_stats));
+
+	esg_container_header_structure_list_for_each(container->header, structure) {
+		if (structure->data == NULL) {
+			continue;
+		}
+		switch (structure->type) {
+			case 0x01: {
+				fragment_management_information = (struct esg_encapsulation_structure *) structure->data;
+				break;
+			}
+			case 0xE0: {
+				data_repository = (struct esg_data_repository *) structure->data;
+				break;
+			}
+			case 0xE2: {
+				store->encoding_version = ((struct esg_init_message *) structure->data)->encoding_version;
+				break;
+			}
+		}
+	}
+
+	if ((fragment_management_information == NULL) || (data_repository == NULL)) {
+		if (stats) {
+			memcpy(stats, &update_stats, sizeof(struct esg_fragment_store_stats));
+		}
+		return ((fragment_management_information == NULL) && (data_repository == NULL)) ? 0 : -1;
+	}
+
+	store->_generation++;
+
+	esg_encapsulation_structure_entry_list_for_each(fragment_management_information, entry) {
+		fragment = esg_fragment_store_find(store, entry->fragment_id);
+
+		if (fragment && (fragment->version == entry->fragment_version)) {
+			fragment->container_id = container_id;
+			fragment->_generation = store->_generation;
+			update_stats.unchanged++;
+			continue;
+		}
+
+		// Only ESG XML fragments (0x00) carry data we can decode
+		if ((entry->fragment_reference == NULL) || (entry->fragment_reference->fragment_type != 0x00) ||
+		    esg_fragment_store_decode(store, data_repository, entry->fragment_reference->data_repository_offset,
+					      &esg_xml_fragment_type, &data, &length)) {
+			if (fragment) {
+				// Keep the old version rather than lose the fragment
+				fragment->_generation = store->_generation;
+			}
+			update_stats.failed++;
+			continue;
+		}
+
+		if (fragment) {
+			free(fragment->data);
+			update_stats.updated++;
+		} else {
+			fragment = (struct esg_fragment *) malloc(sizeof(struct esg_fragment));
+			if (fragment == NULL) {
+				free(data);
+				update_stats.failed++;
+				continue;
+			}
+			memset(fragment, 0, sizeof(struct esg_fragment));
+			fragment->id = entry->fragment_id;
+
+			hash = esg_fragment_store_hash(fragment->id);
+			fragment->_hash_next = store->_hash[hash];
+			store->_hash[hash] = fragment;
+			fragment->_next = store->fragment_list;
+			store->fragment_list = fragment;
+			store->num_fragments++;
+			update_stats.added++;
+		}
+
+		fragment->version = entry->fragment_version;
+		fragment->container_id = container_id;
+		fragment->esg_xml_fragment_type = esg_xml_fragment_type;
+		fragment->data = data;
+		fragment->length = length;
+		fragment->_generation = store->_generation;
+	}
+
+	// Remove the fragments this container no longer lists
+	list_fragment = &store->fragment_list;
+	while (*list_fragment) {
+		fragment = *list_fragment;
+		if ((fragment->container_id != container_id) || (fragment->_generation == store->_generation)) {
+			list_fragment = &fragment->_next;
+			continue;
+		}
+
+		*list_fragment = fragment->_next;
+		esg_fragment_store_unhash(store, fragment);
+		esg_fragment_free(fragment);
+		store->num_fragments--;
+		update_stats.removed++;
+	}
+
+	if (stats) {
+		memcpy(stats, &update_stats, sizeof(struct esg_fragment_store_stats));
+	}
+
+	return update_stats.added + update_stats.updated + update_stats.removed;
+}
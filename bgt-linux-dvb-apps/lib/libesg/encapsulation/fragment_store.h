@@ -0,0 +1,144 @@
+/*
+ * ESG parser
+ *
+ * Copyright (C) 2006 Stephane Este-Gracias (sestegra@free.fr)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef _ESG_ENCAPSULATION_FRAGMENT_STORE_H
+#define _ESG_ENCAPSULATION_FRAGMENT_STORE_H 1
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <libesg/encapsulation/container.h>
+#include <libesg/representation/gzip_decoder.h>
+
+/**
+ * Number of hash buckets of an esg_fragment_store.
+ */
+#define ESG_FRAGMENT_STORE_HASH_SIZE 256
+
+/**
+ * esg_fragment structure. A decoded ESG XML fragment, owned by the store.
+ */
+struct esg_fragment {
+	uint32_t id;
+	uint8_t version;
+	uint8_t container_id;
+	uint16_t esg_xml_fragment_type;
+	uint32_t length;
+	uint8_t *data; // NUL terminated
+
+	struct esg_fragment *_next;
+	struct esg_fragment *_hash_next;
+	uint32_t _generation;
+};
+
+/**
+ * esg_fragment_store_stats structure. Outcome of an esg_fragment_store_update.
+ */
+struct esg_fragment_store_stats {
+	uint32_t added;
+	uint32_t updated;
+	uint32_t unchanged; // same id and version, not decoded again
+	uint32_t removed;
+	uint32_t failed; // undecodable, or unsupported encoding (BiM)
+};
+
+/**
+ * esg_fragment_store structure.
+ *
+ * Keeps the fragments referenced by the fragment management information of
+ * ESG containers, keyed by fragment_id. Containers are carried in a FLUTE
+ * carousel and come round again unchanged most of the time, so an update
+ * only decodes (and inflates) the fragments whose id is new or whose
+ * version changed.
+ */
+struct esg_fragment_store {
+	uint8_t encoding_version;
+	uint32_t num_fragments;
+	struct esg_fragment *fragment_list;
+
+	struct esg_fragment *_hash[ESG_FRAGMENT_STORE_HASH_SIZE];
+	uint32_t _generation;
+	struct esg_gzip_decoder *_gzip_decoder;
+};
+
+/**
+ * Create an esg_fragment_store. Fragments are assumed to be plain textual
+ * (encoding_version 0xF3) until an init message says otherwise.
+ *
+ * @return Pointer to an esg_fragment_store structure, or NULL on error.
+ */
+extern struct esg_fragment_store *esg_fragment_store_create(void);
+
+/**
+ * Free an esg_fragment_store and all its fragments.
+ *
+ * @param store Pointer to an esg_fragment_store structure.
+ */
+extern void esg_fragment_store_free(struct esg_fragment_store *store);
+
+/**
+ * Apply a container to the store. An init message in the container sets the
+ * encoding_version used from then on. The fragments listed in its fragment
+ * management information are added or replaced when their id is new or
+ * their version changed; fragments previously received in a container with
+ * the same id and missing from this one are removed.
+ *
+ * The container may have been decoded with esg_container_decode_ref: the
+ * store copies what it keeps.
+ *
+ * @param store Pointer to an esg_fragment_store structure.
+ * @param container_id Identifier of the container, e.g. its FLUTE TOI.
+ * @param container Pointer to an esg_container structure.
+ * @param stats Where to put the outcome, or NULL.
+ * @return Number of fragments added, updated or removed, or -1 if the
+ * container has fragment management information without a data repository
+ * or the reverse.
+ */
+extern int esg_fragment_store_update(struct esg_fragment_store *store, uint8_t container_id,
+				     struct esg_container *container, struct esg_fragment_store_stats *stats);
+
+/**
+ * Find a fragment by id.
+ *
+ * @param store Pointer to an esg_fragment_store structure.
+ * @param id The fragment_id.
+ * @return Pointer to an esg_fragment structure, or NULL if not present.
+ */
+extern struct esg_fragment *esg_fragment_store_find(struct esg_fragment_store *store, uint32_t id);
+
+/**
+ * Convenience iterator for fragment_list field of an esg_fragment_store.
+ *
+ * @param store The esg_fragment_store pointer.
+ * @param fragment Variable holding a pointer to the current esg_fragment.
+ */
+#define esg_fragment_store_fragment_list_for_each(store, fragment) \
+	for ((fragment) = (store)->fragment_list; \
+	     (fragment); \
+	     (fragment) = (fragment)->_next)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,7 +23,7 @@
 
 #include <libesg/encapsulation/string_repository.h>
 
-struct esg_string_repository *esg_string_repository_decode(uint8_t *buffer, uint32_t size) {
+static struct esg_string_repository *esg_string_repository_decode_internal(uint8_t *buffer, uint32_t size, int referenced) {
 	struct esg_string_repository *string_repository;
 
 	if ((buffer == NULL) || (size <= 1)) {
@@ -35,18 +35,31 @@ struct esg_string_repository *esg_string_repository_decode(uint8_t *buffer, uint
 
 	string_repository->encoding_type = buffer[0];
 	string_repository->length = size-1;
-	string_repository->data = (uint8_t *) malloc(size-1);
-	memcpy(string_repository->data, buffer+1, size-1);
+	if (referenced) {
+		string_repository->data = buffer+1;
+		string_repository->_referenced = 1;
+	} else {
+		string_repository->data = (uint8_t *) malloc(size-1);
+		memcpy(string_repository->data, buffer+1, size-1);
+	}
 
 	return string_repository;
 }
 
+struct esg_string_repository *esg_string_repository_decode(uint8_t *buffer, uint32_t size) {
+	return esg_string_repository_decode_internal(buffer, size, 0);
+}
+
+struct esg_string_repository *esg_string_repository_decode_ref(uint8_t *buffer, uint32_t size) {
+	return esg_string_repository_decode_internal(buffer, size, 1);
+}
+
 void esg_string_repository_free(struct esg_string_repository *string_repository) {
 	if (string_repository == NULL) {
 		return;
 	}
 
-	if (string_repository->data) {
+	if (string_repository->data && !string_repository->_referenced) {
 		free(string_repository->data);
 	}
 
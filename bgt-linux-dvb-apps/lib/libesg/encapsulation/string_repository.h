@@ -35,6 +35,8 @@ struct esg_string_repository {
 	uint8_t encoding_type;
 	uint32_t length;
 	uint8_t *data;
+
+	uint8_t _referenced;
 };
 
 /**
@@ -46,6 +48,16 @@ struct esg_string_repository {
  */
 extern struct esg_string_repository *esg_string_repository_decode(uint8_t *buffer, uint32_t size);
 
+/**
+ * Process an esg_string_repository, referencing the buffer instead of copying
+ * it. The buffer must stay valid until the structure is freed.
+ *
+ * @param buffer Binary buffer to decode.
+ * @param size Binary buffer size.
+ * @return Pointer to an esg_string_repository structure, or NULL on error.
+ */
+extern struct esg_string_repository *esg_string_repository_decode_ref(uint8_t *buffer, uint32_t size);
+
 /**
  * Free an esg_string_repository.
  *
@@ -24,13 +24,13 @@
 #include <libesg/types.h>
 #include <libesg/representation/encapsulated_textual_esg_xml_fragment.h>
 
-struct esg_encapsulated_textual_esg_xml_fragment *esg_encapsulated_textual_esg_xml_fragment_decode(uint8_t *buffer, uint32_t size) {
+static struct esg_encapsulated_textual_esg_xml_fragment *esg_encapsulated_textual_esg_xml_fragment_decode_internal(uint8_t *buffer, uint32_t size, int referenced) {
 	struct esg_encapsulated_textual_esg_xml_fragment *esg_xml_fragment;
 	uint32_t pos;
 	uint32_t length;
 	uint8_t offset_pos;
 
-	if ((buffer == NULL) || (size <= 0)) {
+	if ((buffer == NULL) || (size <= 2)) {
 		return NULL;
 	}
 
@@ -50,19 +50,32 @@ struct esg_encapsulated_textual_esg_xml_fragment *esg_encapsulated_textual_esg_x
 	pos += 2+offset_pos;
 
 	esg_xml_fragment->data_length = length;
-	esg_xml_fragment->data = (uint8_t *) malloc(length);
-	memcpy(esg_xml_fragment->data, buffer+pos, length);
+	if (referenced) {
+		esg_xml_fragment->data = buffer+pos;
+		esg_xml_fragment->_referenced = 1;
+	} else {
+		esg_xml_fragment->data = (uint8_t *) malloc(length);
+		memcpy(esg_xml_fragment->data, buffer+pos, length);
+	}
 	pos += length;
 
 	return esg_xml_fragment;
 }
 
+struct esg_encapsulated_textual_esg_xml_fragment *esg_encapsulated_textual_esg_xml_fragment_decode(uint8_t *buffer, uint32_t size) {
+	return esg_encapsulated_textual_esg_xml_fragment_decode_internal(buffer, size, 0);
+}
+
+struct esg_encapsulated_textual_esg_xml_fragment *esg_encapsulated_textual_esg_xml_fragment_decode_ref(uint8_t *buffer, uint32_t size) {
+	return esg_encapsulated_textual_esg_xml_fragment_decode_internal(buffer, size, 1);
+}
+
 void esg_encapsulated_textual_esg_xml_fragment_free(struct esg_encapsulated_textual_esg_xml_fragment *esg_xml_fragment) {
 	if (esg_xml_fragment == NULL) {
 		return;
 	}
 
-	if (esg_xml_fragment->data) {
+	if (esg_xml_fragment->data && !esg_xml_fragment->_referenced) {
 		free(esg_xml_fragment->data);
 	}
 
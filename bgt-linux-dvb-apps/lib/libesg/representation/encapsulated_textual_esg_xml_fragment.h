@@ -35,6 +35,8 @@ struct esg_encapsulated_textual_esg_xml_fragment {
 	uint16_t esg_xml_fragment_type;
 	uint32_t data_length;
 	uint8_t *data;
+
+	uint8_t _referenced;
 };
 
 /**
@@ -46,6 +48,17 @@ struct esg_encapsulated_textual_esg_xml_fragment {
  */
 extern struct esg_encapsulated_textual_esg_xml_fragment *esg_encapsulated_textual_esg_xml_fragment_decode(uint8_t *buffer, uint32_t size);
 
+/**
+ * Process an esg_encapsulated_textual_esg_xml_fragment, referencing the
+ * fragment data in the buffer instead of copying it. The buffer must stay
+ * valid until the structure is freed.
+ *
+ * @param buffer Binary buffer to decode.
+ * @param size Binary buffer size.
+ * @return Pointer to an esg_encapsulated_textual_esg_xml_fragment structure, or NULL on error.
+ */
+extern struct esg_encapsulated_textual_esg_xml_fragment *esg_encapsulated_textual_esg_xml_fragment_decode_ref(uint8_t *buffer, uint32_t size);
+
 /**
  * Free an esg_encapsulated_textual_esg_xml_fragment.
  *
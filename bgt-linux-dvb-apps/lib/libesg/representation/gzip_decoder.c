@@ -0,0 +1,167 @@
+/*
+ * ESG parser
+ *
+ * Copyright (C) 2006 Stephane Este-Gracias (sestegra@free.fr)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <libesg/representation/gzip_decoder.h>
+
+struct esg_gzip_decoder {
+	z_stream stream;
+	int finished;
+	uint8_t chunk[ESG_GZIP_DECODER_CHUNK_SIZE];
+};
+
+struct esg_gzip_decoder_buffer {
+	uint8_t *data;
+	uint32_t length;
+	uint32_t allocated;
+};
+
+struct esg_gzip_decoder *esg_gzip_decoder_create(void) {
+	struct esg_gzip_decoder *decoder;
+
+	decoder = (struct esg_gzip_decoder *) malloc(sizeof(struct esg_gzip_decoder));
+	if (decoder == NULL) {
+		return NULL;
+	}
+	memset(decoder, 0, sizeof(struct esg_gzip_decoder));
+
+	// 16 + MAX_WBITS : expect a GZIP wrapper rather than a zlib one
+	if (inflateInit2(&decoder->stream, 16 + MAX_WBITS) != Z_OK) {
+		free(decoder);
+		return NULL;
+	}
+
+	return decoder;
+}
+
+void esg_gzip_decoder_free(struct esg_gzip_decoder *decoder) {
+	if (decoder == NULL) {
+		return;
+	}
+
+	inflateEnd(&decoder->stream);
+
+	free(decoder);
+}
+
+void esg_gzip_decoder_reset(struct esg_gzip_decoder *decoder) {
+	inflateReset(&decoder->stream);
+	decoder->finished = 0;
+}
+
+int esg_gzip_decoder_decode(struct esg_gzip_decoder *decoder, uint8_t *buffer, uint32_t size,
+			    esg_gzip_decoder_output output, void *arg) {
+	int result;
+	uint32_t chunk_size;
+
+	if (decoder->finished) {
+		return 1;
+	}
+
+	decoder->stream.next_in = buffer;
+	decoder->stream.avail_in = size;
+
+	do {
+		decoder->stream.next_out = decoder->chunk;
+		decoder->stream.avail_out = ESG_GZIP_DECODER_CHUNK_SIZE;
+
+		result = inflate(&decoder->stream, Z_NO_FLUSH);
+		switch (result) {
+			case Z_OK:
+			case Z_STREAM_END: {
+				break;
+			}
+			case Z_BUF_ERROR: {
+				// No progress possible : all input consumed
+				break;
+			}
+			default: {
+				return -1;
+			}
+		}
+
+		chunk_size = ESG_GZIP_DECODER_CHUNK_SIZE - decoder->stream.avail_out;
+		if (chunk_size && output(arg, decoder->chunk, chunk_size)) {
+			return -1;
+		}
+
+		if (result == Z_STREAM_END) {
+			decoder->finished = 1;
+			return 1;
+		}
+	} while ((decoder->stream.avail_out == 0) || (decoder->stream.avail_in != 0));
+
+	return 0;
+}
+
+static int esg_gzip_decoder_append(void *arg, uint8_t *data, uint32_t size) {
+	struct esg_gzip_decoder_buffer *buffer = (struct esg_gzip_decoder_buffer *) arg;
+	uint8_t *new_data;
+	uint32_t allocated;
+
+	if (buffer->length + size + 1 > buffer->allocated) {
+		allocated = buffer->allocated ? buffer->allocated : ESG_GZIP_DECODER_CHUNK_SIZE;
+		while (buffer->length + size + 1 > allocated) {
+			allocated *= 2;
+		}
+
+		new_data = (uint8_t *) realloc(buffer->data, allocated);
+		if (new_data == NULL) {
+			return -1;
+		}
+		buffer->data = new_data;
+		buffer->allocated = allocated;
+	}
+
+	memcpy(buffer->data + buffer->length, data, size);
+	buffer->length += size;
+
+	return 0;
+}
+
+int esg_gzip_decoder_inflate(struct esg_gzip_decoder *decoder, uint8_t *buffer, uint32_t size,
+			     uint8_t **data, uint32_t *length) {
+	struct esg_gzip_decoder_buffer output;
+
+	memset(&output, 0, sizeof(struct esg_gzip_decoder_buffer));
+
+	esg_gzip_decoder_reset(decoder);
+	if (esg_gzip_decoder_decode(decoder, buffer, size, esg_gzip_decoder_append, &output) != 1) {
+		free(output.data);
+		return -1;
+	}
+
+	// Empty member
+	if (output.data == NULL) {
+		output.data = (uint8_t *) malloc(1);
+		if (output.data == NULL) {
+			return -1;
+		}
+	}
+	output.data[output.length] = 0;
+
+	*data = output.data;
+	*length = output.length;
+
+	return 0;
+}
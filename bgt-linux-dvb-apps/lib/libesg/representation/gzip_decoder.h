@@ -0,0 +1,109 @@
+/*
+ * ESG parser
+ *
+ * Copyright (C) 2006 Stephane Este-Gracias (sestegra@free.fr)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef _ESG_REPRESENTATION_GZIP_DECODER_H
+#define _ESG_REPRESENTATION_GZIP_DECODER_H 1
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/**
+ * Size of the chunks passed to an esg_gzip_decoder_output callback.
+ */
+#define ESG_GZIP_DECODER_CHUNK_SIZE 4096
+
+/**
+ * esg_gzip_decoder structure, opaque. Holds the zlib state so a single
+ * decoder can be reset and reused for every GZIP encoded fragment
+ * (encoding_version 0xF2) of a session.
+ */
+struct esg_gzip_decoder;
+
+/**
+ * Type definition for the output callback of esg_gzip_decoder_decode.
+ *
+ * @param arg Private argument.
+ * @param data Decompressed data, only valid during the call.
+ * @param size Size of data, at most ESG_GZIP_DECODER_CHUNK_SIZE.
+ * @return 0 to continue, anything else to abort decoding.
+ */
+typedef int (*esg_gzip_decoder_output)(void *arg, uint8_t *data, uint32_t size);
+
+/**
+ * Create an esg_gzip_decoder.
+ *
+ * @return Pointer to an esg_gzip_decoder structure, or NULL on error.
+ */
+extern struct esg_gzip_decoder *esg_gzip_decoder_create(void);
+
+/**
+ * Free an esg_gzip_decoder.
+ *
+ * @param decoder Pointer to an esg_gzip_decoder structure.
+ */
+extern void esg_gzip_decoder_free(struct esg_gzip_decoder *decoder);
+
+/**
+ * Reset an esg_gzip_decoder to expect the start of a new GZIP member.
+ *
+ * @param decoder Pointer to an esg_gzip_decoder structure.
+ */
+extern void esg_gzip_decoder_reset(struct esg_gzip_decoder *decoder);
+
+/**
+ * Decompress the next part of a GZIP member. The compressed data may be
+ * split anywhere across calls, e.g. as FLUTE packets arrive; decompressed
+ * data is passed to the callback in chunks as soon as it is available.
+ *
+ * @param decoder Pointer to an esg_gzip_decoder structure.
+ * @param buffer Compressed data.
+ * @param size Size of buffer.
+ * @param output Callback receiving the decompressed data.
+ * @param arg Private argument for the callback.
+ * @return 0 if more data is expected, 1 at the end of the member, or -1 on
+ * error (including the callback aborting).
+ */
+extern int esg_gzip_decoder_decode(struct esg_gzip_decoder *decoder, uint8_t *buffer, uint32_t size,
+				   esg_gzip_decoder_output output, void *arg);
+
+/**
+ * Decompress a complete GZIP member into a newly allocated buffer. The
+ * decoder is reset first. The result is followed by a NUL which is not
+ * counted in length, so textual fragments can be used as strings.
+ *
+ * @param decoder Pointer to an esg_gzip_decoder structure.
+ * @param buffer Compressed data.
+ * @param size Size of buffer.
+ * @param data Where to put the decompressed data, to be freed by the caller.
+ * @param length Where to put the decompressed size.
+ * @return 0 on success, or -1 on error or truncated data.
+ */
+extern int esg_gzip_decoder_inflate(struct esg_gzip_decoder *decoder, uint8_t *buffer, uint32_t size,
+				    uint8_t **data, uint32_t *length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -219,7 +219,7 @@ void esg_session_partition_declaration_free(struct esg_session_partition_declara
 		next_ip_stream = ip_stream->_next;
 
 		field = partition->field_list;
-		for(ip_stream_field = next_ip_stream->field_list; ip_stream_field; ip_stream_field = next_ip_stream_field) {
+		for(ip_stream_field = ip_stream->field_list; ip_stream_field; ip_stream_field = next_ip_stream_field) {
 			next_ip_stream_field = ip_stream_field->_next;
 
 			switch (field->encoding) {
@@ -25,7 +25,7 @@ uint8_t vluimsbf8(uint8_t *buffer, uint32_t size, uint32_t *length) {
 	*length = 0;
 
 	do {
-		if (size < offset) {
+		if (size <= offset) {
 			offset = 0;
 			*length = 0;
 			break;
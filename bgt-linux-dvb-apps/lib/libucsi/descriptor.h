@@ -62,6 +62,43 @@ static inline struct descriptor *
 }
 
 
+/**
+ * Retreive pointer to the next descriptor structure in an unprocessed,
+ * read-only buffer. Descriptor headers contain no multibyte fields, so the
+ * structure can be read directly.
+ *
+ * @param buf The buffer of descriptors.
+ * @param len Size of the buffer.
+ * @param pos Current descriptor.
+ * @return Pointer to next descriptor, or NULL if there are none.
+ */
+static inline const struct descriptor *
+	next_descriptor_raw(const uint8_t * buf, size_t len, const struct descriptor * pos)
+{
+	const uint8_t* next;
+
+	if (pos == NULL)
+		return NULL;
+
+	next = (const uint8_t*) pos + 2 + pos->len;
+	if (next >= buf + len)
+		return NULL;
+
+	return (const struct descriptor *) next;
+}
+
+/**
+ * Iterator over a verified loop of descriptors in a read-only buffer.
+ *
+ * @param buf The buffer of descriptors.
+ * @param len Size of the buffer.
+ * @param pos Variable containing a pointer to the current const descriptor.
+ */
+#define raw_descriptors_for_each(buf, len, pos) \
+	for ((pos) = (len) ? (const struct descriptor *) (buf) : NULL; \
+	     (pos); \
+	     (pos) = next_descriptor_raw(buf, len, pos))
+
 /**
  * The unknown descriptor.
  */
@@ -105,7 +142,7 @@ static inline int
 
 
 /******************************** PRIVATE CODE ********************************/
-static inline int verify_descriptors(uint8_t * buf, size_t len)
+static inline int verify_descriptors(const uint8_t * buf, size_t len)
 {
 	size_t pos = 0;
 
@@ -0,0 +1,69 @@
+/*
+ * section and descriptor parser
+ *
+ * Copyright (C) 2005 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <string.h>
+#include "descriptor_index.h"
+
+int descriptor_index_build(struct descriptor_index *idx)
+{
+	uint16_t last[256];
+	size_t len = idx->len;
+	size_t pos = 0;
+	int ret = 0;
+
+	memset(idx->first, 0, sizeof(idx->first));
+	memset(idx->ext_first, 0, sizeof(idx->ext_first));
+	idx->count = 0;
+
+	if (len > DESCRIPTOR_INDEX_MAX_LEN) {
+		len = DESCRIPTOR_INDEX_MAX_LEN;
+		ret = -1;
+	}
+
+	while(pos < len) {
+		uint8_t tag;
+		uint16_t offset = pos + 1;
+
+		if (((pos + 2) > len) || ((pos + 2 + idx->buf[pos+1]) > len)) {
+			ret = -1;
+			break;
+		}
+		tag = idx->buf[pos];
+
+		// chain onto the previous descriptor with this tag
+		idx->next[pos / 2] = 0;
+		if (idx->first[tag] == 0)
+			idx->first[tag] = offset;
+		else
+			idx->next[(last[tag] - 1) / 2] = offset;
+		last[tag] = offset;
+
+		// later extension descriptors are found through the 0x7f chain
+		if ((tag == DESCRIPTOR_INDEX_EXTENSION_TAG) && (idx->buf[pos+1] > 0) &&
+		    (idx->ext_first[idx->buf[pos+2]] == 0))
+			idx->ext_first[idx->buf[pos+2]] = offset;
+
+		idx->count++;
+		pos += 2 + idx->buf[pos+1];
+	}
+
+	idx->state = ret ? DESCRIPTOR_INDEX_MALFORMED : DESCRIPTOR_INDEX_BUILT;
+	return ret;
+}
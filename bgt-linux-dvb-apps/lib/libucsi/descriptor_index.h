@@ -0,0 +1,248 @@
+/*
+ * section and descriptor parser
+ *
+ * Copyright (C) 2005 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef _UCSI_DESCRIPTOR_INDEX_H
+#define _UCSI_DESCRIPTOR_INDEX_H 1
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <libucsi/descriptor.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Largest descriptor loop which can be indexed. Descriptor loop lengths are
+ * 12 bit fields, so this covers every loop in a valid section.
+ */
+#define DESCRIPTOR_INDEX_MAX_LEN 4096
+
+/**
+ * Tag used by extension descriptors; the first data byte holds the
+ * descriptor_tag_extension.
+ */
+#define DESCRIPTOR_INDEX_EXTENSION_TAG 0x7f
+
+/**
+ * Index of a descriptor loop, mapping each tag to the descriptors using it.
+ *
+ * The loop is scanned once, the first time the index is queried. After that
+ * finding the first descriptor with a given tag is O(1), and further
+ * descriptors with the same tag are chained in loop order. The index refers
+ * to the original buffer, which must stay valid and must not be modified.
+ *
+ * The structure is around 5kB, and can be reused for another loop by calling
+ * descriptor_index_init() again.
+ */
+struct descriptor_index {
+	const uint8_t *buf;
+	size_t len;
+	int state;
+	int count;
+
+	/* offsets are stored +1, so 0 means "none" */
+	uint16_t first[256];
+	uint16_t ext_first[256];
+	uint16_t next[DESCRIPTOR_INDEX_MAX_LEN / 2];
+};
+
+/**
+ * Set up an index for a loop of descriptors. This is cheap; the loop is only
+ * scanned when the index is first queried.
+ *
+ * @param idx The index.
+ * @param buf Start of the descriptor loop.
+ * @param len Length of the descriptor loop in bytes.
+ */
+static inline void descriptor_index_init(struct descriptor_index *idx,
+					 const uint8_t *buf, size_t len);
+
+/**
+ * Scan the descriptor loop and build the index. Called automatically by the
+ * query functions, but may be called directly to check the loop is valid.
+ *
+ * A truncated final descriptor, or a loop longer than
+ * DESCRIPTOR_INDEX_MAX_LEN, is an error; the descriptors before the problem
+ * are still indexed.
+ *
+ * @param idx The index.
+ * @return 0 on success, -1 if the loop is malformed.
+ */
+extern int descriptor_index_build(struct descriptor_index *idx);
+
+/**
+ * Find the first descriptor with a tag.
+ *
+ * @param idx The index.
+ * @param tag Descriptor tag to look for.
+ * @return Pointer to the descriptor, or NULL if there is none.
+ */
+static inline const struct descriptor *
+	descriptor_index_find(struct descriptor_index *idx, uint8_t tag);
+
+/**
+ * Find the first extension descriptor with a descriptor_tag_extension.
+ *
+ * @param idx The index.
+ * @param ext_tag The descriptor_tag_extension to look for.
+ * @return Pointer to the descriptor, or NULL if there is none.
+ */
+static inline const struct descriptor *
+	descriptor_index_find_extension(struct descriptor_index *idx, uint8_t ext_tag);
+
+/**
+ * Find the next descriptor with the same tag as pos.
+ *
+ * @param idx The index.
+ * @param pos A descriptor returned by one of the find functions.
+ * @return Pointer to the next descriptor, or NULL if there are no more.
+ */
+static inline const struct descriptor *
+	descriptor_index_next(struct descriptor_index *idx, const struct descriptor *pos);
+
+/**
+ * Find the next extension descriptor with the same descriptor_tag_extension
+ * as pos.
+ *
+ * @param idx The index.
+ * @param pos A descriptor returned by descriptor_index_find_extension().
+ * @return Pointer to the next descriptor, or NULL if there are no more.
+ */
+static inline const struct descriptor *
+	descriptor_index_next_extension(struct descriptor_index *idx, const struct descriptor *pos);
+
+/**
+ * Number of complete descriptors in the loop.
+ *
+ * @param idx The index.
+ * @return The count.
+ */
+static inline int descriptor_index_count(struct descriptor_index *idx);
+
+/**
+ * Iterator over all descriptors in the loop with a given tag.
+ *
+ * @param idx The index.
+ * @param tag The descriptor tag.
+ * @param pos Variable containing a pointer to the current const descriptor.
+ */
+#define descriptor_index_for_each(idx, tag, pos) \
+	for ((pos) = descriptor_index_find(idx, tag); \
+	     (pos); \
+	     (pos) = descriptor_index_next(idx, pos))
+
+/**
+ * Iterator over all extension descriptors in the loop with a given
+ * descriptor_tag_extension.
+ *
+ * @param idx The index.
+ * @param ext_tag The descriptor_tag_extension.
+ * @param pos Variable containing a pointer to the current const descriptor.
+ */
+#define descriptor_index_for_each_extension(idx, ext_tag, pos) \
+	for ((pos) = descriptor_index_find_extension(idx, ext_tag); \
+	     (pos); \
+	     (pos) = descriptor_index_next_extension(idx, pos))
+
+
+
+
+
+
+
+
+
+/******************************** PRIVATE CODE ********************************/
+#define DESCRIPTOR_INDEX_UNBUILT 0
+#define DESCRIPTOR_INDEX_BUILT 1
+#define DESCRIPTOR_INDEX_MALFORMED -1
+
+static inline void descriptor_index_init(struct descriptor_index *idx,
+					 const uint8_t *buf, size_t len)
+{
+	idx->buf = buf;
+	idx->len = len;
+	idx->state = DESCRIPTOR_INDEX_UNBUILT;
+	idx->count = 0;
+}
+
+static inline const struct descriptor *
+	descriptor_index_ptr(struct descriptor_index *idx, uint16_t offset)
+{
+	if (offset == 0)
+		return NULL;
+
+	return (const struct descriptor *) (idx->buf + offset - 1);
+}
+
+static inline const struct descriptor *
+	descriptor_index_find(struct descriptor_index *idx, uint8_t tag)
+{
+	if (idx->state == DESCRIPTOR_INDEX_UNBUILT)
+		descriptor_index_build(idx);
+
+	return descriptor_index_ptr(idx, idx->first[tag]);
+}
+
+static inline const struct descriptor *
+	descriptor_index_find_extension(struct descriptor_index *idx, uint8_t ext_tag)
+{
+	if (idx->state == DESCRIPTOR_INDEX_UNBUILT)
+		descriptor_index_build(idx);
+
+	return descriptor_index_ptr(idx, idx->ext_first[ext_tag]);
+}
+
+static inline const struct descriptor *
+	descriptor_index_next(struct descriptor_index *idx, const struct descriptor *pos)
+{
+	// descriptors are at least 2 bytes, so offset / 2 is unique
+	return descriptor_index_ptr(idx, idx->next[((const uint8_t *) pos - idx->buf) / 2]);
+}
+
+static inline const struct descriptor *
+	descriptor_index_next_extension(struct descriptor_index *idx, const struct descriptor *pos)
+{
+	const uint8_t ext_tag = ((const uint8_t *) pos)[2];
+
+	// extension descriptors are rare, so follow the 0x7f chain
+	while((pos = descriptor_index_next(idx, pos)) != NULL) {
+		if ((pos->len > 0) && (((const uint8_t *) pos)[2] == ext_tag))
+			return pos;
+	}
+
+	return NULL;
+}
+
+static inline int descriptor_index_count(struct descriptor_index *idx)
+{
+	if (idx->state == DESCRIPTOR_INDEX_UNBUILT)
+		descriptor_index_build(idx);
+
+	return idx->count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -98,6 +98,158 @@ static inline uint16_t dvb_eit_section_service_id(struct dvb_eit_section *eit)
 	     (pos); \
 	     (pos) = dvb_eit_event_descriptors_next(event, pos))
 
+/**
+ * Check an unprocessed EIT without modifying it. The section must already
+ * have been checked with section_ext_raw_verify().
+ *
+ * @param buf Pointer to the start of the section.
+ * @return 0 if the EIT is valid, or -1 if not.
+ */
+extern int dvb_eit_section_raw_verify(const uint8_t *buf);
+
+/**
+ * Accessor for the service_id field of an unprocessed EIT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The service_id.
+ */
+static inline uint16_t dvb_eit_section_raw_service_id(const uint8_t *buf)
+{
+	return section_ext_raw_table_id_ext(buf);
+}
+
+/**
+ * Accessor for the transport_stream_id field of an unprocessed EIT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The transport_stream_id.
+ */
+static inline uint16_t dvb_eit_section_raw_transport_stream_id(const uint8_t *buf)
+{
+	return ucsi_get16(buf + sizeof(struct section_ext));
+}
+
+/**
+ * Accessor for the original_network_id field of an unprocessed EIT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The original_network_id.
+ */
+static inline uint16_t dvb_eit_section_raw_original_network_id(const uint8_t *buf)
+{
+	return ucsi_get16(buf + sizeof(struct section_ext) + 2);
+}
+
+/**
+ * Accessor for the segment_last_section_number field of an unprocessed EIT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The segment_last_section_number.
+ */
+static inline uint8_t dvb_eit_section_raw_segment_last_section_number(const uint8_t *buf)
+{
+	return buf[sizeof(struct section_ext) + 4];
+}
+
+/**
+ * Accessor for the last_table_id field of an unprocessed EIT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The last_table_id.
+ */
+static inline uint8_t dvb_eit_section_raw_last_table_id(const uint8_t *buf)
+{
+	return buf[sizeof(struct section_ext) + 5];
+}
+
+/**
+ * Iterator for the events field of an unprocessed EIT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @param pos Variable containing a const uint8_t pointer to the current event.
+ */
+#define dvb_eit_section_raw_events_for_each(buf, pos) \
+	for ((pos) = dvb_eit_section_raw_events_first(buf); \
+	     (pos); \
+	     (pos) = dvb_eit_section_raw_events_next(buf, pos))
+
+/**
+ * Accessor for the event_id field of an unprocessed EIT event.
+ *
+ * @param pos Pointer to the event.
+ * @return The event_id.
+ */
+static inline uint16_t dvb_eit_event_raw_event_id(const uint8_t *pos)
+{
+	return ucsi_get16(pos);
+}
+
+/**
+ * Accessor for the start_time field of an unprocessed EIT event.
+ *
+ * @param pos Pointer to the event.
+ * @return The start_time as a unix timestamp.
+ */
+static inline time_t dvb_eit_event_raw_start_time(const uint8_t *pos)
+{
+	return dvbdate_to_unixtime((uint8_t *) pos + 2);
+}
+
+/**
+ * Accessor for the duration field of an unprocessed EIT event.
+ *
+ * @param pos Pointer to the event.
+ * @return The duration in seconds.
+ */
+static inline int dvb_eit_event_raw_duration(const uint8_t *pos)
+{
+	return dvbduration_to_seconds((uint8_t *) pos + 7);
+}
+
+/**
+ * Accessor for the running_status field of an unprocessed EIT event.
+ *
+ * @param pos Pointer to the event.
+ * @return The running_status.
+ */
+static inline uint8_t dvb_eit_event_raw_running_status(const uint8_t *pos)
+{
+	return pos[10] >> 5;
+}
+
+/**
+ * Accessor for the free_ca_mode field of an unprocessed EIT event.
+ *
+ * @param pos Pointer to the event.
+ * @return The free_ca_mode.
+ */
+static inline uint8_t dvb_eit_event_raw_free_ca_mode(const uint8_t *pos)
+{
+	return (pos[10] >> 4) & 0x01;
+}
+
+/**
+ * Accessor for the descriptors_loop_length field of an unprocessed EIT event.
+ *
+ * @param pos Pointer to the event.
+ * @return The descriptors_loop_length.
+ */
+static inline uint16_t dvb_eit_event_raw_descriptors_loop_length(const uint8_t *pos)
+{
+	return ucsi_get16(pos + 10) & 0x0fff;
+}
+
+/**
+ * Iterator for the descriptors field of an unprocessed EIT event.
+ *
+ * @param event Pointer to the event.
+ * @param pos Variable containing a pointer to the current const descriptor.
+ */
+#define dvb_eit_event_raw_descriptors_for_each(event, pos) \
+	raw_descriptors_for_each((event) + sizeof(struct dvb_eit_event), \
+				 dvb_eit_event_raw_descriptors_loop_length(event), pos)
+
+
 
 
 
@@ -153,6 +305,30 @@ static inline struct descriptor *
 			       pos);
 }
 
+static inline const uint8_t *
+	dvb_eit_section_raw_events_first(const uint8_t *buf)
+{
+	size_t pos = sizeof(struct dvb_eit_section);
+
+	if (pos >= section_ext_raw_length(buf))
+		return NULL;
+
+	return buf + pos;
+}
+
+static inline const uint8_t *
+	dvb_eit_section_raw_events_next(const uint8_t *buf, const uint8_t *pos)
+{
+	const uint8_t *end = buf + section_ext_raw_length(buf);
+	const uint8_t *next = pos + sizeof(struct dvb_eit_event) +
+			      dvb_eit_event_raw_descriptors_loop_length(pos);
+
+	if (next >= end)
+		return NULL;
+
+	return next;
+}
+
 #ifdef __cplusplus
 }
 #endif
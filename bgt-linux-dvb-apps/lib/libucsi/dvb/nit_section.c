@@ -76,3 +76,50 @@ struct dvb_nit_section *dvb_nit_section_codec(struct section_ext * ext)
 
 	return ret;
 }
+
+int dvb_nit_section_raw_verify(const uint8_t *buf)
+{
+	size_t pos = sizeof(struct dvb_nit_section);
+	size_t len = section_ext_raw_length(buf);
+	size_t network_descriptors_length;
+
+	if (len < sizeof(struct dvb_nit_section))
+		return -1;
+
+	network_descriptors_length = dvb_nit_section_raw_network_descriptors_length(buf);
+	if ((pos + network_descriptors_length) > len)
+		return -1;
+
+	if (verify_descriptors(buf + pos, network_descriptors_length))
+		return -1;
+
+	pos += network_descriptors_length;
+
+	if ((pos + sizeof(struct dvb_nit_section_part2)) > len)
+		return -1;
+
+	pos += sizeof(struct dvb_nit_section_part2);
+
+	while (pos < len) {
+		size_t transport_descriptors_length;
+
+		if ((pos + sizeof(struct dvb_nit_transport)) > len)
+			return -1;
+
+		transport_descriptors_length = dvb_nit_transport_raw_descriptors_length(buf + pos);
+		pos += sizeof(struct dvb_nit_transport);
+
+		if ((pos + transport_descriptors_length) > len)
+			return -1;
+
+		if (verify_descriptors(buf + pos, transport_descriptors_length))
+			return -1;
+
+		pos += transport_descriptors_length;
+	}
+
+	if (pos != len)
+		return -1;
+
+	return 0;
+}
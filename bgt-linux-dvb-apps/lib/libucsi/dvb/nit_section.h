@@ -127,6 +127,102 @@ static inline struct dvb_nit_section_part2 *dvb_nit_section_part2(struct dvb_nit
 	     (pos); \
 	     (pos) = dvb_nit_transport_descriptors_next(transport, pos))
 
+/**
+ * Check an unprocessed NIT without modifying it. The section must already
+ * have been checked with section_ext_raw_verify().
+ *
+ * @param buf Pointer to the start of the section.
+ * @return 0 if the NIT is valid, or -1 if not.
+ */
+extern int dvb_nit_section_raw_verify(const uint8_t *buf);
+
+/**
+ * Accessor for the network_id field of an unprocessed NIT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The network_id.
+ */
+static inline uint16_t dvb_nit_section_raw_network_id(const uint8_t *buf)
+{
+	return section_ext_raw_table_id_ext(buf);
+}
+
+/**
+ * Accessor for the network_descriptors_length field of an unprocessed NIT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The network_descriptors_length.
+ */
+static inline uint16_t dvb_nit_section_raw_network_descriptors_length(const uint8_t *buf)
+{
+	return ucsi_get16(buf + sizeof(struct section_ext)) & 0x0fff;
+}
+
+/**
+ * Iterator for the network descriptors field of an unprocessed NIT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @param pos Variable containing a pointer to the current const descriptor.
+ */
+#define dvb_nit_section_raw_descriptors_for_each(buf, pos) \
+	raw_descriptors_for_each((buf) + sizeof(struct dvb_nit_section), \
+				 dvb_nit_section_raw_network_descriptors_length(buf), pos)
+
+/**
+ * Iterator for the transports field of an unprocessed NIT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @param pos Variable containing a const uint8_t pointer to the current transport.
+ */
+#define dvb_nit_section_raw_transports_for_each(buf, pos) \
+	for ((pos) = dvb_nit_section_raw_transports_first(buf); \
+	     (pos); \
+	     (pos) = dvb_nit_section_raw_transports_next(buf, pos))
+
+/**
+ * Accessor for the transport_stream_id field of an unprocessed NIT transport.
+ *
+ * @param pos Pointer to the transport.
+ * @return The transport_stream_id.
+ */
+static inline uint16_t dvb_nit_transport_raw_transport_stream_id(const uint8_t *pos)
+{
+	return ucsi_get16(pos);
+}
+
+/**
+ * Accessor for the original_network_id field of an unprocessed NIT transport.
+ *
+ * @param pos Pointer to the transport.
+ * @return The original_network_id.
+ */
+static inline uint16_t dvb_nit_transport_raw_original_network_id(const uint8_t *pos)
+{
+	return ucsi_get16(pos + 2);
+}
+
+/**
+ * Accessor for the transport_descriptors_length field of an unprocessed NIT transport.
+ *
+ * @param pos Pointer to the transport.
+ * @return The transport_descriptors_length.
+ */
+static inline uint16_t dvb_nit_transport_raw_descriptors_length(const uint8_t *pos)
+{
+	return ucsi_get16(pos + 4) & 0x0fff;
+}
+
+/**
+ * Iterator for the descriptors field of an unprocessed NIT transport.
+ *
+ * @param transport Pointer to the transport.
+ * @param pos Variable containing a pointer to the current const descriptor.
+ */
+#define dvb_nit_transport_raw_descriptors_for_each(transport, pos) \
+	raw_descriptors_for_each((transport) + sizeof(struct dvb_nit_transport), \
+				 dvb_nit_transport_raw_descriptors_length(transport), pos)
+
+
 
 
 
@@ -200,6 +296,32 @@ static inline struct descriptor *
 			      pos);
 }
 
+static inline const uint8_t *
+	dvb_nit_section_raw_transports_first(const uint8_t *buf)
+{
+	size_t pos = sizeof(struct dvb_nit_section) +
+		     dvb_nit_section_raw_network_descriptors_length(buf) +
+		     sizeof(struct dvb_nit_section_part2);
+
+	if (pos >= section_ext_raw_length(buf))
+		return NULL;
+
+	return buf + pos;
+}
+
+static inline const uint8_t *
+	dvb_nit_section_raw_transports_next(const uint8_t *buf, const uint8_t *pos)
+{
+	const uint8_t *end = buf + section_ext_raw_length(buf);
+	const uint8_t *next = pos + sizeof(struct dvb_nit_transport) +
+			      dvb_nit_transport_raw_descriptors_length(pos);
+
+	if (next >= end)
+		return NULL;
+
+	return next;
+}
+
 #ifdef __cplusplus
 }
 #endif
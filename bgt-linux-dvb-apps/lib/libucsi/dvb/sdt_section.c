@@ -58,3 +58,35 @@ struct dvb_sdt_section * dvb_sdt_section_codec(struct section_ext * ext)
 
 	return (struct dvb_sdt_section *) ext;
 }
+
+int dvb_sdt_section_raw_verify(const uint8_t *buf)
+{
+	size_t pos = sizeof(struct dvb_sdt_section);
+	size_t len = section_ext_raw_length(buf);
+
+	if (len < sizeof(struct dvb_sdt_section))
+		return -1;
+
+	while (pos < len) {
+		size_t descriptors_loop_length;
+
+		if ((pos + sizeof(struct dvb_sdt_service)) > len)
+			return -1;
+
+		descriptors_loop_length = dvb_sdt_service_raw_descriptors_loop_length(buf + pos);
+		pos += sizeof(struct dvb_sdt_service);
+
+		if ((pos + descriptors_loop_length) > len)
+			return -1;
+
+		if (verify_descriptors(buf + pos, descriptors_loop_length))
+			return -1;
+
+		pos += descriptors_loop_length;
+	}
+
+	if (pos != len)
+		return -1;
+
+	return 0;
+}
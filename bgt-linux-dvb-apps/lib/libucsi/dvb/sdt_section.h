@@ -95,6 +95,125 @@ static inline uint16_t dvb_sdt_section_transport_stream_id(struct dvb_sdt_sectio
 	     (pos); \
 	     (pos) = dvb_sdt_service_descriptors_next(service, pos))
 
+/**
+ * Check an unprocessed SDT without modifying it. The section must already
+ * have been checked with section_ext_raw_verify().
+ *
+ * @param buf Pointer to the start of the section.
+ * @return 0 if the SDT is valid, or -1 if not.
+ */
+extern int dvb_sdt_section_raw_verify(const uint8_t *buf);
+
+/**
+ * Accessor for the transport_stream_id field of an unprocessed SDT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The transport_stream_id.
+ */
+static inline uint16_t dvb_sdt_section_raw_transport_stream_id(const uint8_t *buf)
+{
+	return section_ext_raw_table_id_ext(buf);
+}
+
+/**
+ * Accessor for the original_network_id field of an unprocessed SDT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The original_network_id.
+ */
+static inline uint16_t dvb_sdt_section_raw_original_network_id(const uint8_t *buf)
+{
+	return ucsi_get16(buf + sizeof(struct section_ext));
+}
+
+/**
+ * Iterator for the services field of an unprocessed SDT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @param pos Variable containing a const uint8_t pointer to the current service.
+ */
+#define dvb_sdt_section_raw_services_for_each(buf, pos) \
+	for ((pos) = dvb_sdt_section_raw_services_first(buf); \
+	     (pos); \
+	     (pos) = dvb_sdt_section_raw_services_next(buf, pos))
+
+/**
+ * Accessor for the service_id field of an unprocessed SDT service.
+ *
+ * @param pos Pointer to the service.
+ * @return The service_id.
+ */
+static inline uint16_t dvb_sdt_service_raw_service_id(const uint8_t *pos)
+{
+	return ucsi_get16(pos);
+}
+
+/**
+ * Accessor for the eit_schedule_flag field of an unprocessed SDT service.
+ *
+ * @param pos Pointer to the service.
+ * @return The eit_schedule_flag.
+ */
+static inline uint8_t dvb_sdt_service_raw_eit_schedule_flag(const uint8_t *pos)
+{
+	return (pos[2] >> 1) & 0x01;
+}
+
+/**
+ * Accessor for the eit_present_following_flag field of an unprocessed SDT service.
+ *
+ * @param pos Pointer to the service.
+ * @return The eit_present_following_flag.
+ */
+static inline uint8_t dvb_sdt_service_raw_eit_present_following_flag(const uint8_t *pos)
+{
+	return pos[2] & 0x01;
+}
+
+/**
+ * Accessor for the running_status field of an unprocessed SDT service.
+ *
+ * @param pos Pointer to the service.
+ * @return The running_status.
+ */
+static inline uint8_t dvb_sdt_service_raw_running_status(const uint8_t *pos)
+{
+	return pos[3] >> 5;
+}
+
+/**
+ * Accessor for the free_ca_mode field of an unprocessed SDT service.
+ *
+ * @param pos Pointer to the service.
+ * @return The free_ca_mode.
+ */
+static inline uint8_t dvb_sdt_service_raw_free_ca_mode(const uint8_t *pos)
+{
+	return (pos[3] >> 4) & 0x01;
+}
+
+/**
+ * Accessor for the descriptors_loop_length field of an unprocessed SDT service.
+ *
+ * @param pos Pointer to the service.
+ * @return The descriptors_loop_length.
+ */
+static inline uint16_t dvb_sdt_service_raw_descriptors_loop_length(const uint8_t *pos)
+{
+	return ucsi_get16(pos + 3) & 0x0fff;
+}
+
+/**
+ * Iterator for the descriptors field of an unprocessed SDT service.
+ *
+ * @param service Pointer to the service.
+ * @param pos Variable containing a pointer to the current const descriptor.
+ */
+#define dvb_sdt_service_raw_descriptors_for_each(service, pos) \
+	raw_descriptors_for_each((service) + sizeof(struct dvb_sdt_service), \
+				 dvb_sdt_service_raw_descriptors_loop_length(service), pos)
+
+
 
 
 
@@ -150,6 +269,30 @@ static inline struct descriptor *
 			       pos);
 }
 
+static inline const uint8_t *
+	dvb_sdt_section_raw_services_first(const uint8_t *buf)
+{
+	size_t pos = sizeof(struct dvb_sdt_section);
+
+	if (pos >= section_ext_raw_length(buf))
+		return NULL;
+
+	return buf + pos;
+}
+
+static inline const uint8_t *
+	dvb_sdt_section_raw_services_next(const uint8_t *buf, const uint8_t *pos)
+{
+	const uint8_t *end = buf + section_ext_raw_length(buf);
+	const uint8_t *next = pos + sizeof(struct dvb_sdt_service) +
+			      dvb_sdt_service_raw_descriptors_loop_length(pos);
+
+	if (next >= end)
+		return NULL;
+
+	return next;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,93 @@
+/*
+ * section and descriptor parser
+ *
+ * Copyright (C) 2005 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef _UCSI_DVB_TEXT_H
+#define _UCSI_DVB_TEXT_H 1
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/**
+ * Flags for dvb_text_decode().
+ */
+enum {
+	DVB_TEXT_FLAG_EMPHASIS		= 0x01, /* mark emphasised text as *text* */
+	DVB_TEXT_FLAG_NEWLINES		= 0x02, /* output CR/LF control codes as '\n' */
+};
+
+/**
+ * Opaque DVB text decoder.
+ *
+ * ISO 6937, ISO 8859-x, UCS-2 and UTF-8 text (EN 300 468 annex A) is converted
+ * using built-in tables. Other character tables (KS X 1001, GB-2312, Big5)
+ * are converted with iconv, using a small cache of open conversion
+ * descriptors so iconv_open() is not called per string.
+ *
+ * A decoder is not thread safe; use one per thread.
+ */
+struct dvb_text_decoder;
+
+/**
+ * Create a DVB text decoder.
+ *
+ * @param default_charset iconv name of the character set to use for text
+ * without a character table prefix, or NULL for ISO 6937 (the standard
+ * default). ISO-6937 and ISO-8859-x are recognised and use built-in tables.
+ * @return The decoder, or NULL on error.
+ */
+extern struct dvb_text_decoder *dvb_text_decoder_create(const char *default_charset);
+
+/**
+ * Destroy a DVB text decoder, closing any cached iconv descriptors.
+ *
+ * @param decoder The decoder.
+ */
+extern void dvb_text_decoder_destroy(struct dvb_text_decoder *decoder);
+
+/**
+ * Convert a DVB string to NUL terminated UTF-8.
+ *
+ * Control codes are removed, apart from the emphasis and CR/LF codes, which
+ * are handled according to the flags. Output is truncated on a character
+ * boundary if dest is too small; a destlen of (srclen * 3) + 1 is always
+ * sufficient.
+ *
+ * @param decoder The decoder.
+ * @param src DVB text, including any character table prefix.
+ * @param srclen Length of src.
+ * @param dest Where to put the UTF-8 output.
+ * @param destlen Size of dest, including space for the NUL.
+ * @param flags ORed DVB_TEXT_FLAG_* values.
+ * @return Number of bytes written to dest, excluding the NUL, or -1 if the
+ * character table is not supported.
+ */
+extern int dvb_text_decode(struct dvb_text_decoder *decoder,
+			   const uint8_t *src, int srclen,
+			   char *dest, int destlen, int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
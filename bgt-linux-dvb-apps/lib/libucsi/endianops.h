@@ -121,6 +121,22 @@ static inline void bswap48(uint8_t * buf) {
 
 #endif // __BYTE_ORDER
 
+/*
+ * Read big-endian values from a buffer without modifying it. These are used
+ * by the non-mutating (*_raw_*) accessors.
+ */
+static inline uint16_t ucsi_get16(const uint8_t *buf) {
+	return (buf[0] << 8) | buf[1];
+}
+
+static inline uint32_t ucsi_get24(const uint8_t *buf) {
+	return (buf[0] << 16) | (buf[1] << 8) | buf[2];
+}
+
+static inline uint32_t ucsi_get32(const uint8_t *buf) {
+	return ((uint32_t) buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -44,3 +44,24 @@ struct mpeg_pat_section *mpeg_pat_section_codec(struct section_ext * ext)
 
 	return (struct mpeg_pat_section *)ext;
 }
+
+int mpeg_pat_section_raw_verify(const uint8_t *buf)
+{
+	size_t pos = sizeof(struct section_ext);
+	size_t len = section_ext_raw_length(buf);
+
+	if (len < sizeof(struct mpeg_pat_section))
+		return -1;
+
+	while (pos < len) {
+		if ((pos + sizeof(struct mpeg_pat_program)) > len)
+			return -1;
+
+		pos += sizeof(struct mpeg_pat_program);
+	}
+
+	if (pos != len)
+		return -1;
+
+	return 0;
+}
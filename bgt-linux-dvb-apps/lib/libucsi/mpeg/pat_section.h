@@ -77,6 +77,60 @@ static inline uint16_t mpeg_pat_section_transport_stream_id(struct mpeg_pat_sect
 	     (pos); \
 	     (pos) = mpeg_pat_section_programs_next(pat, pos))
 
+/**
+ * Check an unprocessed PAT without modifying it. The section must already
+ * have been checked with section_ext_raw_verify().
+ *
+ * @param buf Pointer to the start of the section.
+ * @return 0 if the PAT is valid, or -1 if not.
+ */
+extern int mpeg_pat_section_raw_verify(const uint8_t *buf);
+
+/**
+ * Accessor for the transport_stream_id field of an unprocessed PAT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The transport_stream_id.
+ */
+static inline uint16_t mpeg_pat_section_raw_transport_stream_id(const uint8_t *buf)
+{
+	return section_ext_raw_table_id_ext(buf);
+}
+
+/**
+ * Iterator for the programs field of an unprocessed PAT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @param pos Variable containing a const uint8_t pointer to the current program.
+ */
+#define mpeg_pat_section_raw_programs_for_each(buf, pos) \
+	for ((pos) = mpeg_pat_section_raw_programs_first(buf); \
+	     (pos); \
+	     (pos) = mpeg_pat_section_raw_programs_next(buf, pos))
+
+/**
+ * Accessor for the program_number field of an unprocessed PAT program.
+ *
+ * @param pos Pointer to the program.
+ * @return The program_number.
+ */
+static inline uint16_t mpeg_pat_program_raw_program_number(const uint8_t *pos)
+{
+	return ucsi_get16(pos);
+}
+
+/**
+ * Accessor for the pid field of an unprocessed PAT program.
+ *
+ * @param pos Pointer to the program.
+ * @return The pid.
+ */
+static inline uint16_t mpeg_pat_program_raw_pid(const uint8_t *pos)
+{
+	return ucsi_get16(pos + 2) & 0x1fff;
+}
+
+
 
 
 
@@ -111,6 +165,29 @@ static inline
 	return (struct mpeg_pat_program *) next;
 }
 
+static inline const uint8_t *
+	mpeg_pat_section_raw_programs_first(const uint8_t *buf)
+{
+	size_t pos = sizeof(struct mpeg_pat_section);
+
+	if (pos >= section_ext_raw_length(buf))
+		return NULL;
+
+	return buf + pos;
+}
+
+static inline const uint8_t *
+	mpeg_pat_section_raw_programs_next(const uint8_t *buf, const uint8_t *pos)
+{
+	const uint8_t *end = buf + section_ext_raw_length(buf);
+	const uint8_t *next = pos + sizeof(struct mpeg_pat_program);
+
+	if (next >= end)
+		return NULL;
+
+	return next;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -69,3 +69,45 @@ struct mpeg_pmt_section * mpeg_pmt_section_codec(struct section_ext * ext)
 
 	return (struct mpeg_pmt_section *) ext;
 }
+
+int mpeg_pmt_section_raw_verify(const uint8_t *buf)
+{
+	size_t pos = sizeof(struct mpeg_pmt_section);
+	size_t len = section_ext_raw_length(buf);
+	size_t program_info_length;
+
+	if (len < sizeof(struct mpeg_pmt_section))
+		return -1;
+
+	program_info_length = mpeg_pmt_section_raw_program_info_length(buf);
+	if ((pos + program_info_length) > len)
+		return -1;
+
+	if (verify_descriptors(buf + pos, program_info_length))
+		return -1;
+
+	pos += program_info_length;
+
+	while (pos < len) {
+		size_t es_info_length;
+
+		if ((pos + sizeof(struct mpeg_pmt_stream)) > len)
+			return -1;
+
+		es_info_length = mpeg_pmt_stream_raw_es_info_length(buf + pos);
+		pos += sizeof(struct mpeg_pmt_stream);
+
+		if ((pos + es_info_length) > len)
+			return -1;
+
+		if (verify_descriptors(buf + pos, es_info_length))
+			return -1;
+
+		pos += es_info_length;
+	}
+
+	if (pos != len)
+		return -1;
+
+	return 0;
+}
@@ -108,6 +108,113 @@ static inline uint16_t mpeg_pmt_section_program_number(struct mpeg_pmt_section *
 	     (pos); \
 	     (pos) = mpeg_pmt_stream_descriptors_next(stream, pos))
 
+/**
+ * Check an unprocessed PMT without modifying it. The section must already
+ * have been checked with section_ext_raw_verify().
+ *
+ * @param buf Pointer to the start of the section.
+ * @return 0 if the PMT is valid, or -1 if not.
+ */
+extern int mpeg_pmt_section_raw_verify(const uint8_t *buf);
+
+/**
+ * Accessor for the program_number field of an unprocessed PMT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The program_number.
+ */
+static inline uint16_t mpeg_pmt_section_raw_program_number(const uint8_t *buf)
+{
+	return section_ext_raw_table_id_ext(buf);
+}
+
+/**
+ * Accessor for the pcr_pid field of an unprocessed PMT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The pcr_pid.
+ */
+static inline uint16_t mpeg_pmt_section_raw_pcr_pid(const uint8_t *buf)
+{
+	return ucsi_get16(buf + sizeof(struct section_ext)) & 0x1fff;
+}
+
+/**
+ * Accessor for the program_info_length field of an unprocessed PMT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @return The program_info_length.
+ */
+static inline uint16_t mpeg_pmt_section_raw_program_info_length(const uint8_t *buf)
+{
+	return ucsi_get16(buf + sizeof(struct section_ext) + 2) & 0x0fff;
+}
+
+/**
+ * Iterator for the descriptors field of an unprocessed PMT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @param pos Variable containing a pointer to the current const descriptor.
+ */
+#define mpeg_pmt_section_raw_descriptors_for_each(buf, pos) \
+	raw_descriptors_for_each((buf) + sizeof(struct mpeg_pmt_section), \
+				 mpeg_pmt_section_raw_program_info_length(buf), pos)
+
+/**
+ * Iterator for the streams field of an unprocessed PMT.
+ *
+ * @param buf Pointer to the start of the verified section.
+ * @param pos Variable containing a const uint8_t pointer to the current stream.
+ */
+#define mpeg_pmt_section_raw_streams_for_each(buf, pos) \
+	for ((pos) = mpeg_pmt_section_raw_streams_first(buf); \
+	     (pos); \
+	     (pos) = mpeg_pmt_section_raw_streams_next(buf, pos))
+
+/**
+ * Accessor for the stream_type field of an unprocessed PMT stream.
+ *
+ * @param pos Pointer to the stream.
+ * @return The stream_type.
+ */
+static inline uint8_t mpeg_pmt_stream_raw_stream_type(const uint8_t *pos)
+{
+	return pos[0];
+}
+
+/**
+ * Accessor for the pid field of an unprocessed PMT stream.
+ *
+ * @param pos Pointer to the stream.
+ * @return The pid.
+ */
+static inline uint16_t mpeg_pmt_stream_raw_pid(const uint8_t *pos)
+{
+	return ucsi_get16(pos + 1) & 0x1fff;
+}
+
+/**
+ * Accessor for the es_info_length field of an unprocessed PMT stream.
+ *
+ * @param pos Pointer to the stream.
+ * @return The es_info_length.
+ */
+static inline uint16_t mpeg_pmt_stream_raw_es_info_length(const uint8_t *pos)
+{
+	return ucsi_get16(pos + 3) & 0x0fff;
+}
+
+/**
+ * Iterator for the descriptors field of an unprocessed PMT stream.
+ *
+ * @param stream Pointer to the stream.
+ * @param pos Variable containing a pointer to the current const descriptor.
+ */
+#define mpeg_pmt_stream_raw_descriptors_for_each(stream, pos) \
+	raw_descriptors_for_each((stream) + sizeof(struct mpeg_pmt_stream), \
+				 mpeg_pmt_stream_raw_es_info_length(stream), pos)
+
+
 
 
 
@@ -181,6 +288,31 @@ static inline struct descriptor *
 			       pos);
 }
 
+static inline const uint8_t *
+	mpeg_pmt_section_raw_streams_first(const uint8_t *buf)
+{
+	size_t pos = sizeof(struct mpeg_pmt_section) +
+		     mpeg_pmt_section_raw_program_info_length(buf);
+
+	if (pos >= section_ext_raw_length(buf))
+		return NULL;
+
+	return buf + pos;
+}
+
+static inline const uint8_t *
+	mpeg_pmt_section_raw_streams_next(const uint8_t *buf, const uint8_t *pos)
+{
+	const uint8_t *end = buf + section_ext_raw_length(buf);
+	const uint8_t *next = pos + sizeof(struct mpeg_pmt_stream) +
+			      mpeg_pmt_stream_raw_es_info_length(pos);
+
+	if (next >= end)
+		return NULL;
+
+	return next;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,427 @@
+/*
+ * section and descriptor parser
+ *
+ * Copyright (C) 2005 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pes_assembler.h"
+
+#define PES_BUF_MIN 4096
+
+/* as kept by transport_packet_continuity_check() */
+#define CONTINUITY_VALID 0x80
+
+struct pes_assembler_pid {
+	uint8_t *buf;
+	uint32_t size;		/* bytes allocated */
+	uint32_t count;		/* bytes accumulated */
+	uint32_t len;		/* total bytes expected, 0 until the header is known */
+	uint8_t cstate;
+	uint8_t started:1;	/* accumulating a PES packet */
+	uint8_t unbounded:1;	/* PES_packet_length is 0 */
+	uint8_t discontinuity:1;/* data lost since the last PES packet started */
+	enum pes_packet_flags flags;
+};
+
+struct pes_assembler {
+	struct pes_assembler_pid *pids[TRANSPORT_MAX_PIDS];
+	uint32_t max;
+
+	pes_assembler_callback callback;
+	void *arg;
+
+	struct pes_assembler_stats stats;
+};
+
+static void pes_assembler_lost(struct pes_assembler_pid *state);
+static void pes_assembler_deliver(struct pes_assembler *pa, int pid,
+				  uint8_t *buf, uint32_t len,
+				  enum pes_packet_flags flags);
+static void pes_assembler_payload(struct pes_assembler *pa, int pid,
+				  struct pes_assembler_pid *state,
+				  struct transport_values *values,
+				  int pdu_start);
+static int pes_assembler_append(struct pes_assembler *pa,
+				struct pes_assembler_pid *state,
+				uint8_t *frag, uint32_t len);
+static uint64_t pes_timestamp(uint8_t *buf);
+
+
+
+struct pes_assembler *pes_assembler_create(uint32_t max_packet_bytes,
+					   pes_assembler_callback callback,
+					   void *arg)
+{
+	struct pes_assembler *pa;
+
+	if (max_packet_bytes < PES_PACKET_HEADER_SIZE)
+		return NULL;
+
+	pa = malloc(sizeof(struct pes_assembler));
+	if (pa == NULL)
+		return NULL;
+	memset(pa, 0, sizeof(struct pes_assembler));
+
+	pa->max = max_packet_bytes;
+	pa->callback = callback;
+	pa->arg = arg;
+
+	return pa;
+}
+
+void pes_assembler_destroy(struct pes_assembler *pa)
+{
+	int pid;
+
+	for (pid = 0; pid < TRANSPORT_MAX_PIDS; pid++)
+		pes_assembler_remove_pid(pa, pid);
+
+	free(pa);
+}
+
+int pes_assembler_add_pid(struct pes_assembler *pa, int pid)
+{
+	struct pes_assembler_pid *state;
+
+	if ((pid < 0) || (pid >= TRANSPORT_MAX_PIDS))
+		return -1;
+	if (pa->pids[pid])
+		return 0;
+
+	state = malloc(sizeof(struct pes_assembler_pid));
+	if (state == NULL)
+		return -1;
+	memset(state, 0, sizeof(struct pes_assembler_pid));
+
+	pa->pids[pid] = state;
+	return 0;
+}
+
+int pes_assembler_remove_pid(struct pes_assembler *pa, int pid)
+{
+	if ((pid < 0) || (pid >= TRANSPORT_MAX_PIDS) || (pa->pids[pid] == NULL))
+		return -1;
+
+	free(pa->pids[pid]->buf);
+	free(pa->pids[pid]);
+	pa->pids[pid] = NULL;
+	return 0;
+}
+
+int pes_assembler_feed(struct pes_assembler *pa, uint8_t *buf, int len)
+{
+	struct transport_packet *pkt;
+	struct pes_assembler_pid *state;
+	struct transport_values values;
+	unsigned char cstate;
+	int pos = 0;
+	int pid;
+	int discontinuity_indicator;
+
+	while ((len - pos) >= TRANSPORT_PACKET_LENGTH) {
+		if (buf[pos] != TRANSPORT_PACKET_SYNC) {
+			pa->stats.sync_errors++;
+			pos++;
+			continue;
+		}
+		pkt = (struct transport_packet *) (buf + pos);
+		pos += TRANSPORT_PACKET_LENGTH;
+
+		pid = transport_packet_pid(pkt);
+		if ((state = pa->pids[pid]) == NULL)
+			continue;
+		pa->stats.packets++;
+
+		if (pkt->transport_error_indicator) {
+			pa->stats.transport_errors++;
+			pes_assembler_lost(state);
+			continue;
+		}
+		if (transport_packet_values_extract(pkt, &values, 0) < 0) {
+			pa->stats.transport_errors++;
+			pes_assembler_lost(state);
+			continue;
+		}
+		discontinuity_indicator = values.flags & transport_adaptation_flag_discontinuity;
+
+		/* check continuity, dropping a duplicate packet */
+		cstate = state->cstate;
+		if (transport_packet_continuity_check(pkt, discontinuity_indicator, &state->cstate)) {
+			pa->stats.continuity_errors++;
+			pes_assembler_lost(state);
+
+			/* resynchronise on this packet */
+			state->cstate = 0;
+			transport_packet_continuity_check(pkt, 0, &state->cstate);
+		} else if ((cstate & CONTINUITY_VALID) && !discontinuity_indicator &&
+			   ((cstate & 0x0f) == pkt->continuity_counter) &&
+			   (pkt->adaptation_field_control & 1)) {
+			continue;
+		}
+
+		if (pkt->transport_scrambling_control) {
+			pa->stats.scrambled++;
+			pes_assembler_lost(state);
+			continue;
+		}
+		if (values.payload_length == 0)
+			continue;
+
+		pes_assembler_payload(pa, pid, state, &values, pkt->payload_unit_start_indicator);
+	}
+
+	return pos;
+}
+
+void pes_assembler_flush(struct pes_assembler *pa)
+{
+	struct pes_assembler_pid *state;
+	int pid;
+
+	for (pid = 0; pid < TRANSPORT_MAX_PIDS; pid++) {
+		if ((state = pa->pids[pid]) == NULL)
+			continue;
+
+		if (state->started && state->unbounded)
+			pes_assembler_deliver(pa, pid, state->buf, state->count, state->flags);
+		state->started = 0;
+	}
+}
+
+void pes_assembler_get_stats(struct pes_assembler *pa,
+			     struct pes_assembler_stats *stats)
+{
+	memcpy(stats, &pa->stats, sizeof(struct pes_assembler_stats));
+}
+
+int pes_packet_parse(uint8_t *buf, uint32_t len, struct pes_packet *pes)
+{
+	uint32_t pes_len;
+	uint32_t header_len;
+	int pts_dts;
+
+	if (len < PES_PACKET_HEADER_SIZE)
+		return -1;
+	if ((buf[0] != 0x00) || (buf[1] != 0x00) || (buf[2] != 0x01))
+		return -1;
+
+	pes_len = (buf[4] << 8) | buf[5];
+	if (pes_len) {
+		if ((PES_PACKET_HEADER_SIZE + pes_len) > len)
+			return -1;
+		len = PES_PACKET_HEADER_SIZE + pes_len;
+	}
+
+	pes->stream_id = buf[3];
+	pes->flags &= ~(pes_packet_flag_pts | pes_packet_flag_dts);
+	pes->pts = 0;
+	pes->dts = 0;
+	pes->data = buf;
+	pes->length = len;
+
+	switch(pes->stream_id) {
+	case 0xbc: /* program_stream_map */
+	case 0xbe: /* padding_stream */
+	case 0xbf: /* private_stream_2 */
+	case 0xf0: /* ECM */
+	case 0xf1: /* EMM */
+	case 0xf2: /* DSMCC_stream */
+	case 0xf8: /* ITU-T Rec. H.222.1 type E */
+	case 0xff: /* program_stream_directory */
+		pes->payload = buf + PES_PACKET_HEADER_SIZE;
+		pes->payload_length = len - PES_PACKET_HEADER_SIZE;
+		return 0;
+	}
+
+	/* the optional PES header */
+	if (len < (PES_PACKET_HEADER_SIZE + 3))
+		return -1;
+	if ((buf[6] & 0xc0) != 0x80)
+		return -1;
+	header_len = PES_PACKET_HEADER_SIZE + 3 + buf[8];
+	if (header_len > len)
+		return -1;
+
+	pts_dts = buf[7] >> 6;
+	if (pts_dts & 2) {
+		if (buf[8] < 5)
+			return -1;
+		pes->pts = pes_timestamp(buf + 9);
+		pes->dts = pes->pts;
+		pes->flags |= pes_packet_flag_pts;
+	}
+	if (pts_dts == 3) {
+		if (buf[8] < 10)
+			return -1;
+		pes->dts = pes_timestamp(buf + 14);
+		pes->flags |= pes_packet_flag_dts;
+	}
+
+	pes->payload = buf + header_len;
+	pes->payload_length = len - header_len;
+	return 0;
+}
+
+static void pes_assembler_lost(struct pes_assembler_pid *state)
+{
+	state->started = 0;
+	state->discontinuity = 1;
+}
+
+static void pes_assembler_deliver(struct pes_assembler *pa, int pid,
+				  uint8_t *buf, uint32_t len,
+				  enum pes_packet_flags flags)
+{
+	struct pes_packet pes;
+
+	pes.flags = flags;
+	if (pes_packet_parse(buf, len, &pes)) {
+		pa->stats.bad_headers++;
+		return;
+	}
+	pes.pid = pid;
+
+	pa->stats.pes_packets++;
+	if (flags & pes_packet_flag_zero_copy)
+		pa->stats.zero_copy++;
+
+	pa->callback(pa->arg, &pes);
+}
+
+static void pes_assembler_payload(struct pes_assembler *pa, int pid,
+				  struct pes_assembler_pid *state,
+				  struct transport_values *values,
+				  int pdu_start)
+{
+	uint8_t *payload = values->payload;
+	uint32_t len = values->payload_length;
+	uint32_t pes_len;
+
+	if (pdu_start) {
+		/* the previous packet ends here */
+		if (state->started) {
+			if (state->unbounded)
+				pes_assembler_deliver(pa, pid, state->buf, state->count, state->flags);
+			else
+				pes_assembler_lost(state);
+		}
+
+		state->flags = 0;
+		if (state->discontinuity)
+			state->flags |= pes_packet_flag_discontinuity;
+		if (values->flags & transport_adaptation_flag_random_access)
+			state->flags |= pes_packet_flag_random_access;
+		state->discontinuity = 0;
+
+		/* a complete packet in this payload needs no copy */
+		if ((len >= PES_PACKET_HEADER_SIZE) &&
+		    (payload[0] == 0x00) && (payload[1] == 0x00) && (payload[2] == 0x01)) {
+			pes_len = (payload[4] << 8) | payload[5];
+			if (pes_len && ((PES_PACKET_HEADER_SIZE + pes_len) <= len)) {
+				state->started = 0;
+				pes_assembler_deliver(pa, pid, payload, PES_PACKET_HEADER_SIZE + pes_len,
+						      state->flags | pes_packet_flag_zero_copy);
+				return;
+			}
+		}
+
+		state->started = 1;
+		state->unbounded = 0;
+		state->count = 0;
+		state->len = 0;
+	} else if (!state->started) {
+		return;
+	}
+
+	/* don't copy the stuffing after a bounded packet */
+	if (state->len && ((state->count + len) > state->len))
+		len = state->len - state->count;
+	if (pes_assembler_append(pa, state, payload, len))
+		return;
+
+	/* work out the length once the header is there */
+	if ((state->len == 0) && !state->unbounded && (state->count >= PES_PACKET_HEADER_SIZE)) {
+		if ((state->buf[0] != 0x00) || (state->buf[1] != 0x00) || (state->buf[2] != 0x01)) {
+			pa->stats.bad_headers++;
+			pes_assembler_lost(state);
+			return;
+		}
+
+		pes_len = (state->buf[4] << 8) | state->buf[5];
+		if (pes_len == 0) {
+			state->unbounded = 1;
+		} else {
+			state->len = PES_PACKET_HEADER_SIZE + pes_len;
+			if (state->len > pa->max) {
+				pa->stats.overflows++;
+				pes_assembler_lost(state);
+				return;
+			}
+		}
+	}
+
+	if (state->len && (state->count >= state->len)) {
+		state->started = 0;
+		pes_assembler_deliver(pa, pid, state->buf, state->len, state->flags);
+	}
+}
+
+static int pes_assembler_append(struct pes_assembler *pa,
+				struct pes_assembler_pid *state,
+				uint8_t *frag, uint32_t len)
+{
+	uint32_t size;
+	uint8_t *buf;
+
+	if ((state->count + len) > pa->max) {
+		pa->stats.overflows++;
+		pes_assembler_lost(state);
+		return -1;
+	}
+
+	if ((state->count + len) > state->size) {
+		size = state->size ? state->size : PES_BUF_MIN;
+		while (size < (state->count + len))
+			size *= 2;
+		if (size > pa->max)
+			size = pa->max;
+
+		buf = realloc(state->buf, size);
+		if (buf == NULL) {
+			pes_assembler_lost(state);
+			return -1;
+		}
+		state->buf = buf;
+		state->size = size;
+	}
+
+	memcpy(state->buf + state->count, frag, len);
+	state->count += len;
+	pa->stats.bytes_copied += len;
+	return 0;
+}
+
+static uint64_t pes_timestamp(uint8_t *buf)
+{
+	return (((uint64_t) (buf[0] & 0x0e)) << 29) |
+		((uint64_t) buf[1] << 22) |
+		((uint64_t) (buf[2] & 0xfe) << 14) |
+		((uint64_t) buf[3] << 7) |
+		((uint64_t) buf[4] >> 1);
+}
@@ -0,0 +1,187 @@
+/*
+ * section and descriptor parser
+ *
+ * Copyright (C) 2005 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef _UCSI_PES_ASSEMBLER_H
+#define _UCSI_PES_ASSEMBLER_H 1
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include "transport_packet.h"
+
+#define PES_PACKET_HEADER_SIZE		6
+#define PES_DEFAULT_MAX_PACKET_BYTES	(1024 * 1024)
+
+/**
+ * Enumeration of flags describing a PES packet passed to a
+ * pes_assembler_callback.
+ */
+enum pes_packet_flags {
+	pes_packet_flag_pts			= 0x01,	/* pts is valid */
+	pes_packet_flag_dts			= 0x02,	/* dts is valid */
+	pes_packet_flag_discontinuity		= 0x04,	/* data was lost on the PID before this packet */
+	pes_packet_flag_random_access		= 0x08,	/* random_access_indicator set on the first TS packet */
+	pes_packet_flag_zero_copy		= 0x10,	/* data points into the buffer passed to pes_assembler_feed() */
+};
+
+/**
+ * Structure describing a PES packet.
+ */
+struct pes_packet {
+	uint16_t pid;
+	uint8_t stream_id;
+	enum pes_packet_flags flags;
+	uint64_t pts;			/* 90kHz */
+	uint64_t dts;			/* 90kHz, equal to pts if not present */
+
+	uint8_t *data;			/* the whole packet, starting at packet_start_code_prefix */
+	uint32_t length;
+	uint8_t *payload;		/* the PES_packet_data_bytes */
+	uint32_t payload_length;
+};
+
+/**
+ * Counters kept by a pes_assembler.
+ */
+struct pes_assembler_stats {
+	uint64_t packets;		/* TS packets on selected PIDs */
+	uint64_t pes_packets;		/* PES packets delivered */
+	uint64_t zero_copy;		/* ... of which without copying */
+	uint64_t bytes_copied;
+	uint64_t sync_errors;		/* bytes skipped looking for a sync byte */
+	uint64_t transport_errors;	/* packets with transport_error_indicator set */
+	uint64_t continuity_errors;
+	uint64_t scrambled;		/* scrambled packets, dropped */
+	uint64_t bad_headers;		/* PES packets with an invalid header */
+	uint64_t overflows;		/* PES packets larger than the maximum */
+};
+
+/**
+ * Opaque type for a PES assembler. It keeps reassembly state for each
+ * selected PID, and calls back with each complete PES packet.
+ *
+ * A PES packet contained in the payload of a single TS packet is delivered
+ * in place, without copying. Others are accumulated in a per-PID buffer
+ * which grows as needed and is reused for the following packets of the PID.
+ * A PES packet with a PES_packet_length of 0 (unbounded, as is usual for
+ * video) is complete when the next one starts on its PID.
+ *
+ * On a continuity error, transport error or scrambled packet, the partial
+ * PES packet is dropped, and the PID waits for the next
+ * payload_unit_start_indicator. The next PES packet is then flagged with
+ * pes_packet_flag_discontinuity. A single duplicate packet is dropped
+ * silently.
+ */
+struct pes_assembler;
+
+/**
+ * Type definition for the PES packet callback.
+ *
+ * @param arg Private argument.
+ * @param pes The PES packet. Its data is only valid during the call.
+ */
+typedef void (*pes_assembler_callback)(void *arg, struct pes_packet *pes);
+
+/**
+ * Create a pes_assembler.
+ *
+ * @param max_packet_bytes Largest PES packet to assemble, including its
+ * header. Larger packets are dropped.
+ * @param callback Function to call with each PES packet.
+ * @param arg Private argument for the callback.
+ * @return The new instance, or NULL on error.
+ */
+extern struct pes_assembler *pes_assembler_create(uint32_t max_packet_bytes,
+						  pes_assembler_callback callback,
+						  void *arg);
+
+/**
+ * Destroy a pes_assembler. Pending unbounded PES packets are not delivered,
+ * use pes_assembler_flush() first to get them.
+ *
+ * @param pa The instance.
+ */
+extern void pes_assembler_destroy(struct pes_assembler *pa);
+
+/**
+ * Start assembling PES packets on a PID.
+ *
+ * @param pa The instance.
+ * @param pid The PID.
+ * @return 0 on success, nonzero on error.
+ */
+extern int pes_assembler_add_pid(struct pes_assembler *pa, int pid);
+
+/**
+ * Stop assembling PES packets on a PID, discarding any partial packet.
+ *
+ * @param pa The instance.
+ * @param pid The PID.
+ * @return 0 on success, nonzero if the PID was not selected.
+ */
+extern int pes_assembler_remove_pid(struct pes_assembler *pa, int pid);
+
+/**
+ * Pass transport stream data to a pes_assembler. Packets on PIDs which were
+ * not added are skipped.
+ *
+ * @param pa The instance.
+ * @param buf The data.
+ * @param len Number of bytes of data.
+ * @return Number of bytes consumed. Any remainder is less than a transport
+ * packet, and should be passed again with the data which follows it.
+ */
+extern int pes_assembler_feed(struct pes_assembler *pa, uint8_t *buf, int len);
+
+/**
+ * Deliver the pending unbounded PES packets, e.g. at the end of a stream.
+ *
+ * @param pa The instance.
+ */
+extern void pes_assembler_flush(struct pes_assembler *pa);
+
+/**
+ * Retrieve the counters.
+ *
+ * @param pa The instance.
+ * @param stats Where to put them.
+ */
+extern void pes_assembler_get_stats(struct pes_assembler *pa,
+				    struct pes_assembler_stats *stats);
+
+/**
+ * Parse the header of a complete PES packet.
+ *
+ * @param buf The packet, starting at packet_start_code_prefix.
+ * @param len Number of bytes in the packet.
+ * @param pes Where to put the stream_id, pts/dts and their flags, and the
+ * data/payload pointers and lengths. pid is left alone.
+ * @return 0 on success, nonzero if the header is invalid.
+ */
+extern int pes_packet_parse(uint8_t *buf, uint32_t len, struct pes_packet *pes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
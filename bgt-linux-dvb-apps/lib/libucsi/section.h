@@ -246,6 +246,206 @@ static inline int section_ext_useful(struct section_ext *section, struct psi_tab
 	return 1;
 }
 
+/*
+ * Non-mutating accessors.
+ *
+ * section_codec(), section_ext_decode() and the table specific codecs
+ * byteswap fields in place, so a buffer can only be decoded once and must be
+ * writable. The *_raw_* functions below instead read fields directly from
+ * the big-endian wire format and never modify the buffer, so sections can be
+ * used straight from read-only memory (e.g. an mmap()ed capture or a ring
+ * buffer shared between threads).
+ *
+ * A buffer must be checked with section_raw_verify() or
+ * section_ext_raw_verify() (followed by the table specific
+ * *_section_raw_verify()) before any other raw accessor is used on it.
+ */
+
+/**
+ * Accessor for the table_id of an unprocessed section.
+ *
+ * @param buf Pointer to the start of the section.
+ * @return The table_id.
+ */
+static inline uint8_t section_raw_table_id(const uint8_t *buf)
+{
+	return buf[0];
+}
+
+/**
+ * Accessor for the syntax_indicator of an unprocessed section.
+ *
+ * @param buf Pointer to the start of the section.
+ * @return The syntax_indicator.
+ */
+static inline int section_raw_syntax_indicator(const uint8_t *buf)
+{
+	return buf[1] >> 7;
+}
+
+/**
+ * Determine the total length of an unprocessed section, including the header.
+ *
+ * @param buf Pointer to the start of the section.
+ * @return The length.
+ */
+static inline size_t section_raw_length(const uint8_t *buf)
+{
+	return (ucsi_get16(buf + 1) & 0x0fff) + sizeof(struct section);
+}
+
+/**
+ * Determine the total length of an unprocessed extended section, including
+ * the header, but omitting the CRC.
+ *
+ * @param buf Pointer to the start of the section.
+ * @return The length.
+ */
+static inline size_t section_ext_raw_length(const uint8_t *buf)
+{
+	return section_raw_length(buf) - CRC_SIZE;
+}
+
+/**
+ * Accessor for the table_id_ext of an unprocessed extended section.
+ *
+ * @param buf Pointer to the start of the section.
+ * @return The table_id_ext.
+ */
+static inline uint16_t section_ext_raw_table_id_ext(const uint8_t *buf)
+{
+	return ucsi_get16(buf + 3);
+}
+
+/**
+ * Accessor for the version_number of an unprocessed extended section.
+ *
+ * @param buf Pointer to the start of the section.
+ * @return The version_number.
+ */
+static inline uint8_t section_ext_raw_version_number(const uint8_t *buf)
+{
+	return (buf[5] >> 1) & 0x1f;
+}
+
+/**
+ * Accessor for the current_next_indicator of an unprocessed extended section.
+ *
+ * @param buf Pointer to the start of the section.
+ * @return The current_next_indicator.
+ */
+static inline uint8_t section_ext_raw_current_next_indicator(const uint8_t *buf)
+{
+	return buf[5] & 0x01;
+}
+
+/**
+ * Accessor for the section_number of an unprocessed extended section.
+ *
+ * @param buf Pointer to the start of the section.
+ * @return The section_number.
+ */
+static inline uint8_t section_ext_raw_section_number(const uint8_t *buf)
+{
+	return buf[6];
+}
+
+/**
+ * Accessor for the last_section_number of an unprocessed extended section.
+ *
+ * @param buf Pointer to the start of the section.
+ * @return The last_section_number.
+ */
+static inline uint8_t section_ext_raw_last_section_number(const uint8_t *buf)
+{
+	return buf[7];
+}
+
+/**
+ * Check an unprocessed section without modifying it.
+ *
+ * @param buf Pointer to the data.
+ * @param len Length of data.
+ * @param check_crc If 1, the CRC of the section will also be checked.
+ * @return 0 if the section is valid, or -1 if not.
+ */
+static inline int section_raw_verify(const uint8_t *buf, size_t len, int check_crc)
+{
+	if (len < sizeof(struct section))
+		return -1;
+
+	if (len != section_raw_length(buf))
+		return -1;
+
+	/* the crc includes the crc value, the result should therefore be zero */
+	if (check_crc && crc32(CRC32_INIT, (uint8_t *) buf, len))
+		return -1;
+
+	return 0;
+}
+
+/**
+ * Check an unprocessed extended section without modifying it.
+ *
+ * @param buf Pointer to the data.
+ * @param len Length of data.
+ * @param check_crc If 1, the CRC of the section will also be checked.
+ * @return 0 if the section is valid, or -1 if not.
+ */
+static inline int section_ext_raw_verify(const uint8_t *buf, size_t len, int check_crc)
+{
+	if (section_raw_verify(buf, len, 0))
+		return -1;
+
+	if (section_raw_syntax_indicator(buf) == 0)
+		return -1;
+
+	if (len < sizeof(struct section_ext) + CRC_SIZE)
+		return -1;
+
+	if (check_crc && crc32(CRC32_INIT, (uint8_t *) buf, len))
+		return -1;
+
+	return 0;
+}
+
+/**
+ * Check if a supplied unprocessed section_ext is something we want to
+ * process. This is the non-mutating equivalent of section_ext_useful().
+ *
+ * @param buf Pointer to the verified section.
+ * @param tstate The state structure for this PSI table.
+ * @return 0=> not useful. nonzero => useful.
+ */
+static inline int section_ext_raw_useful(const uint8_t *buf, struct psi_table_state *tstate)
+{
+	uint8_t version_number = section_ext_raw_version_number(buf);
+	uint8_t section_number = section_ext_raw_section_number(buf);
+
+	if ((version_number == tstate->version_number) && tstate->complete)
+		return 0;
+	if (version_number != tstate->version_number) {
+		if (section_number != 0)
+			return 0;
+
+		tstate->next_section_number = 0;
+		tstate->complete = 0;
+		tstate->version_number = version_number;
+		tstate->new_table = 1;
+	} else if (section_number == tstate->next_section_number) {
+		tstate->new_table = 0;
+	} else {
+		return 0;
+	}
+
+	tstate->next_section_number++;
+	if (section_ext_raw_last_section_number(buf) < tstate->next_section_number) {
+		tstate->complete = 1;
+	}
+
+	return 1;
+}
+
 #ifdef __cplusplus
 }
 #endif
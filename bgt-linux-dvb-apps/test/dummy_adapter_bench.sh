@@ -0,0 +1,155 @@
+#!/bin/sh
+#
+# Run dvbtraffic, gnutv and scan against the dvb_dummy_adapter module and
+# report stream throughput and CPU use, without any DVB hardware.
+#
+# Usage: dummy_adapter_bench.sh [dvbtraffic|gnutv|scan|all]
+#
+# Settings are taken from the environment:
+#
+#   REPLAY_FILE=capture.ts	TS to replay (default: synthetic PID mix)
+#   BITRATE=38000		stream bitrate in kbit/s, 0 = unthrottled
+#   BUFFER_PACKETS=348		TS packets per buffer
+#   LOCK_DELAY=0		frontend lock delay in ms
+#   DURATION=10			seconds to run dvbtraffic and gnutv
+#   CHANNELS=channels.conf	gnutv/scan channel list matching REPLAY_FILE
+#   CHANNEL=name		gnutv channel to record
+#   INITIAL=initial-tuning	scan initial tuning file
+#   MODULE=dvb_dummy_adapter	module name, or path to the .ko
+#
+# Must be run as root from the test directory of a built dvb-apps tree.
+#
+
+TOP=$(cd "$(dirname "$0")/.." && pwd)
+DVBTRAFFIC=$TOP/util/dvbtraffic/dvbtraffic
+GNUTV=$TOP/util/gnutv/gnutv
+SCAN=$TOP/util/scan/scan
+
+BITRATE=${BITRATE:-38000}
+BUFFER_PACKETS=${BUFFER_PACKETS:-348}
+LOCK_DELAY=${LOCK_DELAY:-0}
+DURATION=${DURATION:-10}
+MODULE=${MODULE:-dvb_dummy_adapter}
+TMP=${TMPDIR:-/tmp}/dummy_adapter_bench.$$
+
+die() {
+	echo "$*" >&2
+	exit 1
+}
+
+# jiffies of CPU used by a process: utime + stime
+cpu_ticks() {
+	[ -r /proc/$1/stat ] || { echo 0; return; }
+	sed 's/.*) //' /proc/$1/stat | awk '{ print $12 + $13 }'
+}
+
+load_module() {
+	before=$(ls -d /dev/dvb/adapter* 2>/dev/null)
+
+	params="bitrate=$BITRATE buffer_packets=$BUFFER_PACKETS"
+	[ -n "$REPLAY_FILE" ] && params="$params replay_file=$REPLAY_FILE"
+
+	modprobe dvb_dummy_fe lock_delay=$LOCK_DELAY || die "cannot load dvb_dummy_fe"
+	case "$MODULE" in
+	*.ko)	insmod "$MODULE" $params ;;
+	*)	modprobe "$MODULE" $params ;;
+	esac || die "cannot load $MODULE"
+	sleep 1
+
+	for dev in $(ls -d /dev/dvb/adapter* 2>/dev/null); do
+		echo "$before" | grep -qx "$dev" && continue
+		ADAPTER=${dev#/dev/dvb/adapter}
+		break
+	done
+	[ -n "$ADAPTER" ] || die "no new adapter appeared"
+	echo "dummy adapter is /dev/dvb/adapter$ADAPTER"
+}
+
+unload_module() {
+	rmmod "$(basename "$MODULE" .ko)"
+	rmmod dvb_dummy_fe
+	# the module logs its own throughput each time streaming stops
+	dmesg | grep "dvb_dummy_adapter[0-9]*: .* packets in" | tail -n 5
+}
+
+# run_timed <name> <command...>: runs the command, sampling the CPU of the
+# command and of the adapter's feed thread
+run_timed() {
+	name=$1
+	shift
+	hz=$(getconf CLK_TCK)
+
+	"$@" > $TMP.out 2> $TMP.err &
+	pid=$!
+	sleep 1
+	kthread=$(pgrep -x "dvb_dummy[0-9]*" | head -n 1)
+	k0=$(cpu_ticks "$kthread")
+	t0=$(date +%s%N)
+
+	wait $pid
+	status=$?
+
+	t1=$(date +%s%N)
+	k1=$(cpu_ticks "$kthread")
+	ms=$(( (t1 - t0) / 1000000 ))
+	[ $ms -gt 0 ] || ms=1
+
+	ucpu=$(awk '/^utime/ { u = $2 } /^stime/ { s = $2 } END { print u + s }' $TMP.time 2>/dev/null)
+	echo "$name: exit $status, ${ms}ms wall"
+	[ -n "$ucpu" ] && echo "$name: ${ucpu}s process CPU"
+	[ -n "$kthread" ] &&
+		echo "$name: feed thread CPU $(( (k1 - k0) * 100000 / hz / ms ))%"
+	return $status
+}
+
+bench_dvbtraffic() {
+	[ -x $DVBTRAFFIC ] || die "build $DVBTRAFFIC first"
+	run_timed dvbtraffic /usr/bin/time -f "utime %U\nstime %S" -o $TMP.time \
+		timeout -s INT $DURATION $DVBTRAFFIC -a $ADAPTER
+	# last total (PID 0x2000) line is the full stream rate
+	grep "^2000 " $TMP.out | tail -n 1 | awk '{ print "dvbtraffic: " $2 " p/s, " $6 " kbit/s" }'
+}
+
+bench_gnutv() {
+	[ -x $GNUTV ] || die "build $GNUTV first"
+	[ -n "$CHANNELS" ] && [ -n "$CHANNEL" ] || {
+		echo "gnutv: skipped, set CHANNELS and CHANNEL"
+		return
+	}
+	run_timed gnutv /usr/bin/time -f "utime %U\nstime %S" -o $TMP.time \
+		$GNUTV -adapter $ADAPTER -channels "$CHANNELS" \
+		-out file $TMP.ts -timeout $DURATION "$CHANNEL"
+	bytes=$(stat -c %s $TMP.ts 2>/dev/null || echo 0)
+	echo "gnutv: recorded $bytes bytes, $(( bytes * 8 / 1000 / DURATION )) kbit/s"
+	rm -f $TMP.ts
+}
+
+bench_scan() {
+	[ -x $SCAN ] || die "build $SCAN first"
+	[ -n "$INITIAL" ] || {
+		echo "scan: skipped, set INITIAL"
+		return
+	}
+	run_timed scan /usr/bin/time -f "utime %U\nstime %S" -o $TMP.time \
+		$SCAN -a $ADAPTER "$INITIAL"
+	echo "scan: $(grep -c : $TMP.out) services found"
+}
+
+[ "$(id -u)" = 0 ] || die "must be run as root"
+
+what=${1:-all}
+load_module
+trap 'rm -f $TMP.*' EXIT
+
+case "$what" in
+dvbtraffic|gnutv|scan)
+	bench_$what ;;
+all)
+	bench_dvbtraffic
+	bench_gnutv
+	bench_scan ;;
+*)
+	echo "usage: $0 [dvbtraffic|gnutv|scan|all]" >&2 ;;
+esac
+
+unload_module
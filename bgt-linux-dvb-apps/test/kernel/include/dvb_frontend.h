@@ -0,0 +1,10 @@
+#include <kernel_stubs.h>
+
+#ifndef _DVB_FRONTEND_H_
+#define _DVB_FRONTEND_H_
+
+struct dvb_frontend {
+	void *tuner_priv;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * Minimal userspace stand-ins for the kernel interfaces used by the
+ * dvb-core and tuner sources built by the programs in this directory.
+ */
+
+#ifndef KERNEL_STUBS_H
+#define KERNEL_STUBS_H 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+
+#define __user
+#define EXPORT_SYMBOL(sym)
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define ACCESS_ONCE(x) (*(volatile typeof(x) *)&(x))
+#define READ_ONCE(x) ACCESS_ONCE(x)
+#define smp_mb() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define smp_load_acquire(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+typedef pthread_spinlock_t spinlock_t;
+#define spin_lock_init(l) pthread_spin_init(l, PTHREAD_PROCESS_PRIVATE)
+#define spin_lock(l) pthread_spin_lock(l)
+#define spin_unlock(l) pthread_spin_unlock(l)
+#define spin_lock_irqsave(l, flags) do { (void) (flags); pthread_spin_lock(l); } while (0)
+#define spin_unlock_irqrestore(l, flags) pthread_spin_unlock(l)
+
+typedef int wait_queue_head_t;
+#define init_waitqueue_head(q) (*(q) = 0)
+#define wake_up(q) do { } while (0)
+
+#define copy_to_user(to, from, n) (memcpy(to, from, n), 0)
+#define copy_from_user(to, from, n) (memcpy(to, from, n), 0)
+
+#define IS_ENABLED(option) 1
+
+#define KERN_ERR ""
+#define KERN_WARNING ""
+#define KERN_INFO ""
+#define KERN_DEBUG ""
+#define printk printf
+#define pr_info printf
+
+#define BUG_ON(condition) do { if (condition) abort(); } while (0)
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+struct mutex {
+	pthread_mutex_t lock;
+};
+
+#endif
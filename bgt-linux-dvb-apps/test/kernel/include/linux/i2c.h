@@ -0,0 +1,3 @@
+#include <kernel_stubs.h>
+
+struct i2c_adapter;
@@ -0,0 +1,186 @@
+/*
+ * dvb_ringbuffer benchmark: one writer thread standing in for the demux
+ * callback and one reader thread standing in for read() on the device,
+ * passing sequence-numbered TS packets through the dvb-core ring buffer.
+ *
+ * Copyright (C) 2005 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+
+/* the kernel source, built against the stubs in include/ */
+#include "dvb_ringbuffer.c"
+
+#define DEFAULT_PACKETS (4 * 1024 * 1024)
+#define PACKET_LENGTH 188
+#define READ_BYTES (64 * 1024)
+#define DVR_BUFFER_SIZE (10 * 188 * 1024)	/* as in dmxdev.h */
+
+struct bench {
+	const char *name;
+	size_t size;
+	int locked;		/* writer takes a lock per packet, as dmxdev did */
+
+	struct dvb_ringbuffer rbuf;
+	spinlock_t lock;
+	long packets;
+	long errors;
+};
+
+static void *writer_thread(void *arg);
+static void *reader_thread(void *arg);
+static int run(struct bench *bench);
+static double now(void);
+
+int main(int argc, char *argv[])
+{
+	struct bench benches[] = {
+		{ "spsc pow2", 2 * 1024 * 1024, 0 },
+		{ "spsc", DVR_BUFFER_SIZE, 0 },
+		{ "locked pow2", 2 * 1024 * 1024, 1 },
+	};
+	long packets = DEFAULT_PACKETS;
+	int failed = 0;
+	unsigned int i;
+
+	if (argc > 2) {
+		fprintf(stderr, "Syntax: ringbench [<packets>]\n");
+		exit(1);
+	}
+	if (argc == 2)
+		packets = atol(argv[1]);
+
+	for(i=0; i < ARRAY_SIZE(benches); i++) {
+		benches[i].packets = packets;
+		if (run(&benches[i]))
+			failed = 1;
+	}
+
+	return failed;
+}
+
+static int run(struct bench *bench)
+{
+	pthread_t writer, reader;
+	double start, elapsed;
+	void *mem;
+
+	if ((mem = malloc(bench->size)) == NULL) {
+		fprintf(stderr, "Failed to allocate %zu bytes\n", bench->size);
+		return -1;
+	}
+	dvb_ringbuffer_init(&bench->rbuf, mem, bench->size);
+	spin_lock_init(&bench->lock);
+	bench->errors = 0;
+
+	start = now();
+	pthread_create(&reader, NULL, reader_thread, bench);
+	pthread_create(&writer, NULL, writer_thread, bench);
+	pthread_join(writer, NULL);
+	pthread_join(reader, NULL);
+	elapsed = now() - start;
+
+	printf("%-12s %8zu bytes%s: %7.1f MB/s, %5.2f M packets/sec",
+	       bench->name, bench->size, bench->rbuf.mask ? " (masked)" : "",
+	       (bench->packets * PACKET_LENGTH) / elapsed / (1024 * 1024),
+	       bench->packets / elapsed / 1000000);
+	if (bench->errors)
+		printf(", FAILED: %li packets out of order\n", bench->errors);
+	else
+		printf("\n");
+
+	free(mem);
+	return bench->errors ? -1 : 0;
+}
+
+static void *writer_thread(void *arg)
+{
+	struct bench *bench = arg;
+	uint8_t packet[PACKET_LENGTH];
+	long seq;
+
+	memset(packet, 0xff, sizeof(packet));
+	packet[0] = 0x47;
+
+	for(seq = 0; seq < bench->packets; seq++) {
+		memcpy(packet + 4, &seq, sizeof(seq));
+
+		// the demux would drop the packet; wait, so that the reader
+		// can check nothing was reordered
+		while(dvb_ringbuffer_free(&bench->rbuf) < PACKET_LENGTH)
+			sched_yield();
+
+		if (bench->locked)
+			spin_lock(&bench->lock);
+		dvb_ringbuffer_write(&bench->rbuf, packet, PACKET_LENGTH);
+		if (bench->locked)
+			spin_unlock(&bench->lock);
+	}
+
+	return NULL;
+}
+
+static void *reader_thread(void *arg)
+{
+	struct bench *bench = arg;
+	uint8_t buf[READ_BYTES];
+	uint8_t packet[PACKET_LENGTH];
+	int packet_length = 0;
+	long expected = 0;
+	ssize_t avail;
+	ssize_t i;
+	long seq;
+
+	while(expected < bench->packets) {
+		avail = dvb_ringbuffer_avail(&bench->rbuf);
+		if (avail == 0) {
+			sched_yield();
+			continue;
+		}
+		if (avail > READ_BYTES)
+			avail = READ_BYTES;
+		dvb_ringbuffer_read_user(&bench->rbuf, buf, avail);
+
+		// reads do not stop at packet boundaries
+		for(i=0; i < avail; i++) {
+			packet[packet_length++] = buf[i];
+			if (packet_length < PACKET_LENGTH)
+				continue;
+			packet_length = 0;
+
+			memcpy(&seq, packet + 4, sizeof(seq));
+			if ((packet[0] != 0x47) || (seq != expected))
+				bench->errors++;
+			expected++;
+		}
+	}
+
+	return NULL;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
@@ -0,0 +1,320 @@
+/*
+ * Check the tda18271 map lookups: for every kHz of each map of the C1 and
+ * C2 layouts, the binary search must give the same entry and return code
+ * as the linear walk.
+ *
+ * Copyright (C) 2005 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+/* only the props type is used, and the real header needs the i2c core */
+#define __TUNER_I2C_H__
+struct tuner_i2c_props {
+	int addr;
+};
+
+/* the kernel source, built against the stubs in include/ */
+#include "tda18271-maps.c"
+
+/* lookups above the top of a map, in kHz */
+#define OVER_RANGE_KHZ 1000
+
+#define MAX_REPORTED 10
+
+int tda18271_debug;
+
+static int warnings;
+static long lookups;
+static long mismatches;
+
+static const char *map_names[] = {
+	"main_pll", "cal_pll", "rf_cal", "km", "rf_cal_dc_over_dt",
+	"bp_filter", "rf_band", "gain_taper", "ir_measure",
+};
+
+static int check_layout(enum tda18271_ver id, const char *name);
+static void *layout_map(struct tda18271_map_layout *maps, enum tda18271_map_type type);
+static u32 map_top(struct tda18271_priv *priv, enum tda18271_map_type type);
+static void check_lookup(struct dvb_frontend *fe, enum tda18271_map_type type, u32 freq);
+static void check_rf_band(struct dvb_frontend *fe, u32 freq);
+static void check_cid_target(struct dvb_frontend *fe, u32 freq);
+static int check_count_map(void);
+static void mismatch(const char *map_name, u32 freq, int ret1, int val1, int ret2, int val2);
+
+int main(int argc, char *argv[])
+{
+	int failed = 0;
+
+	if (argc != 1) {
+		fprintf(stderr, "Syntax: tda18271_maps\n");
+		exit(1);
+	}
+
+	if (check_layout(TDA18271HDC1, "C1"))
+		failed = 1;
+	if (check_layout(TDA18271HDC2, "C2"))
+		failed = 1;
+	if (check_count_map())
+		failed = 1;
+
+	if (failed)
+		printf("FAILED\n");
+	return failed;
+}
+
+void _tda_printk(struct tda18271_priv *state, const char *level,
+		 const char *func, const char *fmt, ...)
+{
+	va_list ap;
+
+	warnings++;
+	if (getenv("TDA18271_VERBOSE")) {
+		va_start(ap, fmt);
+		printf("%s: ", func);
+		vprintf(fmt, ap);
+		va_end(ap);
+	}
+}
+
+static int check_layout(enum tda18271_ver id, const char *name)
+{
+	struct tda18271_priv priv;
+	struct dvb_frontend fe;
+	long old_mismatches = mismatches;
+	long old_lookups = lookups;
+	u32 top, khz;
+	int type;
+
+	memset(&priv, 0, sizeof(priv));
+	priv.id = id;
+	fe.tuner_priv = &priv;
+	warnings = 0;
+
+	if (tda18271_assign_map_layout(&fe)) {
+		printf("%s: no map layout\n", name);
+		return -1;
+	}
+	for(type = MAIN_PLL; type <= IR_MEASURE; type++) {
+		if (layout_map(priv.maps, type) && (priv.map_entries[type] == 0)) {
+			printf("%s: %s map is not searchable\n", name, map_names[type]);
+			return -1;
+		}
+	}
+	if (warnings) {
+		printf("%s: %i warnings while sizing the maps\n", name, warnings);
+		return -1;
+	}
+
+	for(type = MAIN_PLL; type <= IR_MEASURE; type++) {
+		// not every chip has every map
+		if (!layout_map(priv.maps, type))
+			continue;
+
+		top = map_top(&priv, type) + OVER_RANGE_KHZ;
+		for(khz = 0; khz <= top; khz++) {
+			// the maps are in kHz, lookups in Hz: also try just
+			// above each kHz, so every boundary is crossed
+			check_lookup(&fe, type, khz * 1000);
+			check_lookup(&fe, type, khz * 1000 + 1);
+		}
+	}
+
+	top = tda18271_rf_band_template[ARRAY_SIZE(tda18271_rf_band_template) - 2].rfmax;
+	for(khz = 0; khz <= top + OVER_RANGE_KHZ; khz++) {
+		check_rf_band(&fe, khz * 1000);
+		check_rf_band(&fe, khz * 1000 + 1);
+	}
+
+	top = tda18271_cid_target[ARRAY_SIZE(tda18271_cid_target) - 2].rfmax;
+	for(khz = 0; khz <= top + OVER_RANGE_KHZ; khz++) {
+		check_cid_target(&fe, khz * 1000);
+		check_cid_target(&fe, khz * 1000 + 1);
+	}
+
+	printf("%s: %li lookups, %li mismatches\n", name,
+	       lookups - old_lookups, mismatches - old_mismatches);
+	return (mismatches != old_mismatches) ? -1 : 0;
+}
+
+static void *layout_map(struct tda18271_map_layout *maps, enum tda18271_map_type type)
+{
+	switch (type) {
+	case MAIN_PLL:		return maps->main_pll;
+	case CAL_PLL:		return maps->cal_pll;
+	case RF_CAL:		return maps->rf_cal;
+	case RF_CAL_KMCO:	return maps->rf_cal_kmco;
+	case RF_CAL_DC_OVER_DT:	return maps->rf_cal_dc_over_dt;
+	case BP_FILTER:		return maps->bp_filter;
+	case RF_BAND:		return maps->rf_band;
+	case GAIN_TAPER:	return maps->gain_taper;
+	case IR_MEASURE:	return maps->ir_measure;
+	}
+	return NULL;
+}
+
+/* the highest frequency of a map, in kHz */
+static u32 map_top(struct tda18271_priv *priv, enum tda18271_map_type type)
+{
+	int last = priv->map_entries[type] - 1;
+
+	if (type <= CAL_PLL)
+		return ((struct tda18271_pll_map *) layout_map(priv->maps, type))[last].lomax;
+	return ((struct tda18271_map *) layout_map(priv->maps, type))[last].rfmax;
+}
+
+/*
+ * Look freq up once with the map's entry count, which searches, and once
+ * with it cleared, which walks the map as the driver did before.
+ */
+static void check_lookup(struct dvb_frontend *fe, enum tda18271_map_type type, u32 freq)
+{
+	struct tda18271_priv *priv = fe->tuner_priv;
+	u16 entries = priv->map_entries[type];
+	u8 pd1 = 0, d1 = 0, pd2 = 0, d2 = 0;
+	u8 val1 = 0, val2 = 0;
+	u32 f;
+	int ret1, ret2;
+
+	lookups++;
+	if (type <= CAL_PLL) {
+		f = freq;
+		ret1 = tda18271_lookup_pll_map(fe, type, &f, &pd1, &d1);
+		priv->map_entries[type] = 0;
+		f = freq;
+		ret2 = tda18271_lookup_pll_map(fe, type, &f, &pd2, &d2);
+		priv->map_entries[type] = entries;
+
+		if ((ret1 != ret2) || (pd1 != pd2) || (d1 != d2))
+			mismatch(map_names[type], freq, ret1, (pd1 << 8) | d1,
+				 ret2, (pd2 << 8) | d2);
+	} else {
+		f = freq;
+		ret1 = tda18271_lookup_map(fe, type, &f, &val1);
+		priv->map_entries[type] = 0;
+		f = freq;
+		ret2 = tda18271_lookup_map(fe, type, &f, &val2);
+		priv->map_entries[type] = entries;
+
+		if ((ret1 != ret2) || (val1 != val2))
+			mismatch(map_names[type], freq, ret1, val1, ret2, val2);
+	}
+}
+
+/* the rf_band and cid_target lookups only search; walk them here */
+static void check_rf_band(struct dvb_frontend *fe, u32 freq)
+{
+	struct tda18271_priv *priv = fe->tuner_priv;
+	struct tda18271_rf_tracking_filter_cal *map = priv->rf_cal_state;
+	u8 band1 = 0, band2 = 0;
+	int ret1, ret2;
+	int i = 0;
+
+	lookups++;
+	ret1 = tda18271_lookup_rf_band(fe, &freq, &band1);
+
+	while ((map[i].rfmax * 1000) < freq) {
+		if (map[i].rfmax == 0)
+			break;
+		i++;
+	}
+	if (map[i].rfmax == 0) {
+		ret2 = -EINVAL;
+	} else {
+		ret2 = i;
+		band2 = map[i].rfband;
+	}
+
+	if ((ret1 != ret2) || (band1 != band2))
+		mismatch("rf_band template", freq, ret1, band1, ret2, band2);
+}
+
+static void check_cid_target(struct dvb_frontend *fe, u32 freq)
+{
+	u8 target1 = 0;
+	u16 limit1 = 0;
+	int i = 0;
+
+	lookups++;
+	tda18271_lookup_cid_target(fe, &freq, &target1, &limit1);
+
+	while ((tda18271_cid_target[i].rfmax * 1000) < freq) {
+		if (tda18271_cid_target[i + 1].rfmax == 0)
+			break;
+		i++;
+	}
+
+	if ((target1 != tda18271_cid_target[i].target) ||
+	    (limit1 != tda18271_cid_target[i].limit))
+		mismatch("cid_target", freq, 0, (limit1 << 8) | target1, 0,
+			 (tda18271_cid_target[i].limit << 8) | tda18271_cid_target[i].target);
+}
+
+/* an unsorted map must be left to the walk, with a warning */
+static int check_count_map(void)
+{
+	struct tda18271_map sorted[] = {
+		{ .rfmax = 100, .val = 1 },
+		{ .rfmax = 200, .val = 2 },
+		{ .rfmax = 200, .val = 3 },
+		{ .rfmax =   0, .val = 0 },
+	};
+	struct tda18271_map unsorted[] = {
+		{ .rfmax = 100, .val = 1 },
+		{ .rfmax = 300, .val = 2 },
+		{ .rfmax = 200, .val = 3 },
+		{ .rfmax =   0, .val = 0 },
+	};
+	struct tda18271_map *missing = NULL;
+	struct tda18271_priv *priv = NULL;	/* for tda_warn() */
+	unsigned int count;
+	int failed = 0;
+
+	warnings = 0;
+	count = tda18271_count_map(sorted, rfmax, "sorted");
+	if ((count != 3) || warnings) {
+		printf("count_map: sorted map gave %u entries, %i warnings\n", count, warnings);
+		failed = 1;
+	}
+
+	warnings = 0;
+	count = tda18271_count_map(unsorted, rfmax, "unsorted");
+	if ((count != 0) || (warnings != 1)) {
+		printf("count_map: unsorted map gave %u entries, %i warnings\n", count, warnings);
+		failed = 1;
+	}
+
+	count = tda18271_count_map(missing, rfmax, "missing");
+	if (count != 0) {
+		printf("count_map: missing map gave %u entries\n", count);
+		failed = 1;
+	}
+
+	(void) priv;
+	if (!failed)
+		printf("count_map: ok\n");
+	return failed ? -1 : 0;
+}
+
+static void mismatch(const char *map_name, u32 freq, int ret1, int val1, int ret2, int val2)
+{
+	if (mismatches++ < MAX_REPORTED)
+		printf("%s at %u Hz: search %i/0x%x, walk %i/0x%x\n",
+		       map_name, freq, ret1, val1, ret2, val2);
+}
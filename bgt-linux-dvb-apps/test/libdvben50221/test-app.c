@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <ctype.h>
+#include <string.h>
 #include <unistd.h>
 #include <libdvben50221/en50221_session.h>
 #include <libdvben50221/en50221_app_utils.h>
@@ -37,12 +38,14 @@
 #include <libdvben50221/en50221_app_rm.h>
 #include <libdvben50221/en50221_app_smartcard.h>
 #include <libdvben50221/en50221_app_teletext.h>
+#include <libdvben50221/en50221_ca_list.h>
 #include <libdvbapi/dvbca.h>
 #include <pthread.h>
 #include <libdvbcfg/dvbcfg_zapchannel.h>
 #include <libdvbapi/dvbdemux.h>
 #include <libucsi/section.h>
 #include <libucsi/mpeg/section.h>
+#include <libucsi/mpeg/descriptor.h>
 
 #define DEFAULT_SLOT 0
 
@@ -114,6 +117,9 @@ int test_app_mmi_list_callback(void *arg, uint8_t slot_id, uint16_t session_numb
 
 struct section_ext *read_section_ext(char *buf, int buflen, int adapter, int demux, int pid, int table_id);
 
+int test_ca_list_send(void *arg, uint8_t *ca_pmt, uint32_t ca_pmt_length);
+int test_ca_list_selftest(void);
+
 
 
 
@@ -138,6 +144,9 @@ struct en50221_app_ai *ai_resource;
 struct en50221_app_ca *ca_resource;
 struct en50221_app_mmi *mmi_resource;
 
+// the set of services sent to the CAM
+struct en50221_ca_list *ca_list;
+
 // lookup table used in resource manager implementation
 struct resource {
     struct en50221_app_public_resource_id resid;
@@ -173,8 +182,12 @@ int main(int argc, char * argv[])
     pthread_t pmtthread;
     struct en50221_app_send_functions sendfuncs;
 
+    if ((argc == 2) && (!strcmp(argv[1], "-calist"))) {
+        exit(test_ca_list_selftest());
+    }
     if ((argc < 2) || (argc > 3)) {
         fprintf(stderr, "Syntax: test-app <adapterid> [<pmtpid>]\n");
+        fprintf(stderr, "        test-app -calist (check CA_PMT list management against a software CAM)\n");
         exit(1);
     }
     adapterid = atoi(argv[1]);
@@ -289,6 +302,7 @@ int main(int argc, char * argv[])
 
     // start another thread parsing PMT
     if (pmt_pid != -1) {
+        ca_list = en50221_ca_list_create(1, 1, CA_PMT_CMD_ID_OK_DESCRAMBLING, test_ca_list_send, NULL);
         pthread_create(&pmtthread, NULL, pmtthread_func, tl);
     }
 
@@ -521,6 +535,8 @@ int test_ca_info_callback(void *arg, uint8_t slot_id, uint16_t session_number, u
     }
 
     ca_connected = 1;
+    if (ca_list)
+        en50221_ca_list_connect(ca_list);
     return 0;
 }
 
@@ -757,8 +773,6 @@ void *stackthread_func(void* arg) {
 void *pmtthread_func(void* arg) {
     (void)arg;
     char buf[4096];
-    uint8_t capmt[4096];
-    int pmtversion = -1;
 
     while(!shutdown_pmtthread) {
 
@@ -778,32 +792,12 @@ void *pmtthread_func(void* arg) {
             fprintf(stderr, "Bad PMT received\n");
             exit(1);
         }
-        if (pmt->head.version_number == pmtversion) {
-            continue;
-        }
-
-        // translate it into a CA PMT
-        int listmgmt = CA_LIST_MANAGEMENT_ONLY;
-        if (pmtversion != -1) {
-            listmgmt = CA_LIST_MANAGEMENT_UPDATE;
-        }
-        int size;
-        if ((size = en50221_ca_format_pmt(pmt,
-                                         capmt,
-                                         sizeof(capmt),
-                                         listmgmt,
-                                         0,
-                                         CA_PMT_CMD_ID_OK_DESCRAMBLING)) < 0) {
-            fprintf(stderr, "Failed to format CA PMT object\n");
-            exit(1);
-        }
 
-        // set it
-        if (en50221_app_ca_pmt(ca_resource, ca_session_number, capmt, size)) {
+        // the CA list only sends it if the version changed
+        if (en50221_ca_list_set_pmt(ca_list, pmt) < 0) {
             fprintf(stderr, "Failed to send CA PMT object\n");
             exit(1);
         }
-        pmtversion = pmt->head.version_number;
     }
     shutdown_pmtthread = 0;
     return 0;
@@ -852,3 +846,291 @@ exit:
         close(demux_fd);
     return result;
 }
+
+int test_ca_list_send(void *arg, uint8_t *ca_pmt, uint32_t ca_pmt_length)
+{
+    (void)arg;
+
+    return en50221_app_ca_pmt(ca_resource, ca_session_number, ca_pmt, ca_pmt_length);
+}
+
+
+
+// software CAM: keeps the set of selected services the way a CAM would
+#define SOFTCAM_MAX_SERVICES 16
+
+struct softcam {
+    uint16_t selected[SOFTCAM_MAX_SERVICES];
+    int selected_count;
+    uint16_t pending[SOFTCAM_MAX_SERVICES];
+    int pending_count;
+    int in_list;
+    int connected;
+    int errors;
+    char log[512];
+};
+
+static void softcam_error(struct softcam *cam, const char *msg, uint16_t program_number)
+{
+    printf("  softcam: %s (program %04x)\n", msg, program_number);
+    cam->errors++;
+}
+
+static int softcam_find(uint16_t *set, int count, uint16_t program_number)
+{
+    int i;
+
+    for(i=0; i < count; i++) {
+        if (set[i] == program_number)
+            return i;
+    }
+    return -1;
+}
+
+static int softcam_ca_pmt(void *arg, uint8_t *ca_pmt, uint32_t ca_pmt_length)
+{
+    static const char *lm_names[] = { "MORE", "FIRST", "LAST", "ONLY", "ADD", "UPDATE" };
+    struct softcam *cam = arg;
+    uint8_t lm = ca_pmt[0];
+    uint16_t program_number = (ca_pmt[1] << 8) | ca_pmt[2];
+    uint32_t info_length = ((ca_pmt[4] & 0x0f) << 8) | ca_pmt[5];
+    uint32_t pos = 6;
+    int cmd_id = -1;
+    int i;
+
+    // every descriptor loop must carry the same ca_pmt_cmd_id
+    if (info_length)
+        cmd_id = ca_pmt[pos];
+    pos += info_length;
+    while((pos + 5) <= ca_pmt_length) {
+        info_length = ((ca_pmt[pos+3] & 0x0f) << 8) | ca_pmt[pos+4];
+        pos += 5;
+        if (info_length) {
+            if ((cmd_id != -1) && (ca_pmt[pos] != cmd_id))
+                softcam_error(cam, "mixed ca_pmt_cmd_ids", program_number);
+            cmd_id = ca_pmt[pos];
+        }
+        pos += info_length;
+    }
+    if (pos != ca_pmt_length)
+        softcam_error(cam, "bad ca_pmt length", program_number);
+    if (lm > CA_LIST_MANAGEMENT_UPDATE) {
+        softcam_error(cam, "bad ca_pmt_list_management", program_number);
+        return 0;
+    }
+
+    sprintf(cam->log + strlen(cam->log), "%s%s:%04x%s", cam->log[0] ? " " : "",
+            lm_names[lm], program_number, (cmd_id == CA_PMT_CMD_ID_NOT_SELECTED) ? "!" : "");
+
+    // a list in progress must be completed before anything else
+    if (cam->in_list && (lm != CA_LIST_MANAGEMENT_MORE) && (lm != CA_LIST_MANAGEMENT_LAST)) {
+        softcam_error(cam, "list interrupted", program_number);
+        cam->in_list = 0;
+    }
+
+    switch(lm) {
+    case CA_LIST_MANAGEMENT_ONLY:
+        cam->selected[0] = program_number;
+        cam->selected_count = 1;
+        break;
+
+    case CA_LIST_MANAGEMENT_FIRST:
+        cam->pending[0] = program_number;
+        cam->pending_count = 1;
+        cam->in_list = 1;
+        break;
+
+    case CA_LIST_MANAGEMENT_MORE:
+    case CA_LIST_MANAGEMENT_LAST:
+        if (!cam->in_list) {
+            softcam_error(cam, "MORE/LAST without FIRST", program_number);
+            break;
+        }
+        if (cam->pending_count < SOFTCAM_MAX_SERVICES)
+            cam->pending[cam->pending_count++] = program_number;
+        if (lm == CA_LIST_MANAGEMENT_LAST) {
+            memcpy(cam->selected, cam->pending, sizeof(cam->pending));
+            cam->selected_count = cam->pending_count;
+            cam->in_list = 0;
+        }
+        break;
+
+    case CA_LIST_MANAGEMENT_ADD:
+        if (softcam_find(cam->selected, cam->selected_count, program_number) != -1) {
+            softcam_error(cam, "ADD of a selected service", program_number);
+            break;
+        }
+        if (cam->selected_count < SOFTCAM_MAX_SERVICES)
+            cam->selected[cam->selected_count++] = program_number;
+        break;
+
+    case CA_LIST_MANAGEMENT_UPDATE:
+        if ((i = softcam_find(cam->selected, cam->selected_count, program_number)) == -1) {
+            softcam_error(cam, "UPDATE of an unknown service", program_number);
+            break;
+        }
+        if (cmd_id == CA_PMT_CMD_ID_NOT_SELECTED)
+            cam->selected[i] = cam->selected[--cam->selected_count];
+        break;
+    }
+    return 0;
+}
+
+// builds a PMT with a programme level and a stream level CA descriptor
+static struct mpeg_pmt_section *softcam_pmt(uint8_t *buf, uint16_t program_number, uint8_t version)
+{
+    uint16_t pid = 0x100 + ((program_number & 0xff) << 4);
+    int pos = 0;
+
+    buf[pos++] = stag_mpeg_program_map;
+    buf[pos++] = 0xb0;
+    buf[pos++] = 0;
+    buf[pos++] = program_number >> 8;
+    buf[pos++] = program_number;
+    buf[pos++] = 0xc1 | ((version & 0x1f) << 1);
+    buf[pos++] = 0;
+    buf[pos++] = 0;
+    buf[pos++] = 0xe0 | (pid >> 8);
+    buf[pos++] = pid;
+    buf[pos++] = 0xf0;
+    buf[pos++] = 6;
+    buf[pos++] = dtag_mpeg_ca;
+    buf[pos++] = 4;
+    buf[pos++] = 0x05;
+    buf[pos++] = 0x00;
+    buf[pos++] = 0xe0 | ((pid + 0xf) >> 8);
+    buf[pos++] = pid + 0xf;
+
+    // video, no descriptors
+    buf[pos++] = 0x02;
+    buf[pos++] = 0xe0 | ((pid + 1) >> 8);
+    buf[pos++] = pid + 1;
+    buf[pos++] = 0xf0;
+    buf[pos++] = 0;
+
+    // audio, with its own ECM stream
+    buf[pos++] = 0x04;
+    buf[pos++] = 0xe0 | ((pid + 2) >> 8);
+    buf[pos++] = pid + 2;
+    buf[pos++] = 0xf0;
+    buf[pos++] = 6;
+    buf[pos++] = dtag_mpeg_ca;
+    buf[pos++] = 4;
+    buf[pos++] = 0x05;
+    buf[pos++] = 0x00;
+    buf[pos++] = 0xe0 | ((pid + 0xe) >> 8);
+    buf[pos++] = pid + 0xe;
+
+    // CRC, not checked
+    memset(buf + pos, 0, 4);
+    pos += 4;
+    buf[2] = pos - 3;
+
+    struct section *section = section_codec(buf, pos);
+    if (section == NULL)
+        return NULL;
+    struct section_ext *section_ext = section_ext_decode(section, 0);
+    if (section_ext == NULL)
+        return NULL;
+    return mpeg_pmt_section_codec(section_ext);
+}
+
+static int softcam_check(struct softcam *cam, struct en50221_ca_list *list,
+                         const char *step, int result, int expected_result,
+                         const char *expected_log)
+{
+    int failed = 0;
+    int i;
+
+    if (result != expected_result) {
+        printf("  %s: returned %i, expected %i\n", step, result, expected_result);
+        failed = 1;
+    }
+    if (strcmp(cam->log, expected_log)) {
+        printf("  %s: CAM received \"%s\", expected \"%s\"\n", step, cam->log, expected_log);
+        failed = 1;
+    }
+    if (cam->connected && (!cam->in_list) && (cam->selected_count != en50221_ca_list_count(list))) {
+        printf("  %s: CAM has %i services, list has %i\n", step, cam->selected_count, en50221_ca_list_count(list));
+        failed = 1;
+    }
+    if (cam->errors)
+        failed = 1;
+
+    printf("%-40s %s [", step, failed ? "FAIL" : "ok");
+    for(i=0; i < cam->selected_count; i++)
+        printf("%s%04x", i ? " " : "", cam->selected[i]);
+    printf("]\n");
+
+    cam->log[0] = 0;
+    cam->errors = 0;
+    return failed;
+}
+
+int test_ca_list_selftest(void)
+{
+    struct softcam cam;
+    struct en50221_ca_list *list;
+    struct en50221_ca_list_stats stats;
+    uint8_t buf[1024];
+    int failed = 0;
+    int result;
+
+    memset(&cam, 0, sizeof(cam));
+    list = en50221_ca_list_create(3, 1, CA_PMT_CMD_ID_OK_DESCRAMBLING, softcam_ca_pmt, &cam);
+    if (list == NULL) {
+        fprintf(stderr, "Failed to create CA list\n");
+        return 1;
+    }
+
+    result = en50221_ca_list_set_pmt(list, softcam_pmt(buf, 0x101, 1));
+    failed |= softcam_check(&cam, list, "add 0101 before CAM connects", result, 0, "");
+    result = en50221_ca_list_set_pmt(list, softcam_pmt(buf, 0x102, 1));
+    failed |= softcam_check(&cam, list, "add 0102 before CAM connects", result, 0, "");
+    cam.connected = 1;
+    result = en50221_ca_list_connect(list);
+    failed |= softcam_check(&cam, list, "CAM connects", result, 2, "FIRST:0101 LAST:0102");
+    result = en50221_ca_list_set_pmt(list, softcam_pmt(buf, 0x101, 1));
+    failed |= softcam_check(&cam, list, "0101 PMT repeated", result, 0, "");
+    result = en50221_ca_list_set_pmt(list, softcam_pmt(buf, 0x103, 4));
+    failed |= softcam_check(&cam, list, "add 0103", result, 1, "ADD:0103");
+    result = en50221_ca_list_set_pmt(list, softcam_pmt(buf, 0x102, 2));
+    failed |= softcam_check(&cam, list, "0102 PMT version change", result, 1, "UPDATE:0102");
+    result = en50221_ca_list_remove(list, 0x101);
+    failed |= softcam_check(&cam, list, "remove 0101", result, 1, "UPDATE:0101!");
+    result = en50221_ca_list_remove(list, 0x101);
+    failed |= softcam_check(&cam, list, "remove 0101 again", result, -1, "");
+    result = en50221_ca_list_set_pmt(list, softcam_pmt(buf, 0x101, 1));
+    failed |= softcam_check(&cam, list, "re-add 0101 from the cache", result, 1, "ADD:0101");
+    en50221_ca_list_disconnect(list);
+    cam.connected = 0;
+    result = en50221_ca_list_set_pmt(list, softcam_pmt(buf, 0x103, 5));
+    failed |= softcam_check(&cam, list, "0103 PMT change while disconnected", result, 0, "");
+    cam.connected = 1;
+    result = en50221_ca_list_connect(list);
+    failed |= softcam_check(&cam, list, "CAM reconnects", result, 3, "FIRST:0101 MORE:0102 LAST:0103");
+    result = en50221_ca_list_set_pmt(list, softcam_pmt(buf, 0x104, 1));
+    failed |= softcam_check(&cam, list, "add 0104 with the list full", result, -1, "");
+    result = en50221_ca_list_remove(list, 0x101);
+    failed |= softcam_check(&cam, list, "remove 0101", result, 1, "UPDATE:0101!");
+    result = en50221_ca_list_remove(list, 0x102);
+    failed |= softcam_check(&cam, list, "remove 0102", result, 1, "UPDATE:0102!");
+    result = en50221_ca_list_remove(list, 0x103);
+    failed |= softcam_check(&cam, list, "remove 0103", result, 1, "UPDATE:0103!");
+    result = en50221_ca_list_set_pmt(list, softcam_pmt(buf, 0x104, 1));
+    failed |= softcam_check(&cam, list, "add 0104, evicting 0101", result, 1, "ONLY:0104");
+    result = en50221_ca_list_set_pmt(list, softcam_pmt(buf, 0x103, 5));
+    failed |= softcam_check(&cam, list, "re-add 0103 from the cache", result, 1, "ADD:0103");
+
+    // 0101 v1, 0102 v1, 0103 v4, 0102 v2, 0103 v5, 0104 v1
+    en50221_ca_list_get_stats(list, &stats);
+    printf("formatted %u, sent from cache %u, sent %u\n", stats.formatted, stats.reused, stats.sent);
+    if ((stats.formatted != 6) || (stats.sent != 14)) {
+        printf("FAIL: expected 6 formatted and 14 sent\n");
+        failed = 1;
+    }
+
+    en50221_ca_list_destroy(list);
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+    return failed;
+}
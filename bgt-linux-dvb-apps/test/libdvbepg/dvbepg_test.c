@@ -0,0 +1,495 @@
+/*
+ * EPG store test and benchmark.
+ *
+ * Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <libdvbepg/dvbepg_store.h>
+#include <libucsi/crc32.h>
+#include <libucsi/section.h>
+#include <libucsi/atsc/section.h>
+#include <libucsi/dvb/section.h>
+#include <libucsi/dvb/descriptor.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+/* the generated schedule: a week of half hour slots per service */
+#define GEN_SERVICES	300
+#define GEN_EVENTS	336
+#define GEN_SLOT	1800
+#define GEN_TITLES	200
+#define GEN_TEXTS	1000
+#define GEN_START	1160000000
+
+#define QUERIES		1000000
+
+static int fill(struct dvbepg_store *store);
+static int verify(struct dvbepg_store *store, const char *what);
+static int test_overlap(void);
+static int test_dvb_eit(void);
+static int test_atsc_eit(void);
+static void gen_key(int service, struct dvbepg_service_key *key);
+static const char *gen_title(int service, int event);
+static const char *gen_text(int service, int event);
+static double now(void);
+
+int main(int argc, char *argv[])
+{
+	struct dvbepg_store *store;
+	struct dvbepg_store *loaded;
+	struct dvbepg_store_stats stats;
+	struct dvbepg_service_key key;
+	struct dvbepg_event_info cur, next;
+	char filename[256];
+	int failed = 0;
+	int i;
+	double start, fill_time, save_time, load_time, query_time;
+
+	if (argc > 2) {
+		fprintf(stderr, "Syntax: dvbepg_test [<snapshot file>]\n");
+		exit(1);
+	}
+	if (argc == 2)
+		snprintf(filename, sizeof(filename), "%s", argv[1]);
+	else
+		snprintf(filename, sizeof(filename), "/tmp/dvbepg_test.%i", getpid());
+
+	failed |= test_overlap();
+	failed |= test_dvb_eit();
+	failed |= test_atsc_eit();
+
+	// build the store the way EIT decoding would
+	if ((store = dvbepg_store_create()) == NULL) {
+		fprintf(stderr, "Failed to create store\n");
+		exit(1);
+	}
+	start = now();
+	if (fill(store)) {
+		fprintf(stderr, "Failed to fill store\n");
+		exit(1);
+	}
+	fill_time = now() - start;
+	failed |= verify(store, "built");
+
+	// the carousel coming round again changes nothing
+	if (fill(store))
+		failed = 1;
+	dvbepg_store_get_stats(store, &stats);
+	if ((stats.added != GEN_SERVICES * GEN_EVENTS) ||
+	    (stats.unchanged != GEN_SERVICES * GEN_EVENTS) ||
+	    (stats.updated != 0) || (stats.overlapped != 0)) {
+		fprintf(stderr, "unexpected counters: %u added, %u unchanged, %u updated, %u overlapped\n",
+			stats.added, stats.unchanged, stats.updated, stats.overlapped);
+		failed = 1;
+	}
+
+	// now/next queries
+	start = now();
+	for (i = 0; i < QUERIES; i++) {
+		gen_key(i % GEN_SERVICES, &key);
+		dvbepg_store_now_next(store, &key,
+				      GEN_START + ((i * 7919L) % (GEN_EVENTS * GEN_SLOT)),
+				      &cur, &next);
+	}
+	query_time = now() - start;
+
+	// snapshot and restart
+	start = now();
+	if (dvbepg_store_save(store, filename)) {
+		fprintf(stderr, "Failed to save %s\n", filename);
+		exit(1);
+	}
+	save_time = now() - start;
+
+	start = now();
+	if ((loaded = dvbepg_store_load(filename)) == NULL) {
+		fprintf(stderr, "Failed to load %s\n", filename);
+		exit(1);
+	}
+	load_time = now() - start;
+	failed |= verify(loaded, "loaded");
+
+	// a loaded store takes changes, and saves over its own snapshot
+	if ((fill(loaded) != 0) || dvbepg_store_save(loaded, filename))
+		failed = 1;
+	gen_key(7, &key);
+	if (dvbepg_store_add_event(loaded, &key, 0x50, 1, 60000, GEN_START + 5 * GEN_SLOT,
+				   GEN_SLOT, "Changed", "") != 1)
+		failed = 1;
+	if (dvbepg_store_save(loaded, filename)) {
+		fprintf(stderr, "Failed to save %s again\n", filename);
+		failed = 1;
+	}
+	dvbepg_store_destroy(loaded);
+	if ((loaded = dvbepg_store_load(filename)) == NULL) {
+		fprintf(stderr, "Failed to load %s again\n", filename);
+		exit(1);
+	}
+	dvbepg_store_now_next(loaded, &key, GEN_START + 5 * GEN_SLOT, &cur, &next);
+	if ((cur.event_id != 60000) || strcmp(cur.title, "Changed") ||
+	    (next.event_id != 6) || strcmp(next.title, gen_title(7, 6))) {
+		fprintf(stderr, "changed event not found after reload\n");
+		failed = 1;
+	}
+	dvbepg_store_destroy(loaded);
+
+	// a damaged snapshot is refused
+	if (truncate(filename, 4096) || (dvbepg_store_load(filename) != NULL)) {
+		fprintf(stderr, "truncated snapshot was loaded\n");
+		failed = 1;
+	}
+	unlink(filename);
+
+	dvbepg_store_get_stats(store, &stats);
+	printf("%u services, %u events, %u bytes of strings\n",
+	       stats.services, stats.events, stats.string_bytes);
+	printf("build:   %.3f ms (%.0f events/sec)\n",
+	       fill_time * 1000, (GEN_SERVICES * GEN_EVENTS) / fill_time);
+	printf("now/next: %.0f queries/sec\n", QUERIES / query_time);
+	printf("save:    %.3f ms\n", save_time * 1000);
+	printf("load:    %.3f ms (%.0fx faster than building)\n",
+	       load_time * 1000, fill_time / load_time);
+
+	dvbepg_store_destroy(store);
+
+	if (failed) {
+		printf("FAILED\n");
+		exit(1);
+	}
+	printf("OK\n");
+	return 0;
+}
+
+static int fill(struct dvbepg_store *store)
+{
+	struct dvbepg_service_key key;
+	int service, event;
+
+	for (event = 0; event < GEN_EVENTS; event++) {
+		for (service = 0; service < GEN_SERVICES; service++) {
+			gen_key(service, &key);
+			if (dvbepg_store_add_event(store, &key, 0x50, 1, event,
+						   GEN_START + event * GEN_SLOT, GEN_SLOT,
+						   gen_title(service, event),
+						   gen_text(service, event)) < 0)
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int verify(struct dvbepg_store *store, const char *what)
+{
+	struct dvbepg_service_key key;
+	struct dvbepg_event_info cur, next;
+	struct dvbepg_event_info events[8];
+	int service, event, count;
+	int failed = 0;
+	time_t when;
+
+	if (dvbepg_store_service_count(store) != GEN_SERVICES) {
+		fprintf(stderr, "%s: %i services\n", what, dvbepg_store_service_count(store));
+		return 1;
+	}
+
+	for (service = 0; service < GEN_SERVICES; service++) {
+		gen_key(service, &key);
+
+		for (event = 0; event < GEN_EVENTS; event += 17) {
+			when = GEN_START + event * GEN_SLOT + (GEN_SLOT / 2);
+
+			if (dvbepg_store_now_next(store, &key, when, &cur, &next) ||
+			    (cur.event_id != event) ||
+			    (cur.start_time != GEN_START + event * GEN_SLOT) ||
+			    (cur.duration != GEN_SLOT) ||
+			    strcmp(cur.title, gen_title(service, event)) ||
+			    strcmp(cur.text, gen_text(service, event)) ||
+			    ((event + 1 < GEN_EVENTS) && (next.event_id != event + 1)) ||
+			    ((event + 1 == GEN_EVENTS) && (next.start_time != -1))) {
+				fprintf(stderr, "%s: service %i event %i: now/next mismatch\n",
+					what, service, event);
+				failed = 1;
+			}
+
+			// a range from the middle of one event to the start of the fourth
+			count = dvbepg_store_range(store, &key, when,
+						   GEN_START + (event + 3) * GEN_SLOT, events, 8);
+			if (((event + 3 <= GEN_EVENTS) && (count != 3)) ||
+			    (events[0].event_id != event)) {
+				fprintf(stderr, "%s: service %i event %i: range returned %i events\n",
+					what, service, event, count);
+				failed = 1;
+			}
+		}
+
+		// before the first and after the last event
+		dvbepg_store_now_next(store, &key, GEN_START - 1, &cur, &next);
+		if ((cur.start_time != -1) || (next.event_id != 0))
+			failed = 1;
+		dvbepg_store_now_next(store, &key, GEN_START + GEN_EVENTS * GEN_SLOT, &cur, &next);
+		if ((cur.start_time != -1) || (next.start_time != -1))
+			failed = 1;
+	}
+
+	key.original_network_id = 0xffff;
+	if (dvbepg_store_now_next(store, &key, GEN_START, &cur, &next) != -1)
+		failed = 1;
+
+	if (failed)
+		fprintf(stderr, "%s: verify failed\n", what);
+	return failed;
+}
+
+static int test_overlap(void)
+{
+	struct dvbepg_store *store;
+	struct dvbepg_store_stats stats;
+	struct dvbepg_service_key key = { 1, 2, 3 };
+	struct dvbepg_event_info events[8];
+	int failed = 0;
+	int i;
+
+	if ((store = dvbepg_store_create()) == NULL)
+		return 1;
+
+	for (i = 0; i < 6; i++)
+		dvbepg_store_add_event(store, &key, 0x50, 0, i, 1000 + i * 100, 100, "event", NULL);
+
+	// a rescheduled film replacing events 2-4
+	dvbepg_store_add_event(store, &key, 0x50, 1, 10, 1250, 200, "film", NULL);
+	// event 1 moving to where event 5 was
+	dvbepg_store_add_event(store, &key, 0x50, 1, 1, 1500, 100, "moved", NULL);
+
+	if ((dvbepg_store_range(store, &key, 0, 10000, events, 8) != 3) ||
+	    (events[0].event_id != 0) ||
+	    (events[1].event_id != 10) || strcmp(events[1].title, "film") ||
+	    (events[2].event_id != 1) || (events[2].start_time != 1500))
+		failed = 1;
+
+	dvbepg_store_get_stats(store, &stats);
+	if ((stats.added != 7) || (stats.updated != 1) || (stats.overlapped != 4))
+		failed = 1;
+
+	// the same event from the present/following table is not a change
+	if (dvbepg_store_add_event(store, &key, 0x4e, 3, 10, 1250, 200, "film", NULL) != 0)
+		failed = 1;
+
+	dvbepg_store_destroy(store);
+	if (failed)
+		fprintf(stderr, "overlap test failed\n");
+	return failed;
+}
+
+static int test_dvb_eit(void)
+{
+	struct dvbepg_store *store;
+	struct dvbepg_service_key key = { 0x233a, 0x1004, 0x10bf };
+	struct dvbepg_event_info cur, next;
+	struct section *section;
+	struct section_ext *section_ext;
+	struct dvb_eit_section *eit;
+	uint8_t buf[256];
+	dvbdate_t date;
+	uint32_t crc;
+	int pos, dpos;
+	int failed = 0;
+
+	unixtime_to_dvbdate(GEN_START, date);
+
+	memset(buf, 0, sizeof(buf));
+	buf[0] = stag_dvb_event_information_schedule_actual;
+	buf[3] = key.service_id >> 8;
+	buf[4] = key.service_id & 0xff;
+	buf[5] = 0xc1 | (4 << 1);
+	buf[8] = key.transport_stream_id >> 8;
+	buf[9] = key.transport_stream_id & 0xff;
+	buf[10] = key.original_network_id >> 8;
+	buf[11] = key.original_network_id & 0xff;
+	buf[13] = stag_dvb_event_information_schedule_actual;
+	pos = 14;
+
+	// one event, with a short_event_descriptor
+	buf[pos++] = 0x12;
+	buf[pos++] = 0x34;
+	memcpy(buf + pos, date, 5);
+	pos += 5;
+	seconds_to_dvbduration(GEN_SLOT, buf + pos);
+	pos += 3;
+	dpos = pos;
+	pos += 2;
+	buf[pos++] = dtag_dvb_short_event;
+	buf[pos++] = 3 + 1 + 4 + 1 + 5;
+	memcpy(buf + pos, "eng", 3);
+	pos += 3;
+	buf[pos++] = 4;
+	memcpy(buf + pos, "News", 4);
+	pos += 4;
+	buf[pos++] = 5;
+	memcpy(buf + pos, "Today", 5);
+	pos += 5;
+	buf[dpos] = 0x80 | ((pos - dpos - 2) >> 8);
+	buf[dpos + 1] = (pos - dpos - 2) & 0xff;
+
+	buf[1] = 0xb0 | ((pos + 4 - 3) >> 8);
+	buf[2] = (pos + 4 - 3) & 0xff;
+	crc = crc32(CRC32_INIT, buf, pos);
+	buf[pos++] = crc >> 24;
+	buf[pos++] = crc >> 16;
+	buf[pos++] = crc >> 8;
+	buf[pos++] = crc;
+
+	if (((section = section_codec(buf, pos)) == NULL) ||
+	    ((section_ext = section_ext_decode(section, 1)) == NULL) ||
+	    ((eit = dvb_eit_section_codec(section_ext)) == NULL)) {
+		fprintf(stderr, "DVB EIT test section did not decode\n");
+		return 1;
+	}
+
+	if ((store = dvbepg_store_create()) == NULL)
+		return 1;
+	if (dvbepg_store_add_dvb_eit(store, eit) != 1)
+		failed = 1;
+	if (dvbepg_store_add_dvb_eit(store, eit) != 0)
+		failed = 1;
+
+	dvbepg_store_now_next(store, &key, dvbdate_to_unixtime(date) + 60, &cur, &next);
+	if ((cur.event_id != 0x1234) || (cur.duration != GEN_SLOT) ||
+	    strcmp(cur.title, "News") || strcmp(cur.text, "Today") ||
+	    (next.start_time != -1))
+		failed = 1;
+
+	dvbepg_store_destroy(store);
+	if (failed)
+		fprintf(stderr, "DVB EIT test failed\n");
+	return failed;
+}
+
+static int test_atsc_eit(void)
+{
+	struct dvbepg_store *store;
+	struct dvbepg_service_key key = { 0, 0x0801, 0x0003 };
+	struct dvbepg_event_info cur, next;
+	struct section *section;
+	struct section_ext *section_ext;
+	struct atsc_section_psip *psip;
+	struct atsc_eit_section *eit;
+	uint8_t buf[256];
+	atsctime_t start = unixtime_to_atsctime(GEN_START);
+	uint32_t crc;
+	int pos, tpos;
+	int failed = 0;
+
+	memset(buf, 0, sizeof(buf));
+	buf[0] = stag_atsc_event_information;
+	buf[3] = key.service_id >> 8;
+	buf[4] = key.service_id & 0xff;
+	buf[5] = 0xc1 | (2 << 1);
+	buf[9] = 1;
+	pos = 10;
+
+	// one event, with a one string, one segment title
+	buf[pos++] = 0xc0 | 0x05;
+	buf[pos++] = 0x67;
+	buf[pos++] = start >> 24;
+	buf[pos++] = start >> 16;
+	buf[pos++] = start >> 8;
+	buf[pos++] = start;
+	buf[pos++] = 0xc0 | (GEN_SLOT >> 16);
+	buf[pos++] = (GEN_SLOT >> 8) & 0xff;
+	buf[pos++] = GEN_SLOT & 0xff;
+	tpos = pos++;
+	buf[pos++] = 1;
+	memcpy(buf + pos, "eng", 3);
+	pos += 3;
+	buf[pos++] = 1;
+	buf[pos++] = 0;
+	buf[pos++] = 0;
+	buf[pos++] = 7;
+	memcpy(buf + pos, "Weather", 7);
+	pos += 7;
+	buf[tpos] = pos - tpos - 1;
+	buf[pos++] = 0xf0;
+	buf[pos++] = 0;
+
+	buf[1] = 0xb0 | ((pos + 4 - 3) >> 8);
+	buf[2] = (pos + 4 - 3) & 0xff;
+	crc = crc32(CRC32_INIT, buf, pos);
+	buf[pos++] = crc >> 24;
+	buf[pos++] = crc >> 16;
+	buf[pos++] = crc >> 8;
+	buf[pos++] = crc;
+
+	if (((section = section_codec(buf, pos)) == NULL) ||
+	    ((section_ext = section_ext_decode(section, 1)) == NULL) ||
+	    ((psip = atsc_section_psip_decode(section_ext)) == NULL) ||
+	    ((eit = atsc_eit_section_codec(psip)) == NULL)) {
+		fprintf(stderr, "ATSC EIT test section did not decode\n");
+		return 1;
+	}
+
+	if ((store = dvbepg_store_create()) == NULL)
+		return 1;
+	if (dvbepg_store_add_atsc_eit(store, key.transport_stream_id, eit) != 1)
+		failed = 1;
+
+	dvbepg_store_now_next(store, &key, GEN_START, &cur, &next);
+	if ((cur.event_id != 0x0567) || (cur.duration != GEN_SLOT) ||
+	    strcmp(cur.title, "Weather") || strcmp(cur.text, ""))
+		failed = 1;
+
+	dvbepg_store_destroy(store);
+	if (failed)
+		fprintf(stderr, "ATSC EIT test failed\n");
+	return failed;
+}
+
+static void gen_key(int service, struct dvbepg_service_key *key)
+{
+	key->original_network_id = 0x2000 + (service % 3);
+	key->transport_stream_id = 0x1000 + (service / 10);
+	key->service_id = 0x100 + service;
+}
+
+static const char *gen_title(int service, int event)
+{
+	static char title[64];
+
+	// the same programmes are on many services
+	sprintf(title, "Programme %i", ((service * 7) + event) % GEN_TITLES);
+	return title;
+}
+
+static const char *gen_text(int service, int event)
+{
+	static char text[128];
+
+	sprintf(text, "Episode %i of a series with a fairly long description, as most have",
+		((service * 13) + event) % GEN_TEXTS);
+	return text;
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
@@ -24,16 +24,19 @@
 #include <string.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <zlib.h>
 
 #include <libesg/bootstrap/access_descriptor.h>
 #include <libesg/encapsulation/container.h>
 #include <libesg/encapsulation/fragment_management_information.h>
 #include <libesg/encapsulation/data_repository.h>
 #include <libesg/encapsulation/string_repository.h>
+#include <libesg/encapsulation/fragment_store.h>
 #include <libesg/representation/encapsulated_textual_esg_xml_fragment.h>
 #include <libesg/representation/init_message.h>
 #include <libesg/representation/textual_decoder_init.h>
 #include <libesg/representation/bim_decoder_init.h>
+#include <libesg/representation/gzip_decoder.h>
 #include <libesg/transport/session_partition_declaration.h>
 
 #define MAX_FILENAME 256
@@ -42,6 +45,7 @@ void usage(void) {
   static const char *_usage =
     "Usage: testesg [-a <ESGAccessDescriptor>]\n"
     "               [-c <ESGContainer with Textual ESG XML Fragment>]\n"
+    "               [-s (self test of the fragment store)]\n"
     "               [-X XXXX]\n";
 
   fprintf(stderr, "%s", _usage);
@@ -74,6 +78,254 @@ void read_from_file(const char *filename, char **buffer, int *size) {
 	return;
 }
 
+struct selftest_fragment {
+	uint32_t id;
+	uint8_t version;
+	const char *xml;
+};
+
+static int selftest_errors = 0;
+
+#define selftest_check(cond) \
+	do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			selftest_errors++; \
+		} \
+	} while (0)
+
+static uint32_t selftest_vluimsbf8(uint8_t *buffer, uint32_t value) {
+	uint32_t pos = 0;
+	int shift;
+
+	for (shift = 28; shift > 0; shift -= 7) {
+		if ((value >> shift) || pos) {
+			buffer[pos++] = 0x80 | ((value >> shift) & 0x7F);
+		}
+	}
+	buffer[pos++] = value & 0x7F;
+
+	return pos;
+}
+
+static uint32_t selftest_gzip(const char *xml, uint8_t *buffer, uint32_t size) {
+	z_stream stream;
+	uint32_t length;
+
+	memset(&stream, 0, sizeof(z_stream));
+	if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return 0;
+	}
+	stream.next_in = (uint8_t *) xml;
+	stream.avail_in = strlen(xml);
+	stream.next_out = buffer;
+	stream.avail_out = size;
+	if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+		deflateEnd(&stream);
+		return 0;
+	}
+	length = size - stream.avail_out;
+	deflateEnd(&stream);
+
+	return length;
+}
+
+static void selftest_structure(uint8_t *header, uint8_t type, uint32_t ptr, uint32_t length) {
+	header[0] = type;
+	header[1] = 0x00;
+	header[2] = ptr >> 16;
+	header[3] = ptr >> 8;
+	header[4] = ptr;
+	header[5] = length >> 16;
+	header[6] = length >> 8;
+	header[7] = length;
+}
+
+/*
+ * Build a container holding an init message, the fragment management
+ * information and the data repository of the given fragments.
+ */
+static uint32_t selftest_container(uint8_t *buffer, uint8_t encoding_version,
+				   struct selftest_fragment *fragments, int count) {
+	uint8_t data[8192];
+	uint8_t encoded[4096];
+	uint32_t data_length = 0;
+	uint32_t encoded_length;
+	uint32_t pos;
+	uint32_t fmi_length = 2 + (8 * count);
+	int i;
+
+	buffer[0] = 3;
+	pos = 1 + (3 * 8);
+
+	// Init message : textual, empty decoder init
+	selftest_structure(buffer + 1, 0xE2, pos, 8);
+	buffer[pos++] = encoding_version;
+	buffer[pos++] = 0x00;
+	buffer[pos++] = 4;
+	buffer[pos++] = 0x00;
+	buffer[pos++] = 0x01;
+	buffer[pos++] = 0x02;
+	buffer[pos++] = 0x00;
+	buffer[pos++] = 0x00;
+
+	// Fragment management information
+	selftest_structure(buffer + 9, 0x01, pos, fmi_length);
+	buffer[pos++] = 0x00;
+	buffer[pos++] = 0x21;
+	for (i = 0; i < count; i++) {
+		buffer[pos++] = 0x00;
+		buffer[pos++] = data_length >> 16;
+		buffer[pos++] = data_length >> 8;
+		buffer[pos++] = data_length;
+		buffer[pos++] = fragments[i].version;
+		buffer[pos++] = fragments[i].id >> 16;
+		buffer[pos++] = fragments[i].id >> 8;
+		buffer[pos++] = fragments[i].id;
+
+		if (encoding_version == 0xF2) {
+			encoded_length = selftest_gzip(fragments[i].xml, encoded, sizeof(encoded));
+		} else {
+			encoded_length = strlen(fragments[i].xml);
+			memcpy(encoded, fragments[i].xml, encoded_length);
+		}
+		data[data_length++] = 0x00;
+		data[data_length++] = 0x01;
+		data_length += selftest_vluimsbf8(data + data_length, encoded_length);
+		memcpy(data + data_length, encoded, encoded_length);
+		data_length += encoded_length;
+	}
+
+	// Data repository
+	selftest_structure(buffer + 17, 0xE0, pos, data_length);
+	memcpy(buffer + pos, data, data_length);
+	pos += data_length;
+
+	return pos;
+}
+
+static void selftest_update(struct esg_fragment_store *store, uint8_t container_id, uint8_t *buffer, uint32_t size,
+			    int referenced, struct esg_fragment_store_stats *stats, int *changed) {
+	struct esg_container *container;
+
+	if (referenced) {
+		container = esg_container_decode_ref(buffer, size);
+	} else {
+		container = esg_container_decode(buffer, size);
+	}
+	selftest_check(container != NULL);
+	if (container == NULL) {
+		memset(stats, 0, sizeof(struct esg_fragment_store_stats));
+		*changed = -1;
+		return;
+	}
+
+	*changed = esg_fragment_store_update(store, container_id, container, stats);
+	esg_container_free(container);
+
+	fprintf(stdout, "container %d: changed %d added %d updated %d unchanged %d removed %d failed %d\n",
+		container_id, *changed, stats->added, stats->updated, stats->unchanged, stats->removed, stats->failed);
+}
+
+static int selftest_collect(void *arg, uint8_t *data, uint32_t size) {
+	char *string = (char *) arg;
+
+	strncat(string, (char *) data, size);
+
+	return 0;
+}
+
+static int selftest(void) {
+	struct selftest_fragment first[] = {
+		{ 1, 1, "<Service>first</Service>" },
+		{ 2, 1, "<Schedule>first</Schedule>" },
+		{ 3, 1, "<Content>first</Content>" },
+	};
+	struct selftest_fragment second[] = {
+		{ 1, 1, "<Service>first</Service>" },
+		{ 2, 2, "<Schedule>second</Schedule>" },
+		{ 4, 1, "<Content>second</Content>" },
+	};
+	struct selftest_fragment other[] = {
+		{ 5, 1, "<Acquisition>other</Acquisition>" },
+	};
+	const char *xml = "<ESGMain><Service>streamed</Service><Service>streamed</Service></ESGMain>";
+	uint8_t buffer[16384];
+	uint8_t encoded[4096];
+	char string[4096];
+	uint32_t size;
+	uint32_t encoded_length;
+	uint32_t pos;
+	int changed;
+	int result;
+	struct esg_fragment_store *store;
+	struct esg_fragment_store_stats stats;
+	struct esg_fragment *fragment;
+	struct esg_gzip_decoder *decoder;
+
+	store = esg_fragment_store_create();
+	selftest_check(store != NULL);
+	if (store == NULL) {
+		return 1;
+	}
+
+	// New container : everything is added
+	size = selftest_container(buffer, 0xF2, first, 3);
+	selftest_update(store, 1, buffer, size, 0, &stats, &changed);
+	selftest_check((changed == 3) && (stats.added == 3) && (store->num_fragments == 3));
+	fragment = esg_fragment_store_find(store, 2);
+	selftest_check((fragment != NULL) && (strcmp((char *) fragment->data, first[1].xml) == 0));
+
+	// Same container from the carousel : nothing is decoded
+	selftest_update(store, 1, buffer, size, 1, &stats, &changed);
+	selftest_check((changed == 0) && (stats.unchanged == 3));
+
+	// One new version, one new fragment, one gone
+	size = selftest_container(buffer, 0xF2, second, 3);
+	selftest_update(store, 1, buffer, size, 1, &stats, &changed);
+	selftest_check((changed == 3) && (stats.unchanged == 1) && (stats.updated == 1) &&
+		       (stats.added == 1) && (stats.removed == 1) && (store->num_fragments == 3));
+	fragment = esg_fragment_store_find(store, 2);
+	selftest_check((fragment != NULL) && (fragment->version == 2) && (strcmp((char *) fragment->data, second[1].xml) == 0));
+	selftest_check(esg_fragment_store_find(store, 3) == NULL);
+
+	// Another container, plain textual, leaves the first one alone
+	size = selftest_container(buffer, 0xF3, other, 1);
+	selftest_update(store, 2, buffer, size, 1, &stats, &changed);
+	selftest_check((changed == 1) && (stats.added == 1) && (stats.removed == 0) && (store->num_fragments == 4));
+	fragment = esg_fragment_store_find(store, 5);
+	selftest_check((fragment != NULL) && (fragment->length == strlen(other[0].xml)) &&
+		       (strcmp((char *) fragment->data, other[0].xml) == 0));
+
+	esg_fragment_store_free(store);
+
+	// Streaming : a GZIP member fed one byte at a time
+	decoder = esg_gzip_decoder_create();
+	selftest_check(decoder != NULL);
+	if (decoder == NULL) {
+		return 1;
+	}
+	encoded_length = selftest_gzip(xml, encoded, sizeof(encoded));
+	string[0] = 0;
+	result = 0;
+	for (pos = 0; (pos < encoded_length) && (result == 0); pos++) {
+		result = esg_gzip_decoder_decode(decoder, encoded + pos, 1, selftest_collect, string);
+	}
+	selftest_check((result == 1) && (pos == encoded_length) && (strcmp(string, xml) == 0));
+
+	// Truncated member
+	esg_gzip_decoder_reset(decoder);
+	string[0] = 0;
+	result = esg_gzip_decoder_decode(decoder, encoded, encoded_length - 4, selftest_collect, string);
+	selftest_check(result == 0);
+
+	esg_gzip_decoder_free(decoder);
+
+	fprintf(stdout, "self test %s\n", selftest_errors ? "FAILED" : "passed");
+
+	return selftest_errors ? 1 : 0;
+}
+
 int main(int argc, char *argv[]) {
 	char access_descriptor_filename[MAX_FILENAME] = "";
 	char container_filename[MAX_FILENAME] = "";
@@ -82,7 +334,7 @@ int main(int argc, char *argv[]) {
 	int size;
 
 	// Read command line options
-	while ((c = getopt(argc, argv, "a:c:")) != -1) {
+	while ((c = getopt(argc, argv, "a:c:s")) != -1) {
 		switch (c) {
 			case 'a':
 				strncpy(access_descriptor_filename, optarg, MAX_FILENAME);
@@ -90,6 +342,8 @@ int main(int argc, char *argv[]) {
 			case 'c':
 				strncpy(container_filename, optarg, MAX_FILENAME);
 				break;
+			case 's':
+				return selftest();
 			default:
 				usage();
 		}
@@ -488,7 +742,7 @@ int main(int argc, char *argv[]) {
 				switch (entry->fragment_reference->fragment_type) {
 					case 0x00: {
 						if (data_repository) {
-							struct esg_encapsulated_textual_esg_xml_fragment *esg_xml_fragment = esg_encapsulated_textual_esg_xml_fragment_decode(data_repository->data + entry->fragment_reference->data_repository_offset, data_repository->length);
+							struct esg_encapsulated_textual_esg_xml_fragment *esg_xml_fragment = esg_encapsulated_textual_esg_xml_fragment_decode(data_repository->data + entry->fragment_reference->data_repository_offset, data_repository->length - entry->fragment_reference->data_repository_offset);
 
 							fprintf(stdout, "ESG_XML_fragment_type %d\n", esg_xml_fragment->esg_xml_fragment_type);
 							fprintf(stdout, "data_length %d\n", esg_xml_fragment->data_length);
@@ -0,0 +1,413 @@
+/*
+ * PES assembler benchmark.
+ *
+ * Copyright (C) 2005 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <libucsi/transport_packet.h>
+#include <libucsi/pes_assembler.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define DEFAULT_ITERATIONS 20
+#define FEED_BYTES (TRANSPORT_PACKET_LENGTH * 348)
+
+/* the generated capture */
+#define GEN_FRAMES		500
+#define GEN_VIDEO_PID		0x100
+#define GEN_AUDIO_PID		0x101
+#define GEN_SUBTITLE_PID	0x102
+#define GEN_VIDEO_BYTES		24000
+#define GEN_AUDIO_BYTES		1500
+#define GEN_SUBTITLE_BYTES	100
+#define GEN_LOST_FRAME		100	/* a video packet goes missing */
+#define GEN_DUPLICATE_FRAME	200	/* an audio packet is sent twice */
+
+struct capture {
+	uint8_t *buf;
+	int len;
+	int pids[TRANSPORT_MAX_PIDS];
+	int pid_count;
+};
+
+struct counts {
+	long pes[TRANSPORT_MAX_PIDS];
+	long payload_bytes;
+	long discontinuities;
+	long errors;
+	int verify;
+};
+
+static int generate(struct capture *capture);
+static int read_capture(char *filename, struct capture *capture);
+static void find_pes_pids(struct capture *capture);
+static void run(struct capture *capture, struct counts *counts,
+		struct pes_assembler_stats *stats);
+static void pes_callback(void *arg, struct pes_packet *pes);
+static double now(void);
+
+int main(int argc, char *argv[])
+{
+	struct capture capture;
+	struct counts counts;
+	struct pes_assembler_stats stats;
+	int iterations = DEFAULT_ITERATIONS;
+	int generated = 0;
+	int failed = 0;
+	int i;
+	long pes_packets = 0;
+	double start, elapsed;
+
+	if (argc > 3) {
+		fprintf(stderr, "Syntax: testpes [<ts filename> [<iterations>]]\n");
+		exit(1);
+	}
+	if (argc == 3)
+		iterations = atoi(argv[2]);
+
+	memset(&capture, 0, sizeof(capture));
+	if (argc == 1) {
+		if (generate(&capture) < 0) {
+			fprintf(stderr, "Failed to generate a capture\n");
+			exit(1);
+		}
+		generated = 1;
+	} else {
+		if (read_capture(argv[1], &capture) < 0)
+			exit(1);
+		find_pes_pids(&capture);
+	}
+	if (capture.pid_count == 0) {
+		fprintf(stderr, "No PES PIDs found\n");
+		exit(1);
+	}
+
+	// one checked pass
+	memset(&counts, 0, sizeof(counts));
+	counts.verify = generated;
+	run(&capture, &counts, &stats);
+
+	printf("%i bytes, %i PES PIDs\n", capture.len, capture.pid_count);
+	for(i=0; i < capture.pid_count; i++) {
+		printf("  pid 0x%04x: %li PES packets\n", capture.pids[i], counts.pes[capture.pids[i]]);
+		pes_packets += counts.pes[capture.pids[i]];
+	}
+	printf("%llu TS packets, %llu PES packets (%llu without copying), %llu bytes copied for %li payload bytes\n",
+	       (unsigned long long) stats.packets, (unsigned long long) stats.pes_packets,
+	       (unsigned long long) stats.zero_copy, (unsigned long long) stats.bytes_copied,
+	       counts.payload_bytes);
+	printf("errors: %llu sync, %llu transport, %llu continuity, %llu scrambled, %llu bad header, %llu overflow\n",
+	       (unsigned long long) stats.sync_errors, (unsigned long long) stats.transport_errors,
+	       (unsigned long long) stats.continuity_errors, (unsigned long long) stats.scrambled,
+	       (unsigned long long) stats.bad_headers, (unsigned long long) stats.overflows);
+
+	if (generated) {
+		// one video PES packet is lost, the duplicate is dropped
+		if ((counts.pes[GEN_VIDEO_PID] != GEN_FRAMES - 1) ||
+		    (counts.pes[GEN_AUDIO_PID] != GEN_FRAMES) ||
+		    (counts.pes[GEN_SUBTITLE_PID] != GEN_FRAMES) ||
+		    (stats.continuity_errors != 1) ||
+		    (stats.zero_copy != GEN_FRAMES) ||
+		    (counts.discontinuities != 1) ||
+		    counts.errors) {
+			printf("FAILED: %li content errors, %li discontinuities\n",
+			       counts.errors, counts.discontinuities);
+			failed = 1;
+		} else {
+			printf("generated capture reassembled correctly\n");
+		}
+	}
+
+	counts.verify = 0;
+	start = now();
+	for(i=0; i < iterations; i++)
+		run(&capture, &counts, &stats);
+	elapsed = now() - start;
+
+	printf("pes_assembler: %.1f MB/s, %.0f TS packets/sec, %.0f PES packets/sec\n",
+	       ((double) capture.len * iterations) / elapsed / (1024 * 1024),
+	       ((double) (capture.len / TRANSPORT_PACKET_LENGTH) * iterations) / elapsed,
+	       ((double) pes_packets * iterations) / elapsed);
+
+	free(capture.buf);
+	return failed;
+}
+
+static void run(struct capture *capture, struct counts *counts,
+		struct pes_assembler_stats *stats)
+{
+	struct pes_assembler *pa;
+	int pos = 0;
+	int len;
+	int i;
+
+	if ((pa = pes_assembler_create(PES_DEFAULT_MAX_PACKET_BYTES, pes_callback, counts)) == NULL) {
+		fprintf(stderr, "Failed to create PES assembler\n");
+		exit(1);
+	}
+	for(i=0; i < capture->pid_count; i++)
+		pes_assembler_add_pid(pa, capture->pids[i]);
+
+	// feed it as a DVR device read would
+	while(pos < capture->len) {
+		len = capture->len - pos;
+		if (len > FEED_BYTES)
+			len = FEED_BYTES;
+		len = pes_assembler_feed(pa, capture->buf + pos, len);
+		if (len == 0)
+			break;
+		pos += len;
+	}
+	pes_assembler_flush(pa);
+
+	pes_assembler_get_stats(pa, stats);
+	pes_assembler_destroy(pa);
+}
+
+static void pes_callback(void *arg, struct pes_packet *pes)
+{
+	struct counts *counts = (struct counts *) arg;
+	uint32_t expected = 0;
+	uint32_t i;
+
+	counts->pes[pes->pid]++;
+	counts->payload_bytes += pes->payload_length;
+	if (pes->flags & pes_packet_flag_discontinuity)
+		counts->discontinuities++;
+
+	if (!counts->verify)
+		return;
+
+	switch(pes->pid) {
+	case GEN_VIDEO_PID:
+		expected = GEN_VIDEO_BYTES;
+		if ((pes->stream_id != 0xe0) ||
+		    !(pes->flags & pes_packet_flag_dts) || (pes->dts != pes->pts - 3600))
+			counts->errors++;
+		break;
+	case GEN_AUDIO_PID:
+		expected = GEN_AUDIO_BYTES;
+		if ((pes->stream_id != 0xc0) || (pes->flags & pes_packet_flag_dts))
+			counts->errors++;
+		break;
+	case GEN_SUBTITLE_PID:
+		expected = GEN_SUBTITLE_BYTES;
+		if ((pes->stream_id != 0xbd) || !(pes->flags & pes_packet_flag_zero_copy))
+			counts->errors++;
+		break;
+	}
+	if (!(pes->flags & pes_packet_flag_pts) || (pes->payload_length != expected)) {
+		counts->errors++;
+		return;
+	}
+	for(i=0; i < pes->payload_length; i++) {
+		if (pes->payload[i] != (uint8_t) (pes->pts + i)) {
+			counts->errors++;
+			return;
+		}
+	}
+}
+
+static void put_timestamp(uint8_t *buf, int marker, uint64_t ts)
+{
+	buf[0] = (marker << 4) | (((ts >> 30) & 0x07) << 1) | 1;
+	buf[1] = ts >> 22;
+	buf[2] = (((ts >> 15) & 0x7f) << 1) | 1;
+	buf[3] = ts >> 7;
+	buf[4] = ((ts & 0x7f) << 1) | 1;
+}
+
+/*
+ * Write a PES packet with the given payload size as TS packets. The last
+ * packet is padded with adaptation field stuffing.
+ */
+static int put_pes(uint8_t *out, int pid, uint8_t *cc, uint8_t stream_id,
+		   int bounded, uint64_t pts, uint64_t dts, int size,
+		   int lose_packet, int duplicate_packet)
+{
+	uint8_t pes[GEN_VIDEO_BYTES + 32];
+	uint8_t *pkt;
+	int header_len = dts ? 10 : 5;
+	int len = 0;
+	int pos = 0;
+	int out_len = 0;
+	int packet = 0;
+	int copy;
+	int i;
+
+	pes[len++] = 0x00;
+	pes[len++] = 0x00;
+	pes[len++] = 0x01;
+	pes[len++] = stream_id;
+	len += 2;
+	pes[len++] = 0x80;
+	pes[len++] = dts ? 0xc0 : 0x80;
+	pes[len++] = header_len;
+	put_timestamp(pes + len, dts ? 3 : 2, pts);
+	len += 5;
+	if (dts) {
+		put_timestamp(pes + len, 1, dts);
+		len += 5;
+	}
+	for(i=0; i < size; i++)
+		pes[len++] = (uint8_t) (pts + i);
+	if (bounded) {
+		pes[4] = (len - PES_PACKET_HEADER_SIZE) >> 8;
+		pes[5] = (len - PES_PACKET_HEADER_SIZE);
+	} else {
+		pes[4] = 0;
+		pes[5] = 0;
+	}
+
+	while(pos < len) {
+		pkt = out + out_len;
+		copy = len - pos;
+		pkt[0] = TRANSPORT_PACKET_SYNC;
+		pkt[1] = ((pos == 0) ? 0x40 : 0x00) | (pid >> 8);
+		pkt[2] = pid;
+		if (copy >= 184) {
+			copy = 184;
+			pkt[3] = 0x10 | *cc;
+			memcpy(pkt + 4, pes + pos, copy);
+		} else {
+			pkt[3] = 0x30 | *cc;
+			pkt[4] = 183 - copy;
+			if (pkt[4]) {
+				pkt[5] = 0x00;
+				memset(pkt + 6, 0xff, pkt[4] - 1);
+			}
+			memcpy(pkt + 5 + pkt[4], pes + pos, copy);
+		}
+		pos += copy;
+		*cc = (*cc + 1) & 0x0f;
+
+		if (packet == lose_packet) {
+			packet++;
+			continue;
+		}
+		out_len += TRANSPORT_PACKET_LENGTH;
+		if (packet == duplicate_packet) {
+			memcpy(out + out_len, pkt, TRANSPORT_PACKET_LENGTH);
+			out_len += TRANSPORT_PACKET_LENGTH;
+		}
+		packet++;
+	}
+
+	return out_len;
+}
+
+static int generate(struct capture *capture)
+{
+	uint8_t video_cc = 0, audio_cc = 0, subtitle_cc = 0;
+	uint64_t pts;
+	int frame;
+	int size;
+
+	size = GEN_FRAMES * (((GEN_VIDEO_BYTES + GEN_AUDIO_BYTES + GEN_SUBTITLE_BYTES) / 184) + 8) * TRANSPORT_PACKET_LENGTH;
+	if ((capture->buf = malloc(size)) == NULL)
+		return -1;
+
+	for(frame=0; frame < GEN_FRAMES; frame++) {
+		pts = 900000 + (frame * 3600);
+
+		capture->len += put_pes(capture->buf + capture->len, GEN_VIDEO_PID, &video_cc, 0xe0,
+					0, pts, pts - 3600, GEN_VIDEO_BYTES,
+					(frame == GEN_LOST_FRAME) ? 10 : -1, -1);
+		capture->len += put_pes(capture->buf + capture->len, GEN_AUDIO_PID, &audio_cc, 0xc0,
+					1, pts, 0, GEN_AUDIO_BYTES,
+					-1, (frame == GEN_DUPLICATE_FRAME) ? 3 : -1);
+		capture->len += put_pes(capture->buf + capture->len, GEN_SUBTITLE_PID, &subtitle_cc, 0xbd,
+					1, pts, 0, GEN_SUBTITLE_BYTES, -1, -1);
+	}
+
+	capture->pids[capture->pid_count++] = GEN_VIDEO_PID;
+	capture->pids[capture->pid_count++] = GEN_AUDIO_PID;
+	capture->pids[capture->pid_count++] = GEN_SUBTITLE_PID;
+	return 0;
+}
+
+static int read_capture(char *filename, struct capture *capture)
+{
+	struct stat st;
+	int fd;
+	int sz;
+
+	if ((fd = open(filename, O_RDONLY)) < 0) {
+		fprintf(stderr, "Unable to open file %s\n", filename);
+		return -1;
+	}
+	if (fstat(fd, &st) < 0) {
+		fprintf(stderr, "Unable to stat file %s\n", filename);
+		close(fd);
+		return -1;
+	}
+	if ((capture->buf = malloc(st.st_size)) == NULL) {
+		fprintf(stderr, "Failed to allocate %li bytes\n", (long) st.st_size);
+		close(fd);
+		return -1;
+	}
+
+	while((capture->len < st.st_size) &&
+	      ((sz = read(fd, capture->buf + capture->len, st.st_size - capture->len)) > 0))
+		capture->len += sz;
+
+	close(fd);
+	return 0;
+}
+
+/*
+ * Select the PIDs whose first payload_unit_start_indicator packet carries a
+ * PES start code.
+ */
+static void find_pes_pids(struct capture *capture)
+{
+	uint8_t seen[TRANSPORT_MAX_PIDS];
+	struct transport_packet *tspkt;
+	struct transport_values tsvals;
+	int pid;
+	int i;
+
+	memset(seen, 0, sizeof(seen));
+	for(i=0; (i + TRANSPORT_PACKET_LENGTH) <= capture->len; i+=TRANSPORT_PACKET_LENGTH) {
+		tspkt = transport_packet_init(capture->buf + i);
+		if (tspkt == NULL)
+			continue;
+		pid = transport_packet_pid(tspkt);
+		if (seen[pid] || (pid == TRANSPORT_NULL_PID) || !tspkt->payload_unit_start_indicator)
+			continue;
+		if (transport_packet_values_extract(tspkt, &tsvals, 0) < 0)
+			continue;
+		seen[pid] = 1;
+
+		if ((tsvals.payload_length >= 3) &&
+		    (tsvals.payload[0] == 0x00) && (tsvals.payload[1] == 0x00) && (tsvals.payload[2] == 0x01))
+			capture->pids[capture->pid_count++] = pid;
+	}
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
@@ -0,0 +1,690 @@
+/*
+ * Check the read-only (*_raw_*) section accessors against the codecs.
+ *
+ * Copyright (C) 2005 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <libucsi/section.h>
+#include <libucsi/crc32.h>
+#include <libucsi/mpeg/section.h>
+#include <libucsi/dvb/section.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SECTION 1024
+#define MAX_TRACE 512
+
+/* a section under construction */
+struct builder {
+	uint8_t buf[MAX_SECTION];
+	int len;
+};
+
+/* the fields read from a section, in the order they were read */
+struct trace {
+	uint32_t values[MAX_TRACE];
+	int count;
+};
+
+enum table {
+	TABLE_PAT,
+	TABLE_PMT,
+	TABLE_SDT,
+	TABLE_NIT,
+	TABLE_EIT,
+};
+
+static const char *table_names[] = { "PAT", "PMT", "SDT", "NIT", "EIT" };
+
+static int failures;
+
+static void put8(struct builder *b, int value);
+static void put16(struct builder *b, int value);
+static void put_descriptors(struct builder *b, int count, int seed);
+static int mark(struct builder *b);
+static void patch_length(struct builder *b, int at, int len_mask);
+static void begin_section(struct builder *b, int table_id, int table_id_ext,
+			  int version, int section_number, int last_section_number);
+static void end_section(struct builder *b);
+
+static void build_pat(struct builder *b, int programs);
+static void build_pmt(struct builder *b, int streams);
+static void build_sdt(struct builder *b, int services);
+static void build_nit(struct builder *b, int transports);
+static void build_eit(struct builder *b, int events);
+static void build(enum table table, struct builder *b, int count);
+
+static void trace_put(struct trace *t, uint32_t value);
+static int trace_raw(enum table table, const uint8_t *buf, int len, struct trace *t);
+static int trace_codec(enum table table, uint8_t *buf, int len, struct trace *t);
+
+static void check(enum table table, int count);
+static void check_corrupt(enum table table);
+static void check_useful(void);
+static void fail(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+int main(int argc, char *argv[])
+{
+	int table;
+	int count;
+
+	if (argc != 1) {
+		fprintf(stderr, "Syntax: %s\n", argv[0]);
+		exit(1);
+	}
+
+	for (table = TABLE_PAT; table <= TABLE_EIT; table++) {
+		for (count = 0; count <= 4; count++)
+			check(table, count);
+		check_corrupt(table);
+	}
+	check_useful();
+
+	if (failures) {
+		printf("%i checks FAILED\n", failures);
+		exit(1);
+	}
+	printf("all checks passed\n");
+	return 0;
+}
+
+static void fail(const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("FAILED: ");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+	failures++;
+}
+
+static void put8(struct builder *b, int value)
+{
+	b->buf[b->len++] = value;
+}
+
+static void put16(struct builder *b, int value)
+{
+	put8(b, value >> 8);
+	put8(b, value);
+}
+
+/* a 12 bit length field with its top reserved bits set, patched later */
+static int mark(struct builder *b)
+{
+	int at = b->len;
+
+	put16(b, 0xf000);
+	return at;
+}
+
+static void patch_length(struct builder *b, int at, int len_mask)
+{
+	int len = b->len - at - 2;
+
+	b->buf[at] = (b->buf[at] & ~(len_mask >> 8)) | ((len >> 8) & (len_mask >> 8));
+	b->buf[at + 1] = len & len_mask;
+}
+
+static void put_descriptors(struct builder *b, int count, int seed)
+{
+	int i;
+	int j;
+
+	for (i = 0; i < count; i++) {
+		int len = (seed + i) % 5;
+
+		put8(b, 0x80 + seed + i);
+		put8(b, len);
+		for (j = 0; j < len; j++)
+			put8(b, seed * 16 + j);
+	}
+}
+
+static void begin_section(struct builder *b, int table_id, int table_id_ext,
+			  int version, int section_number, int last_section_number)
+{
+	b->len = 0;
+	put8(b, table_id);
+	put16(b, 0xb000);	/* syntax_indicator, reserved, length */
+	put16(b, table_id_ext);
+	put8(b, 0xc0 | (version << 1) | 1);
+	put8(b, section_number);
+	put8(b, last_section_number);
+}
+
+static void end_section(struct builder *b)
+{
+	uint32_t crc;
+	int len = b->len + CRC_SIZE - 3;
+
+	b->buf[1] = (b->buf[1] & 0xf0) | ((len >> 8) & 0x0f);
+	b->buf[2] = len;
+
+	crc = crc32(CRC32_INIT, b->buf, b->len);
+	put8(b, crc >> 24);
+	put8(b, crc >> 16);
+	put8(b, crc >> 8);
+	put8(b, crc);
+}
+
+static void build_pat(struct builder *b, int programs)
+{
+	int i;
+
+	begin_section(b, stag_mpeg_program_association, 0x1234, 3, 0, 0);
+	for (i = 0; i < programs; i++) {
+		put16(b, i * 0x0101);
+		put16(b, 0xe000 | (0x0100 + i * 0x0777));
+	}
+	end_section(b);
+}
+
+static void build_pmt(struct builder *b, int streams)
+{
+	int i;
+	int at;
+
+	begin_section(b, stag_mpeg_program_map, 0x0101, 5, 0, 0);
+	put16(b, 0xe000 | 0x1ffe);
+	at = mark(b);
+	put_descriptors(b, streams, 1);
+	patch_length(b, at, 0x0fff);
+	for (i = 0; i < streams; i++) {
+		put8(b, 0x02 + i);
+		put16(b, 0xe000 | (0x1100 + i * 0x0123));
+		at = mark(b);
+		put_descriptors(b, i, 2 + i);
+		patch_length(b, at, 0x0fff);
+	}
+	end_section(b);
+}
+
+static void build_sdt(struct builder *b, int services)
+{
+	int i;
+	int at;
+
+	begin_section(b, stag_dvb_service_description_actual, 0x0440, 7, 0, 1);
+	put16(b, 0x233a);
+	put8(b, 0xff);
+	for (i = 0; i < services; i++) {
+		put16(b, 0x1000 + i);
+		put8(b, 0xfc | (i & 3));
+		at = b->len;
+		put16(b, ((i % 5) << 13) | ((i & 1) << 12));
+		put_descriptors(b, i + 1, 3 + i);
+		patch_length(b, at, 0x0fff);
+	}
+	end_section(b);
+}
+
+static void build_nit(struct builder *b, int transports)
+{
+	int i;
+	int at;
+	int loop;
+
+	begin_section(b, stag_dvb_network_information_actual, 0x3001, 9, 1, 1);
+	at = mark(b);
+	put_descriptors(b, transports % 3, 4);
+	patch_length(b, at, 0x0fff);
+	loop = mark(b);
+	for (i = 0; i < transports; i++) {
+		put16(b, 0x0400 + i);
+		put16(b, 0x233a);
+		at = mark(b);
+		put_descriptors(b, i, 5 + i);
+		patch_length(b, at, 0x0fff);
+	}
+	patch_length(b, loop, 0x0fff);
+	end_section(b);
+}
+
+static void build_eit(struct builder *b, int events)
+{
+	dvbdate_t start;
+	dvbduration_t duration;
+	int i;
+	int at;
+
+	begin_section(b, stag_dvb_event_information_schedule_actual, 0x1000, 11, 8, 16);
+	put16(b, 0x0440);
+	put16(b, 0x233a);
+	put8(b, 15);
+	put8(b, stag_dvb_event_information_schedule_actual + 1);
+	for (i = 0; i < events; i++) {
+		put16(b, 0x8000 + i);
+		unixtime_to_dvbdate(1160000000 + i * 5400, start);
+		memcpy(b->buf + b->len, start, sizeof(start));
+		b->len += sizeof(start);
+		seconds_to_dvbduration(1800 + i * 3661, duration);
+		memcpy(b->buf + b->len, duration, sizeof(duration));
+		b->len += sizeof(duration);
+		at = b->len;
+		put16(b, ((i % 5) << 13) | ((i & 1) << 12));
+		put_descriptors(b, i + 1, 6 + i);
+		patch_length(b, at, 0x0fff);
+	}
+	end_section(b);
+}
+
+static void build(enum table table, struct builder *b, int count)
+{
+	switch (table) {
+	case TABLE_PAT:
+		build_pat(b, count);
+		break;
+	case TABLE_PMT:
+		build_pmt(b, count);
+		break;
+	case TABLE_SDT:
+		build_sdt(b, count);
+		break;
+	case TABLE_NIT:
+		build_nit(b, count);
+		break;
+	case TABLE_EIT:
+		build_eit(b, count);
+		break;
+	}
+}
+
+static void trace_put(struct trace *t, uint32_t value)
+{
+	if (t->count < MAX_TRACE)
+		t->values[t->count] = value;
+	t->count++;
+}
+
+/* descriptors are traced by their tag, length and offset in the section */
+#define TRACE_DESCRIPTOR(t, buf, d) \
+	do { \
+		trace_put(t, (d)->tag); \
+		trace_put(t, (d)->len); \
+		trace_put(t, (const uint8_t *) (d) - (const uint8_t *) (buf)); \
+	} while (0)
+
+static int trace_raw(enum table table, const uint8_t *buf, int len, struct trace *t)
+{
+	const struct descriptor *d;
+	const uint8_t *pos;
+
+	t->count = 0;
+	if (section_ext_raw_verify(buf, len, 1))
+		return -1;
+
+	trace_put(t, section_raw_table_id(buf));
+	trace_put(t, section_raw_syntax_indicator(buf));
+	trace_put(t, section_raw_length(buf));
+	trace_put(t, section_ext_raw_length(buf));
+	trace_put(t, section_ext_raw_table_id_ext(buf));
+	trace_put(t, section_ext_raw_version_number(buf));
+	trace_put(t, section_ext_raw_current_next_indicator(buf));
+	trace_put(t, section_ext_raw_section_number(buf));
+	trace_put(t, section_ext_raw_last_section_number(buf));
+
+	switch (table) {
+	case TABLE_PAT:
+		if (mpeg_pat_section_raw_verify(buf))
+			return -1;
+		trace_put(t, mpeg_pat_section_raw_transport_stream_id(buf));
+		mpeg_pat_section_raw_programs_for_each(buf, pos) {
+			trace_put(t, mpeg_pat_program_raw_program_number(pos));
+			trace_put(t, mpeg_pat_program_raw_pid(pos));
+		}
+		break;
+
+	case TABLE_PMT:
+		if (mpeg_pmt_section_raw_verify(buf))
+			return -1;
+		trace_put(t, mpeg_pmt_section_raw_program_number(buf));
+		trace_put(t, mpeg_pmt_section_raw_pcr_pid(buf));
+		trace_put(t, mpeg_pmt_section_raw_program_info_length(buf));
+		mpeg_pmt_section_raw_descriptors_for_each(buf, d)
+			TRACE_DESCRIPTOR(t, buf, d);
+		mpeg_pmt_section_raw_streams_for_each(buf, pos) {
+			trace_put(t, mpeg_pmt_stream_raw_stream_type(pos));
+			trace_put(t, mpeg_pmt_stream_raw_pid(pos));
+			trace_put(t, mpeg_pmt_stream_raw_es_info_length(pos));
+			mpeg_pmt_stream_raw_descriptors_for_each(pos, d)
+				TRACE_DESCRIPTOR(t, buf, d);
+		}
+		break;
+
+	case TABLE_SDT:
+		if (dvb_sdt_section_raw_verify(buf))
+			return -1;
+		trace_put(t, dvb_sdt_section_raw_transport_stream_id(buf));
+		trace_put(t, dvb_sdt_section_raw_original_network_id(buf));
+		dvb_sdt_section_raw_services_for_each(buf, pos) {
+			trace_put(t, dvb_sdt_service_raw_service_id(pos));
+			trace_put(t, dvb_sdt_service_raw_eit_schedule_flag(pos));
+			trace_put(t, dvb_sdt_service_raw_eit_present_following_flag(pos));
+			trace_put(t, dvb_sdt_service_raw_running_status(pos));
+			trace_put(t, dvb_sdt_service_raw_free_ca_mode(pos));
+			trace_put(t, dvb_sdt_service_raw_descriptors_loop_length(pos));
+			dvb_sdt_service_raw_descriptors_for_each(pos, d)
+				TRACE_DESCRIPTOR(t, buf, d);
+		}
+		break;
+
+	case TABLE_NIT:
+		if (dvb_nit_section_raw_verify(buf))
+			return -1;
+		trace_put(t, dvb_nit_section_raw_network_id(buf));
+		trace_put(t, dvb_nit_section_raw_network_descriptors_length(buf));
+		dvb_nit_section_raw_descriptors_for_each(buf, d)
+			TRACE_DESCRIPTOR(t, buf, d);
+		dvb_nit_section_raw_transports_for_each(buf, pos) {
+			trace_put(t, dvb_nit_transport_raw_transport_stream_id(pos));
+			trace_put(t, dvb_nit_transport_raw_original_network_id(pos));
+			trace_put(t, dvb_nit_transport_raw_descriptors_length(pos));
+			dvb_nit_transport_raw_descriptors_for_each(pos, d)
+				TRACE_DESCRIPTOR(t, buf, d);
+		}
+		break;
+
+	case TABLE_EIT:
+		if (dvb_eit_section_raw_verify(buf))
+			return -1;
+		trace_put(t, dvb_eit_section_raw_service_id(buf));
+		trace_put(t, dvb_eit_section_raw_transport_stream_id(buf));
+		trace_put(t, dvb_eit_section_raw_original_network_id(buf));
+		trace_put(t, dvb_eit_section_raw_segment_last_section_number(buf));
+		trace_put(t, dvb_eit_section_raw_last_table_id(buf));
+		dvb_eit_section_raw_events_for_each(buf, pos) {
+			trace_put(t, dvb_eit_event_raw_event_id(pos));
+			trace_put(t, dvb_eit_event_raw_start_time(pos));
+			trace_put(t, dvb_eit_event_raw_duration(pos));
+			trace_put(t, dvb_eit_event_raw_running_status(pos));
+			trace_put(t, dvb_eit_event_raw_free_ca_mode(pos));
+			trace_put(t, dvb_eit_event_raw_descriptors_loop_length(pos));
+			dvb_eit_event_raw_descriptors_for_each(pos, d)
+				TRACE_DESCRIPTOR(t, buf, d);
+		}
+		break;
+	}
+
+	return 0;
+}
+
+static int trace_codec(enum table table, uint8_t *buf, int len, struct trace *t)
+{
+	struct section *section;
+	struct section_ext *ext;
+	struct descriptor *d;
+
+	t->count = 0;
+	if ((section = section_codec(buf, len)) == NULL)
+		return -1;
+	if ((ext = section_ext_decode(section, 1)) == NULL)
+		return -1;
+
+	trace_put(t, section->table_id);
+	trace_put(t, section->syntax_indicator);
+	trace_put(t, section_length(section));
+	trace_put(t, section_ext_length(ext));
+	trace_put(t, ext->table_id_ext);
+	trace_put(t, ext->version_number);
+	trace_put(t, ext->current_next_indicator);
+	trace_put(t, ext->section_number);
+	trace_put(t, ext->last_section_number);
+
+	switch (table) {
+	case TABLE_PAT:
+	{
+		struct mpeg_pat_section *pat;
+		struct mpeg_pat_program *program;
+
+		if ((pat = mpeg_pat_section_codec(ext)) == NULL)
+			return -1;
+		trace_put(t, mpeg_pat_section_transport_stream_id(pat));
+		mpeg_pat_section_programs_for_each(pat, program) {
+			trace_put(t, program->program_number);
+			trace_put(t, program->pid);
+		}
+		break;
+	}
+
+	case TABLE_PMT:
+	{
+		struct mpeg_pmt_section *pmt;
+		struct mpeg_pmt_stream *stream;
+
+		if ((pmt = mpeg_pmt_section_codec(ext)) == NULL)
+			return -1;
+		trace_put(t, mpeg_pmt_section_program_number(pmt));
+		trace_put(t, pmt->pcr_pid);
+		trace_put(t, pmt->program_info_length);
+		mpeg_pmt_section_descriptors_for_each(pmt, d)
+			TRACE_DESCRIPTOR(t, buf, d);
+		mpeg_pmt_section_streams_for_each(pmt, stream) {
+			trace_put(t, stream->stream_type);
+			trace_put(t, stream->pid);
+			trace_put(t, stream->es_info_length);
+			mpeg_pmt_stream_descriptors_for_each(stream, d)
+				TRACE_DESCRIPTOR(t, buf, d);
+		}
+		break;
+	}
+
+	case TABLE_SDT:
+	{
+		struct dvb_sdt_section *sdt;
+		struct dvb_sdt_service *service;
+
+		if ((sdt = dvb_sdt_section_codec(ext)) == NULL)
+			return -1;
+		trace_put(t, dvb_sdt_section_transport_stream_id(sdt));
+		trace_put(t, sdt->original_network_id);
+		dvb_sdt_section_services_for_each(sdt, service) {
+			trace_put(t, service->service_id);
+			trace_put(t, service->eit_schedule_flag);
+			trace_put(t, service->eit_present_following_flag);
+			trace_put(t, service->running_status);
+			trace_put(t, service->free_ca_mode);
+			trace_put(t, service->descriptors_loop_length);
+			dvb_sdt_service_descriptors_for_each(service, d)
+				TRACE_DESCRIPTOR(t, buf, d);
+		}
+		break;
+	}
+
+	case TABLE_NIT:
+	{
+		struct dvb_nit_section *nit;
+		struct dvb_nit_section_part2 *part2;
+		struct dvb_nit_transport *transport;
+
+		if ((nit = dvb_nit_section_codec(ext)) == NULL)
+			return -1;
+		trace_put(t, dvb_nit_section_network_id(nit));
+		trace_put(t, nit->network_descriptors_length);
+		dvb_nit_section_descriptors_for_each(nit, d)
+			TRACE_DESCRIPTOR(t, buf, d);
+		part2 = dvb_nit_section_part2(nit);
+		dvb_nit_section_transports_for_each(nit, part2, transport) {
+			trace_put(t, transport->transport_stream_id);
+			trace_put(t, transport->original_network_id);
+			trace_put(t, transport->transport_descriptors_length);
+			dvb_nit_transport_descriptors_for_each(transport, d)
+				TRACE_DESCRIPTOR(t, buf, d);
+		}
+		break;
+	}
+
+	case TABLE_EIT:
+	{
+		struct dvb_eit_section *eit;
+		struct dvb_eit_event *event;
+
+		if ((eit = dvb_eit_section_codec(ext)) == NULL)
+			return -1;
+		trace_put(t, dvb_eit_section_service_id(eit));
+		trace_put(t, eit->transport_stream_id);
+		trace_put(t, eit->original_network_id);
+		trace_put(t, eit->segment_last_section_number);
+		trace_put(t, eit->last_table_id);
+		dvb_eit_section_events_for_each(eit, event) {
+			trace_put(t, event->event_id);
+			trace_put(t, dvbdate_to_unixtime(event->start_time));
+			trace_put(t, dvbduration_to_seconds(event->duration));
+			trace_put(t, event->running_status);
+			trace_put(t, event->free_ca_mode);
+			trace_put(t, event->descriptors_loop_length);
+			dvb_eit_event_descriptors_for_each(event, d)
+				TRACE_DESCRIPTOR(t, buf, d);
+		}
+		break;
+	}
+	}
+
+	return 0;
+}
+
+static void check(enum table table, int count)
+{
+	struct builder b;
+	uint8_t pristine[MAX_SECTION];
+	struct trace raw;
+	struct trace codec;
+	int i;
+
+	build(table, &b, count);
+	memcpy(pristine, b.buf, b.len);
+
+	if (trace_raw(table, b.buf, b.len, &raw)) {
+		fail("%s/%i: raw path rejected a valid section", table_names[table], count);
+		return;
+	}
+	if (memcmp(pristine, b.buf, b.len)) {
+		fail("%s/%i: raw path modified the buffer", table_names[table], count);
+		return;
+	}
+	if (trace_codec(table, b.buf, b.len, &codec)) {
+		fail("%s/%i: codec rejected a valid section", table_names[table], count);
+		return;
+	}
+	if ((raw.count > MAX_TRACE) || (codec.count > MAX_TRACE)) {
+		fail("%s/%i: trace too long", table_names[table], count);
+		return;
+	}
+
+	if (raw.count != codec.count) {
+		fail("%s/%i: raw path read %i fields, codec %i",
+		     table_names[table], count, raw.count, codec.count);
+		return;
+	}
+	for (i = 0; i < raw.count; i++) {
+		if (raw.values[i] != codec.values[i]) {
+			fail("%s/%i: field %i is 0x%x raw, 0x%x codec",
+			     table_names[table], count, i, raw.values[i], codec.values[i]);
+			return;
+		}
+	}
+}
+
+/* sections which the raw path and the codec must both reject */
+static void check_corrupt(enum table table)
+{
+	struct builder good;
+	struct builder b;
+	struct trace t;
+	int variant;
+
+	build(table, &good, 3);
+
+	for (variant = 0; variant < 4; variant++) {
+		int raw_ok;
+		int codec_ok;
+
+		b = good;
+		switch (variant) {
+		case 0:		/* bad crc */
+			b.buf[b.len - 1] ^= 0x01;
+			break;
+
+		case 1:		/* truncated */
+			b.len -= 1;
+			break;
+
+		case 2:		/* not a section_ext */
+			b.buf[1] &= 0x7f;
+			break;
+
+		case 3:		/* a partial entry after the last loop entry */
+			b.len -= CRC_SIZE;
+			b.buf[b.len++] = 0xff;
+			end_section(&b);
+			break;
+		}
+
+		raw_ok = !trace_raw(table, b.buf, b.len, &t);
+		codec_ok = !trace_codec(table, b.buf, b.len, &t);
+		if (raw_ok || codec_ok)
+			fail("%s: corrupt section %i accepted by the%s%s",
+			     table_names[table], variant,
+			     raw_ok ? " raw path" : "", codec_ok ? " codec" : "");
+	}
+}
+
+/* section_ext_raw_useful() must track a table exactly as section_ext_useful() */
+static void check_useful(void)
+{
+	static const struct {
+		int version;
+		int section_number;
+	} sequence[] = {
+		{ 1, 1 }, { 1, 0 }, { 1, 0 }, { 1, 2 }, { 1, 1 }, { 1, 1 },
+		{ 1, 0 }, { 2, 1 }, { 2, 0 }, { 2, 1 }, { 2, 0 }, { 3, 0 },
+	};
+	struct psi_table_state raw_state;
+	struct psi_table_state codec_state;
+	struct builder b;
+	unsigned int i;
+
+	memset(&raw_state, 0, sizeof(raw_state));
+	memset(&codec_state, 0, sizeof(codec_state));
+	psi_table_state_reset(&raw_state);
+	psi_table_state_reset(&codec_state);
+
+	for (i = 0; i < sizeof(sequence) / sizeof(sequence[0]); i++) {
+		struct section_ext *ext;
+		int raw_useful;
+		int codec_useful;
+
+		begin_section(&b, stag_mpeg_program_association, 0x1234,
+			      sequence[i].version, sequence[i].section_number, 1);
+		end_section(&b);
+
+		raw_useful = section_ext_raw_useful(b.buf, &raw_state);
+		ext = section_ext_decode(section_codec(b.buf, b.len), 1);
+		codec_useful = section_ext_useful(ext, &codec_state);
+
+		if ((!raw_useful != !codec_useful) ||
+		    (raw_state.version_number != codec_state.version_number) ||
+		    (raw_state.next_section_number != codec_state.next_section_number) ||
+		    (raw_state.complete != codec_state.complete) ||
+		    (raw_state.new_table != codec_state.new_table))
+			fail("useful: step %i differs", i);
+	}
+}
@@ -0,0 +1,309 @@
+/*
+ * DVB text decoder benchmark.
+ *
+ * Copyright (C) 2005 Andrew de Quincey (adq_dvb@lidskialf.net)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <libucsi/mpeg/section.h>
+#include <libucsi/dvb/section.h>
+#include <libucsi/dvb/descriptor.h>
+#include <libucsi/dvb/text.h>
+#include <libucsi/dvb/types.h>
+#include <libucsi/transport_packet.h>
+#include <libucsi/section_buf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <iconv.h>
+#include <sys/time.h>
+
+#define EIT_PID 0x12
+#define MAX_STRINGS 100000
+#define DEFAULT_ITERATIONS 20
+
+struct dvbstring {
+	uint8_t *text;
+	int len;
+};
+
+static struct dvbstring strings[MAX_STRINGS];
+static int strings_count = 0;
+static long strings_bytes = 0;
+
+static void read_eit(char *filename);
+static void parse_eit(uint8_t *buf, int len);
+static void add_string(uint8_t *text, int len);
+static int decode_iconv(struct dvbstring *s, char *dest, int destlen);
+static void strip_controls(char *str);
+static double now(void);
+
+int main(int argc, char *argv[])
+{
+	struct dvb_text_decoder *decoder;
+	char dest[256 * 3 + 1];
+	int iterations = DEFAULT_ITERATIONS;
+	int i, j;
+	int mismatches = 0;
+	double start, decoder_time, iconv_time;
+
+	if ((argc < 2) || (argc > 3)) {
+		fprintf(stderr, "Syntax: testtext <ts filename> [<iterations>]\n");
+		exit(1);
+	}
+	if (argc == 3)
+		iterations = atoi(argv[2]);
+
+	read_eit(argv[1]);
+	if (strings_count == 0) {
+		fprintf(stderr, "No EIT event text found in %s\n", argv[1]);
+		exit(1);
+	}
+	printf("%i strings (%li bytes) from EIT\n", strings_count, strings_bytes);
+
+	if ((decoder = dvb_text_decoder_create(NULL)) == NULL) {
+		fprintf(stderr, "Failed to create text decoder\n");
+		exit(1);
+	}
+
+	// compare the output of both methods once
+	for(i=0; i < strings_count; i++) {
+		char tmp[sizeof(dest)];
+
+		if (dvb_text_decode(decoder, strings[i].text, strings[i].len, dest, sizeof(dest), 0) < 0)
+			continue;
+		if (decode_iconv(&strings[i], tmp, sizeof(tmp)) < 0)
+			continue;
+		strip_controls(tmp);
+		if (strcmp(dest, tmp)) {
+			if (mismatches < 10)
+				printf("Mismatch:\n  decoder: %s\n  iconv:   %s\n", dest, tmp);
+			mismatches++;
+		}
+	}
+
+	start = now();
+	for(j=0; j < iterations; j++)
+		for(i=0; i < strings_count; i++)
+			dvb_text_decode(decoder, strings[i].text, strings[i].len, dest, sizeof(dest), 0);
+	decoder_time = now() - start;
+
+	start = now();
+	for(j=0; j < iterations; j++)
+		for(i=0; i < strings_count; i++)
+			decode_iconv(&strings[i], dest, sizeof(dest));
+	iconv_time = now() - start;
+
+	printf("dvb_text_decode:     %.0f strings/sec\n",
+	       (strings_count * (double) iterations) / decoder_time);
+	printf("iconv_open per string: %.0f strings/sec\n",
+	       (strings_count * (double) iterations) / iconv_time);
+	printf("speedup: %.1fx, %i mismatches\n", iconv_time / decoder_time, mismatches);
+
+	dvb_text_decoder_destroy(decoder);
+	for(i=0; i < strings_count; i++)
+		free(strings[i].text);
+	return 0;
+}
+
+static void read_eit(char *filename)
+{
+	unsigned char databuf[TRANSPORT_PACKET_LENGTH*20];
+	int fd;
+	int sz;
+	int i;
+	int used;
+	int section_status;
+	unsigned char continuity = 0;
+	struct section_buf *section_buf;
+	struct transport_packet *tspkt;
+	struct transport_values tsvals;
+
+	if ((fd = open(filename, O_RDONLY)) < 0) {
+		fprintf(stderr, "Unable to open file %s\n", filename);
+		exit(1);
+	}
+
+	section_buf = (struct section_buf*) malloc(sizeof(struct section_buf) + DVB_MAX_SECTION_BYTES);
+	if (section_buf == NULL) {
+		fprintf(stderr, "Failed to allocate section buf\n");
+		exit(1);
+	}
+	section_buf_init(section_buf, DVB_MAX_SECTION_BYTES);
+
+	while((sz = read(fd, databuf, sizeof(databuf))) > 0) {
+		for(i=0; (i + TRANSPORT_PACKET_LENGTH) <= sz; i+=TRANSPORT_PACKET_LENGTH) {
+			tspkt = transport_packet_init(databuf + i);
+			if (tspkt == NULL)
+				continue;
+			if (transport_packet_pid(tspkt) != EIT_PID)
+				continue;
+			if (transport_packet_values_extract(tspkt, &tsvals, 0) < 0)
+				continue;
+
+			if (transport_packet_continuity_check(tspkt,
+			    tsvals.flags & transport_adaptation_flag_discontinuity,
+			    &continuity)) {
+				continuity = 0;
+				section_buf_reset(section_buf);
+				continue;
+			}
+
+			while(tsvals.payload_length) {
+				used = section_buf_add_transport_payload(section_buf,
+									 tsvals.payload,
+									 tsvals.payload_length,
+									 tspkt->payload_unit_start_indicator,
+									 &section_status);
+				tspkt->payload_unit_start_indicator = 0;
+				tsvals.payload_length -= used;
+				tsvals.payload += used;
+
+				if (section_status == 1) {
+					parse_eit(section_buf_data(section_buf), section_buf->len);
+					section_buf_reset(section_buf);
+				} else if (section_status < 0) {
+					section_buf_reset(section_buf);
+				}
+			}
+		}
+	}
+
+	free(section_buf);
+	close(fd);
+}
+
+static void parse_eit(uint8_t *buf, int len)
+{
+	struct section *section;
+	struct section_ext *section_ext;
+	struct dvb_eit_section *eit;
+	struct dvb_eit_event *cur_event;
+	struct descriptor *curd;
+
+	if ((section = section_codec(buf, len)) == NULL)
+		return;
+	if ((section->table_id < stag_dvb_event_information_nownext_actual) ||
+	    (section->table_id > (stag_dvb_event_information_schedule_other + 0x0f)))
+		return;
+	if ((section_ext = section_ext_decode(section, 1)) == NULL)
+		return;
+	if ((eit = dvb_eit_section_codec(section_ext)) == NULL)
+		return;
+
+	dvb_eit_section_events_for_each(eit, cur_event) {
+		dvb_eit_event_descriptors_for_each(cur_event, curd) {
+			switch(curd->tag) {
+			case dtag_dvb_short_event:
+			{
+				struct dvb_short_event_descriptor *dx;
+				struct dvb_short_event_descriptor_part2 *part2;
+
+				if ((dx = dvb_short_event_descriptor_codec(curd)) == NULL)
+					break;
+				part2 = dvb_short_event_descriptor_part2(dx);
+				add_string(dvb_short_event_descriptor_event_name(dx), dx->event_name_length);
+				add_string(dvb_short_event_descriptor_text(part2), part2->text_length);
+				break;
+			}
+
+			case dtag_dvb_extended_event:
+			{
+				struct dvb_extended_event_descriptor *dx;
+				struct dvb_extended_event_descriptor_part2 *part2;
+
+				if ((dx = dvb_extended_event_descriptor_codec(curd)) == NULL)
+					break;
+				part2 = dvb_extended_event_descriptor_part2(dx);
+				add_string(dvb_extended_event_descriptor_part2_text(part2), part2->text_length);
+				break;
+			}
+			}
+		}
+	}
+}
+
+static void add_string(uint8_t *text, int len)
+{
+	if ((len == 0) || (strings_count >= MAX_STRINGS))
+		return;
+
+	strings[strings_count].text = malloc(len);
+	if (strings[strings_count].text == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	memcpy(strings[strings_count].text, text, len);
+	strings[strings_count].len = len;
+	strings_count++;
+	strings_bytes += len;
+}
+
+/*
+ * The conversion most applications do: look up the charset, then open an
+ * iconv descriptor for each string.
+ */
+static int decode_iconv(struct dvbstring *s, char *dest, int destlen)
+{
+	const char *charset;
+	int consumed;
+	iconv_t cd;
+	char *in;
+	char *out = dest;
+	size_t inlen;
+	size_t outlen = destlen - 1;
+
+	charset = dvb_charset((char *) s->text, s->len, &consumed);
+	in = (char *) s->text + consumed;
+	inlen = s->len - consumed;
+
+	if ((cd = iconv_open("UTF-8", charset)) == (iconv_t) -1)
+		return -1;
+	iconv(cd, &in, &inlen, &out, &outlen);
+	iconv_close(cd);
+	*out = 0;
+
+	return out - dest;
+}
+
+/*
+ * iconv passes the C1 control codes (emphasis, CR/LF) straight through, so
+ * remove them before comparing.
+ */
+static void strip_controls(char *str)
+{
+	unsigned char *in = (unsigned char *) str;
+	char *out = str;
+
+	while(*in) {
+		if ((in[0] == 0xc2) && (in[1] >= 0x80) && (in[1] <= 0x9f)) {
+			in += 2;
+			continue;
+		}
+		*out++ = *in++;
+	}
+	*out = 0;
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
@@ -0,0 +1,427 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/dvb/dmx.h>
+#include "vt.h"
+#include "misc.h"
+#include "fdset.h"
+#include "vbi.h"
+#include "cache.h"
+#include "lang.h"
+#include "dllist.h"
+#include "export.h"
+
+/*
+ * Headless teletext archiver: captures the teletext of many services at
+ * once from a single TS filter on the demux.  Each service has its own
+ * vbi (PES reassembly and page assembly) and page cache, and every page
+ * is written out as soon as it arrives with new contents.
+ */
+
+#define MAX_SERVICES	64
+#define TS_BUF_PACKETS	348
+#define DEMUX_BUFFER	(TS_PACKET_SIZE * 4096)
+
+static volatile int stop = 0;
+u_int16_t sid;
+
+
+struct service
+{
+    char *name; // for the file name (%s)
+    int pid;
+    struct vbi *vbi;
+    u32 sums[0x800]; // checksum of the last written version of each page
+    unsigned long pages; // pages received
+    unsigned long written; // pages written
+};
+
+static struct service services[MAX_SERVICES];
+static int nservices;
+static short pidmap[0x2000]; // PID -> index into services, -1 if none
+static u8 wanted[0x900]; // pages to write
+static struct export *fmt;
+static char *fname = "ttext-%s-%p.%e";
+
+static u8 tsbuf[TS_PACKET_SIZE * TS_BUF_PACKETS];
+static unsigned int tsfill;
+static unsigned long ts_packets;
+
+
+static void usage(FILE *fp, int exitval)
+{
+    fprintf(fp, "\nUsage: %s [options] pid[=name]...\n", prgname);
+    fprintf(fp,
+	    "\n"
+	    "  Valid options:\t\tDefault:\n"
+	    "    -cs -charset\t\tlatin-1\n"
+	    "    <latin-1/2/koi8-r/iso8859-7>\n"
+	    "    -d -demux <demuxdev>\t/dev/dvb/adapter0/demux0\n"
+	    "    -f -format <fmt,options>\tascii\n"
+	    "    -f help -format help\n"
+	    "    -h -help\n"
+	    "    -n -name <filename>\t\tttext-%%s-%%p.%%e\n"
+	    "    -p -pages <ppp[-ppp],...>\t(all)\n"
+	    "    -to -timeout <secs>\t\t(none)\n"
+	    "\n"
+	    "  Each pid is the teletext PID of a service.  The name\n"
+	    "  (default: the PID) is used for %%s in the file name.\n"
+	);
+    exit(exitval);
+}
+
+
+static void exp_help(FILE *fp)
+{
+    struct export_module **ep;
+    char **cp, c;
+
+    fprintf(fp,
+	    "\nSyntax: -format Name[,Options]\n"
+	    "\n"
+	    "    Name\tExt.\tOptions\n"
+	    "    --------------------------------\n"
+	);
+    for (ep = modules; *ep; ep++)
+    {
+	fprintf(fp, "    %-7s\t.%-4s", (*ep)->fmt_name, (*ep)->extension);
+	for (c = '\t', cp = (*ep)->options; cp && *cp; cp++, c = ',')
+	    fprintf(fp, "%c%s", c, *cp);
+	fprintf(fp, "\n");
+    }
+    exit(0);
+}
+
+
+static int option(int argc, char **argv, int *ind, char **arg)
+{
+    static struct { char *nam, *altnam; int arg; } opts[] = {
+	{ "-charset", "-cs", 1 },
+	{ "-demux", "-d", 1 },
+	{ "-format", "-f", 1 },
+	{ "-help", "-h", 0 },
+	{ "-name", "-n", 1 },
+	{ "-pages", "-p", 1 },
+	{ "-timeout", "-to", 1 },
+    };
+    int i;
+
+    if (*ind >= argc)
+	return 0;
+
+    *arg = argv[(*ind)++];
+    for (i = 0; i < NELEM(opts); ++i)
+	if (streq(*arg, opts[i].nam) || streq(*arg, opts[i].altnam))
+	{
+	    if (opts[i].arg)
+		if (*ind < argc)
+		    *arg = argv[(*ind)++];
+		else
+		    fatal("option %s requires an argument", *arg);
+	    return i+1;
+	}
+
+    if (**arg == '-')
+    {
+	fatal("%s: invalid option", *arg);
+	usage(stderr, 2);
+    }
+
+    return -1;
+}
+
+
+static void arg_pages(char *p)
+{
+    char *end;
+    int first, last;
+
+    for (;;)
+    {
+	first = last = strtol(p, &end, 16);
+	if (*end == '-')
+	    last = strtol(end + 1, &end, 16);
+	if (first < 0x100 || last > 0x8ff || first > last)
+	    fatal("%s: invalid page range", p);
+	memset(wanted + first, 1, last - first + 1);
+	if (*end == 0)
+	    return;
+	if (*end != ',')
+	    fatal("%s: invalid page range", p);
+	p = end + 1;
+    }
+}
+
+
+static void arg_service(char *arg)
+{
+    struct service *svc;
+    char *end;
+    int pid;
+
+    if (nservices == MAX_SERVICES)
+	fatal("too many services (max %d)", MAX_SERVICES);
+
+    pid = strtoul(arg, &end, 0);
+    if (pid < 0x10 || pid >= 0x1fff || (*end && *end != '='))
+	fatal("%s: invalid teletext pid", arg);
+    if (pidmap[pid] != -1)
+	fatal("%s: pid given twice", arg);
+
+    svc = services + nservices;
+    svc->pid = pid;
+    svc->name = *end ? end + 1 : arg;
+    pidmap[pid] = nservices++;
+}
+
+
+static u32 page_sum(struct vt_page *vtp)
+{
+    const u8 *p = vtp->data[0];
+    u32 sum = 2166136261u ^ vtp->subno;
+    int i;
+
+    for (i = 0; i < H * W; ++i)
+	sum = (sum ^ p[i]) * 16777619u;
+    return sum ?: 1;
+}
+
+
+static void event(struct service *svc, struct vt_event *ev)
+{
+    struct vt_page *vtp;
+    char *name;
+    u32 sum;
+
+    if (ev->type != EV_PAGE || ev->i1) // only new pages, not queries
+	return;
+
+    vtp = ev->p1;
+    if (vtp->pgno < 0x100 || vtp->pgno > 0x8ff || not wanted[vtp->pgno])
+	return;
+    svc->pages++;
+
+    // rotating and repeated pages are only written when they change
+    sum = page_sum(vtp);
+    if (svc->sums[vtp->pgno - 0x100] == sum)
+	return;
+    svc->sums[vtp->pgno - 0x100] = sum;
+
+    name = export_mkname(fmt, fname, vtp, svc->name);
+    if (not name || export(fmt, vtp, name))
+	error("%s: error saving page %x: %s", svc->name, vtp->pgno,
+		export_errstr());
+    else
+	svc->written++;
+    if (name)
+	free(name);
+}
+
+
+static void ts_handler(void *data, int fd)
+{
+    unsigned int p, left;
+    int n, idx;
+
+    n = read(fd, tsbuf + tsfill, sizeof(tsbuf) - tsfill);
+    if (n < 0)
+    {
+	if (errno == EOVERFLOW)
+	    error("demux buffer overflow, increase it or capture fewer services");
+	return;
+    }
+    tsfill += n;
+
+    for (p = 0; tsfill - p >= TS_PACKET_SIZE; p += TS_PACKET_SIZE)
+    {
+	// resync on the next sync byte
+	while (tsbuf[p] != 0x47 && tsfill - p >= TS_PACKET_SIZE)
+	    p++;
+	if (tsfill - p < TS_PACKET_SIZE)
+	    break;
+
+	ts_packets++;
+	idx = pidmap[((tsbuf[p+1] << 8) | tsbuf[p+2]) & 0x1fff];
+	if (idx >= 0)
+	    vbi_feed_ts(services[idx].vbi, tsbuf + p);
+    }
+
+    // keep a partial packet for the next read
+    left = tsfill - p;
+    if (left)
+	memcpy(tsbuf, tsbuf + p, left);
+    tsfill = left;
+}
+
+
+static int open_demux(char *dev)
+{
+    struct dmx_pes_filter_params filterpar;
+    u16 pid;
+    int fd, i;
+
+    if ((fd = open(dev, O_RDWR)) == -1)
+	fatal("cannot open demux device %s", dev);
+
+    if (ioctl(fd, DMX_SET_BUFFER_SIZE, DEMUX_BUFFER) < 0)
+	error("ioctl: DMX_SET_BUFFER_SIZE %s", strerror(errno));
+
+    // one TS filter with all the teletext PIDs added to it
+    memset(&filterpar, 0, sizeof(filterpar));
+    filterpar.pid = services[0].pid;
+    filterpar.input = DMX_IN_FRONTEND;
+    filterpar.output = DMX_OUT_TSDEMUX_TAP;
+    filterpar.pes_type = DMX_PES_OTHER;
+    filterpar.flags = 0;
+    if (ioctl(fd, DMX_SET_PES_FILTER, &filterpar) < 0)
+	fatal("ioctl: DMX_SET_PES_FILTER %s (%u)", strerror(errno), errno);
+
+    for (i = 1; i < nservices; ++i)
+    {
+	pid = services[i].pid;
+	if (ioctl(fd, DMX_ADD_PID, &pid) < 0)
+	{
+	    // old kernel: take the whole TS and filter here
+	    error("ioctl: DMX_ADD_PID %s, using the full TS", strerror(errno));
+	    filterpar.pid = 0x2000;
+	    if (ioctl(fd, DMX_SET_PES_FILTER, &filterpar) < 0)
+		fatal("ioctl: DMX_SET_PES_FILTER %s (%u)", strerror(errno), errno);
+	    break;
+	}
+    }
+
+    if (ioctl(fd, DMX_START, 0) < 0)
+	fatal("ioctl: DMX_START %s (%u)", strerror(errno), errno);
+    return fd;
+}
+
+
+static void sig_stop(int sig)
+{
+    stop = 1;
+}
+
+
+int main(int argc, char **argv)
+{
+    char *demux_name = "/dev/dvb/adapter0/demux0";
+    char *out_fmt = "ascii";
+    int timeout = 0;
+    int opt, ind, fd, i;
+    char *arg;
+    struct service *svc;
+
+    setlocale (LC_CTYPE, "");
+    setprgname(argv[0]);
+
+    fdset_init(fds);
+    memset(pidmap, 0xff, sizeof(pidmap));
+
+    ind = 1;
+    while (opt = option(argc, argv, &ind, &arg))
+	switch (opt)
+	{
+	    case 1: // charset
+		if (streq(arg, "latin-1") || streq(arg, "1"))
+		    latin1 = 1;
+		else if (streq(arg, "latin-2") || streq(arg, "2"))
+		    latin1 = 0;
+		else if (streq(arg, "koi8-r") || streq(arg, "koi"))
+		    latin1 = KOI8;
+		else if (streq(arg, "iso8859-7") || streq(arg, "el"))
+		    latin1 = GREEK;
+		else
+		    fatal("bad charset (not latin-1/2/koi8-r/iso8859-7)");
+		break;
+	    case 2: // demux
+		demux_name = arg;
+		break;
+	    case 3: // format
+		if (streq(arg, "help") || streq(arg, "?") || streq(arg, "list"))
+		    exp_help(stdout);
+		out_fmt = arg;
+		break;
+	    case 4: // help
+		usage(stdout, 0);
+		break;
+	    case 5: // name
+		fname = arg;
+		break;
+	    case 6: // pages
+		arg_pages(arg);
+		break;
+	    case 7: // timeout
+		timeout = strtol(arg, 0, 10);
+		if (timeout < 1 || timeout > 999999)
+		fatal("bad timeout value", timeout);
+		break;
+	    case -1: // non-option arg
+		arg_service(arg);
+		break;
+	}
+
+    if (nservices == 0)
+	fatal("no teletext pids given");
+    for (i = 0x100; i < 0x900 && not wanted[i]; ++i)
+	;
+    if (i == 0x900)
+	memset(wanted + 0x100, 1, 0x800);
+
+    if (not(fmt = export_open(out_fmt)))
+	fatal("%s", export_errstr());
+
+    // one vbi and cache per service, fed from the TS below
+    for (svc = services; svc < services + nservices; ++svc)
+    {
+	struct cache *ca;
+
+	if (not(ca = cache_open()))
+	    fatal("cannot create cache");
+	if (not(svc->vbi = vbi_open_ts(ca, svc->pid)))
+	    fatal("cannot create vbi for pid %d", svc->pid);
+	vbi_add_handler(svc->vbi, event, svc);
+    }
+
+    fd = open_demux(demux_name);
+    fdset_add_fd(fds, fd, ts_handler, 0);
+
+    signal(SIGINT, sig_stop);
+    signal(SIGTERM, sig_stop);
+    signal(SIGALRM, sig_stop);
+    if (timeout)
+	alarm(timeout);
+
+    while (not stop)
+	if (fdset_select(fds, 30000) == 0) // 30sec select time out
+	{
+	    error("no signal.");
+	    break;
+	}
+
+    alarm(0);
+    fdset_del_fd(fds, fd);
+    close(fd);
+
+    fprintf(stderr, "%lu TS packets\n", ts_packets);
+    for (svc = services; svc < services + nservices; ++svc)
+    {
+	struct word_index *wi = svc->vbi->cache->index;
+
+	fprintf(stderr, "%s (pid %d): %lu pages, %lu written\n",
+		svc->name, svc->pid, svc->pages, svc->written);
+	if (wi && wi->updates)
+	    fprintf(stderr, "  index: %d words, %lu pages indexed (%lu unchanged skipped), "
+		    "%llu us/page\n", wi->nwords, wi->updates, wi->unchanged,
+		    wi->usecs / wi->updates);
+	vbi_del_handler(svc->vbi, event, svc);
+	vbi_close(svc->vbi);
+    }
+    export_close(fmt);
+    exit(0);
+}
@@ -43,8 +43,12 @@ static void cache_close(struct cache *ca)
 	{
 	    cp = PTR ca->hash[i].first;
 	    dl_remove(cp->node);
+	    if (ca->index)
+		wordidx_remove(ca->index, &cp->words);
 	    free(cp);
 	}
+    if (ca->index)
+	wordidx_close(ca->index);
     free(ca);
 }
 
@@ -59,6 +63,8 @@ static void cache_reset(struct cache *ca)
 	    if (cp->page->pgno / 256 != 9) // don't remove help pages
 	    {
 		dl_remove(cp->node);
+		if (ca->index)
+		    wordidx_remove(ca->index, &cp->words);
 		free(cp);
 		ca->npages--;
 	    }
@@ -93,6 +99,7 @@ static struct vt_page * cache_put(struct cache *ca, struct vt_page *vtp)
 {
     struct cache_page *cp;
     int h = hash(vtp->pgno);
+    int changed = 1;
     
     for (cp = PTR ca->hash[h].first; cp->node->next; cp = PTR cp->node->next)
 	if (cp->page->pgno == vtp->pgno && cp->page->subno == vtp->subno)
@@ -104,12 +111,14 @@ static struct vt_page * cache_put(struct cache *ca, struct vt_page *vtp)
 	dl_insert_first(ca->hash + h, dl_remove(cp->node));
 	if (ca->erc)
 	    do_erc(cp->page, vtp);
+	changed = memcmp(cp->page->data, vtp->data, sizeof(vtp->data)) != 0;
     }
     else
     {
 	cp = malloc(sizeof(*cp));
 	if (cp == 0)
 	    return 0;
+	cp->words = 0;
 	if (vtp->subno >= ca->hi_subno[vtp->pgno])
 	    ca->hi_subno[vtp->pgno] = vtp->subno + 1;
 	ca->npages++;
@@ -117,6 +126,15 @@ static struct vt_page * cache_put(struct cache *ca, struct vt_page *vtp)
     }
 
     *cp->page = *vtp;
+
+    // most pages are retransmitted unchanged: only reindex real updates
+    if (ca->index)
+    {
+	if (changed)
+	    wordidx_update(ca->index, &cp->words, cp->page);
+	else
+	    ca->index->unchanged++;
+    }
     return cp->page;
 }
 
@@ -216,6 +234,7 @@ struct cache * cache_open(void)
     ca->erc = 1;
     ca->npages = 0;
     ca->op = &cops;
+    ca->index = wordidx_open(); // search falls back to a full scan without it
 
     for (vtp = help_pages; vtp < help_pages + nr_help_pages; vtp++)
 	cache_put(ca, vtp);
@@ -4,6 +4,7 @@
 #include "vt.h"
 #include "misc.h"
 #include "dllist.h"
+#include "wordidx.h"
 
 #define HASH_SIZE 113
 
@@ -15,6 +16,7 @@ struct cache
     int npages;
     u16 hi_subno[0x9ff + 1]; // 0:pg not in cache, 1-3f80:highest subno + 1
     struct cache_ops *op;
+    struct word_index *index; // words on the cached pages, may be 0
 };
 
 
@@ -22,6 +24,7 @@ struct cache_page
 {
     struct dl_node node[1];
     struct vt_page page[1];
+    struct word_post *words; // index entries of this page
 };
 
 
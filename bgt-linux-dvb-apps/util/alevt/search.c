@@ -1,56 +1,126 @@
 #include <sys/types.h> // for freebsd
 #include <stdlib.h>
+#include <string.h>
 #include "vt.h"
 #include "misc.h"
 #include "cache.h"
 #include "search.h"
 
 
-static void convert(u8 *p, u8 *buf, int *line)
+// an escaped char which stands for itself and is not a word char
+static int escaped_literal(int c)
 {
-    int x, y, c, ch, gfx, hid = 0;
+    return c && not wordidx_char(c) && not strchr("<>`'", c);
+}
+
+
+/*
+ * Find the longest run of word characters which every match of the (basic)
+ * regular expression must contain, and whether it has to be a whole word.
+ * Alternatives and groups, which may be optional, make this impossible:
+ * such patterns are searched with a full scan.
+ */
+static void keyword(struct search *s, u8 *pat)
+{
+    u8 run[WORD_MAX + 1];
+    int len = 0, start_bound = 0, bound, i;
+
+    s->keyword[0] = 0;
+    s->exact = 0;
+    if (strstr(PTR pat, "\\|") || strstr(PTR pat, "\\("))
+	return;
 
-    for (y = 1, p += 40; y < 25; ++y)
+    for (;;)
     {
-	if (not hid)
+	if (wordidx_char(*pat))
 	{
-	    gfx = 0;
-	    for (x = 0; x < 40; ++x)
-	    {
-		c = ' ';
-		switch (ch = *p++)
-		{
-		    case 0x00 ... 0x07:
-			gfx = 0;
-			break;
-		    case 0x10 ... 0x17:
-			gfx = 1;
-			break;
-		    case 0x0c:
-			hid = 1;
-			break;
-		    case 0x7f:
-			c = '*';
-			break;
-		    case 0x20 ... 0x7e:
-			if (gfx && ch != ' ' && (ch & 0xa0) == 0x20)
-			    ch = '#';
-		    case 0xa0 ... 0xff:
-			c= ch;
-		}
-		*buf++ = c;
-	    }
-	    *buf++ = '\n';
-	    *line++ = y;
+	    if (len == WORD_MAX)
+		return; // too long for the index
+	    run[len++] = wordidx_lower(*pat++);
+	    continue;
+	}
+
+	// does the char ending the run make it end on a word boundary?
+	bound = 0;
+	if (*pat == '*' || (pat[0] == '\\' && pat[1] && strchr("?+{", pat[1])))
+	    len--; // quantified: the last char may be missing
+	else if (*pat == '\\')
+	    bound = pat[1] == '>' || pat[1] == 'b' || escaped_literal(pat[1]);
+	else if (*pat && *pat != '.' && *pat != '[')
+	    bound = 1; // literal non-word char, ^ or $
+
+	if (len >= WORD_MIN && len > (int)strlen(PTR s->keyword))
+	{
+	    for (i = 0; i < len; ++i)
+		s->keyword[i] = run[i];
+	    s->keyword[len] = 0;
+	    s->exact = start_bound && bound;
 	}
-	else
+	len = 0;
+
+	// and does the next run start on one?
+	switch (*pat)
 	{
-	    p += 40;
-	    hid = 0;
+	    case 0:
+		return;
+	    case '[':
+		if (*++pat == '^')
+		    pat++;
+		if (*pat == ']')
+		    pat++;
+		while (*pat && *pat != ']')
+		    pat++;
+		if (*pat == 0)
+		    return;
+		start_bound = 0;
+		break;
+	    case '\\':
+		if (pat[1] == '{')
+		{
+		    // skip the interval
+		    while (*pat && (pat[0] != '\\' || pat[1] != '}'))
+			pat++;
+		    if (*pat == 0)
+			return;
+		    start_bound = 0;
+		}
+		else
+		    start_bound = pat[1] == '<' || pat[1] == 'b' || escaped_literal(pat[1]);
+		if (*++pat == 0)
+		    return;
+		break;
+	    default:
+		start_bound = *pat != '*' && *pat != '.';
+		break;
 	}
+	pat++;
+    }
+}
+
+
+static void add_candidate(struct search *s, struct vt_page *vtp)
+{
+    struct vt_page **tmp;
+
+    if (s->ncand == s->maxcand)
+    {
+	if (not(tmp = realloc(s->cand, (s->maxcand * 2 + 16) * sizeof(*tmp))))
+	    return;
+	s->cand = tmp;
+	s->maxcand = s->maxcand * 2 + 16;
     }
-    *line = y;
-    *buf = 0;
+    s->cand[s->ncand++] = vtp;
+}
+
+
+static int cand_cmp(const void *a, const void *b)
+{
+    const struct vt_page *pa = *(struct vt_page **)a;
+    const struct vt_page *pb = *(struct vt_page **)b;
+
+    if (pa->pgno != pb->pgno)
+	return pa->pgno - pb->pgno;
+    return pa->subno - pb->subno;
 }
 
 
@@ -60,7 +130,7 @@ static int search_pg(struct search *s, struct vt_page *vtp)
     u8 buf[H *(W+1) + 1];
     int line[H];
 
-    convert(PTR vtp->data, buf, line);
+    page_to_text(PTR vtp->data, buf, line);
     if (regexec(s->pattern, buf, 1, m, 0) == 0)
     {
 	s->len = 0;
@@ -95,6 +165,9 @@ struct search * search_start(struct cache *ca, u8 *pattern)
 	goto fail2;
 
     s->cache = ca;
+    s->cand = 0;
+    s->ncand = s->maxcand = 0;
+    keyword(s, pattern);
     return s;
 
 fail2:
@@ -107,15 +180,65 @@ fail1:
 void search_end(struct search *s)
 {
     regfree(s->pattern);
+    if (s->cand)
+	free(s->cand);
     free(s);
 }
 
 
+/*
+ * Search the pages from the index only, in the same order as foreach_pg.
+ * The candidates are looked up again each time as the cache keeps changing.
+ */
+static struct vt_page * search_index(struct search *s, int pgno, int subno, int dir)
+{
+    int cur, key, i, n, first;
+    struct vt_page *vtp;
+
+    s->ncand = 0;
+    wordidx_lookup(s->cache->index, s->keyword, s->exact,
+	PTR add_candidate, s);
+    if (s->ncand == 0)
+	return 0;
+    qsort(s->cand, s->ncand, sizeof(*s->cand), cand_cmp);
+
+    // the first candidate after the current page in the search direction,
+    // starting from the same subpage as foreach_pg
+    if (vtp = s->cache->op->get(s->cache, pgno, subno))
+	subno = vtp->subno;
+    else if (subno == ANY_SUB)
+	subno = dir < 0 ? 0 : 0xffff;
+    cur = pgno * 0x10000 + subno;
+    for (first = 0; first < s->ncand; ++first)
+    {
+	key = s->cand[first]->pgno * 0x10000 + s->cand[first]->subno;
+	if (dir > 0 ? key > cur : key >= cur)
+	    break;
+    }
+    if (dir < 0)
+	first--;
+
+    for (n = 0; n < s->ncand; ++n)
+    {
+	i = (first + (dir < 0 ? -n : n) + 2 * s->ncand) % s->ncand;
+	vtp = s->cand[i];
+	// substring lookups can list a page more than once
+	if (n && vtp == s->cand[(i - (dir < 0 ? -1 : 1) + s->ncand) % s->ncand])
+	    continue;
+	if (search_pg(s, vtp))
+	    return vtp;
+    }
+    return 0;
+}
+
+
 int search_next(struct search *s, int *pgno, int *subno, int dir)
 {
     struct vt_page *vtp = 0;
 
-    if (s->cache)
+    if (s->cache && s->cache->index && s->keyword[0])
+	vtp = search_index(s, *pgno, *subno, dir);
+    else if (s->cache)
 	vtp = s->cache->op->foreach_pg(s->cache, *pgno, *subno, dir,
 	search_pg, s);
     if (vtp == 0)
@@ -2,12 +2,18 @@
 #define SEARCH_H
 
 #include <regex.h>
+#include "wordidx.h"
 
 struct search
 {
     struct cache *cache;
     regex_t pattern[1];
     int x, y, len; // the position of the match
+    // first stage: pages from the word index
+    u8 keyword[WORD_MAX + 1]; // literal part of the pattern, "" if none
+    int exact; // keyword is a whole word
+    struct vt_page **cand; // candidate pages
+    int ncand, maxcand;
 };
 
 struct search *search_start(struct cache *ca, u8 *pattern);
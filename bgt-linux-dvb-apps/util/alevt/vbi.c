@@ -33,8 +33,6 @@ static void dvb_handler(struct vbi *vbi, int fd);
 
 #define FAC (1<<16) // factor for fix-point arithmetic
 
-static u8 *rawbuf; // one common buffer for raw vbi data
-static int rawbuf_size; // its current size
 u_int16_t sid;
 static char *vbi_names[]
 	= { "/dev/vbi", "/dev/vbi0", "/dev/video0", "/dev/dvb/adapter0/demux0",
@@ -407,6 +405,7 @@ fail1:
 
 void vbi_close(struct vbi *vbi)
 {
+    if (vbi->fd != -1)
     fdset_del_fd(fds, vbi->fd);
     if (vbi->cache)
     vbi->cache->op->close(vbi->cache);
@@ -425,6 +424,7 @@ void vbi_close(struct vbi *vbi)
        vbi_proxy_client_destroy(pProxy);
        pProxy = NULL;
     }
+    free(vbi->pes);
     free(vbi);
 }
 
@@ -526,15 +526,65 @@ static const u_int8_t byterev8[256] = {
         0x1f, 0x9f, 0x5f, 0xdf, 0x3f, 0xbf, 0x7f, 0xff
 };
 
-static void dvb_handle_pes_payload(struct vbi *vbi, const u_int8_t *buf,
+/*
+ * PES reassembly.  Data from the demux (a PES stream) or from TS packets
+ * is appended to a ring and the EBU data units are decoded straight out
+ * of it as soon as each one is complete, so nothing is ever moved down.
+ */
+#define PES_RING_SIZE 8192 // power of 2; a data unit is at most 257 bytes
+
+enum { PES_SYNC, PES_HEADER, PES_UNIT, PES_SKIP };
+
+struct vbi_pes
+{
+    u8 ring[PES_RING_SIZE];
+    unsigned int head; // write position, free running
+    unsigned int tail; // read position, free running
+    int state;
+    unsigned int left; // bytes still to come in this PES packet
+};
+
+static inline u8 pes_peek(struct vbi_pes *pes, unsigned int off)
+{
+    return pes->ring[(pes->tail + off) & (PES_RING_SIZE - 1)];
+}
+
+static void pes_copy(struct vbi_pes *pes, unsigned int off, u8 *buf,
 	unsigned int len)
 {
-	unsigned int p, i;
-	u_int8_t data[42];
+    unsigned int pos = (pes->tail + off) & (PES_RING_SIZE - 1);
+    unsigned int n = min(len, PES_RING_SIZE - pos);
+
+    memcpy(buf, pes->ring + pos, n);
+    memcpy(buf + n, pes->ring, len - n);
+}
+
+static void pes_write(struct vbi_pes *pes, const u8 *buf, unsigned int len)
+{
+    unsigned int pos = pes->head & (PES_RING_SIZE - 1);
+    unsigned int n = min(len, PES_RING_SIZE - pos);
+
+    memcpy(pes->ring + pos, buf, n);
+    memcpy(pes->ring, buf + n, len - n);
+    pes->head += len;
+}
+
+static void pes_reset(struct vbi_pes *pes)
+{
+    pes->tail = pes->head;
+    pes->state = PES_SYNC;
+    pes->left = 0;
+}
+
+static void dvb_handle_unit(struct vbi *vbi, struct vbi_pes *pes, unsigned int len)
+{
+    unsigned int i;
+    u8 unit[2 + 255];
+    u8 data[42];
 
-	if (buf[0] < 0x10 || buf[0] > 0x1f)
-		return;  /* no EBU teletext data */
-	for (p = 1; p < len; p += /*6 + 40*/ 2 + buf[p + 1]) {
+    if (len < 2 + 44 || dl_empty(vbi->clients))
+	return;
+    pes_copy(pes, 0, unit, 2 + 44);
 #if 0
 	printf("Txt Line:\n"
 	       "  data_unit_id		   0x%02x\n"
@@ -545,72 +595,160 @@ static void dvb_handle_pes_payload(struct vbi *vbi, const u_int8_t *buf,
 	       "  framing_code		   0x%02x\n"
 	       "  magazine_and_packet_addr 0x%04x\n"
 	       "  data_block		   0x%02x 0x%02x 0x%02x 0x%02x\n",
-	       buf[p], buf[p+1],
-	       buf[p+2] >> 6,
-	       (buf[p+2] >> 5) & 1,
-	       buf[p+2] & 0x1f,
-	       buf[p+3],
-	       (buf[p+4] << 8) | buf[p+5],
-	       buf[p+6], buf[p+7], buf[p+8], buf[p+9]);
+	       unit[0], unit[1],
+	       unit[2] >> 6,
+	       (unit[2] >> 5) & 1,
+	       unit[2] & 0x1f,
+	       unit[3],
+	       (unit[4] << 8) | unit[5],
+	       unit[6], unit[7], unit[8], unit[9]);
 #endif
-		for (i = 0; i < sizeof(data); i++)
-			data[i] = byterev8[buf[p+4+i]];
-		/* note: we should probably check for missing lines and then
-		 * call out_of_sync(vbi); and/or vbi_reset(vbi); */
-		vt_line(vbi, data);
-	}
+    for (i = 0; i < sizeof(data); i++)
+	data[i] = byterev8[unit[4+i]];
+    /* note: we should probably check for missing lines and then
+     * call out_of_sync(vbi); and/or vbi_reset(vbi); */
+    vt_line(vbi, data);
 }
 
-static unsigned int rawptr;
+// decode everything complete in the ring
+static void dvb_parse_pes(struct vbi *vbi, struct vbi_pes *pes)
+{
+    unsigned int avail, len;
+    u8 id;
+
+    for (;;)
+    {
+	avail = pes->head - pes->tail;
+	switch (pes->state)
+	{
+	    case PES_SYNC:
+		/* PES packet start code prefix and stream_id == private_stream_1 */
+		if (avail < 6)
+		    return;
+		if (pes_peek(pes, 0) != 0x00 || pes_peek(pes, 1) != 0x00 ||
+		    pes_peek(pes, 2) != 0x01 || pes_peek(pes, 3) != 0xbd)
+		{
+		    pes->tail++;
+		    break;
+		}
+		len = (pes_peek(pes, 4) << 8) | pes_peek(pes, 5);
+		pes->tail += 6;
+		if (len < 3)
+		    break;
+		pes->left = len;
+		pes->state = PES_HEADER;
+		break;
+
+	    case PES_HEADER:
+		// flags, header length, optional fields, data_identifier
+		if (avail < 3)
+		    return;
+		len = 3 + pes_peek(pes, 2) + 1;
+		if (len > pes->left)
+		{
+		    pes->state = PES_SKIP;
+		    break;
+		}
+		if (avail < len)
+		    return;
+		id = pes_peek(pes, len - 1);
+		pes->tail += len;
+		pes->left -= len;
+		/* no EBU teletext data */
+		pes->state = (id < 0x10 || id > 0x1f) ? PES_SKIP : PES_UNIT;
+		break;
+
+	    case PES_UNIT:
+		if (pes->left < 2)
+		{
+		    pes->state = PES_SKIP;
+		    break;
+		}
+		if (avail < 2)
+		    return;
+		len = 2 + pes_peek(pes, 1);
+		if (len > pes->left)
+		{
+		    pes->state = PES_SKIP;
+		    break;
+		}
+		if (avail < len)
+		    return;
+		dvb_handle_unit(vbi, pes, len);
+		pes->tail += len;
+		pes->left -= len;
+		if (pes->left == 0)
+		    pes->state = PES_SYNC;
+		break;
+
+	    case PES_SKIP:
+		len = min(avail, pes->left);
+		pes->tail += len;
+		pes->left -= len;
+		if (pes->left)
+		    return;
+		pes->state = PES_SYNC;
+		break;
+	}
+    }
+}
 
 static void dvb_handler(struct vbi *vbi, int fd)
 {
-	/* PES packet start code prefix and stream_id == private_stream_1 */
-	static const u_int8_t peshdr[4] = { 0x00, 0x00, 0x01, 0xbd };
-	u_int8_t *bp;
+	struct vbi_pes *pes = vbi->pes;
+	unsigned int pos = pes->head & (PES_RING_SIZE - 1);
+	unsigned int space = PES_RING_SIZE - (pes->head - pes->tail);
 	int n;
-	unsigned int p, i, len;
-        u_int16_t rpid;
-        u_int32_t crc, crccomp;
 
-	if (rawptr >= (unsigned int)rawbuf_size)
-		rawptr = 0;
-	n = read(vbi->fd, rawbuf + rawptr, rawbuf_size - rawptr);
+	// read straight into the ring, up to its end
+	n = read(vbi->fd, pes->ring + pos, min(space, PES_RING_SIZE - pos));
 	if (n <= 0)
 		return;
-	rawptr += n;
-	if (rawptr < 6)
+	pes->head += n;
+	dvb_parse_pes(vbi, pes);
+
+	// only a stream of garbage can fill the ring: drop it
+	if (pes->head - pes->tail == PES_RING_SIZE)
+		pes_reset(pes);
+}
+
+/*
+ * Feed one TS packet of the teletext PID, for callers which demultiplex a
+ * transport stream carrying several services themselves.
+ */
+void vbi_feed_ts(struct vbi *vbi, const u8 *pkt)
+{
+	struct vbi_pes *pes = vbi->pes;
+	unsigned int p = 4;
+	u8 cc;
+
+	if (pkt[0] != 0x47 || (pkt[1] & 0x80)) // sync lost or TEI
 		return;
-	if (memcmp(rawbuf, peshdr, sizeof(peshdr))) {
-		bp = memmem(rawbuf, rawptr, peshdr, sizeof(peshdr));
-		if (!bp)
-			return;
-		rawptr -= (bp - rawbuf);
-		memmove(rawbuf, bp, rawptr);
-		if (rawptr < 6)
-			return;
-	}
-	len = (rawbuf[4] << 8) | rawbuf[5];
-	if (len < 9) {
-		rawptr = 0;
+	if (not(pkt[3] & 0x10)) // no payload
 		return;
+
+	// a lost packet breaks the PES packet in progress
+	cc = pkt[3] & 0x0f;
+	if (cc != ((vbi->ts_cc + 1) & 0x0f) && pes->state != PES_SYNC)
+	{
+		pes_reset(pes);
+		out_of_sync(vbi);
 	}
-	if (rawptr < len + 6)
+	vbi->ts_cc = cc;
+
+	if (pkt[3] & 0x20) // adaptation field
+		p += 1 + pkt[4];
+	if (p >= TS_PACKET_SIZE)
 		return;
-	p = 9 + rawbuf[8];
-#if 0
-	for (i = 0; i < len - p; i++) {
-		if (!(i & 15))
-			printf("\n%04x:", i);
-		printf(" %02x", rawbuf[p + i]);
-	}
-	printf("\n");
-#endif
-	if (!dl_empty(vbi->clients))
-		dvb_handle_pes_payload(vbi, rawbuf + p, len - p);
-	rawptr -= len;
-	if (rawptr)
-		memmove(rawbuf, rawbuf + len, rawptr);
+
+	// payload_unit_start: a new PES packet begins here
+	if (pkt[1] & 0x40)
+		pes_reset(pes);
+	else if (pes->state == PES_SYNC)
+		return;
+
+	pes_write(pes, pkt + p, TS_PACKET_SIZE - p);
+	dvb_parse_pes(vbi, pes);
 }
 
 
@@ -636,6 +774,8 @@ static int vbi_dvb_open(struct vbi *vbi, const char *vbi_name,
 	unsigned int i, j, k, l, progcnt = 0;
 	struct dmx_pes_filter_params filterpar;
 
+	vbi->pes = NULL;
+
 	/* open DVB demux device */
 	if (!vbi_name)
 		vbi_name = "/dev/dvb/adapter0/demux0";
@@ -858,10 +998,9 @@ static int vbi_dvb_open(struct vbi *vbi, const char *vbi_name,
     vbi->ttpid = progp->ttpid;
 
  ttpidfound:
-	rawbuf = malloc(rawbuf_size = 8192);
-	if (!rawbuf)
+	vbi->pes = calloc(1, sizeof(*vbi->pes));
+	if (!vbi->pes)
 		goto outerr;
-	rawptr = 0;
 #if 0
 	close(vbi->fd);
 	if ((vbi->fd = open(vbi_name, O_RDWR)) == -1) {
@@ -884,6 +1023,8 @@ static int vbi_dvb_open(struct vbi *vbi, const char *vbi_name,
  outerr:
 	close(vbi->fd);
 	vbi->fd = -1;
+	free(vbi->pes);
+	vbi->pes = NULL;
 	return -1;
 }
 
@@ -912,6 +1053,7 @@ struct vbi *open_null_vbi(struct cache *ca)
 	}
 
     vbi->ttpid = -1;
+    vbi->pes = NULL;
     out_of_sync(vbi);
     vbi->ppage = vbi->rpage;
     fdset_add_fd(fds, vbi->fd, vbi_handler, vbi);
@@ -926,6 +1068,42 @@ fail1:
 }
 
 
+/*
+ * A vbi without a device of its own: the caller reads a transport stream
+ * and hands over the packets of ttpid with vbi_feed_ts().
+ */
+struct vbi *vbi_open_ts(struct cache *ca, int ttpid)
+{
+    static int inited = 0;
+    struct vbi *vbi;
+
+    if (not inited)
+    lang_init();
+    inited = 1;
+
+    if (not(vbi = malloc(sizeof(*vbi))))
+    {
+	error("out of memory");
+	return 0;
+    }
+    if (not(vbi->pes = calloc(1, sizeof(*vbi->pes))))
+    {
+	error("out of memory");
+	free(vbi);
+	return 0;
+    }
+    vbi->fd = -1;
+    vbi->cache = ca;
+    vbi->ttpid = ttpid;
+    vbi->sid = 0;
+    vbi->ts_cc = 0;
+    dl_init(vbi->clients);
+    out_of_sync(vbi);
+    vbi->ppage = vbi->rpage;
+    return vbi;
+}
+
+
 void send_errmsg(struct vbi *vbi, char *errmsg, ...)
 {
 	va_list args;
@@ -7,6 +7,9 @@
 #include "lang.h"
 
 #define PLL_ADJUST 4
+#define TS_PACKET_SIZE 188
+
+struct vbi_pes;
 
 struct raw_page
 {
@@ -25,6 +28,8 @@ struct vbi
     // DVB stuff
     unsigned int ttpid;
     u_int16_t sid;
+    struct vbi_pes *pes; // PES reassembly ring
+    u8 ts_cc; // continuity counter of the last TS packet
 };
 
 struct vbi_client
@@ -43,5 +48,7 @@ void vbi_del_handler(struct vbi *vbi, void *handler, void *data);
 struct vt_page *vbi_query_page(struct vbi *vbi, int pgno, int subno);
 
 struct vbi *open_null_vbi(struct cache *ca);
+struct vbi *vbi_open_ts(struct cache *ca, int ttpid);
+void vbi_feed_ts(struct vbi *vbi, const u8 *pkt);
 void send_errmsg(struct vbi *vbi, char *errmsg, ...);
 #endif
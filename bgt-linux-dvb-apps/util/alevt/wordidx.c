@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "vt.h"
+#include "misc.h"
+#include "dllist.h"
+#include "wordidx.h"
+
+
+void page_to_text(u8 *p, u8 *buf, int *line)
+{
+    int x, y, c, ch, gfx, hid = 0;
+
+    for (y = 1, p += 40; y < 25; ++y)
+    {
+	if (not hid)
+	{
+	    gfx = 0;
+	    for (x = 0; x < 40; ++x)
+	    {
+		c = ' ';
+		switch (ch = *p++)
+		{
+		    case 0x00 ... 0x07:
+			gfx = 0;
+			break;
+		    case 0x10 ... 0x17:
+			gfx = 1;
+			break;
+		    case 0x0c:
+			hid = 1;
+			break;
+		    case 0x7f:
+			c = '*';
+			break;
+		    case 0x20 ... 0x7e:
+			if (gfx && ch != ' ' && (ch & 0xa0) == 0x20)
+			    ch = '#';
+		    case 0xa0 ... 0xff:
+			c= ch;
+		}
+		*buf++ = c;
+	    }
+	    *buf++ = '\n';
+	    *line++ = y;
+	}
+	else
+	{
+	    p += 40;
+	    hid = 0;
+	}
+    }
+    *line = y;
+    *buf = 0;
+}
+
+
+/*
+ * Words are ASCII letters and digits only.  Anything regcomp could take as
+ * a word boundary then also splits words here, whatever the locale.
+ */
+int wordidx_char(int c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+	   (c >= 'A' && c <= 'Z');
+}
+
+
+int wordidx_lower(int c)
+{
+    if (c >= 'A' && c <= 'Z')
+	return c + 0x20;
+    return c;
+}
+
+
+static inline int hash(u8 *text)
+{
+    u32 h = 2166136261u;
+
+    while (*text)
+	h = (h ^ *text++) * 16777619u;
+    return h & (WIDX_HASH_SIZE - 1);
+}
+
+
+static struct word * word_find(struct word_index *wi, u8 *text, int h)
+{
+    struct word *w;
+
+    for (w = wi->hash[h]; w; w = w->next)
+	if (streq(PTR w->text, PTR text))
+	    return w;
+    return 0;
+}
+
+
+static struct word * word_get(struct word_index *wi, u8 *text)
+{
+    struct word *w;
+    int h = hash(text);
+
+    if (w = word_find(wi, text, h))
+	return w;
+
+    if (not(w = malloc(sizeof(*w))))
+	return 0;
+    dl_init(w->posts);
+    w->count = 0;
+    w->mark = 0;
+    strcpy(PTR w->text, PTR text);
+    w->next = wi->hash[h];
+    wi->hash[h] = w;
+    wi->nwords++;
+    return w;
+}
+
+
+static void word_free(struct word_index *wi, struct word *w)
+{
+    struct word **wp;
+
+    for (wp = &wi->hash[hash(w->text)]; *wp; wp = &(*wp)->next)
+	if (*wp == w)
+	{
+	    *wp = w->next;
+	    break;
+	}
+    free(w);
+    wi->nwords--;
+}
+
+
+struct word_index * wordidx_open(void)
+{
+    struct word_index *wi;
+
+    if (not(wi = malloc(sizeof(*wi))))
+	return 0;
+    memset(wi, 0, sizeof(*wi));
+    return wi;
+}
+
+
+void wordidx_close(struct word_index *wi)
+{
+    struct word *w, *wn;
+    int i;
+
+    // the pages free their posts; only words without pages are left
+    for (i = 0; i < WIDX_HASH_SIZE; ++i)
+	for (w = wi->hash[i]; w; w = wn)
+	{
+	    wn = w->next;
+	    free(w);
+	}
+    free(wi);
+}
+
+
+void wordidx_remove(struct word_index *wi, struct word_post **posts)
+{
+    struct word_post *wp;
+
+    while (wp = *posts)
+    {
+	*posts = wp->next;
+	dl_remove(wp->node);
+	if (--wp->word->count == 0)
+	    word_free(wi, wp->word);
+	free(wp);
+	wi->nposts--;
+    }
+}
+
+
+void wordidx_update(struct word_index *wi, struct word_post **posts,
+	struct vt_page *vtp)
+{
+    struct timeval t0, t1;
+    u8 buf[H * (W+1) + 1];
+    int line[H];
+    u8 text[WORD_MAX + 1];
+    struct word_post *wp;
+    struct word *w;
+    u8 *p;
+    int len;
+
+    gettimeofday(&t0, 0);
+    wordidx_remove(wi, posts);
+    page_to_text(PTR vtp->data, buf, line);
+
+    for (p = buf; *p; )
+    {
+	if (not wordidx_char(*p))
+	{
+	    p++;
+	    continue;
+	}
+	for (len = 0; wordidx_char(*p); p++)
+	    if (len < WORD_MAX)
+		text[len++] = wordidx_lower(*p);
+	text[len] = 0;
+	if (len < WORD_MIN)
+	    continue;
+
+	if (not(w = word_get(wi, text)))
+	    break;
+	if (w->mark == vtp) // already have it for this page
+	    continue;
+	if (not(wp = malloc(sizeof(*wp))))
+	{
+	    if (w->count == 0)
+		word_free(wi, w);
+	    break;
+	}
+	w->mark = vtp;
+	w->count++;
+	wp->word = w;
+	wp->page = vtp;
+	dl_insert_last(w->posts, wp->node);
+	wp->next = *posts;
+	*posts = wp;
+	wi->nposts++;
+    }
+    for (wp = *posts; wp; wp = wp->next)
+	wp->word->mark = 0;
+
+    gettimeofday(&t1, 0);
+    wi->last_usecs = (t1.tv_sec - t0.tv_sec) * 1000000 + t1.tv_usec - t0.tv_usec;
+    wi->usecs += wi->last_usecs;
+    wi->updates++;
+}
+
+
+static void word_pages(struct word *w,
+	void (*func)(void *data, struct vt_page *vtp), void *data)
+{
+    struct word_post *wp;
+
+    for (wp = PTR w->posts->first; wp->node->next; wp = PTR wp->node->next)
+	func(data, wp->page);
+}
+
+
+void wordidx_lookup(struct word_index *wi, u8 *word, int exact,
+	void (*func)(void *data, struct vt_page *vtp), void *data)
+{
+    struct word *w;
+    int i;
+
+    if (exact)
+    {
+	if (w = word_find(wi, word, hash(word)))
+	    word_pages(w, func, data);
+	return;
+    }
+
+    // substring: look through the words, not the pages
+    for (i = 0; i < WIDX_HASH_SIZE; ++i)
+	for (w = wi->hash[i]; w; w = w->next)
+	    if (strstr(PTR w->text, PTR word))
+		word_pages(w, func, data);
+}
@@ -0,0 +1,70 @@
+#ifndef WORDIDX_H
+#define WORDIDX_H
+
+#include "vt.h"
+#include "misc.h"
+#include "dllist.h"
+
+#define WORD_MIN 2
+#define WORD_MAX W // a whole row: words are never cut
+#define WIDX_HASH_SIZE 4096
+
+/*
+ * Inverted index from the words on the cached pages to the pages, kept up
+ * to date by cache_put so that a search only has to look at the pages
+ * containing its keyword.
+ */
+
+struct word
+{
+    struct word *next; // hash chain
+    struct dl_head posts[1]; // word_post.node of every page with this word
+    int count; // number of pages
+    struct vt_page *mark; // page being indexed, to skip repeats
+    u8 text[WORD_MAX + 1]; // lower case
+};
+
+
+struct word_post
+{
+    struct dl_node node[1]; // in word->posts
+    struct word_post *next; // next word of the same page
+    struct word *word;
+    struct vt_page *page;
+};
+
+
+struct word_index
+{
+    struct word *hash[WIDX_HASH_SIZE];
+    int nwords; // distinct words
+    int nposts;
+    // update cost
+    unsigned long updates; // pages (re)indexed
+    unsigned long unchanged; // puts which did not change the text
+    unsigned long long usecs; // total time spent indexing
+    unsigned int last_usecs; // time for the last page
+};
+
+
+struct word_index *wordidx_open(void);
+void wordidx_close(struct word_index *wi);
+
+// (re)index a page; *posts is the page's list of words
+void wordidx_update(struct word_index *wi, struct word_post **posts,
+	struct vt_page *vtp);
+void wordidx_remove(struct word_index *wi, struct word_post **posts);
+
+/*
+ * Call func for every page containing the word (exact) or a word with it as
+ * a substring (not exact).  The word must be lower case.
+ */
+void wordidx_lookup(struct word_index *wi, u8 *word, int exact,
+	void (*func)(void *data, struct vt_page *vtp), void *data);
+
+int wordidx_char(int c);
+int wordidx_lower(int c);
+
+// rows 1-24 as text, one line of W chars + '\n' each; line[] gets the row numbers
+void page_to_text(u8 *p, u8 *buf, int *line);
+#endif
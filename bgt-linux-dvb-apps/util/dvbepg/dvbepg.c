@@ -0,0 +1,490 @@
+/*
+	dvbepg utility
+
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/poll.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <libdvbapi/dvbdemux.h>
+#include <libdvbepg/dvbepg_store.h>
+#include <libucsi/section.h>
+#include <libucsi/section_buf.h>
+#include <libucsi/transport_packet.h>
+#include "dvbepg_pipeline.h"
+
+#define EIT_PID 0x12
+#define DEMUX_BUFFER_SIZE (1024 * 1024)
+
+struct demux_source {
+	int fd;
+	int timeout;
+	struct timeval start;
+};
+
+struct file_source {
+	uint8_t *data;		/* the sections, back to back */
+	int len;
+	int count;
+	int pos;
+	int loops;
+};
+
+static void signal_handler(int _signal);
+static int demux_read(void *arg, uint8_t *buf, int size);
+static int file_read(void *arg, uint8_t *buf, int size);
+static int file_load(struct file_source *source, char *filename, int pid);
+static void print_stats(struct dvbepg_stats *stats, int workers);
+static void store_section(void *arg, struct dvbepg_section *section);
+static void list_events(struct dvbepg_store *store);
+
+static volatile int quit_app = 0;
+
+void usage(void)
+{
+	static const char *_usage = "\n"
+		" dvbepg: Collect the EIT, decoding sections on several threads\n"
+		" Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)\n\n"
+		" usage: dvbepg <options> as follows:\n"
+		" -h			help\n"
+		" -adapter <id>		adapter to use (default 0)\n"
+		" -demux <id>		demux to use (default 0)\n"
+		" -pid <pid>		PID to collect from (default 0x12)\n"
+		" -timeout <secs>	Number of seconds to collect for (default is until interrupted)\n"
+		" -file <filename>	Collect from a TS capture instead of the demux\n"
+		" -loops <count>		Number of times to replay the capture (default 1)\n"
+		" -workers <count>	Number of decode workers, 0 to do everything in one\n"
+		"			thread (default is one per CPU)\n"
+		" -compare		Replay the capture with 0 workers as well, and print\n"
+		"			the speedup\n"
+		" -snapshot <filename>	Start from the events saved in the snapshot, and save\n"
+		"			them there again when done\n"
+		" -list			List the events collected\n";
+	fprintf(stderr, "%s\n", _usage);
+
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	int adapter_id = 0;
+	int demux_id = 0;
+	int pid = EIT_PID;
+	int timeout = -1;
+	char *filename = NULL;
+	char *snapshot = NULL;
+	int loops = 1;
+	int workers = -1;
+	int compare = 0;
+	int list = 0;
+	int argpos = 1;
+	struct demux_source demux_source;
+	struct file_source file_source;
+	struct dvbepg_store *store;
+	struct dvbepg_store_stats store_stats;
+	struct dvbepg_stats stats;
+	struct dvbepg_stats inline_stats;
+	uint8_t filter[18];
+	uint8_t mask[18];
+	int result;
+
+	while(argpos != argc) {
+		if (!strcmp(argv[argpos], "-h")) {
+			usage();
+		} else if (!strcmp(argv[argpos], "-adapter")) {
+			if ((argc - argpos) < 2)
+				usage();
+			if (sscanf(argv[argpos+1], "%i", &adapter_id) != 1)
+				usage();
+			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-demux")) {
+			if ((argc - argpos) < 2)
+				usage();
+			if (sscanf(argv[argpos+1], "%i", &demux_id) != 1)
+				usage();
+			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-pid")) {
+			if ((argc - argpos) < 2)
+				usage();
+			if ((sscanf(argv[argpos+1], "%i", &pid) != 1) ||
+			    (pid < 0) || (pid >= TRANSPORT_MAX_PIDS))
+				usage();
+			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-timeout")) {
+			if ((argc - argpos) < 2)
+				usage();
+			if (sscanf(argv[argpos+1], "%i", &timeout) != 1)
+				usage();
+			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-file")) {
+			if ((argc - argpos) < 2)
+				usage();
+			filename = argv[argpos+1];
+			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-loops")) {
+			if ((argc - argpos) < 2)
+				usage();
+			if ((sscanf(argv[argpos+1], "%i", &loops) != 1) || (loops < 1))
+				usage();
+			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-workers")) {
+			if ((argc - argpos) < 2)
+				usage();
+			if ((sscanf(argv[argpos+1], "%i", &workers) != 1) || (workers < 0))
+				usage();
+			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-compare")) {
+			compare = 1;
+			argpos++;
+		} else if (!strcmp(argv[argpos], "-snapshot")) {
+			if ((argc - argpos) < 2)
+				usage();
+			snapshot = argv[argpos+1];
+			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-list")) {
+			list = 1;
+			argpos++;
+		} else {
+			usage();
+		}
+	}
+	if (compare && (filename == NULL)) {
+		fprintf(stderr, "-compare needs -file\n");
+		exit(1);
+	}
+	if (workers < 0) {
+		workers = sysconf(_SC_NPROCESSORS_ONLN);
+		if (workers < 1)
+			workers = 1;
+	}
+
+	// the source
+	memset(&demux_source, 0, sizeof(demux_source));
+	memset(&file_source, 0, sizeof(file_source));
+	if (filename) {
+		if (file_load(&file_source, filename, pid))
+			exit(1);
+		if (file_source.count == 0) {
+			fprintf(stderr, "No sections found on PID 0x%04x of %s\n", pid, filename);
+			exit(1);
+		}
+		fprintf(stderr, "%i sections (%i bytes) on PID 0x%04x, replayed %i times\n",
+			file_source.count, file_source.len, pid, loops);
+	} else {
+		if ((demux_source.fd = dvbdemux_open_demux(adapter_id, demux_id, 0)) < 0) {
+			fprintf(stderr, "Failed to open demux\n");
+			exit(1);
+		}
+		if (dvbdemux_set_buffer(demux_source.fd, DEMUX_BUFFER_SIZE))
+			fprintf(stderr, "Failed to set demux buffer size\n");
+
+		// the CRC is checked by the workers
+		memset(filter, 0, sizeof(filter));
+		memset(mask, 0, sizeof(mask));
+		if (dvbdemux_set_section_filter(demux_source.fd, pid, filter, mask, 1, 0)) {
+			fprintf(stderr, "Failed to set section filter\n");
+			exit(1);
+		}
+		demux_source.timeout = timeout;
+		gettimeofday(&demux_source.start, NULL);
+	}
+
+	signal(SIGINT, signal_handler);
+	signal(SIGTERM, signal_handler);
+
+	// the single threaded run to compare with
+	if (compare) {
+		if ((store = dvbepg_store_create()) == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		file_source.loops = loops;
+		dvbepg_pipeline_run(0, file_read, &file_source,
+				    store_section, store, &quit_app, &inline_stats);
+		print_stats(&inline_stats, 0);
+		dvbepg_store_destroy(store);
+	}
+
+	store = NULL;
+	if (snapshot && ((store = dvbepg_store_load(snapshot)) != NULL)) {
+		dvbepg_store_get_stats(store, &store_stats);
+		fprintf(stderr, "snapshot: %u events of %u services\n",
+			store_stats.events, store_stats.services);
+	}
+	if ((store == NULL) && ((store = dvbepg_store_create()) == NULL)) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	if (filename) {
+		file_source.pos = 0;
+		file_source.loops = loops;
+		result = dvbepg_pipeline_run(workers, file_read, &file_source,
+					     store_section, store, &quit_app, &stats);
+	} else {
+		result = dvbepg_pipeline_run(workers, demux_read, &demux_source,
+					     store_section, store, &quit_app, &stats);
+		close(demux_source.fd);
+	}
+	if (result) {
+		dvbepg_store_destroy(store);
+		exit(1);
+	}
+	print_stats(&stats, workers);
+
+	dvbepg_store_get_stats(store, &store_stats);
+	fprintf(stderr, "store: %u events of %u services, %u bytes of strings "
+		"(%u added, %u updated, %u unchanged, %u overlapped)\n",
+		store_stats.events, store_stats.services, store_stats.string_bytes,
+		store_stats.added, store_stats.updated,
+		store_stats.unchanged, store_stats.overlapped);
+	if (compare && (stats.elapsed > 0))
+		fprintf(stderr, "speedup: %.2fx\n", inline_stats.elapsed / stats.elapsed);
+
+	if (list)
+		list_events(store);
+	if (snapshot && dvbepg_store_save(store, snapshot))
+		fprintf(stderr, "Failed to save snapshot %s\n", snapshot);
+
+	dvbepg_store_destroy(store);
+	free(file_source.data);
+	return 0;
+}
+
+static void signal_handler(int _signal)
+{
+	(void) _signal;
+
+	quit_app = 1;
+}
+
+static void store_section(void *arg, struct dvbepg_section *section)
+{
+	struct dvbepg_store *store = arg;
+	struct dvbepg_event *event;
+	struct dvbepg_service_key key;
+	int i;
+
+	if (section->status != DVBEPG_SECTION_OK)
+		return;
+
+	for(i=0; i < section->event_count; i++) {
+		event = &section->events[i];
+
+		key.original_network_id = event->original_network_id;
+		key.transport_stream_id = event->transport_stream_id;
+		key.service_id = event->service_id;
+		dvbepg_store_add_event(store, &key, event->table_id, event->version,
+				       event->event_id, event->start_time, event->duration,
+				       event->title, event->text);
+	}
+}
+
+static void list_events(struct dvbepg_store *store)
+{
+	struct dvbepg_service_key key;
+	struct dvbepg_event_info *events;
+	struct tm tm;
+	char start[32];
+	int services;
+	int count;
+	int i, j;
+
+	services = dvbepg_store_service_count(store);
+	for(i=0; i < services; i++) {
+		dvbepg_store_service_key(store, i, &key);
+
+		count = dvbepg_store_range(store, &key, 0, 0xffffffffLL, NULL, 0);
+		if (count <= 0)
+			continue;
+		if ((events = malloc(count * sizeof(struct dvbepg_event_info))) == NULL)
+			return;
+		dvbepg_store_range(store, &key, 0, 0xffffffffLL, events, count);
+
+		for(j=0; j < count; j++) {
+			gmtime_r(&events[j].start_time, &tm);
+			strftime(start, sizeof(start), "%Y-%m-%d %H:%M", &tm);
+			printf("%04x:%04x:%04x %5i %s %4im %s\n",
+			       key.original_network_id, key.transport_stream_id, key.service_id,
+			       events[j].event_id, start, events[j].duration / 60,
+			       events[j].title);
+		}
+		free(events);
+	}
+}
+
+static void print_stats(struct dvbepg_stats *stats, int workers)
+{
+	double elapsed = stats->elapsed > 0 ? stats->elapsed : 1e-9;
+
+	fprintf(stderr, "%i workers: %llu sections (%llu CRC errors, %llu invalid, %llu other tables), "
+		"%llu events in %.3fs\n",
+		workers,
+		(unsigned long long) stats->sections,
+		(unsigned long long) stats->crc_errors,
+		(unsigned long long) stats->invalid,
+		(unsigned long long) stats->not_eit,
+		(unsigned long long) stats->events,
+		stats->elapsed);
+	fprintf(stderr, "%i workers: %.0f sections/sec, %.0f events/sec",
+		workers, stats->sections / elapsed, stats->events / elapsed);
+	if (workers)
+		fprintf(stderr, " (reader waited %llu times, store %llu times)",
+			(unsigned long long) stats->reader_waits,
+			(unsigned long long) stats->store_waits);
+	fprintf(stderr, "\n");
+}
+
+static int demux_read(void *arg, uint8_t *buf, int size)
+{
+	struct demux_source *source = arg;
+	struct pollfd pollfd;
+	struct timeval now;
+	int count;
+
+	if (source->timeout >= 0) {
+		gettimeofday(&now, NULL);
+		if ((now.tv_sec - source->start.tv_sec) >= source->timeout)
+			return -1;
+	}
+
+	pollfd.fd = source->fd;
+	pollfd.events = POLLIN|POLLPRI|POLLERR;
+	if (poll(&pollfd, 1, 100) != 1)
+		return 0;
+
+	// the section filter API gives us one full section per read()
+	if ((count = read(source->fd, buf, size)) < 0) {
+		if ((errno == EOVERFLOW) || (errno == EINTR) || (errno == EAGAIN))
+			return 0;
+		fprintf(stderr, "Demux read error: %m\n");
+		return -1;
+	}
+	return count;
+}
+
+static int file_read(void *arg, uint8_t *buf, int size)
+{
+	struct file_source *source = arg;
+	int len;
+
+	if (source->pos >= source->len) {
+		if (--source->loops <= 0)
+			return -1;
+		source->pos = 0;
+	}
+
+	len = section_raw_length(source->data + source->pos);
+	if (len > size)
+		return -1;
+	memcpy(buf, source->data + source->pos, len);
+	source->pos += len;
+
+	return len;
+}
+
+static int file_load(struct file_source *source, char *filename, int pid)
+{
+	uint8_t databuf[TRANSPORT_PACKET_LENGTH*20];
+	int fd;
+	int sz;
+	int i;
+	int used;
+	int section_status;
+	int max = 0;
+	unsigned char continuity = 0;
+	struct section_buf *section_buf;
+	struct transport_packet *tspkt;
+	struct transport_values tsvals;
+	uint8_t *data;
+
+	if ((fd = open(filename, O_RDONLY)) < 0) {
+		fprintf(stderr, "Unable to open file %s\n", filename);
+		return -1;
+	}
+
+	section_buf = (struct section_buf*) malloc(sizeof(struct section_buf) + DVB_MAX_SECTION_BYTES);
+	if (section_buf == NULL) {
+		fprintf(stderr, "Failed to allocate section buf\n");
+		close(fd);
+		return -1;
+	}
+	section_buf_init(section_buf, DVB_MAX_SECTION_BYTES);
+
+	while((sz = read(fd, databuf, sizeof(databuf))) > 0) {
+		for(i=0; (i + TRANSPORT_PACKET_LENGTH) <= sz; i+=TRANSPORT_PACKET_LENGTH) {
+			tspkt = transport_packet_init(databuf + i);
+			if (tspkt == NULL)
+				continue;
+			if (transport_packet_pid(tspkt) != pid)
+				continue;
+			if (transport_packet_values_extract(tspkt, &tsvals, 0) < 0)
+				continue;
+
+			if (transport_packet_continuity_check(tspkt,
+			    tsvals.flags & transport_adaptation_flag_discontinuity,
+			    &continuity)) {
+				continuity = 0;
+				section_buf_reset(section_buf);
+				continue;
+			}
+
+			while(tsvals.payload_length) {
+				used = section_buf_add_transport_payload(section_buf,
+									 tsvals.payload,
+									 tsvals.payload_length,
+									 tspkt->payload_unit_start_indicator,
+									 &section_status);
+				tspkt->payload_unit_start_indicator = 0;
+				tsvals.payload_length -= used;
+				tsvals.payload += used;
+
+				if (section_status == 1) {
+					// keep the raw section, as the demux would deliver it
+					if ((source->len + (int) section_buf->len) > max) {
+						max = max ? max * 2 : 1024 * 1024;
+						if ((data = realloc(source->data, max)) == NULL) {
+							fprintf(stderr, "Out of memory\n");
+							free(section_buf);
+							close(fd);
+							return -1;
+						}
+						source->data = data;
+					}
+					memcpy(source->data + source->len, section_buf_data(section_buf), section_buf->len);
+					source->len += section_buf->len;
+					source->count++;
+					section_buf_reset(section_buf);
+				} else if (section_status < 0) {
+					section_buf_reset(section_buf);
+				}
+			}
+		}
+	}
+
+	free(section_buf);
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,488 @@
+/*
+	dvbepg utility
+
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <libucsi/crc32.h>
+#include <libucsi/section.h>
+#include <libucsi/dvb/section.h>
+#include <libucsi/dvb/descriptor.h>
+#include <libucsi/dvb/text.h>
+#include "dvbepg_pipeline.h"
+
+#define CACHE_LINE 64
+
+/* slots per worker; the rings are sized so they can never overflow */
+#define SLOTS_PER_WORKER 64
+
+#define SPIN_WAITS 100
+#define YIELD_WAITS 200
+#define SLEEP_US 100
+
+struct dvbepg_ring {
+	uint32_t head;			/* written by the producer only */
+	uint8_t pad1[CACHE_LINE - sizeof(uint32_t)];
+	uint32_t tail;			/* written by the consumer only */
+	uint8_t pad2[CACHE_LINE - sizeof(uint32_t)];
+	uint32_t mask;
+	struct dvbepg_section **slots;
+};
+
+struct dvbepg_worker {
+	struct dvbepg_pipeline *pipeline;
+	pthread_t thread;
+	struct dvbepg_ring in;
+	struct dvbepg_ring out;
+	struct dvb_text_decoder *decoder;
+};
+
+struct dvbepg_pipeline {
+	int workers;
+	struct dvbepg_worker worker[DVBEPG_MAX_WORKERS];
+	struct dvbepg_ring free;
+
+	struct dvbepg_section *sections;
+	int section_count;
+
+	dvbepg_read_callback read_cb;
+	void *read_arg;
+	volatile int *quit;
+
+	pthread_t reader;
+	int reader_done;
+	uint64_t total;			/* sections read, valid once reader_done is set */
+	uint64_t reader_waits;
+};
+
+static int ring_init(struct dvbepg_ring *ring, int size);
+static int ring_push(struct dvbepg_ring *ring, struct dvbepg_section *section);
+static struct dvbepg_section *ring_pop(struct dvbepg_ring *ring);
+static void wait_backoff(int *waits);
+static void *reader_thread(void *arg);
+static void *worker_thread(void *arg);
+static void decode_section(struct dvb_text_decoder *decoder, struct dvbepg_section *section);
+static void account(struct dvbepg_stats *stats, struct dvbepg_section *section);
+static void pipeline_free(struct dvbepg_pipeline *p);
+static int run_inline(dvbepg_read_callback read_cb, void *read_arg,
+		      dvbepg_store_callback store_cb, void *store_arg,
+		      volatile int *quit, struct dvbepg_stats *stats);
+static double now(void);
+
+int dvbepg_pipeline_run(int workers,
+			dvbepg_read_callback read_cb, void *read_arg,
+			dvbepg_store_callback store_cb, void *store_arg,
+			volatile int *quit,
+			struct dvbepg_stats *stats)
+{
+	struct dvbepg_pipeline *p;
+	struct dvbepg_section *section;
+	uint64_t next = 0;
+	int waits = 0;
+	int started = 0;
+	int i;
+	double start;
+
+	memset(stats, 0, sizeof(struct dvbepg_stats));
+	if (workers <= 0)
+		return run_inline(read_cb, read_arg, store_cb, store_arg, quit, stats);
+	if (workers > DVBEPG_MAX_WORKERS)
+		workers = DVBEPG_MAX_WORKERS;
+
+	if ((p = malloc(sizeof(struct dvbepg_pipeline))) == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+	memset(p, 0, sizeof(struct dvbepg_pipeline));
+	p->workers = workers;
+	p->read_cb = read_cb;
+	p->read_arg = read_arg;
+	p->quit = quit;
+
+	// the slots, all free to start with
+	p->section_count = workers * SLOTS_PER_WORKER;
+	if ((p->sections = calloc(p->section_count, sizeof(struct dvbepg_section))) == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		goto fail;
+	}
+	if (ring_init(&p->free, p->section_count))
+		goto fail;
+	for(i=0; i < p->section_count; i++)
+		ring_push(&p->free, &p->sections[i]);
+
+	for(i=0; i < workers; i++) {
+		p->worker[i].pipeline = p;
+		if (ring_init(&p->worker[i].in, SLOTS_PER_WORKER) ||
+		    ring_init(&p->worker[i].out, p->section_count))
+			goto fail;
+		if ((p->worker[i].decoder = dvb_text_decoder_create(NULL)) == NULL) {
+			fprintf(stderr, "Failed to create text decoder\n");
+			goto fail;
+		}
+	}
+
+	start = now();
+	for(started=0; started < workers; started++) {
+		if (pthread_create(&p->worker[started].thread, NULL, worker_thread, &p->worker[started])) {
+			fprintf(stderr, "Failed to create worker thread\n");
+			goto stop;
+		}
+	}
+	if (pthread_create(&p->reader, NULL, reader_thread, p)) {
+		fprintf(stderr, "Failed to create reader thread\n");
+		goto stop;
+	}
+
+	// the store stage: take the sections back in the order they were dealt
+	while(1) {
+		section = ring_pop(&p->worker[next % workers].out);
+		if (section) {
+			store_cb(store_arg, section);
+			account(stats, section);
+			ring_push(&p->free, section);
+			next++;
+			waits = 0;
+			continue;
+		}
+
+		if (__atomic_load_n(&p->reader_done, __ATOMIC_ACQUIRE) && (next == p->total))
+			break;
+		stats->store_waits++;
+		wait_backoff(&waits);
+	}
+
+	pthread_join(p->reader, NULL);
+	for(i=0; i < workers; i++)
+		pthread_join(p->worker[i].thread, NULL);
+	stats->elapsed = now() - start;
+	stats->reader_waits = p->reader_waits;
+
+	pipeline_free(p);
+	return 0;
+
+stop:
+	// let the started workers see an empty, finished input
+	__atomic_store_n(&p->reader_done, 1, __ATOMIC_RELEASE);
+	for(i=0; i < started; i++)
+		pthread_join(p->worker[i].thread, NULL);
+fail:
+	pipeline_free(p);
+	return -1;
+}
+
+static void *reader_thread(void *arg)
+{
+	struct dvbepg_pipeline *p = arg;
+	struct dvbepg_section *section;
+	struct dvbepg_ring *ring;
+	uint64_t seq = 0;
+	int waits = 0;
+	int len;
+
+	while(!*p->quit) {
+		if ((section = ring_pop(&p->free)) == NULL) {
+			p->reader_waits++;
+			wait_backoff(&waits);
+			continue;
+		}
+		waits = 0;
+
+		while(!*p->quit && ((len = p->read_cb(p->read_arg, section->buf, sizeof(section->buf))) == 0))
+			;
+		// the store stage is the only producer on the free ring, so the
+		// unused slot is just left out; pipeline_free() releases it
+		if (*p->quit || (len < 0))
+			break;
+		section->len = len;
+		section->seq = seq;
+
+		ring = &p->worker[seq % p->workers].in;
+		while(ring_push(ring, section)) {
+			p->reader_waits++;
+			wait_backoff(&waits);
+		}
+		waits = 0;
+		seq++;
+	}
+
+	p->total = seq;
+	__atomic_store_n(&p->reader_done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void *worker_thread(void *arg)
+{
+	struct dvbepg_worker *w = arg;
+	struct dvbepg_section *section;
+	int waits = 0;
+
+	while(1) {
+		if ((section = ring_pop(&w->in)) == NULL) {
+			if (__atomic_load_n(&w->pipeline->reader_done, __ATOMIC_ACQUIRE)) {
+				// anything pushed before the flag was set is visible now
+				if ((section = ring_pop(&w->in)) == NULL)
+					break;
+			} else {
+				wait_backoff(&waits);
+				continue;
+			}
+		}
+		waits = 0;
+
+		decode_section(w->decoder, section);
+
+		// out has room for every slot, so this cannot fail
+		ring_push(&w->out, section);
+	}
+
+	return NULL;
+}
+
+static int run_inline(dvbepg_read_callback read_cb, void *read_arg,
+		      dvbepg_store_callback store_cb, void *store_arg,
+		      volatile int *quit, struct dvbepg_stats *stats)
+{
+	struct dvbepg_section *section;
+	struct dvb_text_decoder *decoder;
+	double start;
+	int len = 0;
+
+	if ((section = calloc(1, sizeof(struct dvbepg_section))) == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+	if ((decoder = dvb_text_decoder_create(NULL)) == NULL) {
+		fprintf(stderr, "Failed to create text decoder\n");
+		free(section);
+		return -1;
+	}
+
+	start = now();
+	while(!*quit) {
+		if ((len = read_cb(read_arg, section->buf, sizeof(section->buf))) == 0)
+			continue;
+		if (len < 0)
+			break;
+		section->len = len;
+
+		decode_section(decoder, section);
+		store_cb(store_arg, section);
+		account(stats, section);
+		section->seq++;
+	}
+	stats->elapsed = now() - start;
+
+	dvb_text_decoder_destroy(decoder);
+	free(section->events);
+	free(section);
+	return 0;
+}
+
+static void decode_section(struct dvb_text_decoder *decoder, struct dvbepg_section *section)
+{
+	struct section *sec;
+	struct section_ext *ext;
+	struct dvb_eit_section *eit;
+	struct dvb_eit_event *cur_event;
+	struct descriptor *curd;
+	struct dvbepg_event *event;
+	uint8_t table_id;
+
+	section->event_count = 0;
+
+	if (section->len < 3) {
+		section->status = DVBEPG_SECTION_INVALID;
+		return;
+	}
+	table_id = section->buf[0];
+	if ((table_id < stag_dvb_event_information_nownext_actual) ||
+	    (table_id > (stag_dvb_event_information_schedule_other + 0x0f))) {
+		section->status = DVBEPG_SECTION_NOT_EIT;
+		return;
+	}
+	if (crc32(CRC32_INIT, section->buf, section->len)) {
+		section->status = DVBEPG_SECTION_CRC;
+		return;
+	}
+
+	section->status = DVBEPG_SECTION_INVALID;
+	if ((sec = section_codec(section->buf, section->len)) == NULL)
+		return;
+	if ((ext = section_ext_decode(sec, 0)) == NULL)
+		return;
+	if ((eit = dvb_eit_section_codec(ext)) == NULL)
+		return;
+	section->status = DVBEPG_SECTION_OK;
+
+	dvb_eit_section_events_for_each(eit, cur_event) {
+		if (section->event_count == section->event_max) {
+			int max = section->event_max ? section->event_max * 2 : 16;
+			struct dvbepg_event *events = realloc(section->events, max * sizeof(struct dvbepg_event));
+
+			if (events == NULL)
+				break;
+			section->events = events;
+			section->event_max = max;
+		}
+		event = &section->events[section->event_count++];
+
+		event->original_network_id = eit->original_network_id;
+		event->transport_stream_id = eit->transport_stream_id;
+		event->service_id = dvb_eit_section_service_id(eit);
+		event->event_id = cur_event->event_id;
+		event->table_id = table_id;
+		event->version = ext->version_number;
+		event->running_status = cur_event->running_status;
+		event->start_time = dvbdate_to_unixtime(cur_event->start_time);
+		event->duration = dvbduration_to_seconds(cur_event->duration);
+		event->title[0] = 0;
+		event->text[0] = 0;
+
+		dvb_eit_event_descriptors_for_each(cur_event, curd) {
+			struct dvb_short_event_descriptor *dx;
+			struct dvb_short_event_descriptor_part2 *part2;
+
+			if (curd->tag != dtag_dvb_short_event)
+				continue;
+			if ((dx = dvb_short_event_descriptor_codec(curd)) == NULL)
+				continue;
+			part2 = dvb_short_event_descriptor_part2(dx);
+
+			if (dvb_text_decode(decoder,
+					    dvb_short_event_descriptor_event_name(dx), dx->event_name_length,
+					    event->title, sizeof(event->title), 0) < 0)
+				event->title[0] = 0;
+			if (dvb_text_decode(decoder,
+					    dvb_short_event_descriptor_text(part2), part2->text_length,
+					    event->text, sizeof(event->text), 0) < 0)
+				event->text[0] = 0;
+			break;
+		}
+	}
+}
+
+static void account(struct dvbepg_stats *stats, struct dvbepg_section *section)
+{
+	stats->sections++;
+	switch(section->status) {
+	case DVBEPG_SECTION_OK:
+		stats->events += section->event_count;
+		break;
+	case DVBEPG_SECTION_CRC:
+		stats->crc_errors++;
+		break;
+	case DVBEPG_SECTION_INVALID:
+		stats->invalid++;
+		break;
+	case DVBEPG_SECTION_NOT_EIT:
+		stats->not_eit++;
+		break;
+	}
+}
+
+static int ring_init(struct dvbepg_ring *ring, int size)
+{
+	uint32_t ring_size = 1;
+
+	while(ring_size < (uint32_t) size)
+		ring_size <<= 1;
+
+	ring->head = 0;
+	ring->tail = 0;
+	ring->mask = ring_size - 1;
+	if ((ring->slots = calloc(ring_size, sizeof(struct dvbepg_section *))) == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * The release store of an index publishes everything written before it:
+ * the slot, and the section it points to. The acquire load on the other
+ * side makes them visible before they are used.
+ */
+static int ring_push(struct dvbepg_ring *ring, struct dvbepg_section *section)
+{
+	uint32_t head = ring->head;
+
+	if ((head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) > ring->mask)
+		return -1;
+
+	ring->slots[head & ring->mask] = section;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static struct dvbepg_section *ring_pop(struct dvbepg_ring *ring)
+{
+	uint32_t tail = ring->tail;
+	struct dvbepg_section *section;
+
+	if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	section = ring->slots[tail & ring->mask];
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	return section;
+}
+
+static void wait_backoff(int *waits)
+{
+	(*waits)++;
+	if (*waits < SPIN_WAITS)
+		return;
+	if (*waits < YIELD_WAITS)
+		sched_yield();
+	else
+		usleep(SLEEP_US);
+}
+
+static void pipeline_free(struct dvbepg_pipeline *p)
+{
+	int i;
+
+	for(i=0; i < p->workers; i++) {
+		free(p->worker[i].in.slots);
+		free(p->worker[i].out.slots);
+		if (p->worker[i].decoder)
+			dvb_text_decoder_destroy(p->worker[i].decoder);
+	}
+	free(p->free.slots);
+	if (p->sections) {
+		for(i=0; i < p->section_count; i++)
+			free(p->sections[i].events);
+		free(p->sections);
+	}
+	free(p);
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
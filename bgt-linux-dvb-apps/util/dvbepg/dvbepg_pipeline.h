@@ -0,0 +1,115 @@
+/*
+	dvbepg utility
+
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef DVBEPG_PIPELINE_H
+#define DVBEPG_PIPELINE_H 1
+
+#include <stdint.h>
+#include <time.h>
+
+#define DVBEPG_MAX_WORKERS 32
+#define DVBEPG_MAX_SECTION 4096
+#define DVBEPG_MAX_TITLE 256
+#define DVBEPG_MAX_TEXT 768
+
+/*
+ * The pipeline runs three stages:
+ *
+ *  - a reader thread, which fills section slots from the read callback and
+ *    hands them to the workers in turn: section n goes to worker n % workers.
+ *  - the workers, which check the CRC, decode the EIT and walk the event
+ *    descriptors, turning each section into a list of dvbepg_events.
+ *  - the store stage, in the calling thread, which takes the decoded
+ *    sections back from the workers in the same turn, so they reach the
+ *    store callback in the order they were read.
+ *
+ * The stages are connected by single producer/single consumer rings: one
+ * into and one out of each worker, and one returning free slots from the
+ * store stage to the reader. No locks are taken on the way through; a stage
+ * finding its ring empty (or full) spins briefly, then yields, then sleeps.
+ *
+ * With 0 workers, each section is read, decoded and stored in turn in the
+ * calling thread, which is how the pipeline is measured against.
+ */
+
+enum dvbepg_section_status {
+	DVBEPG_SECTION_OK,
+	DVBEPG_SECTION_CRC,		/* CRC error */
+	DVBEPG_SECTION_INVALID,		/* failed to decode */
+	DVBEPG_SECTION_NOT_EIT,		/* some other table */
+};
+
+struct dvbepg_event {
+	uint16_t original_network_id;
+	uint16_t transport_stream_id;
+	uint16_t service_id;
+	uint16_t event_id;
+	uint8_t table_id;
+	uint8_t version;
+	uint8_t running_status;
+	time_t start_time;
+	int duration;			/* seconds */
+	char title[DVBEPG_MAX_TITLE];	/* UTF-8 */
+	char text[DVBEPG_MAX_TEXT];	/* UTF-8 */
+};
+
+struct dvbepg_section {
+	uint64_t seq;
+	int len;
+	uint8_t buf[DVBEPG_MAX_SECTION];
+
+	enum dvbepg_section_status status;
+	int event_count;
+	int event_max;
+	struct dvbepg_event *events;	/* grown as needed, kept with the slot */
+};
+
+struct dvbepg_stats {
+	uint64_t sections;
+	uint64_t crc_errors;
+	uint64_t invalid;
+	uint64_t not_eit;
+	uint64_t events;
+	uint64_t reader_waits;		/* reader found no free slot or a full ring */
+	uint64_t store_waits;		/* store stage found the next section not ready */
+	double elapsed;			/* seconds */
+};
+
+/*
+ * Read one section into buf, returning its length, 0 if there is nothing
+ * yet (the reader checks *quit and calls again), or -1 at the end of the
+ * input.
+ */
+typedef int (*dvbepg_read_callback)(void *arg, uint8_t *buf, int size);
+
+/*
+ * Store a decoded section. Called in read order, from the thread which
+ * called dvbepg_pipeline_run().
+ */
+typedef void (*dvbepg_store_callback)(void *arg, struct dvbepg_section *section);
+
+extern int dvbepg_pipeline_run(int workers,
+			       dvbepg_read_callback read_cb, void *read_arg,
+			       dvbepg_store_callback store_cb, void *store_arg,
+			       volatile int *quit,
+			       struct dvbepg_stats *stats);
+
+#endif
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <fcntl.h>
 #include <libdvbsec/dvbsec_cfg.h>
 #include <libdvbcfg/dvbcfg_scanfile.h>
 #include <libdvbapi/dvbdemux.h>
@@ -31,9 +32,6 @@
 
 
 #define OUTPUT_TYPE_RAW 		1
-#define OUTPUT_TYPE_CHANNELS 		2
-#define OUTPUT_TYPE_VDR12 		3
-#define OUTPUT_TYPE_VDR13 		4
 
 #define SERVICE_FILTER_TV		1
 #define SERVICE_FILTER_RADIO		2
@@ -42,14 +40,18 @@
 
 #define TIMEOUT_WAIT_LOCK		2
 
+#define BLINDSCAN_IF_MIN		950000
+#define BLINDSCAN_IF_MAX		2150000
+#define BLINDSCAN_STEP			10000
+#define BLINDSCAN_SRATE_MIN		1000000
+#define BLINDSCAN_SRATE_MAX		45000000
+#define BLINDSCAN_MAX_CARRIERS		128
+#define BLINDSCAN_CBAND_LOF_MIN		5000000
+#define BLINDSCAN_CBAND_LOF_MAX		7000000
 
-// transponders we have yet to scan
-static struct transponder *toscan = NULL;
-static struct transponder *toscan_end = NULL;
 
-// transponders we have scanned
-static struct transponder *scanned = NULL;
-static struct transponder *scanned_end = NULL;
+// every transponder we know about
+static struct transponder_table transponders;
 
 
 static void usage(void)
@@ -76,6 +78,9 @@ static void usage(void)
 		" -satpos <position>	Specify DISEQC switch position for DVB-S.\n"
 		" -inversion <on|off|auto> Specify inversion (default: auto).\n"
 		" -uk-ordering 		Use UK DVB-T channel ordering if present.\n"
+		" -blindscan		Find DVB-S transponders with the frontend's blind search, in\n"
+		"			 each band and polarization of the LNB. No initial scan file is\n"
+		"			 needed, but one may still be given.\n"
 		" -timeout <secs>	Specify filter timeout to use (standard specced values will be used by default)\n"
 		" -filter <filter>	Specify service filter, a comma seperated list of the following tokens:\n"
 		" 			 (If no filter is supplied, all services will be output)\n"
@@ -84,10 +89,7 @@ static void usage(void)
 		"			 * other - Output other channels\n"
 		"			 * encrypted - Output encrypted channels\n"
 		" -out raw <filename>|-	 Output in raw format to <filename> or stdout\n"
-		"      channels <filename>|-  Output in channels.conf format to <filename> or stdout.\n"
-		"      vdr12 <filename>|- Output in vdr 1.2.x format to <filename> or stdout.\n"
-		"      vdr13 <filename>|- Output in vdr 1.3.x format to <filename> or stdout.\n"
-		" <initial scan file>\n";
+		" [<initial scan file>]\n";
 	fprintf(stderr, "%s\n", _usage);
 
 	exit(1);
@@ -102,15 +104,261 @@ static int scan_load_callback(struct dvbcfg_scanfile *channel, void *private_dat
 		return 0;
 
 	struct transponder *t = new_transponder();
-	append_transponder(t, &toscan, &toscan_end);
 	memcpy(&t->params, &channel->fe_params, sizeof(struct dvbfe_parameters));
+	t->polarization = channel->polarization;
 
 	add_frequency(t, t->params.frequency);
 	t->params.frequency = 0;
 
+	// ignore duplicates in the scan file
+	if (transponder_table_find(&transponders, t)) {
+		free_transponder(t);
+		return 0;
+	}
+	transponder_table_add(&transponders, t);
+
 	return 0;
 }
 
+static uint32_t blindscan_lof(struct dvbsec_config *sec,
+			      enum dvbsec_diseqc_polarization polarization, int high)
+{
+	switch(polarization) {
+	case DISEQC_POLARIZATION_H:
+		return high ? sec->lof_hi_h : sec->lof_lo_h;
+	case DISEQC_POLARIZATION_V:
+		return high ? sec->lof_hi_v : sec->lof_lo_v;
+	case DISEQC_POLARIZATION_L:
+		return high ? sec->lof_hi_l : sec->lof_lo_l;
+	case DISEQC_POLARIZATION_R:
+		return high ? sec->lof_hi_r : sec->lof_lo_r;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Convert an IF to the downlink frequency. Ku-band LNBs oscillate below the
+ * downlink band, C-band ones (single band, 5-7 GHz) above it and invert the
+ * spectrum; either way libdvbsec gets the IF back as abs(frequency - lof).
+ */
+static uint32_t blindscan_downlink(struct dvbsec_config *sec, uint32_t lof,
+				   uint32_t intermediate)
+{
+	if (sec && !sec->switch_frequency &&
+	    (lof >= BLINDSCAN_CBAND_LOF_MIN) && (lof < BLINDSCAN_CBAND_LOF_MAX))
+		return lof - intermediate;
+
+	return lof + intermediate;
+}
+
+/*
+ * Blind scan one band/polarization of the LNB, adding the carriers found to
+ * the transponder table. Returns the number found, or <0 if the frontend
+ * cannot blind scan.
+ */
+static int blindscan_band(struct dvbfe_handle *fe, struct dvbsec_state *secstate,
+			  struct dvbsec_config *sec, int satpos,
+			  enum dvbsec_diseqc_polarization polarization, int high)
+{
+	struct dvbfe_carrier carriers[BLINDSCAN_MAX_CARRIERS];
+	struct dvbfe_parameters params;
+	uint32_t lof = sec ? blindscan_lof(sec, polarization, high) : 0;
+	int count;
+	int i;
+
+	// set up the LNB with a dummy tune inside the band; dvbsec_set picks
+	// the band by comparing against the switch frequency
+	memset(&params, 0, sizeof(params));
+	params.inversion = DVBFE_INVERSION_AUTO;
+	params.u.dvbs.symbol_rate = 27500000;
+	params.u.dvbs.fec_inner = DVBFE_FEC_AUTO;
+	if (sec && sec->switch_frequency)
+		params.frequency = high ? sec->switch_frequency + 1 : sec->switch_frequency - 1;
+	else
+		params.frequency = blindscan_downlink(sec, lof, BLINDSCAN_IF_MIN);
+	if (dvbsec_state_set(secstate, sec, polarization,
+			     (satpos & 0x01) ? DISEQC_SWITCH_B : DISEQC_SWITCH_A,
+			     (satpos & 0x02) ? DISEQC_SWITCH_B : DISEQC_SWITCH_A,
+			     &params, 0)) {
+		fprintf(stderr, "Failed to set up LNB for blind scan\n");
+		return -1;
+	}
+
+	count = dvbfe_blind_scan(fe, BLINDSCAN_IF_MIN, BLINDSCAN_IF_MAX, BLINDSCAN_STEP,
+				 BLINDSCAN_SRATE_MIN, BLINDSCAN_SRATE_MAX,
+				 carriers, BLINDSCAN_MAX_CARRIERS);
+	if (count < 0)
+		return count;
+
+	for(i=0; i < count; i++) {
+		uint32_t frequency = blindscan_downlink(sec, lof, carriers[i].frequency);
+
+		// the IF range overlaps between bands: keep each carrier once
+		if (sec && sec->switch_frequency &&
+		    ((high && (frequency < sec->switch_frequency)) ||
+		     (!high && (frequency >= sec->switch_frequency))))
+			continue;
+
+		struct transponder *t = new_transponder();
+		t->params.inversion = carriers[i].inversion;
+		t->params.u.dvbs.symbol_rate = carriers[i].symbol_rate;
+		t->params.u.dvbs.fec_inner = carriers[i].fec_inner;
+		t->params.u.dvbs.dvbs2 = carriers[i].dvbs2;
+		t->params.u.dvbs.modulation = carriers[i].modulation;
+		t->polarization = polarization;
+		add_frequency(t, frequency);
+
+		// only a carrier on the same polarization is the same transponder;
+		// the lookup checks that, so V/R carriers sharing a frequency
+		// with H/L ones are kept
+		if (transponder_table_find(&transponders, t)) {
+			fprintf(stderr, "blind scan: %u %c %u already known\n", frequency,
+				polarization, carriers[i].symbol_rate);
+			free_transponder(t);
+			continue;
+		}
+
+		fprintf(stderr, "blind scan: %u %c %u%s\n", frequency,
+			polarization, carriers[i].symbol_rate,
+			carriers[i].dvbs2 ? " (DVB-S2)" : "");
+		transponder_table_add(&transponders, t);
+	}
+
+	return count;
+}
+
+static void blindscan(struct dvbfe_handle *fe, struct dvbsec_state *secstate,
+		      struct dvbsec_config *sec, int satpos)
+{
+	enum dvbsec_diseqc_polarization pols[2] = { DISEQC_POLARIZATION_H, DISEQC_POLARIZATION_V };
+	int bands = (sec && sec->switch_frequency) ? 2 : 1;
+	int pol;
+	int band;
+
+	// circular LNBs only have L/R oscillators configured
+	if (sec && (sec->lof_lo_l || sec->lof_lo_r)) {
+		pols[0] = DISEQC_POLARIZATION_L;
+		pols[1] = DISEQC_POLARIZATION_R;
+	}
+
+	for(band=0; band < bands; band++) {
+		for(pol=0; pol < 2; pol++) {
+			if (blindscan_band(fe, secstate, sec, satpos, pols[pol], band) < 0) {
+				fprintf(stderr, "Blind scan failed: the frontend may not support it\n");
+				return;
+			}
+		}
+	}
+}
+
+static const char *timing_str(int ms, char *buf)
+{
+	if (ms < 0)
+		return "    -";
+	sprintf(buf, "%5i", ms);
+	return buf;
+}
+
+static void print_timing(struct transponder *t)
+{
+	char b[8][16];
+	int service_count = 0;
+	struct service *s;
+
+	for(s = t->services; s; s = s->next)
+		service_count++;
+
+	fprintf(stderr, "%10u %s %5i %s %s %s %s %s %s %s %8i\n",
+		t->params.frequency,
+		timing_str(t->timing.sec, b[7]),
+		t->timing.lock,
+		timing_str(t->timing.fe_lock, b[6]),
+		timing_str(t->timing.pat, b[0]),
+		timing_str(t->timing.pmt, b[1]),
+		timing_str(t->timing.sdt, b[2]),
+		timing_str(t->timing.nit, b[3]),
+		timing_str(t->timing.vct, b[4]),
+		timing_str(t->timing.total, b[5]),
+		service_count);
+}
+
+static void print_timing_header(void)
+{
+	fprintf(stderr, " frequency   sec  lock fe_lk   PAT   PMT   SDT   NIT   VCT total services (ms)\n");
+}
+
+static void print_summary(struct dvbsec_state *secstate, long long elapsed)
+{
+	struct dvbsec_state_stats secstats;
+	struct transponder *t;
+	int scanned = 0;
+	int locked = 0;
+	int duplicates = 0;
+	long long lock_total = 0;
+	long long scan_total = 0;
+	long long sec_total = 0;
+
+	for(t = transponders.scanned; t; t = t->next) {
+		if (t->duplicate) {
+			duplicates++;
+			continue;
+		}
+		scanned++;
+		sec_total += t->timing.sec;
+		if (!t->locked)
+			continue;
+		locked++;
+		lock_total += t->timing.lock;
+		scan_total += t->timing.total;
+	}
+
+	fprintf(stderr, "\n%i transponders known, %i tuned, %i locked, %i duplicates skipped\n",
+		transponders.count, scanned, locked, duplicates);
+	if (locked)
+		fprintf(stderr, "average lock %llims, average table scan %llims\n",
+			lock_total / locked, scan_total / locked);
+	dvbsec_state_get_stats(secstate, &secstats);
+	if (scanned)
+		fprintf(stderr, "average SEC %llims, %u SEC steps sent, %u skipped as already set\n",
+			sec_total / scanned, secstats.sent, secstats.skipped);
+	fprintf(stderr, "total scan time %llims\n", elapsed);
+}
+
+static void output_raw(FILE *f)
+{
+	struct transponder *t;
+	struct service *s;
+	struct stream *st;
+	uint32_t i;
+
+	for(t = transponders.scanned; t; t = t->next) {
+		if ((!t->locked) || t->duplicate)
+			continue;
+
+		fprintf(f, "transponder %u onid 0x%04x tsid 0x%04x\n",
+			t->params.frequency, t->original_network_id, t->transport_stream_id);
+		for(s = t->services; s; s = s->next) {
+			fprintf(f, "\tservice 0x%04x type 0x%02x pmt 0x%04x pcr 0x%04x%s",
+				s->service_id, s->service_type, s->pmt_pid, s->pcr_pid,
+				s->is_scrambled ? " scrambled" : "");
+			if (s->atsc_major_channel >= 0)
+				fprintf(f, " channel %i.%i", s->atsc_major_channel, s->atsc_minor_channel);
+			fprintf(f, " \"%s\" \"%s\"\n",
+				s->provider_name ? s->provider_name : "",
+				s->service_name ? s->service_name : "");
+			for(st = s->streams; st; st = st->next) {
+				fprintf(f, "\t\tstream 0x%04x type 0x%02x", st->pid, st->stream_type);
+				if (st->language[0])
+					fprintf(f, " lang %.3s", st->language);
+				fprintf(f, "\n");
+			}
+			for(i=0; i < s->ca_ids_count; i++)
+				fprintf(f, "\t\tca 0x%04x\n", s->ca_ids[i]);
+		}
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	uint32_t i;
@@ -124,7 +372,8 @@ int main(int argc, char *argv[])
 	enum dvbfe_spectral_inversion inversion = DVBFE_INVERSION_AUTO;
 	int service_filter = -1;
 	int uk_ordering = 0;
-	int timeout = 5;
+	int blind = 0;
+	int timeout = 0;
 	int output_type = OUTPUT_TYPE_RAW;
 	char *output_filename = NULL;
 	char *scan_filename = NULL;
@@ -185,6 +434,10 @@ int main(int argc, char *argv[])
 			if ((argc - argpos) < 1)
 				usage();
 			uk_ordering = 1;
+			argpos++;
+		} else if (!strcmp(argv[argpos], "-blindscan")) {
+			blind = 1;
+			argpos++;
 		} else if (!strcmp(argv[argpos], "-timeout")) {
 			if ((argc - argpos) < 2)
 				usage();
@@ -213,18 +466,14 @@ int main(int argc, char *argv[])
 				usage();
 			if (!strcmp(argv[argpos+1], "raw")) {
 				output_type = OUTPUT_TYPE_RAW;
-			} else if (!strcmp(argv[argpos+1], "channels")) {
-				output_type = OUTPUT_TYPE_CHANNELS;
-			} else if (!strcmp(argv[argpos+1], "vdr12")) {
-				output_type = OUTPUT_TYPE_VDR12;
-			} else if (!strcmp(argv[argpos+1], "vdr13")) {
-				output_type = OUTPUT_TYPE_VDR13;
 			} else {
+				fprintf(stderr, "Output format %s is not supported\n", argv[argpos+1]);
 				usage();
 			}
 			output_filename = argv[argpos+2];
 			if (!strcmp(output_filename, "-"))
 				output_filename = NULL;
+			argpos+=3;
 		} else {
 			if ((argc - argpos) != 1)
 				usage();
@@ -245,6 +494,13 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
+	// track the SEC, so that only what changes between transponders is sent
+	struct dvbsec_state *secstate = dvbsec_state_create(fe);
+	if (secstate == NULL) {
+		fprintf(stderr, "Failed to create SEC state\n");
+		exit(1);
+	}
+
 	// default SEC with a DVBS card
 	if ((secid == NULL) && (feinfo.type == DVBFE_TYPE_DVBS))
 		secid = "UNIVERSAL";
@@ -258,67 +514,108 @@ int main(int argc, char *argv[])
 		valid_sec = 1;
 	}
 
+	if ((scan_filename == NULL) && (!blind))
+		usage();
+
 	// load the initial scan file
-	FILE *scan_file = fopen(scan_filename, "r");
-	if (scan_file == NULL) {
-		fprintf(stderr, "Could not open scan file %s\n", scan_filename);
-		exit(1);
+	if (scan_filename) {
+		FILE *scan_file = fopen(scan_filename, "r");
+		if (scan_file == NULL) {
+			fprintf(stderr, "Could not open scan file %s\n", scan_filename);
+			exit(1);
+		}
+		if (dvbcfg_scanfile_parse(scan_file, scan_load_callback, &feinfo) < 0) {
+			fprintf(stderr, "Could not parse scan file %s\n", scan_filename);
+			exit(1);
+		}
+		fclose(scan_file);
 	}
-	if (dvbcfg_scanfile_parse(scan_file, scan_load_callback, &feinfo) < 0) {
-		fprintf(stderr, "Could not parse scan file %s\n", scan_filename);
+
+	// setup the scanners
+	struct scan_config config;
+	memset(&config, 0, sizeof(config));
+	config.adapter_id = adapter_id;
+	config.demux_id = demux_id;
+	config.timeout = timeout;
+	config.fe_type = feinfo.type;
+	config.table = &transponders;
+	config.text_decoder = dvb_text_decoder_create(NULL);
+	if (config.text_decoder == NULL) {
+		fprintf(stderr, "Failed to create text decoder\n");
 		exit(1);
 	}
-	fclose(scan_file);
 
-	// main scan loop
-	while(toscan) {
-		// get the first item on the toscan list
-		struct transponder *tmp = first_transponder(&toscan, &toscan_end);
+	// do we have a valid SEC configuration?
+	struct dvbsec_config *psec = NULL;
+	if (valid_sec)
+		psec = &sec;
 
-		// have we already seen this transponder?
-		if (seen_transponder(tmp, scanned)) {
-			free_transponder(tmp);
-			continue;
+	// find more transponders with the frontend's own search
+	if (blind) {
+		if (feinfo.type != DVBFE_TYPE_DVBS) {
+			fprintf(stderr, "Blind scan is only supported on DVB-S frontends\n");
+			exit(1);
 		}
+		blindscan(fe, secstate, psec, satpos);
+	}
+
+	// main scan loop: transponders found in NITs are added to the table as
+	// we go, so this runs until the whole network has been covered.
+	long long scan_start = scan_time_ms();
+	print_timing_header();
+	while(transponders.toscan) {
+		// get the first item on the toscan list
+		struct transponder *tmp = first_transponder(&transponders.toscan, &transponders.toscan_end);
+		append_transponder(tmp, &transponders.scanned, &transponders.scanned_end);
 
-		// do we have a valid SEC configuration?
-		struct dvbsec_config *psec = NULL;
-		if (valid_sec)
-			psec = &sec;
+		// found to be the same as one we scanned under another frequency?
+		if (tmp->duplicate)
+			continue;
 
 		// tune it
-		int tuned_ok = 0;
-		for(i=0; i < tmp->frequency_count; i++) {
+		long long tune_start = scan_time_ms();
+		uint32_t sec_us = 0;
+		for(i=0; (i < tmp->frequency_count) && (!tmp->locked); i++) {
+			struct dvbsec_state_stats secstats;
+
 			tmp->params.frequency = tmp->frequencies[i];
-			if (dvbsec_set(fe,
-					psec,
-					tmp->polarization,
-					(satpos & 0x01) ? DISEQC_SWITCH_B : DISEQC_SWITCH_A,
-					(satpos & 0x02) ? DISEQC_SWITCH_B : DISEQC_SWITCH_A,
-					&tmp->params,
-					0)) {
+			if (dvbsec_state_set(secstate,
+					     psec,
+					     tmp->polarization,
+					     (satpos & 0x01) ? DISEQC_SWITCH_B : DISEQC_SWITCH_A,
+					     (satpos & 0x02) ? DISEQC_SWITCH_B : DISEQC_SWITCH_A,
+					     &tmp->params,
+					     0)) {
 				fprintf(stderr, "Failed to set frontend\n");
 				exit(1);
 			}
+			dvbsec_state_get_stats(secstate, &secstats);
+			sec_us += secstats.last_us;
 
 			// wait for lock
-			time_t starttime = time(NULL);
-			while((time(NULL) - starttime) < TIMEOUT_WAIT_LOCK) {
-				if (dvbfe_get_info(fe, DVBFE_INFO_LOCKSTATUS, &feinfo,
-				    			DVBFE_INFO_QUERYTYPE_IMMEDIATE, 0) !=
-					DVBFE_INFO_QUERYTYPE_IMMEDIATE) {
+			long long starttime = scan_time_ms();
+			while((scan_time_ms() - starttime) < (TIMEOUT_WAIT_LOCK * 1000)) {
+				if (!(dvbfe_get_info(fe, DVBFE_INFO_LOCKSTATUS, &feinfo,
+						     DVBFE_INFO_QUERYTYPE_IMMEDIATE, 0) & DVBFE_INFO_LOCKSTATUS)) {
 					fprintf(stderr, "Unable to query frontend status\n");
 					exit(1);
 				}
 				if (feinfo.lock) {
-					tuned_ok = 1;
+					tmp->locked = 1;
 					break;
 				}
-				usleep(100000);
+				usleep(20000);
 			}
 		}
-		if (!tuned_ok) {
-			free_transponder(tmp);
+		tmp->timing.sec = (sec_us + 500) / 1000;
+		tmp->timing.lock = scan_time_ms() - tune_start;
+		tmp->timing.fe_lock = -1;
+		if (tmp->locked &&
+		    (dvbfe_get_info(fe, DVBFE_INFO_LOCK_TIME, &feinfo,
+				    DVBFE_INFO_QUERYTYPE_IMMEDIATE, 0) & DVBFE_INFO_LOCK_TIME))
+			tmp->timing.fe_lock = feinfo.lock_time;
+		if (!tmp->locked) {
+			fprintf(stderr, "%10u no lock after %ims\n", tmp->frequencies[0], tmp->timing.lock);
 			continue;
 		}
 
@@ -327,31 +624,49 @@ int main(int argc, char *argv[])
 		case DVBFE_TYPE_DVBS:
 		case DVBFE_TYPE_DVBC:
 		case DVBFE_TYPE_DVBT:
-			dvbscan_scan_dvb(fe);
+			dvbscan_scan_dvb(&config, tmp);
 			break;
 
 		case DVBFE_TYPE_ATSC:
-			dvbscan_scan_atsc(fe);
+			dvbscan_scan_atsc(&config, tmp);
 			break;
 		}
-
-		// add to scanned list.
-		append_transponder(tmp, &scanned, &scanned_end);
+		print_timing(tmp);
 	}
+	print_summary(secstate, scan_time_ms() - scan_start);
 
-	// FIXME: output the data
+	// output the data
+	FILE *output = stdout;
+	if (output_filename) {
+		if ((output = fopen(output_filename, "w")) == NULL) {
+			fprintf(stderr, "Could not open output file %s\n", output_filename);
+			exit(1);
+		}
+	}
+	switch(output_type) {
+	case OUTPUT_TYPE_RAW:
+		output_raw(output);
+		break;
+	}
+	if (output != stdout)
+		fclose(output);
 
+	dvb_text_decoder_destroy(config.text_decoder);
+	transponder_table_free(&transponders);
+	dvbsec_state_destroy(secstate);
+	dvbfe_close(fe);
 	return 0;
 }
 
-int create_section_filter(int adapter, int demux, uint16_t pid, uint8_t table_id)
+int create_section_filter(int adapter, int demux, uint16_t pid,
+			  uint8_t table_id, uint8_t table_id_mask, int table_id_ext)
 {
 	int demux_fd = -1;
 	uint8_t filter[18];
 	uint8_t mask[18];
 
 	// open the demuxer
-	if ((demux_fd = dvbdemux_open_demux(adapter, demux, 0)) < 0) {
+	if ((demux_fd = dvbdemux_open_demux(adapter, demux, 1)) < 0) {
 		return -1;
 	}
 
@@ -359,7 +674,13 @@ int create_section_filter(int adapter, int demux, uint16_t pid, uint8_t table_id
 	memset(filter, 0, sizeof(filter));
 	memset(mask, 0, sizeof(mask));
 	filter[0] = table_id;
-	mask[0] = 0xFF;
+	mask[0] = table_id_mask;
+	if (table_id_ext >= 0) {
+		filter[3] = table_id_ext >> 8;
+		filter[4] = table_id_ext & 0xff;
+		mask[3] = 0xff;
+		mask[4] = 0xff;
+	}
 	if (dvbdemux_set_section_filter(demux_fd, pid, filter, mask, 1, 1)) {
 		close(demux_fd);
 		return -1;
@@ -25,6 +25,44 @@
 #include <libdvbapi/dvbfe.h>
 #include <libdvbsec/dvbsec_api.h>
 #include <libucsi/types.h>
+#include <libucsi/section.h>
+#include <libucsi/dvb/text.h>
+
+/**
+ * Transponders are indexed on (original_network_id, transport_stream_id) and on
+ * frequency bucket, so checking whether a transponder found in a NIT is
+ * already known costs the same for the 1st and the 500th transponder.
+ */
+#define TRANSPONDER_HASH_BITS		10
+#define TRANSPONDER_HASH_SIZE		(1 << TRANSPONDER_HASH_BITS)
+
+/**
+ * Frequencies closer than this are treated as the same transponder. The
+ * frequency hash uses buckets of this size, so a match is always in the
+ * same or a neighbouring bucket.
+ */
+#define FREQUENCY_TOLERANCE		2000
+#define FREQUENCY_BUCKET(f)		((f) / FREQUENCY_TOLERANCE)
+#define FREQUENCY_MATCH(a, b)		((((a) > (b)) ? ((a) - (b)) : ((b) - (a))) < FREQUENCY_TOLERANCE)
+
+/**
+ * Times in ms from the start of a transponder scan until each table was
+ * complete, or -1 if it was not received. fe_lock is the time to lock as
+ * measured by the frontend driver, or -1 if it does not report one. sec is
+ * the time spent on SEC commands before tuning.
+ */
+struct scan_timing
+{
+	int sec;
+	int lock;
+	int fe_lock;
+	int pat;
+	int pmt;
+	int sdt;
+	int nit;
+	int vct;
+	int total;
+};
 
 /**
  * A stream which is part of a service.
@@ -32,6 +70,7 @@
 struct stream
 {
 	uint8_t stream_type;
+	uint16_t pid;
 	iso639lang_t language;
 
 	struct stream *next;
@@ -46,6 +85,7 @@ struct service
 	 * Service identification stuff. Strings are in UTF-8.
 	 */
 	uint16_t service_id;
+	uint8_t service_type;
 	char *provider_name;
 	char *service_name;
 
@@ -67,6 +107,12 @@ struct service
 	 */
 	int bbc_channel_number;
 
+	/**
+	 * ATSC virtual channel number (-1 if unknown).
+	 */
+	int atsc_major_channel;
+	int atsc_minor_channel;
+
 	/**
 	 * Streams composing this service.
 	 */
@@ -110,27 +156,172 @@ struct transponder
 	uint16_t original_network_id;
 	uint16_t transport_stream_id;
 
+	/**
+	 * Set once original_network_id and transport_stream_id are known.
+	 */
+	int ids_valid;
+
+	/**
+	 * Scan state: locked is set if we got a lock, duplicate if this turned
+	 * out to be the same transponder as one scanned under another frequency.
+	 */
+	int locked;
+	int duplicate;
+
 	/**
 	 * Services detected on this transponder.
 	 */
 	struct service *services;
 	struct service *services_end;
 
+	/**
+	 * Time taken to scan this transponder.
+	 */
+	struct scan_timing timing;
+
 	/**
 	 * Next item in list.
 	 */
 	struct transponder *next;
+
+	/**
+	 * Next transponder in the same transponder_table id hash bucket.
+	 */
+	struct transponder *id_hash_next;
+};
+
+/**
+ * An entry in the transponder_table frequency hash. A transponder has one
+ * entry for each of its frequencies.
+ */
+struct frequency_hash_entry
+{
+	uint32_t frequency;
+	uint32_t bucket;
+	struct transponder *transponder;
+	struct frequency_hash_entry *next;
+};
+
+/**
+ * Every transponder known to the scan. Each transponder is on exactly one
+ * of the toscan and scanned lists, and is indexed in the hashes.
+ */
+struct transponder_table
+{
+	struct transponder *id_hash[TRANSPONDER_HASH_SIZE];
+	struct frequency_hash_entry *frequency_hash[TRANSPONDER_HASH_SIZE];
+
+	struct transponder *toscan;
+	struct transponder *toscan_end;
+	struct transponder *scanned;
+	struct transponder *scanned_end;
+	int count;
+};
+
+/**
+ * Settings shared by the DVB and ATSC scanners.
+ */
+struct scan_config
+{
+	int adapter_id;
+	int demux_id;
+	int timeout;			/* filter timeout in seconds, 0 for the specced values */
+	enum dvbfe_type fe_type;
+	struct transponder_table *table;
+	struct dvb_text_decoder *text_decoder;
 };
 
 extern void append_transponder(struct transponder *t, struct transponder **tlist, struct transponder **tlist_end);
 extern struct transponder *new_transponder(void);
 extern void free_transponder(struct transponder *t);
-extern int seen_transponder(struct transponder *t, struct transponder *checklist);
 extern void add_frequency(struct transponder *t, uint32_t frequency);
 extern struct transponder *first_transponder(struct transponder **tlist, struct transponder **tlist_end);
 
-extern int create_section_filter(int adapter, int demux, uint16_t pid, uint8_t table_id);
-extern void dvbscan_scan_dvb(struct dvbfe_handle *fe);
-extern void dvbscan_scan_atsc(struct dvbfe_handle *fe);
+extern struct service *find_service(struct transponder *t, uint16_t service_id);
+extern struct service *get_service(struct transponder *t, uint16_t service_id);
+extern void append_stream(struct service *s, struct stream *stream);
+
+extern void transponder_table_init(struct transponder_table *table);
+extern void transponder_table_free(struct transponder_table *table);
+extern void transponder_table_add(struct transponder_table *table, struct transponder *t);
+extern void transponder_table_add_frequency(struct transponder_table *table, struct transponder *t,
+					    uint32_t frequency);
+extern void transponder_table_set_ids(struct transponder_table *table, struct transponder *t,
+				      uint16_t original_network_id, uint16_t transport_stream_id);
+extern struct transponder *transponder_table_find_ids(struct transponder_table *table,
+						      uint16_t original_network_id,
+						      uint16_t transport_stream_id);
+extern struct transponder *transponder_table_find_frequency(struct transponder_table *table,
+							    struct transponder *t,
+							    uint32_t frequency);
+extern struct transponder *transponder_table_find(struct transponder_table *table, struct transponder *t);
+
+/**
+ * Table filters used while scanning one transponder. All filters are polled
+ * together and each section is processed as it arrives, so the scan of a
+ * transponder takes as long as its slowest table rather than the sum of them.
+ */
+#define MAX_SCAN_FILTERS		24
+#define MAX_PMT_FILTERS			16
+
+enum scan_filter_type
+{
+	SCAN_FILTER_PAT,
+	SCAN_FILTER_PMT,
+	SCAN_FILTER_SDT,
+	SCAN_FILTER_NIT,
+	SCAN_FILTER_VCT,
+};
+
+struct scan_filter
+{
+	int fd;
+	enum scan_filter_type type;
+	uint8_t table_id;		/* table tracked for completion */
+	struct service *service;	/* PMT filters only */
+	struct psi_table_state tstate;
+	long long deadline;
+};
+
+struct scan_state;
+
+/**
+ * Called for each new SDT/NIT/VCT section. PAT and PMT sections are handled
+ * by scan_run() itself.
+ */
+typedef void (*scan_section_callback)(struct scan_state *state, struct scan_filter *filter,
+				      struct section_ext *section);
+
+struct scan_state
+{
+	struct scan_config *config;
+	struct transponder *transponder;
+	scan_section_callback callback;
+
+	struct scan_filter filters[MAX_SCAN_FILTERS];
+	int filter_count;
+
+	/* services waiting for a PMT filter */
+	struct service **pmt_queue;
+	int pmt_queue_count;
+	int pmt_queue_pos;
+	int pmts_open;
+
+	long long start;
+};
+
+extern long long scan_time_ms(void);
+extern void scan_state_init(struct scan_state *state, struct scan_config *config,
+			    struct transponder *t, scan_section_callback callback);
+extern int scan_add_filter(struct scan_state *state, enum scan_filter_type type,
+			   uint16_t pid, uint8_t table_id, uint8_t table_id_mask,
+			   int table_id_ext, int timeout_ms);
+extern void scan_run(struct scan_state *state);
+extern void scan_state_free(struct scan_state *state);
+
+extern int create_section_filter(int adapter, int demux, uint16_t pid,
+				 uint8_t table_id, uint8_t table_id_mask, int table_id_ext);
+extern void dvbscan_scan_dvb(struct scan_config *config, struct transponder *t);
+extern void dvbscan_scan_atsc(struct scan_config *config, struct transponder *t);
 
 #endif
@@ -22,9 +22,148 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <libucsi/mpeg/section.h>
+#include <libucsi/atsc/section.h>
 #include "dvbscan.h"
 
-void dvbscan_scan_atsc(struct dvbfe_handle *fe)
+/* Repetition rates from A/65, plus some slack */
+#define TIMEOUT_PAT		2000
+#define TIMEOUT_VCT		2000
+
+static void atsc_section_callback(struct scan_state *state, struct scan_filter *filter,
+				  struct section_ext *section);
+static void add_channel(struct scan_state *state, uint16_t channel_tsid, uint16_t program_number,
+			uint8_t *short_name, int major, int minor,
+			int service_type, int access_controlled);
+
+void dvbscan_scan_atsc(struct scan_config *config, struct transponder *t)
+{
+	struct scan_state state;
+	uint8_t vct_table_id;
+
+	scan_state_init(&state, config, t, atsc_section_callback);
+
+	// VSB carries the terrestrial VCT, QAM the cable VCT
+	switch(t->params.u.atsc.modulation) {
+	case DVBFE_ATSC_MOD_VSB_8:
+	case DVBFE_ATSC_MOD_VSB_16:
+		vct_table_id = stag_atsc_terrestrial_virtual_channel;
+		break;
+	default:
+		vct_table_id = stag_atsc_cable_virtual_channel;
+		break;
+	}
+
+	scan_add_filter(&state, SCAN_FILTER_PAT, TRANSPORT_PAT_PID,
+			stag_mpeg_program_association, 0xff, -1, TIMEOUT_PAT);
+	scan_add_filter(&state, SCAN_FILTER_VCT, ATSC_BASE_PID,
+			vct_table_id, 0xff, -1, TIMEOUT_VCT);
+
+	scan_run(&state);
+	scan_state_free(&state);
+}
+
+static void atsc_section_callback(struct scan_state *state, struct scan_filter *filter,
+				  struct section_ext *section)
+{
+	struct atsc_section_psip *psip;
+	int idx;
+
+	if (filter->type != SCAN_FILTER_VCT)
+		return;
+	if ((psip = atsc_section_psip_decode(section)) == NULL)
+		return;
+
+	switch(section->table_id) {
+	case stag_atsc_terrestrial_virtual_channel:
+	{
+		struct atsc_tvct_section *tvct;
+		struct atsc_tvct_channel *cur_channel;
+
+		if ((tvct = atsc_tvct_section_codec(psip)) == NULL)
+			return;
+		state->transponder->transport_stream_id = atsc_tvct_section_transport_stream_id(tvct);
+
+		atsc_tvct_section_channels_for_each(tvct, cur_channel, idx) {
+			add_channel(state, cur_channel->channel_TSID, cur_channel->program_number,
+				    (uint8_t *) cur_channel,
+				    cur_channel->major_channel_number, cur_channel->minor_channel_number,
+				    cur_channel->service_type, cur_channel->access_controlled);
+		}
+		break;
+	}
+
+	case stag_atsc_cable_virtual_channel:
+	{
+		struct atsc_cvct_section *cvct;
+		struct atsc_cvct_channel *cur_channel;
+
+		if ((cvct = atsc_cvct_section_codec(psip)) == NULL)
+			return;
+		state->transponder->transport_stream_id = atsc_cvct_section_transport_stream_id(cvct);
+
+		atsc_cvct_section_channels_for_each(cvct, cur_channel, idx) {
+			add_channel(state, cur_channel->channel_TSID, cur_channel->program_number,
+				    (uint8_t *) cur_channel,
+				    cur_channel->major_channel_number, cur_channel->minor_channel_number,
+				    cur_channel->service_type, cur_channel->access_controlled);
+		}
+		break;
+	}
+	}
+}
+
+/*
+ * short_name points at the raw channel entry: it is the first field of both
+ * the TVCT and the CVCT channel structures.
+ */
+static void add_channel(struct scan_state *state, uint16_t channel_tsid, uint16_t program_number,
+			uint8_t *short_name, int major, int minor,
+			int service_type, int access_controlled)
 {
-	// FIXME
+	struct service *s;
+	char *dest;
+	int i;
+
+	// the VCT may also list channels carried in other transport streams
+	if (channel_tsid != state->transponder->transport_stream_id)
+		return;
+	// analogue and inactive channels have no program
+	if ((program_number == 0) || (program_number == 0xffff))
+		return;
+
+	s = get_service(state->transponder, program_number);
+	s->service_type = service_type;
+	s->atsc_major_channel = major;
+	s->atsc_minor_channel = minor;
+	if (access_controlled)
+		s->is_scrambled = 1;
+
+	if (s->service_name != NULL)
+		return;
+
+	// short_name is 7 big-endian UTF-16 code units: convert to UTF-8
+	if ((dest = (char *) malloc((7 * 3) + 1)) == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	s->service_name = dest;
+
+	for(i=0; i < 7; i++) {
+		uint16_t c = (short_name[i*2] << 8) | short_name[(i*2)+1];
+
+		if (c == 0)
+			break;
+		if (c < 0x80) {
+			*dest++ = c;
+		} else if (c < 0x800) {
+			*dest++ = 0xc0 | (c >> 6);
+			*dest++ = 0x80 | (c & 0x3f);
+		} else {
+			*dest++ = 0xe0 | (c >> 12);
+			*dest++ = 0x80 | ((c >> 6) & 0x3f);
+			*dest++ = 0x80 | (c & 0x3f);
+		}
+	}
+	*dest = 0;
 }
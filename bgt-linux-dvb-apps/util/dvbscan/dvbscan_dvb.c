@@ -22,9 +22,327 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <libucsi/mpeg/section.h>
+#include <libucsi/dvb/section.h>
+#include <libucsi/dvb/descriptor.h>
+#include <libucsi/dvb/types.h>
 #include "dvbscan.h"
 
-void dvbscan_scan_dvb(struct dvbfe_handle *fe)
+/* Repetition rates from EN 300 468, plus some slack */
+#define TIMEOUT_PAT		2000
+#define TIMEOUT_SDT		4000
+#define TIMEOUT_NIT		12000
+
+static const enum dvbfe_code_rate fec_inner_table[16] = {
+	DVBFE_FEC_AUTO, DVBFE_FEC_1_2, DVBFE_FEC_2_3, DVBFE_FEC_3_4,
+	DVBFE_FEC_5_6, DVBFE_FEC_7_8, DVBFE_FEC_8_9, DVBFE_FEC_AUTO,
+	DVBFE_FEC_4_5, DVBFE_FEC_AUTO, DVBFE_FEC_AUTO, DVBFE_FEC_AUTO,
+	DVBFE_FEC_AUTO, DVBFE_FEC_AUTO, DVBFE_FEC_AUTO, DVBFE_FEC_NONE,
+};
+
+static const enum dvbfe_code_rate dvbt_code_rate_table[8] = {
+	DVBFE_FEC_1_2, DVBFE_FEC_2_3, DVBFE_FEC_3_4, DVBFE_FEC_5_6,
+	DVBFE_FEC_7_8, DVBFE_FEC_AUTO, DVBFE_FEC_AUTO, DVBFE_FEC_AUTO,
+};
+
+static const enum dvbfe_dvbt_bandwidth dvbt_bandwidth_table[8] = {
+	DVBFE_DVBT_BANDWIDTH_8_MHZ, DVBFE_DVBT_BANDWIDTH_7_MHZ,
+	DVBFE_DVBT_BANDWIDTH_6_MHZ, DVBFE_DVBT_BANDWIDTH_AUTO,
+	DVBFE_DVBT_BANDWIDTH_AUTO, DVBFE_DVBT_BANDWIDTH_AUTO,
+	DVBFE_DVBT_BANDWIDTH_AUTO, DVBFE_DVBT_BANDWIDTH_AUTO,
+};
+
+static const enum dvbfe_dvbt_const dvbt_constellation_table[4] = {
+	DVBFE_DVBT_CONST_QPSK, DVBFE_DVBT_CONST_QAM_16,
+	DVBFE_DVBT_CONST_QAM_64, DVBFE_DVBT_CONST_AUTO,
+};
+
+static const enum dvbfe_dvbt_hierarchy dvbt_hierarchy_table[4] = {
+	DVBFE_DVBT_HIERARCHY_NONE, DVBFE_DVBT_HIERARCHY_1,
+	DVBFE_DVBT_HIERARCHY_2, DVBFE_DVBT_HIERARCHY_4,
+};
+
+static const enum dvbfe_dvbt_guard_interval dvbt_guard_table[4] = {
+	DVBFE_DVBT_GUARD_INTERVAL_1_32, DVBFE_DVBT_GUARD_INTERVAL_1_16,
+	DVBFE_DVBT_GUARD_INTERVAL_1_8, DVBFE_DVBT_GUARD_INTERVAL_1_4,
+};
+
+static const enum dvbfe_dvbt_transmit_mode dvbt_mode_table[4] = {
+	DVBFE_DVBT_TRANSMISSION_MODE_2K, DVBFE_DVBT_TRANSMISSION_MODE_8K,
+	DVBFE_DVBT_TRANSMISSION_MODE_AUTO, DVBFE_DVBT_TRANSMISSION_MODE_AUTO,
+};
+
+static const enum dvbfe_dvbc_mod dvbc_modulation_table[8] = {
+	DVBFE_DVBC_MOD_AUTO, DVBFE_DVBC_MOD_QAM_16, DVBFE_DVBC_MOD_QAM_32,
+	DVBFE_DVBC_MOD_QAM_64, DVBFE_DVBC_MOD_QAM_128, DVBFE_DVBC_MOD_QAM_256,
+	DVBFE_DVBC_MOD_AUTO, DVBFE_DVBC_MOD_AUTO,
+};
+
+static const enum dvbsec_diseqc_polarization polarization_table[4] = {
+	DISEQC_POLARIZATION_H, DISEQC_POLARIZATION_V,
+	DISEQC_POLARIZATION_L, DISEQC_POLARIZATION_R,
+};
+
+static void dvb_section_callback(struct scan_state *state, struct scan_filter *filter,
+				 struct section_ext *section);
+static void process_sdt(struct scan_state *state, struct section_ext *section);
+static void process_nit(struct scan_state *state, struct section_ext *section);
+static int parse_delivery_descriptor(enum dvbfe_type fe_type, struct descriptor *d,
+				     struct transponder *t);
+static char *decode_text(struct dvb_text_decoder *decoder, uint8_t *src, int srclen);
+
+void dvbscan_scan_dvb(struct scan_config *config, struct transponder *t)
+{
+	struct scan_state state;
+
+	scan_state_init(&state, config, t, dvb_section_callback);
+
+	scan_add_filter(&state, SCAN_FILTER_PAT, TRANSPORT_PAT_PID,
+			stag_mpeg_program_association, 0xff, -1, TIMEOUT_PAT);
+	scan_add_filter(&state, SCAN_FILTER_SDT, TRANSPORT_SDT_PID,
+			stag_dvb_service_description_actual, 0xff, -1, TIMEOUT_SDT);
+
+	// NIT actual and other share a filter: other networks' transponders are
+	// picked up as they go past, but only NIT actual has to be complete.
+	scan_add_filter(&state, SCAN_FILTER_NIT, TRANSPORT_NIT_PID,
+			stag_dvb_network_information_actual, 0xfe, -1, TIMEOUT_NIT);
+
+	scan_run(&state);
+	scan_state_free(&state);
+}
+
+static void dvb_section_callback(struct scan_state *state, struct scan_filter *filter,
+				 struct section_ext *section)
+{
+	switch(filter->type) {
+	case SCAN_FILTER_SDT:
+		process_sdt(state, section);
+		break;
+
+	case SCAN_FILTER_NIT:
+		process_nit(state, section);
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void process_sdt(struct scan_state *state, struct section_ext *section)
+{
+	struct transponder *t = state->transponder;
+	struct dvb_sdt_section *sdt;
+	struct dvb_sdt_service *cur_service;
+	struct descriptor *cur_descriptor;
+
+	if ((sdt = dvb_sdt_section_codec(section)) == NULL)
+		return;
+
+	transponder_table_set_ids(state->config->table, t, sdt->original_network_id,
+				  dvb_sdt_section_transport_stream_id(sdt));
+
+	dvb_sdt_section_services_for_each(sdt, cur_service) {
+		struct service *s = get_service(t, cur_service->service_id);
+
+		if (cur_service->free_ca_mode)
+			s->is_scrambled = 1;
+
+		dvb_sdt_service_descriptors_for_each(cur_service, cur_descriptor) {
+			struct dvb_service_descriptor *dx;
+			struct dvb_service_descriptor_part2 *part2;
+
+			if (cur_descriptor->tag != dtag_dvb_service)
+				continue;
+			if ((dx = dvb_service_descriptor_codec(cur_descriptor)) == NULL)
+				continue;
+			part2 = dvb_service_descriptor_part2(dx);
+
+			s->service_type = dx->service_type;
+			if (s->provider_name == NULL)
+				s->provider_name = decode_text(state->config->text_decoder,
+							       dvb_service_descriptor_service_provider_name(dx),
+							       dx->service_provider_name_length);
+			if (s->service_name == NULL)
+				s->service_name = decode_text(state->config->text_decoder,
+							      dvb_service_descriptor_service_name(part2),
+							      part2->service_name_length);
+		}
+	}
+}
+
+static void process_nit(struct scan_state *state, struct section_ext *section)
 {
-	// FIXME
+	struct transponder_table *table = state->config->table;
+	struct dvb_nit_section *nit;
+	struct dvb_nit_section_part2 *part2;
+	struct dvb_nit_transport *cur_transport;
+	struct descriptor *cur_descriptor;
+	uint32_t i;
+
+	if ((nit = dvb_nit_section_codec(section)) == NULL)
+		return;
+
+	part2 = dvb_nit_section_part2(nit);
+	dvb_nit_section_transports_for_each(nit, part2, cur_transport) {
+		struct transponder *t = new_transponder();
+		struct transponder *found;
+		int valid = 0;
+
+		t->network_id = dvb_nit_section_network_id(nit);
+		t->original_network_id = cur_transport->original_network_id;
+		t->transport_stream_id = cur_transport->transport_stream_id;
+		t->ids_valid = 1;
+
+		dvb_nit_transport_descriptors_for_each(cur_transport, cur_descriptor) {
+			if (parse_delivery_descriptor(state->config->fe_type, cur_descriptor, t) == 0)
+				valid = 1;
+		}
+
+		// no delivery descriptor for our frontend type: not for us
+		if (!valid) {
+			free_transponder(t);
+			continue;
+		}
+
+		// merge with what we already know about it
+		found = transponder_table_find(table, t);
+		if (found != NULL) {
+			if (!found->ids_valid)
+				transponder_table_set_ids(table, found,
+							  t->original_network_id, t->transport_stream_id);
+			for(i=0; i < t->frequency_count; i++)
+				transponder_table_add_frequency(table, found, t->frequencies[i]);
+			free_transponder(t);
+			continue;
+		}
+
+		transponder_table_add(table, t);
+	}
+}
+
+static void add_frequency_once(struct transponder *t, uint32_t frequency)
+{
+	uint32_t i;
+
+	if (frequency == 0)
+		return;
+	for(i=0; i < t->frequency_count; i++) {
+		if (FREQUENCY_MATCH(t->frequencies[i], frequency))
+			return;
+	}
+	add_frequency(t, frequency);
+}
+
+static int parse_delivery_descriptor(enum dvbfe_type fe_type, struct descriptor *d,
+				     struct transponder *t)
+{
+	switch(d->tag) {
+	case dtag_dvb_satellite_delivery_system:
+	{
+		struct dvb_satellite_delivery_descriptor *dx;
+
+		if (fe_type != DVBFE_TYPE_DVBS)
+			break;
+		if ((dx = dvb_satellite_delivery_descriptor_codec(d)) == NULL)
+			break;
+
+		// the frontend takes kHz, the descriptor has BCD 10kHz units
+		add_frequency_once(t, bcd_to_integer(dx->frequency) * 10);
+		t->params.inversion = DVBFE_INVERSION_AUTO;
+		t->params.u.dvbs.symbol_rate = bcd_to_integer(dx->symbol_rate) * 100;
+		t->params.u.dvbs.fec_inner = fec_inner_table[dx->fec_inner];
+		t->polarization = polarization_table[dx->polarization];
+		t->oribital_position = bcd_to_integer(dx->orbital_position);
+		if (!dx->west_east_flag)
+			t->oribital_position = -t->oribital_position;
+		return 0;
+	}
+
+	case dtag_dvb_cable_delivery_system:
+	{
+		struct dvb_cable_delivery_descriptor *dx;
+
+		if (fe_type != DVBFE_TYPE_DVBC)
+			break;
+		if ((dx = dvb_cable_delivery_descriptor_codec(d)) == NULL)
+			break;
+
+		add_frequency_once(t, bcd_to_integer(dx->frequency) * 100);
+		t->params.inversion = DVBFE_INVERSION_AUTO;
+		t->params.u.dvbc.symbol_rate = bcd_to_integer(dx->symbol_rate) * 100;
+		t->params.u.dvbc.fec_inner = fec_inner_table[dx->fec_inner];
+		t->params.u.dvbc.modulation = dvbc_modulation_table[dx->modulation & 7];
+		return 0;
+	}
+
+	case dtag_dvb_terrestial_delivery_system:
+	{
+		struct dvb_terrestrial_delivery_descriptor *dx;
+
+		if (fe_type != DVBFE_TYPE_DVBT)
+			break;
+		if ((dx = dvb_terrestrial_delivery_descriptor_codec(d)) == NULL)
+			break;
+
+		add_frequency_once(t, dx->centre_frequency * 10);
+		t->params.inversion = DVBFE_INVERSION_AUTO;
+		t->params.u.dvbt.bandwidth = dvbt_bandwidth_table[dx->bandwidth];
+		t->params.u.dvbt.code_rate_HP = dvbt_code_rate_table[dx->code_rate_hp_stream];
+		t->params.u.dvbt.code_rate_LP = dvbt_code_rate_table[dx->code_rate_lp_stream];
+		t->params.u.dvbt.constellation = dvbt_constellation_table[dx->constellation];
+		t->params.u.dvbt.transmission_mode = dvbt_mode_table[dx->transmission_mode];
+		t->params.u.dvbt.guard_interval = dvbt_guard_table[dx->guard_interval];
+		t->params.u.dvbt.hierarchy_information = dvbt_hierarchy_table[dx->hierarchy_information & 3];
+		return 0;
+	}
+
+	case dtag_dvb_frequency_list:
+	{
+		struct dvb_frequency_list_descriptor *dx;
+		uint32_t *freqs;
+		int count;
+		int i;
+
+		if ((dx = dvb_frequency_list_descriptor_codec(d)) == NULL)
+			break;
+		freqs = dvb_frequency_list_descriptor_centre_frequencies(dx);
+		count = dvb_frequency_list_descriptor_centre_frequencies_count(dx);
+
+		for(i=0; i < count; i++) {
+			switch(dx->coding_type) {
+			case 1:
+				if (fe_type == DVBFE_TYPE_DVBS)
+					add_frequency_once(t, bcd_to_integer(freqs[i]) * 10);
+				break;
+			case 2:
+				if (fe_type == DVBFE_TYPE_DVBC)
+					add_frequency_once(t, bcd_to_integer(freqs[i]) * 100);
+				break;
+			case 3:
+				if (fe_type == DVBFE_TYPE_DVBT)
+					add_frequency_once(t, freqs[i] * 10);
+				break;
+			}
+		}
+		break;
+	}
+	}
+
+	return -1;
+}
+
+static char *decode_text(struct dvb_text_decoder *decoder, uint8_t *src, int srclen)
+{
+	int destlen = (srclen * 3) + 1;
+	char *dest = (char *) malloc(destlen);
+
+	if (dest == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	if (dvb_text_decode(decoder, src, srclen, dest, destlen, 0) < 0)
+		dest[0] = 0;
+
+	return dest;
 }
@@ -47,31 +47,36 @@ struct transponder *new_transponder(void)
 	return t;
 }
 
-void free_transponder(struct transponder *t)
+static void free_service(struct service *s)
 {
-	if (t->frequencies)
-		free(t->frequencies);
-	// FIXME: free services
-	free(t);
+	struct stream *cur_stream = s->streams;
+	while(cur_stream) {
+		struct stream *next = cur_stream->next;
+		free(cur_stream);
+		cur_stream = next;
+	}
+
+	if (s->provider_name)
+		free(s->provider_name);
+	if (s->service_name)
+		free(s->service_name);
+	if (s->ca_ids)
+		free(s->ca_ids);
+	free(s);
 }
 
-int seen_transponder(struct transponder *t, struct transponder *checklist)
+void free_transponder(struct transponder *t)
 {
-	uint32_t i;
-
-	struct transponder *cur_check = checklist;
-	while(cur_check) {
-		uint32_t freq1 = cur_check->params.frequency / 2000;
-		for(i=0; i < t->frequency_count; i++) {
-			uint32_t freq2 = t->frequencies[i] / 2000;
-			if (freq1 == freq2) {
-				return 1;
-			}
-		}
-		cur_check = cur_check->next;
+	struct service *cur_service = t->services;
+	while(cur_service) {
+		struct service *next = cur_service->next;
+		free_service(cur_service);
+		cur_service = next;
 	}
 
-	return 0;
+	if (t->frequencies)
+		free(t->frequencies);
+	free(t);
 }
 
 void add_frequency(struct transponder *t, uint32_t frequency)
@@ -97,3 +102,262 @@ struct transponder *first_transponder(struct transponder **tlist, struct transpo
 
 	return t;
 }
+
+struct service *find_service(struct transponder *t, uint16_t service_id)
+{
+	struct service *cur_service = t->services;
+
+	while(cur_service) {
+		if (cur_service->service_id == service_id)
+			return cur_service;
+		cur_service = cur_service->next;
+	}
+
+	return NULL;
+}
+
+struct service *get_service(struct transponder *t, uint16_t service_id)
+{
+	struct service *s = find_service(t, service_id);
+	if (s != NULL)
+		return s;
+
+	s = (struct service *) malloc(sizeof(struct service));
+	if (s == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	memset(s, 0, sizeof(struct service));
+	s->service_id = service_id;
+	s->bbc_channel_number = -1;
+	s->atsc_major_channel = -1;
+	s->atsc_minor_channel = -1;
+
+	if (t->services_end == NULL) {
+		t->services = s;
+	} else {
+		t->services_end->next = s;
+	}
+	t->services_end = s;
+
+	return s;
+}
+
+void append_stream(struct service *s, struct stream *stream)
+{
+	if (s->streams_end == NULL) {
+		s->streams = stream;
+	} else {
+		s->streams_end->next = stream;
+	}
+	s->streams_end = stream;
+	stream->next = NULL;
+}
+
+static uint32_t id_hash(uint16_t original_network_id, uint16_t transport_stream_id)
+{
+	uint32_t key = (original_network_id << 16) | transport_stream_id;
+
+	return (key * 2654435761U) >> (32 - TRANSPONDER_HASH_BITS);
+}
+
+static uint32_t frequency_hash(uint32_t bucket)
+{
+	return (bucket * 2654435761U) >> (32 - TRANSPONDER_HASH_BITS);
+}
+
+static void hash_frequency(struct transponder_table *table, struct transponder *t, uint32_t frequency)
+{
+	struct frequency_hash_entry *entry;
+	uint32_t bucket = FREQUENCY_BUCKET(frequency);
+	uint32_t hash = frequency_hash(bucket);
+
+	entry = (struct frequency_hash_entry *) malloc(sizeof(struct frequency_hash_entry));
+	if (entry == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	entry->frequency = frequency;
+	entry->bucket = bucket;
+	entry->transponder = t;
+	entry->next = table->frequency_hash[hash];
+	table->frequency_hash[hash] = entry;
+}
+
+static void hash_ids(struct transponder_table *table, struct transponder *t)
+{
+	uint32_t hash = id_hash(t->original_network_id, t->transport_stream_id);
+
+	t->id_hash_next = table->id_hash[hash];
+	table->id_hash[hash] = t;
+}
+
+static void unhash_ids(struct transponder_table *table, struct transponder *t)
+{
+	struct transponder **pos;
+
+	pos = &table->id_hash[id_hash(t->original_network_id, t->transport_stream_id)];
+	while(*pos) {
+		if (*pos == t) {
+			*pos = t->id_hash_next;
+			break;
+		}
+		pos = &(*pos)->id_hash_next;
+	}
+	t->id_hash_next = NULL;
+}
+
+void transponder_table_init(struct transponder_table *table)
+{
+	memset(table, 0, sizeof(struct transponder_table));
+}
+
+void transponder_table_free(struct transponder_table *table)
+{
+	uint32_t i;
+
+	for(i=0; i < TRANSPONDER_HASH_SIZE; i++) {
+		struct frequency_hash_entry *entry = table->frequency_hash[i];
+		while(entry) {
+			struct frequency_hash_entry *next = entry->next;
+			free(entry);
+			entry = next;
+		}
+	}
+
+	while(table->toscan)
+		free_transponder(first_transponder(&table->toscan, &table->toscan_end));
+	while(table->scanned)
+		free_transponder(first_transponder(&table->scanned, &table->scanned_end));
+
+	transponder_table_init(table);
+}
+
+void transponder_table_add(struct transponder_table *table, struct transponder *t)
+{
+	uint32_t i;
+
+	for(i=0; i < t->frequency_count; i++)
+		hash_frequency(table, t, t->frequencies[i]);
+	if (t->ids_valid)
+		hash_ids(table, t);
+
+	append_transponder(t, &table->toscan, &table->toscan_end);
+	table->count++;
+}
+
+void transponder_table_add_frequency(struct transponder_table *table, struct transponder *t,
+				     uint32_t frequency)
+{
+	uint32_t i;
+
+	for(i=0; i < t->frequency_count; i++) {
+		if (FREQUENCY_MATCH(t->frequencies[i], frequency))
+			return;
+	}
+
+	add_frequency(t, frequency);
+	hash_frequency(table, t, frequency);
+}
+
+void transponder_table_set_ids(struct transponder_table *table, struct transponder *t,
+			       uint16_t original_network_id, uint16_t transport_stream_id)
+{
+	struct transponder *other;
+
+	if (t->ids_valid) {
+		if ((t->original_network_id == original_network_id) &&
+		    (t->transport_stream_id == transport_stream_id))
+			return;
+		unhash_ids(table, t);
+	}
+
+	// a transponder we have not scanned yet may already have been queued
+	// with these ids under a different frequency: it is the same one.
+	other = transponder_table_find_ids(table, original_network_id, transport_stream_id);
+	if ((other != NULL) && (other != t) && (!other->locked)) {
+		unhash_ids(table, other);
+		other->ids_valid = 0;
+		other->duplicate = 1;
+	}
+
+	t->original_network_id = original_network_id;
+	t->transport_stream_id = transport_stream_id;
+	t->ids_valid = 1;
+	hash_ids(table, t);
+}
+
+struct transponder *transponder_table_find_ids(struct transponder_table *table,
+					       uint16_t original_network_id,
+					       uint16_t transport_stream_id)
+{
+	struct transponder *cur = table->id_hash[id_hash(original_network_id, transport_stream_id)];
+
+	while(cur) {
+		if ((cur->original_network_id == original_network_id) &&
+		    (cur->transport_stream_id == transport_stream_id))
+			return cur;
+		cur = cur->id_hash_next;
+	}
+
+	return NULL;
+}
+
+/*
+ * A frequency only identifies a satellite transponder together with its
+ * polarization and orbital position. An orbital position of 0 means it is
+ * not known (scan files and blind scans do not give one), and matches any.
+ */
+static int same_transponder_slot(struct transponder *a, struct transponder *b)
+{
+	if (a->polarization != b->polarization)
+		return 0;
+	if (a->oribital_position && b->oribital_position &&
+	    (a->oribital_position != b->oribital_position))
+		return 0;
+
+	return 1;
+}
+
+struct transponder *transponder_table_find_frequency(struct transponder_table *table,
+						     struct transponder *t,
+						     uint32_t frequency)
+{
+	uint32_t bucket = FREQUENCY_BUCKET(frequency);
+	struct frequency_hash_entry *entry;
+	uint32_t b;
+
+	// a frequency within the tolerance may be just over a bucket boundary
+	for(b = (bucket ? bucket - 1 : 0); b <= bucket + 1; b++) {
+		entry = table->frequency_hash[frequency_hash(b)];
+		while(entry) {
+			if ((entry->bucket == b) &&
+			    FREQUENCY_MATCH(entry->frequency, frequency) &&
+			    same_transponder_slot(entry->transponder, t))
+				return entry->transponder;
+			entry = entry->next;
+		}
+	}
+
+	return NULL;
+}
+
+struct transponder *transponder_table_find(struct transponder_table *table, struct transponder *t)
+{
+	struct transponder *found;
+	uint32_t i;
+
+	if (t->ids_valid) {
+		found = transponder_table_find_ids(table, t->original_network_id, t->transport_stream_id);
+		if (found)
+			return found;
+	}
+
+	for(i=0; i < t->frequency_count; i++) {
+		found = transponder_table_find_frequency(table, t, t->frequencies[i]);
+		if (found)
+			return found;
+	}
+
+	return NULL;
+}
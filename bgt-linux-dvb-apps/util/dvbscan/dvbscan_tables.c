@@ -0,0 +1,373 @@
+/*
+	dvbscan utility
+
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <libucsi/mpeg/section.h>
+#include <libucsi/mpeg/descriptor.h>
+#include "dvbscan.h"
+
+static void process_pat(struct scan_state *state, struct section_ext *section);
+static void process_pmt(struct scan_filter *filter, struct section_ext *section);
+static void close_filter(struct scan_state *state, struct scan_filter *filter);
+static void start_pmt_filters(struct scan_state *state);
+static void record_timing(struct scan_state *state, enum scan_filter_type type);
+
+long long scan_time_ms(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return ((long long) tv.tv_sec * 1000) + (tv.tv_usec / 1000);
+}
+
+void scan_state_init(struct scan_state *state, struct scan_config *config,
+		     struct transponder *t, scan_section_callback callback)
+{
+	memset(state, 0, sizeof(struct scan_state));
+	state->config = config;
+	state->transponder = t;
+	state->callback = callback;
+	state->start = scan_time_ms();
+
+	t->timing.pat = -1;
+	t->timing.pmt = -1;
+	t->timing.sdt = -1;
+	t->timing.nit = -1;
+	t->timing.vct = -1;
+	t->timing.total = -1;
+}
+
+int scan_add_filter(struct scan_state *state, enum scan_filter_type type,
+		    uint16_t pid, uint8_t table_id, uint8_t table_id_mask,
+		    int table_id_ext, int timeout_ms)
+{
+	struct scan_filter *filter;
+	int fd;
+
+	if (state->filter_count == MAX_SCAN_FILTERS)
+		return -1;
+
+	fd = create_section_filter(state->config->adapter_id, state->config->demux_id,
+				   pid, table_id, table_id_mask, table_id_ext);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to create filter for pid %04x table %02x\n", pid, table_id);
+		return -1;
+	}
+
+	if (state->config->timeout)
+		timeout_ms = state->config->timeout * 1000;
+
+	filter = &state->filters[state->filter_count++];
+	memset(filter, 0, sizeof(struct scan_filter));
+	filter->fd = fd;
+	filter->type = type;
+	filter->table_id = table_id;
+	filter->deadline = scan_time_ms() + timeout_ms;
+	psi_table_state_reset(&filter->tstate);
+
+	return 0;
+}
+
+void scan_run(struct scan_state *state)
+{
+	struct pollfd pollfds[MAX_SCAN_FILTERS];
+	uint8_t sibuf[4096];
+	int i;
+
+	for(;;) {
+		long long now = scan_time_ms();
+		long long wait = -1;
+
+		// drop filters which have timed out
+		for(i=0; i < state->filter_count; i++) {
+			if (state->filters[i].deadline <= now) {
+				close_filter(state, &state->filters[i]);
+				i--;
+			}
+		}
+		start_pmt_filters(state);
+		if (state->filter_count == 0)
+			break;
+
+		for(i=0; i < state->filter_count; i++) {
+			pollfds[i].fd = state->filters[i].fd;
+			pollfds[i].events = POLLIN | POLLPRI;
+			pollfds[i].revents = 0;
+			if ((wait < 0) || ((state->filters[i].deadline - now) < wait))
+				wait = state->filters[i].deadline - now;
+		}
+
+		if (poll(pollfds, state->filter_count, (int) wait) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			break;
+		}
+
+		// process everything which arrived. Go backwards, since completing
+		// a table closes its filter and moves the last filter into its slot.
+		for(i=state->filter_count-1; i >= 0; i--) {
+			struct scan_filter *filter = &state->filters[i];
+			struct section *section;
+			struct section_ext *section_ext;
+			int size;
+
+			if (!(pollfds[i].revents & (POLLIN | POLLPRI | POLLERR)))
+				continue;
+
+			size = read(filter->fd, sibuf, sizeof(sibuf));
+			if (size < 0) {
+				// overflows and CRC errors just lose a section
+				if ((errno != EOVERFLOW) && (errno != EAGAIN) && (errno != ETIMEDOUT))
+					perror("read");
+				continue;
+			}
+
+			if ((section = section_codec(sibuf, size)) == NULL)
+				continue;
+			if ((section_ext = section_ext_decode(section, 0)) == NULL)
+				continue;
+			if (!section_ext->current_next_indicator)
+				continue;
+
+			// sections of another table on the same filter (e.g. NIT other)
+			// are passed on without completion tracking
+			if (section_ext->table_id != filter->table_id) {
+				if (state->callback)
+					state->callback(state, filter, section_ext);
+				continue;
+			}
+			if (!section_ext_useful(section_ext, &filter->tstate))
+				continue;
+
+			switch(filter->type) {
+			case SCAN_FILTER_PAT:
+				process_pat(state, section_ext);
+				break;
+
+			case SCAN_FILTER_PMT:
+				process_pmt(filter, section_ext);
+				break;
+
+			default:
+				if (state->callback)
+					state->callback(state, filter, section_ext);
+				break;
+			}
+
+			if (filter->tstate.complete) {
+				record_timing(state, filter->type);
+				close_filter(state, filter);
+			}
+		}
+	}
+
+	state->transponder->timing.total = scan_time_ms() - state->start;
+}
+
+void scan_state_free(struct scan_state *state)
+{
+	while(state->filter_count)
+		close_filter(state, &state->filters[0]);
+
+	if (state->pmt_queue)
+		free(state->pmt_queue);
+	state->pmt_queue = NULL;
+}
+
+static void close_filter(struct scan_state *state, struct scan_filter *filter)
+{
+	struct scan_filter *last = &state->filters[state->filter_count - 1];
+
+	close(filter->fd);
+	if (filter->type == SCAN_FILTER_PMT) {
+		state->pmts_open--;
+
+		// the last PMT to finish marks the PMTs as done
+		if ((state->pmts_open == 0) && (state->pmt_queue_pos == state->pmt_queue_count))
+			state->transponder->timing.pmt = scan_time_ms() - state->start;
+	}
+
+	if (filter != last)
+		memcpy(filter, last, sizeof(struct scan_filter));
+	state->filter_count--;
+}
+
+static void start_pmt_filters(struct scan_state *state)
+{
+	while((state->pmt_queue_pos < state->pmt_queue_count) &&
+	      (state->pmts_open < MAX_PMT_FILTERS) &&
+	      (state->filter_count < MAX_SCAN_FILTERS)) {
+		struct service *s = state->pmt_queue[state->pmt_queue_pos++];
+
+		if (scan_add_filter(state, SCAN_FILTER_PMT, s->pmt_pid,
+				    stag_mpeg_program_map, 0xff, s->service_id, 2000))
+			continue;
+		state->filters[state->filter_count - 1].service = s;
+		state->pmts_open++;
+	}
+}
+
+static void record_timing(struct scan_state *state, enum scan_filter_type type)
+{
+	int elapsed = scan_time_ms() - state->start;
+
+	switch(type) {
+	case SCAN_FILTER_PAT:
+		state->transponder->timing.pat = elapsed;
+		break;
+	case SCAN_FILTER_SDT:
+		state->transponder->timing.sdt = elapsed;
+		break;
+	case SCAN_FILTER_NIT:
+		state->transponder->timing.nit = elapsed;
+		break;
+	case SCAN_FILTER_VCT:
+		state->transponder->timing.vct = elapsed;
+		break;
+	case SCAN_FILTER_PMT:
+		break;
+	}
+}
+
+static void process_pat(struct scan_state *state, struct section_ext *section)
+{
+	struct transponder *t = state->transponder;
+	struct mpeg_pat_section *pat;
+	struct mpeg_pat_program *cur_program;
+	struct service **tmp;
+
+	if ((pat = mpeg_pat_section_codec(section)) == NULL)
+		return;
+
+	t->transport_stream_id = mpeg_pat_section_transport_stream_id(pat);
+
+	mpeg_pat_section_programs_for_each(pat, cur_program) {
+		struct service *s;
+
+		// program 0 is the NIT PID
+		if (cur_program->program_number == 0)
+			continue;
+
+		s = get_service(t, cur_program->program_number);
+		if (s->pmt_pid)
+			continue;
+		s->pmt_pid = cur_program->pid;
+
+		tmp = (struct service **) realloc(state->pmt_queue,
+				sizeof(struct service *) * (state->pmt_queue_count + 1));
+		if (tmp == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		state->pmt_queue = tmp;
+		state->pmt_queue[state->pmt_queue_count++] = s;
+	}
+}
+
+static void add_ca_id(struct service *s, uint16_t ca_system_id)
+{
+	uint16_t *tmp;
+	uint32_t i;
+
+	for(i=0; i < s->ca_ids_count; i++) {
+		if (s->ca_ids[i] == ca_system_id)
+			return;
+	}
+
+	tmp = (uint16_t *) realloc(s->ca_ids, sizeof(uint16_t) * (s->ca_ids_count + 1));
+	if (tmp == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	tmp[s->ca_ids_count++] = ca_system_id;
+	s->ca_ids = tmp;
+}
+
+static void process_pmt(struct scan_filter *filter, struct section_ext *section)
+{
+	struct service *s = filter->service;
+	struct mpeg_pmt_section *pmt;
+	struct mpeg_pmt_stream *cur_stream;
+	struct descriptor *cur_descriptor;
+
+	if ((pmt = mpeg_pmt_section_codec(section)) == NULL)
+		return;
+
+	s->pcr_pid = pmt->pcr_pid;
+
+	mpeg_pmt_section_descriptors_for_each(pmt, cur_descriptor) {
+		if (cur_descriptor->tag == dtag_mpeg_ca) {
+			struct mpeg_ca_descriptor *ca = mpeg_ca_descriptor_codec(cur_descriptor);
+			if (ca)
+				add_ca_id(s, ca->ca_system_id);
+		}
+	}
+
+	mpeg_pmt_section_streams_for_each(pmt, cur_stream) {
+		struct stream *stream = (struct stream *) malloc(sizeof(struct stream));
+		if (stream == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		memset(stream, 0, sizeof(struct stream));
+		stream->stream_type = cur_stream->stream_type;
+		stream->pid = cur_stream->pid;
+
+		mpeg_pmt_stream_descriptors_for_each(cur_stream, cur_descriptor) {
+			switch(cur_descriptor->tag) {
+			case dtag_mpeg_ca:
+			{
+				struct mpeg_ca_descriptor *ca = mpeg_ca_descriptor_codec(cur_descriptor);
+				if (ca)
+					add_ca_id(s, ca->ca_system_id);
+				break;
+			}
+
+			case dtag_mpeg_iso_639_language:
+			{
+				struct mpeg_iso_639_language_descriptor *iso;
+				struct mpeg_iso_639_language_code *lang;
+
+				iso = mpeg_iso_639_language_descriptor_codec(cur_descriptor);
+				if (iso == NULL)
+					break;
+				mpeg_iso_639_language_descriptor_languages_for_each(iso, lang) {
+					memcpy(stream->language, lang->language_code, 3);
+					break;
+				}
+				break;
+			}
+			}
+		}
+
+		append_stream(s, stream);
+	}
+
+	if (s->ca_ids_count)
+		s->is_scrambled = 1;
+}
@@ -17,6 +17,79 @@
 #define BSIZE 188
 
 static int pidt[0x2001];
+static struct dvbdemux_pid_stats kstats[2][0x2000];
+
+static int find_pid(struct dvbdemux_pid_stats *stats, int count, int pid)
+{
+	int lo = 0, hi = count;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (stats[mid].pid < pid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo < count && stats[lo].pid == pid) ? lo : -1;
+}
+
+/*
+ * Print the demux's own counters once a second: only the snapshots cross to
+ * user space, not the stream.
+ */
+static int kernel_stats(int ffd)
+{
+	struct dvbdemux_stats st[2];
+	int count[2];
+	int cur = 0;
+
+	if ((count[cur] = dvbdemux_get_pid_stats(ffd, &st[cur], kstats[cur], 0x2000)) < 0) {
+		perror("dvbdemux_get_pid_stats");
+		return -1;
+	}
+
+	while (1) {
+		int prev = cur, diff, i;
+
+		sleep(1);
+		cur = !cur;
+		if ((count[cur] = dvbdemux_get_pid_stats(ffd, &st[cur], kstats[cur], 0x2000)) < 0) {
+			perror("dvbdemux_get_pid_stats");
+			return -1;
+		}
+		diff = st[cur].msecs - st[prev].msecs;
+		if (diff <= 0)
+			continue;
+
+		for (i = 0; i < count[cur]; i++) {
+			struct dvbdemux_pid_stats *now = &kstats[cur][i];
+			struct dvbdemux_pid_stats zero = { 0, 0, 0, 0, 0, 0 };
+			struct dvbdemux_pid_stats *then = &zero;
+			int j = find_pid(kstats[prev], count[prev], now->pid);
+			unsigned int packets;
+
+			if (j >= 0)
+				then = &kstats[prev][j];
+			packets = now->packets - then->packets;
+			if (!packets)
+				continue;
+			printf("%04x %5u p/s %5u kbit %5u cc %5u tei %5u scr\n",
+			       now->pid,
+			       (unsigned int) ((unsigned long long) packets * 1000 / diff),
+			       (unsigned int) ((unsigned long long) packets * 8 * 188 / diff),
+			       now->cc_errors - then->cc_errors,
+			       now->tei - then->tei,
+			       now->scrambled - then->scrambled);
+		}
+		printf("2000 %5u p/s %5u kbit (demux: %u kbit)\n",
+		       (unsigned int) ((st[cur].packets - st[prev].packets) * 1000 / diff),
+		       (unsigned int) ((st[cur].packets - st[prev].packets) * 8 * 188 / diff),
+		       st[cur].bitrate / 1000);
+		printf("-PID--FREQ-----BANDWIDTH--CC-ERR-----TEI-SCRAMBLED\n");
+	}
+
+	return 0;
+}
 
 static void usage(FILE *output)
 {
@@ -25,6 +98,8 @@ static void usage(FILE *output)
 		"Options:\n"
 		"	-a N	use dvb adapter N\n"
 		"	-d N	use demux N\n"
+		"	-k	show the kernel demux PID statistics instead of\n"
+		"		reading the stream\n"
 		"	-h	display this help\n");
 }
 
@@ -34,9 +109,10 @@ int main(int argc, char **argv)
 	int adapter = 0, demux = 0;
 	char *search = NULL;
 	int fd, ffd, packets = 0;
+	int kernel = 0;
 	int opt;
 
-	while ((opt = getopt(argc, argv, "a:d:hs:")) != -1) {
+	while ((opt = getopt(argc, argv, "a:d:hks:")) != -1) {
 		switch (opt) {
 		case 'a':
 			adapter = atoi(optarg);
@@ -47,6 +123,9 @@ int main(int argc, char **argv)
 		case 'h':
 			usage(stdout);
 			exit(0);
+		case 'k':
+			kernel = 1;
+			break;
 		case 's':
 			search = strdup(optarg);
 			break;
@@ -56,6 +135,23 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (kernel) {
+		// the filter only keeps the stream flowing; with the DVR
+		// device closed, the packets are dropped in the kernel
+		ffd = dvbdemux_open_demux(adapter, demux, 0);
+		if (ffd < 0) {
+			fprintf(stderr, "dvbtraffic: Could not open demux device: %m\n");
+			exit(1);
+		}
+		if (dvbdemux_set_pid_filter(ffd, -1, DVBDEMUX_INPUT_FRONTEND, DVBDEMUX_OUTPUT_DVR, 1)) {
+			perror("dvbdemux_set_pid_filter");
+			return -1;
+		}
+		kernel_stats(ffd);
+		close(ffd);
+		return 1;
+	}
+
 	// open the DVR device
 	fd = dvbdemux_open_dvr(adapter, demux, 1, 0);
 	if (fd < 0) {
@@ -48,11 +48,13 @@ static char *usage_str =
     "                 machine but. The user has to be root.\n"
     "     -a number : use given adapter (default 0)\n"
     "     -f number : use given frontend (default 0)\n"
-    "     -c number : samples to take (default 0 = infinite)\n\n";
+    "     -c number : samples to take (default 0 = infinite)\n"
+    "     -i        : also show the kernel's frontend status reads per minute\n\n";
 
 int sleep_time=1000000;
 int acoustical_mode=0;
 int remote=0;
+int show_reads=0;
 
 static void usage(void)
 {
@@ -119,6 +121,13 @@ int check_frontend (struct dvbfe_handle *fe, int human_readable, unsigned int co
 				fe_info.ucblocks);
 		}
 
+		if (show_reads) {
+			if (dvbfe_get_info(fe, DVBFE_INFO_STATUS_READS, &fe_info, DVBFE_INFO_QUERYTYPE_IMMEDIATE, 0) & DVBFE_INFO_STATUS_READS)
+				printf("rd/min %4u | ", fe_info.status_reads);
+			else
+				printf("rd/min  n/a | ");
+		}
+
 		if (fe_info.lock)
 			printf("FE_HAS_LOCK");
 
@@ -188,7 +197,7 @@ int main(int argc, char *argv[])
 	int human_readable = 0;
 	int opt;
 
-       while ((opt = getopt(argc, argv, "rAHa:f:c:")) != -1) {
+       while ((opt = getopt(argc, argv, "rAHia:f:c:")) != -1) {
 		switch (opt)
 		{
 		default:
@@ -206,6 +215,9 @@ int main(int argc, char *argv[])
 		case 'H':
 			human_readable = 1;
 			break;
+		case 'i':
+			show_reads = 1;
+			break;
 		case 'A':
 			// Acoustical mode: we have to reduce the delay between
 			// checks in order to hear nice sound
@@ -36,6 +36,7 @@
 #include "gnutv_dvb.h"
 #include "gnutv_ca.h"
 #include "gnutv_data.h"
+#include "gnutv_cache.h"
 
 
 static void signal_handler(int _signal);
@@ -67,12 +68,16 @@ void usage(void)
 		"						Dual LO, H:5150MHz, V:5750MHz.\n"
 		"			 * One of the sec definitions from the secfile if supplied\n"
 		" -buffer <size>	Custom DVR buffer size\n"
+		" -tsring <MB>		Size of the time-shift ring (default 1024)\n"
+		" -psicache <filename>	Cache PAT/PMT in <filename> to arm filters immediately after lock\n"
 		" -out decoder		Output to hardware decoder (default)\n"
 		"      decoderabypass	Output to hardware decoder using audio bypass\n"
 		"      dvr		Output stream to dvr device\n"
 		"      null		Do not output anything\n"
 		"      stdout		Output to stdout\n"
 		"      file <filename>	Output stream to file\n"
+		"      timeshift <name>	Output stream to a time-shift ring <name>.ts, indexed\n"
+		"			in <name>.idx; play it back with gnutv_tsplay\n"
 		"      udp <address> <port>			Output stream to address:port using udp\n"
 		"      udpif <address> <port> <interface> 	Output stream to address:port using udp\n"
 		"							forcing the specified interface\n"
@@ -82,6 +87,9 @@ void usage(void)
 		" -timeout <secs>	Number of seconds to output channel for\n"
 		"				(0=>exit immediately after successful tuning, default is to output forever)\n"
 		" -cammenu		Show the CAM menu\n"
+		" -caservice <channel name>	Also have the CAM descramble this channel, which must be\n"
+		"			on the same multiplex, for other users of the demux. May be\n"
+		"			given up to 8 times.\n"
 		" -nomoveca		Do not attempt to move CA descriptors from stream to programme level\n"
 		" <channel name>\n";
 	fprintf(stderr, "%s\n", _usage);
@@ -110,7 +118,10 @@ int main(int argc, char *argv[])
 	char *chanfile = "/etc/channels.conf";
 	char *secfile = NULL;
 	char *secid = NULL;
+	char *psicache = NULL;
 	char *channel_name = NULL;
+	char *ca_service_names[GNUTV_MAX_CA_SERVICES];
+	int ca_service_count = 0;
 	int output_type = OUTPUT_TYPE_DECODER;
 	char *outfile = NULL;
 	char *outhost = NULL;
@@ -126,6 +137,7 @@ int main(int argc, char *argv[])
 	int ffaudiofd = -1;
 	int usertp = 0;
 	int buffer_size = 0;
+	int tsring_mb = 1024;
 
 	while(argpos != argc) {
 		if (!strcmp(argv[argpos], "-h")) {
@@ -169,6 +181,18 @@ int main(int argc, char *argv[])
 				usage();
 			secid = argv[argpos+1];
 			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-psicache")) {
+			if ((argc - argpos) < 2)
+				usage();
+			psicache = argv[argpos+1];
+			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-caservice")) {
+			if ((argc - argpos) < 2)
+				usage();
+			if (ca_service_count == GNUTV_MAX_CA_SERVICES)
+				usage();
+			ca_service_names[ca_service_count++] = argv[argpos+1];
+			argpos+=2;
 		} else if (!strcmp(argv[argpos], "-buffer")) {
 			if ((argc - argpos) < 2)
 				usage();
@@ -177,6 +201,14 @@ int main(int argc, char *argv[])
 			if (buffer_size < 0)
 				usage();
 			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-tsring")) {
+			if ((argc - argpos) < 2)
+				usage();
+			if (sscanf(argv[argpos+1], "%i", &tsring_mb) != 1)
+				usage();
+			if (tsring_mb <= 0)
+				usage();
+			argpos+=2;
 		} else if (!strcmp(argv[argpos], "-out")) {
 			if ((argc - argpos) < 2)
 				usage();
@@ -196,6 +228,12 @@ int main(int argc, char *argv[])
 					usage();
 				outfile = argv[argpos+2];
 				argpos++;
+			} else if (!strcmp(argv[argpos+1], "timeshift")) {
+				output_type = OUTPUT_TYPE_TIMESHIFT;
+				if ((argc - argpos) < 3)
+					usage();
+				outfile = argv[argpos+2];
+				argpos++;
 			} else if ((!strcmp(argv[argpos+1], "udp")) ||
 				   (!strcmp(argv[argpos+1], "rtp"))) {
 				output_type = OUTPUT_TYPE_UDP;
@@ -288,6 +326,31 @@ int main(int argc, char *argv[])
 			fprintf(stderr, "Unable to find requested channel %s\n", channel_name);
 			exit(1);
 		}
+
+		// look up the extra services for the CAM
+		gnutv_dvb_params.ca_services_count = 0;
+		int i;
+		for(i=0; i < ca_service_count; i++) {
+			struct dvbcfg_zapchannel ca_channel;
+
+			if (strlen(ca_service_names[i]) >= sizeof(ca_channel.name)) {
+				fprintf(stderr, "Channel name is too long %s\n", ca_service_names[i]);
+				exit(1);
+			}
+			memcpy(ca_channel.name, ca_service_names[i], strlen(ca_service_names[i]) + 1);
+			rewind(channel_file);
+			if (dvbcfg_zapchannel_parse(channel_file, find_channel, &ca_channel) != 1) {
+				fprintf(stderr, "Unable to find requested channel %s\n", ca_service_names[i]);
+				exit(1);
+			}
+			if ((ca_channel.fe_params.frequency != gnutv_dvb_params.channel.fe_params.frequency) ||
+			    (ca_channel.polarization != gnutv_dvb_params.channel.polarization)) {
+				fprintf(stderr, "Channel %s is not on the same multiplex as %s\n",
+					ca_service_names[i], channel_name);
+				exit(1);
+			}
+			gnutv_dvb_params.ca_services[gnutv_dvb_params.ca_services_count++] = ca_channel.service_id;
+		}
 		fclose(channel_file);
 
 		// default SEC with a DVBS card
@@ -322,6 +385,12 @@ int main(int argc, char *argv[])
 			}
 		}
 
+		// load the PSI cache
+		if (psicache != NULL) {
+			if (gnutv_cache_open(psicache))
+				exit(1);
+		}
+
 		// start the DVB stuff
 		gnutv_dvb_params.adapter_id = adapter_id;
 		gnutv_dvb_params.frontend_id = frontend_id;
@@ -330,7 +399,7 @@ int main(int argc, char *argv[])
 		gnutv_dvb_start(&gnutv_dvb_params);
 
 		// start the data stuff
-		gnutv_data_start(output_type, ffaudiofd, adapter_id, demux_id, buffer_size, outfile, outif, outaddrs, usertp);
+		gnutv_data_start(output_type, ffaudiofd, adapter_id, demux_id, buffer_size, outfile, tsring_mb, outif, outaddrs, usertp);
 	}
 
 	// the UI
@@ -355,8 +424,10 @@ int main(int argc, char *argv[])
 	gnutv_data_stop();
 
 	// shutdown DVB stuff
-	if (channel_name != NULL)
+	if (channel_name != NULL) {
 		gnutv_dvb_stop();
+		gnutv_cache_close();
+	}
 
 	// shutdown CA stuff
 	gnutv_ca_stop();
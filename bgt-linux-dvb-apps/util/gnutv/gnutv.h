@@ -33,5 +33,8 @@
 #define OUTPUT_TYPE_FILE 4
 #define OUTPUT_TYPE_UDP 5
 #define OUTPUT_TYPE_STDOUT 6
+#define OUTPUT_TYPE_TIMESHIFT 7
+
+#define GNUTV_MAX_CA_SERVICES 8
 
 #endif
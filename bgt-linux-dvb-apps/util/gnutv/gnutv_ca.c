@@ -26,6 +26,7 @@
 #include <sys/poll.h>
 #include <pthread.h>
 #include <libdvben50221/en50221_stdcam.h>
+#include <libdvben50221/en50221_ca_list.h>
 #include "gnutv.h"
 #include "gnutv_ca.h"
 
@@ -55,11 +56,13 @@ static int gnutv_mmi_menu_callback(void *arg, uint8_t slot_id, uint16_t session_
 				   struct en50221_app_mmi_text *bottom,
 				   uint32_t item_count, struct en50221_app_mmi_text *items,
 				   uint32_t item_raw_length, uint8_t *items_raw);
+static int gnutv_ca_list_send(void *arg, uint8_t *ca_pmt, uint32_t ca_pmt_length);
 static void *camthread_func(void* arg);
 
 static struct en50221_transport_layer *tl = NULL;
 static struct en50221_session_layer *sl = NULL;
 static struct en50221_stdcam *stdcam = NULL;
+static struct en50221_ca_list *ca_list = NULL;
 
 static int ca_resource_connected = 0;
 static int mmi_state = MMI_STATE_CLOSED;
@@ -68,8 +71,6 @@ static int mmi_enq_length;
 
 static int camthread_shutdown = 0;
 static pthread_t camthread;
-int moveca = 0;
-int seenpmt = 0;
 int cammenu = 0;
 
 char ui_line[256];
@@ -125,8 +126,15 @@ void gnutv_ca_start(struct gnutv_ca_params *params)
 		}
 	}
 
+	// the services the CAM is asked to descramble; removed ones stay cached
+	ca_list = en50221_ca_list_create(2 * GNUTV_MAX_CA_SERVICES, params->moveca,
+					 CA_PMT_CMD_ID_OK_DESCRAMBLING, gnutv_ca_list_send, NULL);
+	if (ca_list == NULL) {
+		fprintf(stderr, "Failed to create CA list\n");
+		exit(1);
+	}
+
 	// any other stuff
-	moveca = params->moveca;
 	cammenu = params->cammenu;
 
 	// start the cam thread
@@ -151,6 +159,8 @@ void gnutv_ca_stop(void)
 
 	// destroy transport layer
 	en50221_tl_destroy(tl);
+
+	en50221_ca_list_destroy(ca_list);
 }
 
 void gnutv_ca_ui(void)
@@ -212,39 +222,27 @@ void gnutv_ca_ui(void)
 
 int gnutv_ca_new_pmt(struct mpeg_pmt_section *pmt)
 {
-	uint8_t capmt[4096];
-	int size;
-
 	if (stdcam == NULL)
 		return -1;
 
-	if (ca_resource_connected) {
-		fprintf(stderr, "Received new PMT - sending to CAM...\n");
-
-		// translate it into a CA PMT
-		int listmgmt = CA_LIST_MANAGEMENT_ONLY;
-		if (seenpmt) {
-			listmgmt = CA_LIST_MANAGEMENT_UPDATE;
-		}
-		seenpmt = 1;
-
-		if ((size = en50221_ca_format_pmt(pmt, capmt, sizeof(capmt), moveca, listmgmt,
-						  CA_PMT_CMD_ID_OK_DESCRAMBLING)) < 0) {
-			fprintf(stderr, "Failed to format PMT\n");
-			return -1;
-		}
+	// the list sends it once the CA resource connects if it has not yet
+	if (en50221_ca_list_set_pmt(ca_list, pmt) < 0) {
+		fprintf(stderr, "Failed to send PMT for service %i\n",
+			mpeg_pmt_section_program_number(pmt));
+		return -1;
+	}
 
-		// set it
-		if (en50221_app_ca_pmt(stdcam->ca_resource, stdcam->ca_session_number, capmt, size)) {
-			fprintf(stderr, "Failed to send PMT\n");
-			return -1;
-		}
+	// we've seen this PMT
+	return 1;
+}
 
-		// we've seen this PMT
-		return 1;
-	}
+void gnutv_ca_remove_service(uint16_t service_id)
+{
+	if (stdcam == NULL)
+		return;
 
-	return 0;
+	if (en50221_ca_list_remove(ca_list, service_id) > 0)
+		fprintf(stderr, "Service %i no longer selected on CAM\n", service_id);
 }
 
 void gnutv_ca_new_dvbtime(time_t dvb_time)
@@ -302,9 +300,21 @@ static int gnutv_ca_info_callback(void *arg, uint8_t slot_id, uint16_t session_n
 		fprintf(stderr, "  0x%04x\n", ca_ids[i]);
 	}
 	ca_resource_connected = 1;
+
+	// (re)send every service selected so far
+	if (en50221_ca_list_connect(ca_list) < 0)
+		fprintf(stderr, "Failed to send PMTs to CAM\n");
 	return 0;
 }
 
+static int gnutv_ca_list_send(void *arg, uint8_t *ca_pmt, uint32_t ca_pmt_length)
+{
+	(void) arg;
+
+	fprintf(stderr, "Sending PMT for service %i to CAM...\n", (ca_pmt[1] << 8) | ca_pmt[2]);
+	return en50221_app_ca_pmt(stdcam->ca_resource, stdcam->ca_session_number, ca_pmt, ca_pmt_length);
+}
+
 static int gnutv_mmi_close_callback(void *arg, uint8_t slot_id, uint16_t session_number,
 				    uint8_t cmd_id, uint8_t delay)
 {
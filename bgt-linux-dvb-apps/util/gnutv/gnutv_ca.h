@@ -35,6 +35,7 @@ extern void gnutv_ca_ui(void);
 extern void gnutv_ca_stop(void);
 
 extern int gnutv_ca_new_pmt(struct mpeg_pmt_section *pmt);
+extern void gnutv_ca_remove_service(uint16_t service_id);
 extern void gnutv_ca_new_dvbtime(time_t dvb_time);
 
 #endif
@@ -0,0 +1,313 @@
+/*
+	gnutv utility
+
+	Copyright (C) 2004, 2005 Manu Abraham <abraham.manu@gmail.com>
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "gnutv_cache.h"
+
+/*
+ * Cache file format, one line per service:
+ *
+ * <frequency>:<polarization>:<service_id>:<tsid>:<pat_version>:<pmt_pid>:<pmt_version>:<pmt hex>
+ *
+ * plus a single statistics line:
+ *
+ * #stats <lookups> <hits> <stale> <saved_ms>
+ */
+
+static char *cache_filename = NULL;
+static struct gnutv_cache_entry *entries = NULL;
+static int entries_count = 0;
+static int cache_dirty = 0;
+
+static unsigned long stats_lookups = 0;
+static unsigned long stats_hits = 0;
+static unsigned long stats_stale = 0;
+static unsigned long long stats_saved_ms = 0;
+static int last_saved_ms = -1;
+
+static struct gnutv_cache_entry *gnutv_cache_find(uint32_t frequency, char polarization,
+						  uint16_t service_id);
+static struct gnutv_cache_entry *gnutv_cache_get(uint32_t frequency, char polarization,
+						 uint16_t service_id);
+static int gnutv_cache_parse_line(char *line);
+
+int gnutv_cache_open(char *filename)
+{
+	FILE *f;
+	char line[(GNUTV_CACHE_MAX_SECTION * 2) + 128];
+
+	cache_filename = filename;
+
+	f = fopen(filename, "r");
+	if (f == NULL) {
+		if (errno == ENOENT)
+			return 0;
+		fprintf(stderr, "Unable to open PSI cache %s: %m\n", filename);
+		return -1;
+	}
+
+	while(fgets(line, sizeof(line), f)) {
+		if (!strncmp(line, "#stats ", 7)) {
+			sscanf(line + 7, "%lu %lu %lu %llu",
+			       &stats_lookups, &stats_hits, &stats_stale, &stats_saved_ms);
+			continue;
+		}
+		if ((line[0] == '#') || (line[0] == '\n'))
+			continue;
+
+		if (gnutv_cache_parse_line(line))
+			fprintf(stderr, "Ignoring corrupt PSI cache entry\n");
+	}
+
+	fclose(f);
+	return 0;
+}
+
+void gnutv_cache_close(void)
+{
+	FILE *f;
+	int i;
+	int j;
+
+	if (cache_filename == NULL)
+		return;
+
+	if (cache_dirty) {
+		f = fopen(cache_filename, "w");
+		if (f == NULL) {
+			fprintf(stderr, "Unable to write PSI cache %s: %m\n", cache_filename);
+		} else {
+			fprintf(f, "#stats %lu %lu %lu %llu\n",
+				stats_lookups, stats_hits, stats_stale, stats_saved_ms);
+
+			for(i=0; i < entries_count; i++) {
+				struct gnutv_cache_entry *entry = &entries[i];
+
+				// only entries with a complete PAT + PMT are useful
+				if (entry->pmt_length == 0)
+					continue;
+
+				fprintf(f, "%u:%c:%u:%u:%u:%u:%u:",
+					entry->frequency, entry->polarization,
+					entry->service_id, entry->transport_stream_id,
+					entry->pat_version, entry->pmt_pid, entry->pmt_version);
+				for(j=0; j < entry->pmt_length; j++)
+					fprintf(f, "%02x", entry->pmt[j]);
+				fprintf(f, "\n");
+			}
+			fclose(f);
+		}
+	}
+
+	if (entries)
+		free(entries);
+	entries = NULL;
+	entries_count = 0;
+	cache_filename = NULL;
+}
+
+struct gnutv_cache_entry *gnutv_cache_lookup(uint32_t frequency, char polarization,
+					     uint16_t service_id)
+{
+	struct gnutv_cache_entry *entry;
+
+	if (cache_filename == NULL)
+		return NULL;
+
+	stats_lookups++;
+	cache_dirty = 1;
+
+	entry = gnutv_cache_find(frequency, polarization, service_id);
+	if ((entry == NULL) || (entry->pmt_length == 0))
+		return NULL;
+
+	return entry;
+}
+
+void gnutv_cache_update_pat(uint32_t frequency, char polarization, uint16_t service_id,
+			    uint16_t transport_stream_id, uint8_t pat_version,
+			    uint16_t pmt_pid)
+{
+	struct gnutv_cache_entry *entry;
+
+	if (cache_filename == NULL)
+		return;
+
+	entry = gnutv_cache_get(frequency, polarization, service_id);
+	if (entry == NULL)
+		return;
+
+	// a different multiplex or PMT PID invalidates the cached PMT
+	if ((entry->transport_stream_id != transport_stream_id) ||
+	    (entry->pmt_pid != pmt_pid))
+		entry->pmt_length = 0;
+
+	entry->transport_stream_id = transport_stream_id;
+	entry->pat_version = pat_version;
+	entry->pmt_pid = pmt_pid;
+	cache_dirty = 1;
+}
+
+void gnutv_cache_update_pmt(uint32_t frequency, char polarization, uint16_t service_id,
+			    uint8_t pmt_version, uint8_t *pmt, int pmt_length)
+{
+	struct gnutv_cache_entry *entry;
+
+	if (cache_filename == NULL)
+		return;
+	if ((pmt_length <= 0) || (pmt_length > GNUTV_CACHE_MAX_SECTION))
+		return;
+
+	entry = gnutv_cache_get(frequency, polarization, service_id);
+	if (entry == NULL)
+		return;
+
+	if ((entry->pmt_version == pmt_version) &&
+	    (entry->pmt_length == pmt_length) &&
+	    (!memcmp(entry->pmt, pmt, pmt_length)))
+		return;
+
+	entry->pmt_version = pmt_version;
+	entry->pmt_length = pmt_length;
+	memcpy(entry->pmt, pmt, pmt_length);
+	cache_dirty = 1;
+}
+
+void gnutv_cache_record(int hit, int saved_ms)
+{
+	if (cache_filename == NULL)
+		return;
+
+	if (hit) {
+		stats_hits++;
+		if (saved_ms > 0)
+			stats_saved_ms += saved_ms;
+		last_saved_ms = saved_ms;
+	} else {
+		stats_stale++;
+		last_saved_ms = 0;
+	}
+	cache_dirty = 1;
+}
+
+void gnutv_cache_report(void)
+{
+	if (cache_filename == NULL)
+		return;
+
+	fprintf(stderr, "PSI cache: %lu/%lu hits (%lu%%), %lu stale",
+		stats_hits, stats_lookups,
+		stats_lookups ? (stats_hits * 100) / stats_lookups : 0,
+		stats_stale);
+	if (last_saved_ms >= 0)
+		fprintf(stderr, ", saved %ims this zap", last_saved_ms);
+	fprintf(stderr, ", %llums in total\n", stats_saved_ms);
+}
+
+static struct gnutv_cache_entry *gnutv_cache_find(uint32_t frequency, char polarization,
+						  uint16_t service_id)
+{
+	int i;
+
+	for(i=0; i < entries_count; i++) {
+		if ((entries[i].frequency == frequency) &&
+		    (entries[i].polarization == polarization) &&
+		    (entries[i].service_id == service_id))
+			return &entries[i];
+	}
+
+	return NULL;
+}
+
+static struct gnutv_cache_entry *gnutv_cache_get(uint32_t frequency, char polarization,
+						 uint16_t service_id)
+{
+	struct gnutv_cache_entry *tmp;
+
+	if ((tmp = gnutv_cache_find(frequency, polarization, service_id)) != NULL)
+		return tmp;
+
+	if ((tmp = realloc(entries, (entries_count + 1) * sizeof(struct gnutv_cache_entry))) == NULL) {
+		fprintf(stderr, "Out of memory when adding a PSI cache entry\n");
+		return NULL;
+	}
+	entries = tmp;
+
+	tmp = &entries[entries_count++];
+	memset(tmp, 0, sizeof(struct gnutv_cache_entry));
+	tmp->frequency = frequency;
+	tmp->polarization = polarization;
+	tmp->service_id = service_id;
+	tmp->pat_version = 0xff;
+	tmp->pmt_version = 0xff;
+	return tmp;
+}
+
+static int gnutv_cache_parse_line(char *line)
+{
+	unsigned int frequency;
+	char polarization;
+	unsigned int service_id;
+	unsigned int tsid;
+	unsigned int pat_version;
+	unsigned int pmt_pid;
+	unsigned int pmt_version;
+	int pos = 0;
+	int len;
+	struct gnutv_cache_entry *entry;
+
+	if (sscanf(line, "%u:%c:%u:%u:%u:%u:%u:%n",
+		   &frequency, &polarization, &service_id, &tsid,
+		   &pat_version, &pmt_pid, &pmt_version, &pos) != 7)
+		return -1;
+	if ((service_id > 0xffff) || (tsid > 0xffff) || (pmt_pid > 0x1fff) ||
+	    (pat_version > 31) || (pmt_version > 31))
+		return -1;
+
+	line += pos;
+	len = strcspn(line, "\r\n");
+	if ((len == 0) || (len & 1) || ((len / 2) > GNUTV_CACHE_MAX_SECTION))
+		return -1;
+
+	entry = gnutv_cache_get(frequency, polarization, service_id);
+	if (entry == NULL)
+		return -1;
+
+	entry->transport_stream_id = tsid;
+	entry->pat_version = pat_version;
+	entry->pmt_pid = pmt_pid;
+	entry->pmt_version = pmt_version;
+	entry->pmt_length = len / 2;
+	for(pos=0; pos < entry->pmt_length; pos++) {
+		unsigned int byte;
+		if (sscanf(line + (pos * 2), "%2x", &byte) != 1) {
+			entry->pmt_length = 0;
+			return -1;
+		}
+		entry->pmt[pos] = byte;
+	}
+
+	return 0;
+}
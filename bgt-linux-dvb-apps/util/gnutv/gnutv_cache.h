@@ -0,0 +1,97 @@
+/*
+	gnutv utility
+
+	Copyright (C) 2004, 2005 Manu Abraham <abraham.manu@gmail.com>
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef gnutv_CACHE_H
+#define gnutv_CACHE_H 1
+
+#include <stdint.h>
+
+#define GNUTV_CACHE_MAX_SECTION 1024
+
+/**
+ * A cached PAT/PMT entry for one service.
+ *
+ * Entries are found before lock using the tuning parameters, and are then
+ * validated against the live PAT (transport_stream_id + version) and
+ * live PMT (version).
+ */
+struct gnutv_cache_entry {
+	uint32_t frequency;
+	char polarization;
+	uint16_t service_id;
+	uint16_t transport_stream_id;
+	uint8_t pat_version;
+	uint16_t pmt_pid;
+	uint8_t pmt_version;
+	int pmt_length;
+	uint8_t pmt[GNUTV_CACHE_MAX_SECTION];
+};
+
+/**
+ * Load the PSI cache from a file. A missing file is not an error.
+ *
+ * @param filename Name of the cache file.
+ * @return 0 on success, -1 on failure.
+ */
+extern int gnutv_cache_open(char *filename);
+
+/**
+ * Write the PSI cache back to its file and release it.
+ */
+extern void gnutv_cache_close(void);
+
+/**
+ * Look up an entry before lock. This counts as a cache lookup in the
+ * statistics.
+ *
+ * @return The entry or NULL if the service has not been seen before.
+ */
+extern struct gnutv_cache_entry *gnutv_cache_lookup(uint32_t frequency, char polarization,
+						    uint16_t service_id);
+
+/**
+ * Store details from a live PAT.
+ */
+extern void gnutv_cache_update_pat(uint32_t frequency, char polarization, uint16_t service_id,
+				   uint16_t transport_stream_id, uint8_t pat_version,
+				   uint16_t pmt_pid);
+
+/**
+ * Store a live PMT. The section is supplied raw, i.e. before section_codec().
+ */
+extern void gnutv_cache_update_pmt(uint32_t frequency, char polarization, uint16_t service_id,
+				   uint8_t pmt_version, uint8_t *pmt, int pmt_length);
+
+/**
+ * Record the result of validating a cached entry against live data.
+ *
+ * @param hit 1 if the cached PAT/PMT matched the live tables, 0 if stale.
+ * @param saved_ms Milliseconds between arming from the cache and the live PMT arriving.
+ */
+extern void gnutv_cache_record(int hit, int saved_ms);
+
+/**
+ * Print the cache statistics to stderr.
+ */
+extern void gnutv_cache_report(void);
+
+#endif
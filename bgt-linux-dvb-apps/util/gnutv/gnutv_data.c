@@ -43,6 +43,7 @@
 #include "gnutv_dvb.h"
 #include "gnutv_ca.h"
 #include "gnutv_data.h"
+#include "gnutv_timeshift.h"
 
 static void *fileoutputthread_func(void* arg);
 static void *udpoutputthread_func(void* arg);
@@ -62,6 +63,7 @@ static int dvrfd = -1;
 static int pat_fd_dvrout = -1;
 static int pmt_fd_dvrout = -1;
 static int outputthread_shutdown = 0;
+static struct gnutv_timeshift *timeshift = NULL;
 
 static int usertp = 0;
 static int adapter_id = -1;
@@ -78,7 +80,7 @@ static int pid_fds_count = 0;
 
 void gnutv_data_start(int _output_type,
 		    int ffaudiofd, int _adapter_id, int _demux_id, int buffer_size,
-		    char *outfile,
+		    char *outfile, int tsring_mb,
 		    char* outif, struct addrinfo *_outaddrs, int _usertp)
 {
 	usertp = _usertp;
@@ -96,6 +98,7 @@ void gnutv_data_start(int _output_type,
 
 	case OUTPUT_TYPE_STDOUT:
 	case OUTPUT_TYPE_FILE:
+	case OUTPUT_TYPE_TIMESHIFT:
 		if (output_type == OUTPUT_TYPE_FILE) {
 			// open output file
 			outfd = open(outfile, O_WRONLY|O_CREAT|O_LARGEFILE|O_TRUNC, 0644);
@@ -103,6 +106,11 @@ void gnutv_data_start(int _output_type,
 				fprintf(stderr, "Failed to open output file\n");
 				exit(1);
 			}
+		} else if (output_type == OUTPUT_TYPE_TIMESHIFT) {
+			// preallocate the ring and its index
+			timeshift = gnutv_timeshift_create(outfile, tsring_mb);
+			if (timeshift == NULL)
+				exit(1);
 		} else {
 			outfd = STDOUT_FILENO;
 		}
@@ -167,6 +175,7 @@ void gnutv_data_start(int _output_type,
 	case OUTPUT_TYPE_DVR:
 	case OUTPUT_TYPE_FILE:
 	case OUTPUT_TYPE_STDOUT:
+	case OUTPUT_TYPE_TIMESHIFT:
 	case OUTPUT_TYPE_UDP:
 		pat_fd_dvrout = gnutv_data_create_dvr_filter(adapter_id, demux_id, TRANSPORT_PAT_PID);
 	}
@@ -180,6 +189,13 @@ void gnutv_data_stop()
 		pthread_join(outputthread, NULL);
 	}
 	gnutv_data_free_pid_fds();
+	if (timeshift != NULL) {
+		fprintf(stderr, "Time-shift: %llu bytes, %llu index entries, %llu access points\n",
+			(unsigned long long) timeshift->header->written,
+			(unsigned long long) timeshift->header->entries,
+			(unsigned long long) timeshift->rap_count);
+		gnutv_timeshift_close(timeshift);
+	}
 	if (pat_fd_dvrout != -1)
 		close(pat_fd_dvrout);
 	if (pmt_fd_dvrout != -1)
@@ -195,6 +211,7 @@ void gnutv_data_new_pat(int pmt_pid)
 	case OUTPUT_TYPE_DVR:
 	case OUTPUT_TYPE_FILE:
 	case OUTPUT_TYPE_STDOUT:
+	case OUTPUT_TYPE_TIMESHIFT:
 	case OUTPUT_TYPE_UDP:
 		if (pmt_fd_dvrout != -1)
 			close(pmt_fd_dvrout);
@@ -217,6 +234,7 @@ int gnutv_data_new_pmt(struct mpeg_pmt_section *pmt)
 	case OUTPUT_TYPE_DVR:
 	case OUTPUT_TYPE_FILE:
 	case OUTPUT_TYPE_STDOUT:
+	case OUTPUT_TYPE_TIMESHIFT:
 	case OUTPUT_TYPE_UDP:
 		gnutv_data_dvr_pmt(pmt);
 		break;
@@ -261,6 +279,12 @@ static void *fileoutputthread_func(void* arg)
 			return 0;
 		}
 
+		if (timeshift != NULL) {
+			if (gnutv_timeshift_write(timeshift, buf, size))
+				return 0;
+			continue;
+		}
+
 		written = 0;
 		while(written < size) {
 			int tmp = write(outfd, buf + written, size - written);
@@ -27,7 +27,7 @@
 
 extern void gnutv_data_start(int output_type,
 			   int ffaudiofd, int adapter_id, int demux_id, int buffer_size,
-			   char *outfile,
+			   char *outfile, int tsring_mb,
 			   char* outif, struct addrinfo *outaddrs, int usertp);
 extern void gnutv_data_stop(void);
 
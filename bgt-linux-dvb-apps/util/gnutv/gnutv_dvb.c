@@ -28,6 +28,7 @@
 #include <pthread.h>
 #include <errno.h>
 #include <sys/poll.h>
+#include <sys/time.h>
 #include <libdvbapi/dvbdemux.h>
 #include <libucsi/section.h>
 #include <libucsi/mpeg/section.h>
@@ -36,6 +37,7 @@
 #include "gnutv_dvb.h"
 #include "gnutv_data.h"
 #include "gnutv_ca.h"
+#include "gnutv_cache.h"
 
 #define FE_STATUS_PARAMS (DVBFE_INFO_LOCKSTATUS|DVBFE_INFO_SIGNAL_STRENGTH|DVBFE_INFO_BER|DVBFE_INFO_SNR|DVBFE_INFO_UNCORRECTED_BLOCKS)
 
@@ -46,13 +48,41 @@ static int tune_state = 0;
 static int pat_version = -1;
 static int ca_pmt_version = -1;
 static int data_pmt_version = -1;
+static int cur_pmt_pid = -1;
+
+static int cache_pending = 0;
+static int cache_report_pending = 0;
+static uint16_t cache_tsid;
+static uint8_t cache_pat_version;
+static uint16_t cache_pmt_pid;
+static uint8_t cache_pmt_version;
+static struct timeval lock_time;
+static struct timeval cache_armed_time;
+
+// further services the CAM descrambles; their PMTs only go to the CA list
+struct ca_service {
+	uint16_t service_id;
+	int pmt_pid;
+	int pmt_fd;
+	int pmt_version;
+};
+static struct ca_service ca_services[GNUTV_MAX_CA_SERVICES];
+static int ca_services_count = 0;
 
 static void *dvbthread_func(void* arg);
 
-static void process_pat(int pat_fd, struct gnutv_dvb_params *params, int *pmt_fd, struct pollfd *pollfd);
+static void process_cache(struct gnutv_dvb_params *params, int *pmt_fd, struct pollfd *pollfd);
+static void process_pat(int pat_fd, struct gnutv_dvb_params *params, int *pmt_fd, struct pollfd *pollfd,
+			struct pollfd *ca_pollfds);
+static void process_ca_services_pat(struct gnutv_dvb_params *params, struct mpeg_pat_section *pat,
+				    struct pollfd *ca_pollfds);
+static void process_ca_service_pmt(struct ca_service *service);
 static void process_tdt(int tdt_fd);
 static void process_pmt(int pmt_fd, struct gnutv_dvb_params *params);
 static int create_section_filter(int adapter, int demux, uint16_t pid, uint8_t table_id);
+static int set_pmt_filter(struct gnutv_dvb_params *params, uint16_t pmt_pid, int *pmt_fd, struct pollfd *pollfd);
+static char cache_polarization(struct gnutv_dvb_params *params);
+static int elapsed_ms(struct timeval *since);
 
 
 int gnutv_dvb_start(struct gnutv_dvb_params *params)
@@ -77,7 +107,8 @@ static void *dvbthread_func(void* arg)
 	int pat_fd = -1;
 	int pmt_fd = -1;
 	int tdt_fd = -1;
-	struct pollfd pollfds[3];
+	struct pollfd pollfds[3 + GNUTV_MAX_CA_SERVICES];
+	int i;
 
 	struct gnutv_dvb_params *params = (struct gnutv_dvb_params *) arg;
 
@@ -104,6 +135,17 @@ static void *dvbthread_func(void* arg)
 	pollfds[2].fd = 0;
 	pollfds[2].events = 0;
 
+	// zero PMT filters of the extra CA services
+	ca_services_count = params->ca_services_count;
+	for(i=0; i < ca_services_count; i++) {
+		ca_services[i].service_id = params->ca_services[i];
+		ca_services[i].pmt_pid = -1;
+		ca_services[i].pmt_fd = -1;
+		ca_services[i].pmt_version = -1;
+		pollfds[3 + i].fd = -1;
+		pollfds[3 + i].events = 0;
+	}
+
 	// the DVB loop
 	while(!dvbthread_shutdown) {
 		// tune frontend + monitor lock status
@@ -137,16 +179,29 @@ static void *dvbthread_func(void* arg)
 				sec = &params->sec;
 
 			// tune!
-			if (dvbsec_set(params->fe,
-			    		  sec,
-					  params->channel.polarization,
-					  (params->channel.diseqc_switch & 0x01) ? DISEQC_SWITCH_B : DISEQC_SWITCH_A,
-					  (params->channel.diseqc_switch & 0x02) ? DISEQC_SWITCH_B : DISEQC_SWITCH_A,
-					  &params->channel.fe_params,
-					  0)) {
+			struct dvbsec_state *secstate = dvbsec_state_create(params->fe);
+			if (secstate == NULL) {
+				fprintf(stderr, "Failed to create SEC state\n");
+				exit(1);
+			}
+			if (dvbsec_state_set(secstate,
+					     sec,
+					     params->channel.polarization,
+					     (params->channel.diseqc_switch & 0x01) ? DISEQC_SWITCH_B : DISEQC_SWITCH_A,
+					     (params->channel.diseqc_switch & 0x02) ? DISEQC_SWITCH_B : DISEQC_SWITCH_A,
+					     &params->channel.fe_params,
+					     0)) {
 				fprintf(stderr, "Failed to set frontend\n");
 				exit(1);
 			}
+			if (sec) {
+				struct dvbsec_state_stats secstats;
+				dvbsec_state_get_stats(secstate, &secstats);
+				fprintf(stderr, "SEC: %u.%03ums, %u steps\n",
+					secstats.last_us / 1000, secstats.last_us % 1000,
+					secstats.last_sent);
+			}
+			dvbsec_state_destroy(secstate);
 
 			tune_state++;
 		} else if (tune_state == 1) {
@@ -175,13 +230,17 @@ static void *dvbthread_func(void* arg)
 				tune_state++;
 				fprintf(stderr, "\n");
 				fflush(stderr);
+
+				// arm the filters from the PSI cache if possible
+				gettimeofday(&lock_time, NULL);
+				process_cache(params, &pmt_fd, &pollfds[2]);
 			} else {
 				usleep(500000);
 			}
 		}
 
 		// is there SI data?
-		int count = poll(pollfds, 3, 100);
+		int count = poll(pollfds, 3 + ca_services_count, 100);
 		if (count < 0) {
 			if (errno != EINTR)
 				fprintf(stderr, "Poll error: %m\n");
@@ -193,7 +252,7 @@ static void *dvbthread_func(void* arg)
 
 		// PAT
 		if (pollfds[0].revents & (POLLIN|POLLPRI)) {
-			process_pat(pat_fd, params, &pmt_fd, &pollfds[2]);
+			process_pat(pat_fd, params, &pmt_fd, &pollfds[2], &pollfds[3]);
 		}
 
 		// TDT
@@ -205,6 +264,12 @@ static void *dvbthread_func(void* arg)
 		if (pollfds[2].revents & (POLLIN|POLLPRI)) {
 			process_pmt(pmt_fd, params);
 		}
+
+		// PMTs of the extra CA services
+		for(i=0; i < ca_services_count; i++) {
+			if (pollfds[3 + i].revents & (POLLIN|POLLPRI))
+				process_ca_service_pmt(&ca_services[i]);
+		}
 	}
 
 	// close demuxers
@@ -214,11 +279,58 @@ static void *dvbthread_func(void* arg)
 		close(pmt_fd);
 	if (tdt_fd != -1)
 		close(tdt_fd);
+	for(i=0; i < ca_services_count; i++) {
+		if (ca_services[i].pmt_fd != -1)
+			close(ca_services[i].pmt_fd);
+	}
 
 	return 0;
 }
 
-static void process_pat(int pat_fd, struct gnutv_dvb_params *params, int *pmt_fd, struct pollfd *pollfd)
+static void process_cache(struct gnutv_dvb_params *params, int *pmt_fd, struct pollfd *pollfd)
+{
+	struct gnutv_cache_entry *entry;
+	uint8_t sibuf[GNUTV_CACHE_MAX_SECTION];
+
+	entry = gnutv_cache_lookup(params->channel.fe_params.frequency,
+				   cache_polarization(params),
+				   params->channel.service_id);
+	cache_report_pending = 1;
+	if (entry == NULL)
+		return;
+
+	// decode a copy; the codecs modify the buffer in place
+	memcpy(sibuf, entry->pmt, entry->pmt_length);
+	struct section *section = section_codec(sibuf, entry->pmt_length);
+	if (section == NULL)
+		return;
+	struct section_ext *section_ext = section_ext_decode(section, 1);
+	if (section_ext == NULL)
+		return;
+	struct mpeg_pmt_section *pmt = mpeg_pmt_section_codec(section_ext);
+	if (pmt == NULL)
+		return;
+
+	cache_tsid = entry->transport_stream_id;
+	cache_pat_version = entry->pat_version;
+	cache_pmt_pid = entry->pmt_pid;
+	cache_pmt_version = entry->pmt_version;
+
+	// listen for the live PMT straight away rather than waiting for a PAT
+	if (set_pmt_filter(params, cache_pmt_pid, pmt_fd, pollfd))
+		return;
+
+	// arm the output filters from the cached PMT
+	if (gnutv_data_new_pmt(pmt) == 1)
+		data_pmt_version = pmt->head.version_number;
+
+	gettimeofday(&cache_armed_time, NULL);
+	cache_pending = 1;
+	fprintf(stderr, "PSI cache: filters armed %ims after lock\n", elapsed_ms(&lock_time));
+}
+
+static void process_pat(int pat_fd, struct gnutv_dvb_params *params, int *pmt_fd, struct pollfd *pollfd,
+			struct pollfd *ca_pollfds)
 {
 	int size;
 	uint8_t sibuf[4096];
@@ -249,23 +361,37 @@ static void process_pat(int pat_fd, struct gnutv_dvb_params *params, int *pmt_fd
 		return;
 	}
 
+	// follow the extra CA services
+	process_ca_services_pat(params, pat, ca_pollfds);
+
 	// try and find the requested program
 	struct mpeg_pat_program *cur_program;
 	mpeg_pat_section_programs_for_each(pat, cur_program) {
 		if (cur_program->program_number == params->channel.service_id) {
-			// close old PMT fd
-			if (*pmt_fd != -1)
-				close(*pmt_fd);
-
-			// create PMT filter
-			if ((*pmt_fd = create_section_filter(params->adapter_id, params->demux_id,
-							     cur_program->pid, stag_mpeg_program_map)) < 0) {
-				return;
+			gnutv_cache_update_pat(params->channel.fe_params.frequency,
+					       cache_polarization(params),
+					       params->channel.service_id,
+					       section_ext->table_id_ext,
+					       section_ext->version_number,
+					       cur_program->pid);
+
+			// the cached PAT was for a different multiplex, PAT or PMT
+			if (cache_pending &&
+			    ((section_ext->table_id_ext != cache_tsid) ||
+			     (section_ext->version_number != cache_pat_version) ||
+			     (cur_program->pid != cache_pmt_pid))) {
+				fprintf(stderr, "PSI cache: stale PAT, re-arming filters\n");
+				gnutv_cache_record(0, 0);
+				cache_pending = 0;
+				data_pmt_version = -1;
 			}
-			pollfd->fd = *pmt_fd;
-			pollfd->events = POLLIN|POLLPRI|POLLERR;
 
-			gnutv_data_new_pat(cur_program->pid);
+			// nothing to do if we are already on the right PMT
+			if ((cur_program->pid == cur_pmt_pid) && (*pmt_fd != -1))
+				break;
+
+			if (set_pmt_filter(params, cur_program->pid, pmt_fd, pollfd))
+				return;
 
 			// we have a new PMT pid
 			data_pmt_version = -1;
@@ -278,6 +404,89 @@ static void process_pat(int pat_fd, struct gnutv_dvb_params *params, int *pmt_fd
 	pat_version = section_ext->version_number;
 }
 
+static void process_ca_services_pat(struct gnutv_dvb_params *params, struct mpeg_pat_section *pat,
+				    struct pollfd *ca_pollfds)
+{
+	struct mpeg_pat_program *cur_program;
+	int i;
+
+	for(i=0; i < ca_services_count; i++) {
+		struct ca_service *service = &ca_services[i];
+		int pmt_pid = -1;
+
+		mpeg_pat_section_programs_for_each(pat, cur_program) {
+			if (cur_program->program_number == service->service_id) {
+				pmt_pid = cur_program->pid;
+				break;
+			}
+		}
+		if ((pmt_pid == service->pmt_pid) && ((pmt_pid == -1) || (service->pmt_fd != -1)))
+			continue;
+
+		// drop the old filter
+		if (service->pmt_fd != -1) {
+			close(service->pmt_fd);
+			service->pmt_fd = -1;
+			ca_pollfds[i].fd = -1;
+			ca_pollfds[i].events = 0;
+		}
+		service->pmt_pid = pmt_pid;
+
+		// the service left the multiplex
+		if (pmt_pid == -1) {
+			if (service->pmt_version != -1)
+				gnutv_ca_remove_service(service->service_id);
+			service->pmt_version = -1;
+			continue;
+		}
+
+		if ((service->pmt_fd = create_section_filter(params->adapter_id, params->demux_id,
+							     pmt_pid, stag_mpeg_program_map)) < 0) {
+			fprintf(stderr, "Failed to create PMT section filter for service %i\n",
+				service->service_id);
+			continue;
+		}
+		ca_pollfds[i].fd = service->pmt_fd;
+		ca_pollfds[i].events = POLLIN|POLLPRI|POLLERR;
+	}
+}
+
+static void process_ca_service_pmt(struct ca_service *service)
+{
+	int size;
+	uint8_t sibuf[4096];
+
+	// read the section
+	if ((size = read(service->pmt_fd, sibuf, sizeof(sibuf))) < 0) {
+		return;
+	}
+
+	// parse section
+	struct section *section = section_codec(sibuf, size);
+	if (section == NULL) {
+		return;
+	}
+
+	// parse section_ext
+	struct section_ext *section_ext = section_ext_decode(section, 0);
+	if (section_ext == NULL) {
+		return;
+	}
+	if (section_ext->table_id_ext != service->service_id)
+		return;
+	if (section_ext->version_number == service->pmt_version)
+		return;
+
+	// parse PMT
+	struct mpeg_pmt_section *pmt = mpeg_pmt_section_codec(section_ext);
+	if (pmt == NULL) {
+		return;
+	}
+
+	if (gnutv_ca_new_pmt(pmt) == 1)
+		service->pmt_version = pmt->head.version_number;
+}
+
 static void process_tdt(int tdt_fd)
 {
 	int size;
@@ -308,12 +517,17 @@ static void process_pmt(int pmt_fd, struct gnutv_dvb_params *params)
 {
 	int size;
 	uint8_t sibuf[4096];
+	uint8_t rawbuf[GNUTV_CACHE_MAX_SECTION];
 
 	// read the section
 	if ((size = read(pmt_fd, sibuf, sizeof(sibuf))) < 0) {
 		return;
 	}
 
+	// keep the raw section for the PSI cache
+	if (size <= GNUTV_CACHE_MAX_SECTION)
+		memcpy(rawbuf, sibuf, size);
+
 	// parse section
 	struct section *section = section_codec(sibuf, size);
 	if (section == NULL) {
@@ -325,9 +539,26 @@ static void process_pmt(int pmt_fd, struct gnutv_dvb_params *params)
 	if (section_ext == NULL) {
 		return;
 	}
-	if ((section_ext->table_id_ext != params->channel.service_id) ||
-	    ((section_ext->version_number == data_pmt_version) &&
-	     (section_ext->version_number == ca_pmt_version))) {
+	if (section_ext->table_id_ext != params->channel.service_id)
+		return;
+
+	// validate the cached PMT against the first live one
+	if (cache_pending) {
+		if (section_ext->version_number == cache_pmt_version) {
+			gnutv_cache_record(1, elapsed_ms(&cache_armed_time));
+		} else {
+			fprintf(stderr, "PSI cache: PMT version changed, re-arming filters\n");
+			gnutv_cache_record(0, 0);
+		}
+		cache_pending = 0;
+	}
+	if (cache_report_pending) {
+		gnutv_cache_report();
+		cache_report_pending = 0;
+	}
+
+	if ((section_ext->version_number == data_pmt_version) &&
+	    (section_ext->version_number == ca_pmt_version)) {
 		return;
 	}
 
@@ -337,6 +568,13 @@ static void process_pmt(int pmt_fd, struct gnutv_dvb_params *params)
 		return;
 	}
 
+	if (size <= GNUTV_CACHE_MAX_SECTION)
+		gnutv_cache_update_pmt(params->channel.fe_params.frequency,
+				       cache_polarization(params),
+				       params->channel.service_id,
+				       section_ext->version_number,
+				       rawbuf, size);
+
 	// do data handling
 	if (section_ext->version_number != data_pmt_version) {
 		if (gnutv_data_new_pmt(pmt) == 1)
@@ -374,3 +612,39 @@ static int create_section_filter(int adapter, int demux, uint16_t pid, uint8_t t
 	// done
 	return demux_fd;
 }
+
+static int set_pmt_filter(struct gnutv_dvb_params *params, uint16_t pmt_pid, int *pmt_fd, struct pollfd *pollfd)
+{
+	// close old PMT fd
+	if (*pmt_fd != -1)
+		close(*pmt_fd);
+
+	// create PMT filter
+	if ((*pmt_fd = create_section_filter(params->adapter_id, params->demux_id,
+					     pmt_pid, stag_mpeg_program_map)) < 0) {
+		cur_pmt_pid = -1;
+		return -1;
+	}
+	pollfd->fd = *pmt_fd;
+	pollfd->events = POLLIN|POLLPRI|POLLERR;
+	cur_pmt_pid = pmt_pid;
+
+	gnutv_data_new_pat(pmt_pid);
+	return 0;
+}
+
+static char cache_polarization(struct gnutv_dvb_params *params)
+{
+	if (params->channel.fe_type != DVBFE_TYPE_DVBS)
+		return '-';
+	return params->channel.polarization;
+}
+
+static int elapsed_ms(struct timeval *since)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return ((now.tv_sec - since->tv_sec) * 1000) +
+		((now.tv_usec - since->tv_usec) / 1000);
+}
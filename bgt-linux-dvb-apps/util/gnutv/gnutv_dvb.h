@@ -35,6 +35,10 @@ struct gnutv_dvb_params {
 	int valid_sec;
 	int output_type;
 	struct dvbfe_handle *fe;
+
+	/* further services on the multiplex for the CAM to descramble */
+	uint16_t ca_services[GNUTV_MAX_CA_SERVICES];
+	int ca_services_count;
 };
 
 extern int gnutv_dvb_start(struct gnutv_dvb_params *params);
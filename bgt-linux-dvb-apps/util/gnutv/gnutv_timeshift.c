@@ -0,0 +1,422 @@
+/*
+	gnutv utility
+
+	Copyright (C) 2004, 2005 Manu Abraham <abraham.manu@gmail.com>
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#define _FILE_OFFSET_BITS 64
+#define _LARGEFILE_SOURCE 1
+#define _LARGEFILE64_SOURCE 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <libucsi/transport_packet.h>
+#include "gnutv_timeshift.h"
+
+/* one index entry per this many ring bytes is plenty for RAPs + PCRs */
+#define INDEX_BYTES_PER_ENTRY 4096
+
+/* at most one PCR-only entry per this many ms */
+#define PCR_INTERVAL_MS 100
+
+static uint64_t timeshift_clock_ms(void);
+static int timeshift_map(struct gnutv_timeshift *ts, int prot);
+static void timeshift_scan(struct gnutv_timeshift *ts, uint8_t *buf, int size, uint64_t offset);
+static void timeshift_packet(struct gnutv_timeshift *ts, uint8_t *buf, uint64_t offset);
+static uint64_t timeshift_oldest(struct gnutv_ts_header *header, uint64_t ring_size);
+static struct gnutv_ts_entry *timeshift_entry(struct gnutv_timeshift *ts, uint64_t seq);
+
+struct gnutv_timeshift *gnutv_timeshift_create(char *name, int size_mb)
+{
+	struct gnutv_timeshift *ts;
+	char filename[PATH_MAX];
+	int segments;
+	int err;
+
+	segments = ((uint64_t) size_mb * 1024 * 1024) / GNUTV_TS_SEGMENT_SIZE;
+	if (segments < GNUTV_TS_MIN_SEGMENTS)
+		segments = GNUTV_TS_MIN_SEGMENTS;
+
+	if ((ts = malloc(sizeof(struct gnutv_timeshift))) == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return NULL;
+	}
+	memset(ts, 0, sizeof(struct gnutv_timeshift));
+	ts->ring_size = (uint64_t) segments * GNUTV_TS_SEGMENT_SIZE;
+	ts->idxfd = -1;
+
+	// the ring itself
+	snprintf(filename, sizeof(filename), "%s.ts", name);
+	ts->datafd = open(filename, O_RDWR|O_CREAT|O_LARGEFILE|O_TRUNC, 0644);
+	if (ts->datafd < 0) {
+		fprintf(stderr, "Failed to open time-shift file %s: %m\n", filename);
+		goto fail;
+	}
+	if ((err = posix_fallocate(ts->datafd, 0, ts->ring_size)) != 0) {
+		fprintf(stderr, "Failed to allocate %llu bytes for %s: %s\n",
+			(unsigned long long) ts->ring_size, filename, strerror(err));
+		goto fail;
+	}
+
+	// the index
+	snprintf(filename, sizeof(filename), "%s.idx", name);
+	ts->idxfd = open(filename, O_RDWR|O_CREAT|O_TRUNC, 0644);
+	if (ts->idxfd < 0) {
+		fprintf(stderr, "Failed to open time-shift index %s: %m\n", filename);
+		goto fail;
+	}
+	ts->map_size = sizeof(struct gnutv_ts_header) +
+		(ts->ring_size / INDEX_BYTES_PER_ENTRY) * sizeof(struct gnutv_ts_entry);
+	if (ftruncate(ts->idxfd, ts->map_size)) {
+		fprintf(stderr, "Failed to size time-shift index %s: %m\n", filename);
+		goto fail;
+	}
+	if (timeshift_map(ts, PROT_READ|PROT_WRITE))
+		goto fail;
+
+	ts->header->segment_size = GNUTV_TS_SEGMENT_SIZE;
+	ts->header->segments = segments;
+	ts->header->index_size = ts->ring_size / INDEX_BYTES_PER_ENTRY;
+	ts->header->start_time = time(NULL);
+	ts->start_ms = timeshift_clock_ms();
+	__sync_synchronize();
+	ts->header->magic = GNUTV_TS_MAGIC;
+
+	return ts;
+
+fail:
+	gnutv_timeshift_close(ts);
+	return NULL;
+}
+
+int gnutv_timeshift_write(struct gnutv_timeshift *ts, uint8_t *buf, int size)
+{
+	uint64_t offset = ts->header->written;
+	uint64_t horizon;
+	int done = 0;
+
+	timeshift_scan(ts, buf, size, offset);
+
+	// readers must stop trusting the segments we are about to overwrite
+	// before any of the data changes
+	horizon = offset + size + ts->header->segment_size - 1;
+	horizon -= horizon % ts->header->segment_size;
+	if (horizon > ts->header->horizon) {
+		__atomic_store_n(&ts->header->horizon, horizon, __ATOMIC_RELEASE);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	}
+
+	while(done < size) {
+		uint64_t pos = (offset + done) % ts->ring_size;
+		size_t count = size - done;
+		ssize_t tmp;
+
+		if (pos + count > ts->ring_size)
+			count = ts->ring_size - pos;
+
+		tmp = pwrite(ts->datafd, buf + done, count, pos);
+		if (tmp < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "Time-shift write error: %m\n");
+			return -1;
+		}
+		done += tmp;
+	}
+
+	// the data must be in place before readers can see it
+	__atomic_store_n(&ts->header->written, offset + size, __ATOMIC_RELEASE);
+	return 0;
+}
+
+struct gnutv_timeshift *gnutv_timeshift_open(char *name)
+{
+	struct gnutv_timeshift *ts;
+	char filename[PATH_MAX];
+	struct gnutv_ts_header header;
+
+	if ((ts = malloc(sizeof(struct gnutv_timeshift))) == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return NULL;
+	}
+	memset(ts, 0, sizeof(struct gnutv_timeshift));
+	ts->idxfd = -1;
+
+	snprintf(filename, sizeof(filename), "%s.ts", name);
+	ts->datafd = open(filename, O_RDONLY|O_LARGEFILE);
+	if (ts->datafd < 0) {
+		fprintf(stderr, "Failed to open time-shift file %s: %m\n", filename);
+		goto fail;
+	}
+
+	snprintf(filename, sizeof(filename), "%s.idx", name);
+	ts->idxfd = open(filename, O_RDONLY);
+	if (ts->idxfd < 0) {
+		fprintf(stderr, "Failed to open time-shift index %s: %m\n", filename);
+		goto fail;
+	}
+	if ((read(ts->idxfd, &header, sizeof(header)) != sizeof(header)) ||
+	    (header.magic != GNUTV_TS_MAGIC) ||
+	    (header.segment_size != GNUTV_TS_SEGMENT_SIZE)) {
+		fprintf(stderr, "%s is not a time-shift index\n", filename);
+		goto fail;
+	}
+	ts->ring_size = (uint64_t) header.segments * header.segment_size;
+	ts->map_size = sizeof(struct gnutv_ts_header) +
+		header.index_size * sizeof(struct gnutv_ts_entry);
+	if (timeshift_map(ts, PROT_READ))
+		goto fail;
+
+	return ts;
+
+fail:
+	gnutv_timeshift_close(ts);
+	return NULL;
+}
+
+void gnutv_timeshift_close(struct gnutv_timeshift *ts)
+{
+	if (ts->header)
+		munmap(ts->header, ts->map_size);
+	if (ts->idxfd >= 0)
+		close(ts->idxfd);
+	if (ts->datafd >= 0)
+		close(ts->datafd);
+	free(ts);
+}
+
+int gnutv_timeshift_seek(struct gnutv_timeshift *ts, uint32_t ms, uint64_t *offset)
+{
+	struct gnutv_ts_header *header = ts->header;
+	uint64_t oldest = timeshift_oldest(header, ts->ring_size);
+	uint64_t hi = header->entries;
+	uint64_t lo = 0;
+	uint64_t mid;
+
+	if (hi > header->index_size)
+		lo = hi - header->index_size;
+
+	// first entry whose data is still in the ring
+	while(lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (timeshift_entry(ts, mid)->offset < oldest)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	// first entry at or after the time; a time before the window
+	// starts gets the first RAP of the window
+	hi = header->entries;
+	while(lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (timeshift_entry(ts, mid)->ms < ms)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for(; lo < header->entries; lo++) {
+		struct gnutv_ts_entry *entry = timeshift_entry(ts, lo);
+
+		if (entry->flags & GNUTV_TS_RAP) {
+			*offset = entry->offset;
+			// the writer may have lapped us while we looked
+			if (*offset < timeshift_oldest(header, ts->ring_size))
+				return -1;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+uint32_t gnutv_timeshift_now(struct gnutv_timeshift *ts)
+{
+	uint64_t entries = ts->header->entries;
+
+	if (entries == 0)
+		return 0;
+	return timeshift_entry(ts, entries - 1)->ms;
+}
+
+ssize_t gnutv_timeshift_read(struct gnutv_timeshift *ts, uint64_t *offset,
+			     uint8_t *buf, size_t size)
+{
+	uint64_t written = __atomic_load_n(&ts->header->written, __ATOMIC_ACQUIRE);
+	uint64_t pos;
+	ssize_t count;
+
+	if (*offset < timeshift_oldest(ts->header, ts->ring_size))
+		return -1;
+	if (*offset >= written)
+		return 0;
+
+	if (size > written - *offset)
+		size = written - *offset;
+	pos = *offset % ts->ring_size;
+	if (pos + size > ts->ring_size)
+		size = ts->ring_size - pos;
+
+	count = pread(ts->datafd, buf, size, pos);
+	if (count <= 0)
+		return count;
+
+	// check it was not overwritten while we read it: the data must be
+	// read before the horizon is looked at again
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (*offset < timeshift_oldest(ts->header, ts->ring_size))
+		return -1;
+
+	*offset += count;
+	return count;
+}
+
+static uint64_t timeshift_clock_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t) now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+static int timeshift_map(struct gnutv_timeshift *ts, int prot)
+{
+	void *map;
+
+	map = mmap(NULL, ts->map_size, prot, MAP_SHARED, ts->idxfd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Failed to map time-shift index: %m\n");
+		return -1;
+	}
+
+	ts->header = map;
+	ts->index = (struct gnutv_ts_entry *) (ts->header + 1);
+	return 0;
+}
+
+/*
+ * Anything a ring length or more behind the writer's horizon may be being
+ * overwritten.
+ */
+static uint64_t timeshift_oldest(struct gnutv_ts_header *header, uint64_t ring_size)
+{
+	uint64_t horizon = __atomic_load_n(&header->horizon, __ATOMIC_ACQUIRE);
+
+	if (horizon <= ring_size)
+		return 0;
+
+	return horizon - ring_size;
+}
+
+static struct gnutv_ts_entry *timeshift_entry(struct gnutv_timeshift *ts, uint64_t seq)
+{
+	return &ts->index[seq % ts->header->index_size];
+}
+
+static void timeshift_scan(struct gnutv_timeshift *ts, uint8_t *buf, int size, uint64_t offset)
+{
+	int pos = 0;
+
+	// complete a packet split over the previous buffer
+	if (ts->carry_length) {
+		int count = TRANSPORT_PACKET_LENGTH - ts->carry_length;
+
+		if (count > size)
+			count = size;
+		memcpy(ts->carry + ts->carry_length, buf, count);
+		ts->carry_length += count;
+		pos = count;
+
+		if (ts->carry_length < TRANSPORT_PACKET_LENGTH)
+			return;
+		timeshift_packet(ts, ts->carry, offset + count - TRANSPORT_PACKET_LENGTH);
+		ts->carry_length = 0;
+	}
+
+	while((pos + TRANSPORT_PACKET_LENGTH) <= size) {
+		if (buf[pos] != TRANSPORT_PACKET_SYNC) {
+			// lost sync; look for the next packet
+			pos++;
+			continue;
+		}
+		timeshift_packet(ts, buf + pos, offset + pos);
+		pos += TRANSPORT_PACKET_LENGTH;
+	}
+
+	if (pos < size) {
+		if (buf[pos] == TRANSPORT_PACKET_SYNC) {
+			ts->carry_length = size - pos;
+			memcpy(ts->carry, buf + pos, ts->carry_length);
+		}
+	}
+}
+
+static void timeshift_packet(struct gnutv_timeshift *ts, uint8_t *buf, uint64_t offset)
+{
+	struct transport_packet *pkt;
+	struct transport_values values;
+	struct gnutv_ts_entry *entry;
+	uint64_t now;
+	int extracted;
+	int flags = 0;
+
+	// only packets with an adaptation field can carry a PCR or RAI
+	if ((pkt = transport_packet_init(buf)) == NULL)
+		return;
+	if ((pkt->adaptation_field_control & 2) == 0)
+		return;
+
+	extracted = transport_packet_values_extract(pkt, &values, transport_value_pcr);
+	if (extracted < 0)
+		return;
+	if (pkt->payload_unit_start_indicator &&
+	    (values.flags & transport_adaptation_flag_random_access))
+		flags |= GNUTV_TS_RAP;
+	if (extracted & transport_value_pcr)
+		flags |= GNUTV_TS_PCR;
+	if (flags == 0)
+		return;
+
+	now = timeshift_clock_ms() - ts->start_ms;
+	if (flags == GNUTV_TS_PCR) {
+		if (now < ts->next_pcr_ms)
+			return;
+		ts->next_pcr_ms = now + PCR_INTERVAL_MS;
+	}
+	if (flags & GNUTV_TS_RAP)
+		ts->rap_count++;
+
+	entry = timeshift_entry(ts, ts->header->entries);
+	entry->offset = offset;
+	entry->pcr = (flags & GNUTV_TS_PCR) ? values.pcr : 0;
+	entry->ms = now;
+	entry->pid = transport_packet_pid(pkt);
+	entry->flags = flags;
+
+	__sync_synchronize();
+	ts->header->entries++;
+}
@@ -0,0 +1,150 @@
+/*
+	gnutv utility
+
+	Copyright (C) 2004, 2005 Manu Abraham <abraham.manu@gmail.com>
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef gnutv_TIMESHIFT_H
+#define gnutv_TIMESHIFT_H 1
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * A time-shift recording is two files:
+ *
+ * <name>.ts  - a preallocated ring of TS data, made of segments of
+ *              GNUTV_TS_SEGMENT_SIZE bytes.
+ * <name>.idx - a struct gnutv_ts_header followed by a ring of
+ *              struct gnutv_ts_entry, one per random access point and
+ *              (rate limited) per PCR.
+ *
+ * Stream offsets in the index are never wrapped: the data for offset o is at
+ * o % ring_size in the .ts file. The segment the writer is filling is not
+ * readable, so the valid window is the last (segments - 1) segments.
+ * Before writing, the writer publishes its horizon: the end of the write
+ * rounded up to a segment. A reader checks it before and after reading, so
+ * it never returns data that may have been overwritten under it.
+ * Both files are in host byte order; they are only meant to be read on the
+ * machine recording them, while it records.
+ */
+
+#define GNUTV_TS_MAGIC 0x32535447 /* "GTS2" */
+#define GNUTV_TS_SEGMENT_SIZE (188 * 357000)	/* ~64MB */
+#define GNUTV_TS_MIN_SEGMENTS 2
+
+#define GNUTV_TS_RAP 0x01	/* PUSI packet with random_access_indicator */
+#define GNUTV_TS_PCR 0x02	/* pcr is valid */
+
+struct gnutv_ts_header {
+	uint32_t magic;
+	uint32_t segment_size;
+	uint32_t segments;
+	uint32_t index_size;		/* entries in the index ring */
+	uint64_t start_time;		/* time(NULL) when recording started */
+	volatile uint64_t written;	/* stream bytes written */
+	volatile uint64_t entries;	/* index entries written */
+	uint64_t horizon;		/* ring bytes that may be written */
+	uint8_t reserved[16];
+};
+
+struct gnutv_ts_entry {
+	uint64_t offset;		/* stream offset of the packet */
+	uint64_t pcr;			/* 27MHz */
+	uint32_t ms;			/* milliseconds since start_time */
+	uint16_t pid;
+	uint16_t flags;
+	uint64_t reserved;
+};
+
+/**
+ * An open time-shift recording, either being written or being read.
+ */
+struct gnutv_timeshift {
+	int datafd;
+	int idxfd;
+	struct gnutv_ts_header *header;	/* mmapped .idx */
+	struct gnutv_ts_entry *index;
+	size_t map_size;
+	uint64_t ring_size;
+
+	/* writer state */
+	uint8_t carry[188];
+	int carry_length;
+	uint64_t start_ms;
+	uint64_t next_pcr_ms;
+	uint64_t rap_count;
+};
+
+/**
+ * Create a recording, preallocating the ring.
+ *
+ * @param name File name prefix.
+ * @param size_mb Ring size in MB; rounded to whole segments.
+ * @return The recording, or NULL on failure (a message is printed).
+ */
+extern struct gnutv_timeshift *gnutv_timeshift_create(char *name, int size_mb);
+
+/**
+ * Append data read from the DVR device. Packets split over two calls are
+ * handled.
+ *
+ * @return 0 on success, -1 on a write error.
+ */
+extern int gnutv_timeshift_write(struct gnutv_timeshift *ts, uint8_t *buf, int size);
+
+/**
+ * Open a recording made by gnutv_timeshift_create() for reading.
+ *
+ * @return The recording, or NULL on failure (a message is printed).
+ */
+extern struct gnutv_timeshift *gnutv_timeshift_open(char *name);
+
+/**
+ * Close a recording opened either way.
+ */
+extern void gnutv_timeshift_close(struct gnutv_timeshift *ts);
+
+/**
+ * Find the first random access point at or after a time, by binary search
+ * of the index.
+ *
+ * @param ms Milliseconds since the recording started.
+ * @param offset Where to put the stream offset of the access point.
+ * @return 0 on success, -1 if there is no such access point in the ring.
+ */
+extern int gnutv_timeshift_seek(struct gnutv_timeshift *ts, uint32_t ms, uint64_t *offset);
+
+/**
+ * @return The time of the newest index entry in ms since the recording
+ * started, or 0 if there is none.
+ */
+extern uint32_t gnutv_timeshift_now(struct gnutv_timeshift *ts);
+
+/**
+ * Read stream data.
+ *
+ * @param offset Stream offset to read from, advanced by the amount read.
+ * @return Bytes read, 0 if there is no new data yet, or -1 if the data at
+ * offset has already been overwritten.
+ */
+extern ssize_t gnutv_timeshift_read(struct gnutv_timeshift *ts, uint64_t *offset,
+				    uint8_t *buf, size_t size);
+
+#endif
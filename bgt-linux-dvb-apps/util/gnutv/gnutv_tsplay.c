@@ -0,0 +1,187 @@
+/*
+	gnutv utility
+
+	Copyright (C) 2004, 2005 Manu Abraham <abraham.manu@gmail.com>
+	Copyright (C) 2006 Andrew de Quincey (adq_dvb@lidskialf.net)
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#define _FILE_OFFSET_BITS 64
+#define _LARGEFILE_SOURCE 1
+#define _LARGEFILE64_SOURCE 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include "gnutv_timeshift.h"
+
+static void signal_handler(int _signal);
+
+static int quit_app = 0;
+
+static void usage(void)
+{
+	static const char *_usage = "\n"
+		" gnutv_tsplay: play back a gnutv time-shift recording\n"
+		" usage: gnutv_tsplay <options> <name>\n"
+		" -h			help\n"
+		" -back <secs>		start this many seconds behind live (default 0)\n"
+		" -nofollow		exit on reaching live instead of following it\n"
+		" -list			list the index instead of playing\n"
+		" <name>		the name given to gnutv -out timeshift\n";
+	fprintf(stderr, "%s\n", _usage);
+
+	exit(1);
+}
+
+static void list_index(struct gnutv_timeshift *ts)
+{
+	struct gnutv_ts_header *header = ts->header;
+	uint64_t entries = header->entries;
+	uint64_t i = 0;
+
+	printf("ring %u x %u bytes, %llu bytes written, %llu index entries\n",
+	       header->segments, header->segment_size,
+	       (unsigned long long) header->written, (unsigned long long) entries);
+
+	if (entries > header->index_size)
+		i = entries - header->index_size;
+	for(; i < entries; i++) {
+		struct gnutv_ts_entry *entry = &ts->index[i % header->index_size];
+
+		printf("%8u.%03u %12llu pid %04x %s",
+		       entry->ms / 1000, entry->ms % 1000,
+		       (unsigned long long) entry->offset, entry->pid,
+		       (entry->flags & GNUTV_TS_RAP) ? "RAP" : "   ");
+		if (entry->flags & GNUTV_TS_PCR)
+			printf(" pcr %llu", (unsigned long long) entry->pcr);
+		printf("\n");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct gnutv_timeshift *ts;
+	char *name = NULL;
+	int back = 0;
+	int follow = 1;
+	int list = 0;
+	int argpos = 1;
+	uint8_t buf[188 * 64];
+	uint64_t offset;
+	uint32_t now;
+
+	while(argpos != argc) {
+		if (!strcmp(argv[argpos], "-h")) {
+			usage();
+		} else if (!strcmp(argv[argpos], "-back")) {
+			if ((argc - argpos) < 2)
+				usage();
+			if ((sscanf(argv[argpos+1], "%i", &back) != 1) || (back < 0))
+				usage();
+			argpos+=2;
+		} else if (!strcmp(argv[argpos], "-nofollow")) {
+			follow = 0;
+			argpos++;
+		} else if (!strcmp(argv[argpos], "-list")) {
+			list = 1;
+			argpos++;
+		} else {
+			if ((argc - argpos) != 1)
+				usage();
+			name = argv[argpos];
+			argpos++;
+		}
+	}
+	if (name == NULL)
+		usage();
+
+	if ((ts = gnutv_timeshift_open(name)) == NULL)
+		exit(1);
+
+	if (list) {
+		list_index(ts);
+		gnutv_timeshift_close(ts);
+		exit(0);
+	}
+
+	signal(SIGINT, signal_handler);
+	signal(SIGPIPE, SIG_IGN);
+
+	// wait for the first access point
+	for(;;) {
+		now = gnutv_timeshift_now(ts);
+		if (now > (uint32_t) back * 1000)
+			now -= back * 1000;
+		else
+			now = 0;
+		if (gnutv_timeshift_seek(ts, now, &offset) == 0)
+			break;
+		if (!follow || quit_app) {
+			fprintf(stderr, "No access point in the recording\n");
+			exit(1);
+		}
+		usleep(100000);
+	}
+
+	while(!quit_app) {
+		ssize_t size = gnutv_timeshift_read(ts, &offset, buf, sizeof(buf));
+		ssize_t written = 0;
+
+		if (size < 0) {
+			// we fell behind the writer: resume from the oldest point left
+			fprintf(stderr, "Playback overtaken by recording, skipping ahead\n");
+			if (gnutv_timeshift_seek(ts, 0, &offset))
+				break;
+			continue;
+		}
+		if (size == 0) {
+			if (!follow)
+				break;
+			usleep(20000);
+			continue;
+		}
+
+		while(written < size) {
+			ssize_t tmp = write(STDOUT_FILENO, buf + written, size - written);
+			if (tmp == -1) {
+				if (errno != EINTR) {
+					fprintf(stderr, "Write error: %m\n");
+					quit_app = 1;
+					break;
+				}
+			} else {
+				written += tmp;
+			}
+		}
+	}
+
+	gnutv_timeshift_close(ts);
+	exit(0);
+}
+
+static void signal_handler(int _signal)
+{
+	(void) _signal;
+
+	if (!quit_app) {
+		quit_app = 1;
+	}
+}
@@ -25,6 +25,7 @@
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <sys/poll.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <time.h>
@@ -39,6 +40,9 @@
 #include <linux/dvb/frontend.h>
 #include <linux/dvb/dmx.h>
 
+#include <libucsi/descriptor_index.h>
+#include <libucsi/dvb/text.h>
+
 #include "list.h"
 #include "diseqc.h"
 #include "dump-zap.h"
@@ -152,9 +156,12 @@ struct transponder {
 };
 
 
+struct scan_tuner;
+
 struct section_buf {
 	struct list_head list;
 	const char *dmx_devname;
+	struct scan_tuner *tuner;	/* owning tuner with -m, else NULL */
 	unsigned int run_once  : 1;
 	unsigned int segmented : 1;	/* segmented by table_id_ext */
 	int fd;
@@ -177,6 +184,44 @@ static LIST_HEAD(scanned_transponders);
 static LIST_HEAD(new_transponders);
 static struct transponder *current_tp;
 
+/*
+ * With -m, several frontends on the same feed scan in parallel. Each one
+ * takes the next transponder from new_transponders, and its filters are
+ * polled together with those of the other tuners, so the shared
+ * transponder and service lists need no locking.
+ */
+#define MAX_TUNERS 8
+#define TUNE_TIMEOUT_MS 2000
+#define TUNE_ATTEMPTS 2
+
+enum tuner_state {
+	TUNER_IDLE,
+	TUNER_TUNING,
+	TUNER_SCANNING,
+	TUNER_DONE
+};
+
+struct scan_tuner {
+	int index;
+	char frontend_devname[80];
+	char demux_devname[80];
+	int frontend_fd;
+	enum tuner_state state;
+	struct transponder *tp;
+	int tune_attempts;
+	long long tune_deadline;
+	int n_filters;			/* filters added and not yet removed */
+	struct section_buf filters[4];
+	int scanned;
+	int failed;
+	time_t start_time;
+};
+
+static struct scan_tuner tuners[MAX_TUNERS];
+static int n_tuners;
+static struct scan_tuner *current_tuner;
+static int poll_timeout = 1000;
+
 
 static void dump_dvb_parameters (FILE *f, struct transponder *p);
 
@@ -550,282 +595,20 @@ static void parse_frequency_list_descriptor (const unsigned char *buf,
 }
 
 /*
- * handle character set correctly (e.g. via iconv)
- *   c.f. EN 300 468 annex A
+ * handle character set correctly, c.f. EN 300 468 annex A
+ *
+ * Text is decoded to UTF-8 by libucsi, then converted to the output charset
+ * (if different) using a single cached iconv descriptor.
  */
-
-struct charset_conv {
-	unsigned len;
-	unsigned char  data[3];
-};
-
-/* This table is the Latin 00 table. Basically ISO-6937 + Euro sign */
-struct charset_conv en300468_latin_00_to_utf8[256] = {
-	[0x00] = { 1, {0x00, } },
-	[0x01] = { 1, {0x01, } },
-	[0x02] = { 1, {0x02, } },
-	[0x03] = { 1, {0x03, } },
-	[0x04] = { 1, {0x04, } },
-	[0x05] = { 1, {0x05, } },
-	[0x06] = { 1, {0x06, } },
-	[0x07] = { 1, {0x07, } },
-	[0x08] = { 1, {0x08, } },
-	[0x09] = { 1, {0x09, } },
-	[0x0a] = { 1, {0x0a, } },
-	[0x0b] = { 1, {0x0b, } },
-	[0x0c] = { 1, {0x0c, } },
-	[0x0d] = { 1, {0x0d, } },
-	[0x0e] = { 1, {0x0e, } },
-	[0x0f] = { 1, {0x0f, } },
-	[0x10] = { 1, {0x10, } },
-	[0x11] = { 1, {0x11, } },
-	[0x12] = { 1, {0x12, } },
-	[0x13] = { 1, {0x13, } },
-	[0x14] = { 1, {0x14, } },
-	[0x15] = { 1, {0x15, } },
-	[0x16] = { 1, {0x16, } },
-	[0x17] = { 1, {0x17, } },
-	[0x18] = { 1, {0x18, } },
-	[0x19] = { 1, {0x19, } },
-	[0x1a] = { 1, {0x1a, } },
-	[0x1b] = { 1, {0x1b, } },
-	[0x1c] = { 1, {0x1c, } },
-	[0x1d] = { 1, {0x1d, } },
-	[0x1e] = { 1, {0x1e, } },
-	[0x1f] = { 1, {0x1f, } },
-	[0x20] = { 1, {0x20, } },
-	[0x21] = { 1, {0x21, } },
-	[0x22] = { 1, {0x22, } },
-	[0x23] = { 1, {0x23, } },
-	[0x24] = { 1, {0x24, } },
-	[0x25] = { 1, {0x25, } },
-	[0x26] = { 1, {0x26, } },
-	[0x27] = { 1, {0x27, } },
-	[0x28] = { 1, {0x28, } },
-	[0x29] = { 1, {0x29, } },
-	[0x2a] = { 1, {0x2a, } },
-	[0x2b] = { 1, {0x2b, } },
-	[0x2c] = { 1, {0x2c, } },
-	[0x2d] = { 1, {0x2d, } },
-	[0x2e] = { 1, {0x2e, } },
-	[0x2f] = { 1, {0x2f, } },
-	[0x30] = { 1, {0x30, } },
-	[0x31] = { 1, {0x31, } },
-	[0x32] = { 1, {0x32, } },
-	[0x33] = { 1, {0x33, } },
-	[0x34] = { 1, {0x34, } },
-	[0x35] = { 1, {0x35, } },
-	[0x36] = { 1, {0x36, } },
-	[0x37] = { 1, {0x37, } },
-	[0x38] = { 1, {0x38, } },
-	[0x39] = { 1, {0x39, } },
-	[0x3a] = { 1, {0x3a, } },
-	[0x3b] = { 1, {0x3b, } },
-	[0x3c] = { 1, {0x3c, } },
-	[0x3d] = { 1, {0x3d, } },
-	[0x3e] = { 1, {0x3e, } },
-	[0x3f] = { 1, {0x3f, } },
-	[0x40] = { 1, {0x40, } },
-	[0x41] = { 1, {0x41, } },
-	[0x42] = { 1, {0x42, } },
-	[0x43] = { 1, {0x43, } },
-	[0x44] = { 1, {0x44, } },
-	[0x45] = { 1, {0x45, } },
-	[0x46] = { 1, {0x46, } },
-	[0x47] = { 1, {0x47, } },
-	[0x48] = { 1, {0x48, } },
-	[0x49] = { 1, {0x49, } },
-	[0x4a] = { 1, {0x4a, } },
-	[0x4b] = { 1, {0x4b, } },
-	[0x4c] = { 1, {0x4c, } },
-	[0x4d] = { 1, {0x4d, } },
-	[0x4e] = { 1, {0x4e, } },
-	[0x4f] = { 1, {0x4f, } },
-	[0x50] = { 1, {0x50, } },
-	[0x51] = { 1, {0x51, } },
-	[0x52] = { 1, {0x52, } },
-	[0x53] = { 1, {0x53, } },
-	[0x54] = { 1, {0x54, } },
-	[0x55] = { 1, {0x55, } },
-	[0x56] = { 1, {0x56, } },
-	[0x57] = { 1, {0x57, } },
-	[0x58] = { 1, {0x58, } },
-	[0x59] = { 1, {0x59, } },
-	[0x5a] = { 1, {0x5a, } },
-	[0x5b] = { 1, {0x5b, } },
-	[0x5c] = { 1, {0x5c, } },
-	[0x5d] = { 1, {0x5d, } },
-	[0x5e] = { 1, {0x5e, } },
-	[0x5f] = { 1, {0x5f, } },
-	[0x60] = { 1, {0x60, } },
-	[0x61] = { 1, {0x61, } },
-	[0x62] = { 1, {0x62, } },
-	[0x63] = { 1, {0x63, } },
-	[0x64] = { 1, {0x64, } },
-	[0x65] = { 1, {0x65, } },
-	[0x66] = { 1, {0x66, } },
-	[0x67] = { 1, {0x67, } },
-	[0x68] = { 1, {0x68, } },
-	[0x69] = { 1, {0x69, } },
-	[0x6a] = { 1, {0x6a, } },
-	[0x6b] = { 1, {0x6b, } },
-	[0x6c] = { 1, {0x6c, } },
-	[0x6d] = { 1, {0x6d, } },
-	[0x6e] = { 1, {0x6e, } },
-	[0x6f] = { 1, {0x6f, } },
-	[0x70] = { 1, {0x70, } },
-	[0x71] = { 1, {0x71, } },
-	[0x72] = { 1, {0x72, } },
-	[0x73] = { 1, {0x73, } },
-	[0x74] = { 1, {0x74, } },
-	[0x75] = { 1, {0x75, } },
-	[0x76] = { 1, {0x76, } },
-	[0x77] = { 1, {0x77, } },
-	[0x78] = { 1, {0x78, } },
-	[0x79] = { 1, {0x79, } },
-	[0x7a] = { 1, {0x7a, } },
-	[0x7b] = { 1, {0x7b, } },
-	[0x7c] = { 1, {0x7c, } },
-	[0x7d] = { 1, {0x7d, } },
-	[0x7e] = { 1, {0x7e, } },
-	[0x7f] = { 1, {0x7f, } },
-	[0x80] = { 2, {0xc2, 0x80, } },
-	[0x81] = { 2, {0xc2, 0x81, } },
-	[0x82] = { 2, {0xc2, 0x82, } },
-	[0x83] = { 2, {0xc2, 0x83, } },
-	[0x84] = { 2, {0xc2, 0x84, } },
-	[0x85] = { 2, {0xc2, 0x85, } },
-	[0x86] = { 2, {0xc2, 0x86, } },
-	[0x87] = { 2, {0xc2, 0x87, } },
-	[0x88] = { 2, {0xc2, 0x88, } },
-	[0x89] = { 2, {0xc2, 0x89, } },
-	[0x8a] = { 2, {0xc2, 0x8a, } },
-	[0x8b] = { 2, {0xc2, 0x8b, } },
-	[0x8c] = { 2, {0xc2, 0x8c, } },
-	[0x8d] = { 2, {0xc2, 0x8d, } },
-	[0x8e] = { 2, {0xc2, 0x8e, } },
-	[0x8f] = { 2, {0xc2, 0x8f, } },
-	[0x90] = { 2, {0xc2, 0x90, } },
-	[0x91] = { 2, {0xc2, 0x91, } },
-	[0x92] = { 2, {0xc2, 0x92, } },
-	[0x93] = { 2, {0xc2, 0x93, } },
-	[0x94] = { 2, {0xc2, 0x94, } },
-	[0x95] = { 2, {0xc2, 0x95, } },
-	[0x96] = { 2, {0xc2, 0x96, } },
-	[0x97] = { 2, {0xc2, 0x97, } },
-	[0x98] = { 2, {0xc2, 0x98, } },
-	[0x99] = { 2, {0xc2, 0x99, } },
-	[0x9a] = { 2, {0xc2, 0x9a, } },
-	[0x9b] = { 2, {0xc2, 0x9b, } },
-	[0x9c] = { 2, {0xc2, 0x9c, } },
-	[0x9d] = { 2, {0xc2, 0x9d, } },
-	[0x9e] = { 2, {0xc2, 0x9e, } },
-	[0x9f] = { 2, {0xc2, 0x9f, } },
-	[0xa0] = { 2, {0xc2, 0xa0, } },
-	[0xa1] = { 2, {0xc2, 0xa1, } },
-	[0xa2] = { 2, {0xc2, 0xa2, } },
-	[0xa3] = { 2, {0xc2, 0xa3, } },
-	[0xa4] = { 3, { 0xe2, 0x82, 0xac,} },		/* Euro sign. Addition over the ISO-6937 standard */
-	[0xa5] = { 2, {0xc2, 0xa5, } },
-	[0xa6] = { 0, {} },
-	[0xa7] = { 2, {0xc2, 0xa7, } },
-	[0xa8] = { 2, {0xc2, 0xa4, } },
-	[0xa9] = { 3, {0xe2, 0x80, 0x98, } },
-	[0xaa] = { 3, {0xe2, 0x80, 0x9c, } },
-	[0xab] = { 2, {0xc2, 0xab, } },
-	[0xac] = { 3, {0xe2, 0x86, 0x90, } },
-	[0xad] = { 3, {0xe2, 0x86, 0x91, } },
-	[0xae] = { 3, {0xe2, 0x86, 0x92, } },
-	[0xaf] = { 3, {0xe2, 0x86, 0x93, } },
-	[0xb0] = { 2, {0xc2, 0xb0, } },
-	[0xb1] = { 2, {0xc2, 0xb1, } },
-	[0xb2] = { 2, {0xc2, 0xb2, } },
-	[0xb3] = { 2, {0xc2, 0xb3, } },
-	[0xb4] = { 2, {0xc3, 0x97, } },
-	[0xb5] = { 2, {0xc2, 0xb5, } },
-	[0xb6] = { 2, {0xc2, 0xb6, } },
-	[0xb7] = { 2, {0xc2, 0xb7, } },
-	[0xb8] = { 2, {0xc3, 0xb7, } },
-	[0xb9] = { 3, {0xe2, 0x80, 0x99, } },
-	[0xba] = { 3, {0xe2, 0x80, 0x9d, } },
-	[0xbb] = { 2, {0xc2, 0xbb, } },
-	[0xbc] = { 2, {0xc2, 0xbc, } },
-	[0xbd] = { 2, {0xc2, 0xbd, } },
-	[0xbe] = { 2, {0xc2, 0xbe, } },
-	[0xbf] = { 2, {0xc2, 0xbf, } },
-	[0xc0] = { 0, {} },
-	[0xc1] = { 0, {} },
-	[0xc2] = { 0, {} },
-	[0xc3] = { 0, {} },
-	[0xc4] = { 0, {} },
-	[0xc5] = { 0, {} },
-	[0xc6] = { 0, {} },
-	[0xc7] = { 0, {} },
-	[0xc8] = { 0, {} },
-	[0xc9] = { 0, {} },
-	[0xca] = { 0, {} },
-	[0xcb] = { 0, {} },
-	[0xcc] = { 0, {} },
-	[0xcd] = { 0, {} },
-	[0xce] = { 0, {} },
-	[0xcf] = { 0, {} },
-	[0xd0] = { 3, {0xe2, 0x80, 0x94, } },
-	[0xd1] = { 2, {0xc2, 0xb9, } },
-	[0xd2] = { 2, {0xc2, 0xae, } },
-	[0xd3] = { 2, {0xc2, 0xa9, } },
-	[0xd4] = { 3, {0xe2, 0x84, 0xa2, } },
-	[0xd5] = { 3, {0xe2, 0x99, 0xaa, } },
-	[0xd6] = { 2, {0xc2, 0xac, } },
-	[0xd7] = { 2, {0xc2, 0xa6, } },
-	[0xd8] = { 0, {} },
-	[0xd9] = { 0, {} },
-	[0xda] = { 0, {} },
-	[0xdb] = { 0, {} },
-	[0xdc] = { 3, {0xe2, 0x85, 0x9b, } },
-	[0xdd] = { 3, {0xe2, 0x85, 0x9c, } },
-	[0xde] = { 3, {0xe2, 0x85, 0x9d, } },
-	[0xdf] = { 3, {0xe2, 0x85, 0x9e, } },
-	[0xe0] = { 3, {0xe2, 0x84, 0xa6, } },
-	[0xe1] = { 2, {0xc3, 0x86, } },
-	[0xe2] = { 2, {0xc3, 0x90, } },
-	[0xe3] = { 2, {0xc2, 0xaa, } },
-	[0xe4] = { 2, {0xc4, 0xa6, } },
-	[0xe5] = { 0, {} },
-	[0xe6] = { 2, {0xc4, 0xb2, } },
-	[0xe7] = { 2, {0xc4, 0xbf, } },
-	[0xe8] = { 2, {0xc5, 0x81, } },
-	[0xe9] = { 2, {0xc3, 0x98, } },
-	[0xea] = { 2, {0xc5, 0x92, } },
-	[0xeb] = { 2, {0xc2, 0xba, } },
-	[0xec] = { 2, {0xc3, 0x9e, } },
-	[0xed] = { 2, {0xc5, 0xa6, } },
-	[0xee] = { 2, {0xc5, 0x8a, } },
-	[0xef] = { 2, {0xc5, 0x89, } },
-	[0xf0] = { 2, {0xc4, 0xb8, } },
-	[0xf1] = { 2, {0xc3, 0xa6, } },
-	[0xf2] = { 2, {0xc4, 0x91, } },
-	[0xf3] = { 2, {0xc3, 0xb0, } },
-	[0xf4] = { 2, {0xc4, 0xa7, } },
-	[0xf5] = { 2, {0xc4, 0xb1, } },
-	[0xf6] = { 2, {0xc4, 0xb3, } },
-	[0xf7] = { 2, {0xc5, 0x80, } },
-	[0xf8] = { 2, {0xc5, 0x82, } },
-	[0xf9] = { 2, {0xc3, 0xb8, } },
-	[0xfa] = { 2, {0xc5, 0x93, } },
-	[0xfb] = { 2, {0xc3, 0x9f, } },
-	[0xfc] = { 2, {0xc3, 0xbe, } },
-	[0xfd] = { 2, {0xc5, 0xa7, } },
-	[0xfe] = { 2, {0xc5, 0x8b, } },
-	[0xff] = { 2, {0xc2, 0xad, } },
-};
+static struct dvb_text_decoder *text_decoder;
+static iconv_t output_cd = (iconv_t) -1;
+static int output_is_utf8 = -1;
 
 static void descriptorcpy(char **dest, const unsigned char *src, size_t len)
 {
-	size_t destlen, i;
-	char *p, *type = default_charset;
-	unsigned char *tmp = NULL;
-	const unsigned char *s;
-	int emphasis = 0, need_conversion = 1;
+	size_t destlen = (len * 3) + 1, inlen;
+	char *utf8, *in, *p;
+	int utf8len;
 
 	if (*dest) {
 		free (*dest);
@@ -834,143 +617,56 @@ static void descriptorcpy(char **dest, const unsigned char *src, size_t len)
 	if (!len)
 		return;
 
-	if (*src < 0x20) {
-		switch (*src) {
-		case 0x00:	type = "ISO-6937";		break;
-		case 0x01:	type = "ISO-8859-5";		break;
-		case 0x02:	type = "ISO-8859-6";		break;
-		case 0x03:	type = "ISO-8859-7";		break;
-		case 0x04:	type = "ISO-8859-8";		break;
-		case 0x05:	type = "ISO-8859-9";		break;
-		case 0x06:	type = "ISO-8859-10";		break;
-		case 0x07:	type = "ISO-8859-11";		break;
-		case 0x09:	type = "ISO-8859-13";		break;
-		case 0x0a:	type = "ISO-8859-14";		break;
-		case 0x0b:	type = "ISO-8859-15";		break;
-		case 0x11:	type = "ISO-10646";		break;
-		case 0x12:	type = "ISO-2022-KR";		break;
-		case 0x13:	type = "GB2312";		break;
-		case 0x14:	type = "BIG5";			break;
-		case 0x15:	type = "ISO-10646/UTF-8";	break;
-		case 0x10: /* ISO8859 */
-			if ((*(src + 1) != 0) || *(src + 2) > 0x0f)
-				break;
-			src+=2;
-			len-=2;
-			switch(*src) {
-			case 0x01:	type = "ISO-8859-1";		break;
-			case 0x02:	type = "ISO-8859-2";		break;
-			case 0x03:	type = "ISO-8859-3";		break;
-			case 0x04:	type = "ISO-8859-4";		break;
-			case 0x05:	type = "ISO-8859-5";		break;
-			case 0x06:	type = "ISO-8859-6";		break;
-			case 0x07:	type = "ISO-8859-7";		break;
-			case 0x08:	type = "ISO-8859-8";		break;
-			case 0x09:	type = "ISO-8859-9";		break;
-			case 0x0a:	type = "ISO-8859-10";		break;
-			case 0x0b:	type = "ISO-8859-11";		break;
-			case 0x0d:	type = "ISO-8859-13";		break;
-			case 0x0e:	type = "ISO-8859-14";		break;
-			case 0x0f:	type = "ISO-8859-15";		break;
-			}
-		}
-		src++;
-		len--;
+	if (text_decoder == NULL) {
+		text_decoder = dvb_text_decoder_create(default_charset);
+		if (text_decoder == NULL)
+			fatal("failed to create text decoder\n");
 	}
+	if (output_is_utf8 < 0)
+		output_is_utf8 = !strcasecmp(output_charset, "UTF-8") ||
+				 !strcasecmp(output_charset, "UTF8");
 
-	/*
-	 * Destination length should be bigger. As the worse case seems to
-	 * use 3 chars for one code, use it for destlen
-	 */
-	destlen = len * 3;
-	*dest = malloc(destlen + 1);
-
-	/* Remove special chars */
-	if (!strncasecmp(type, "ISO-8859", 8) || !strcasecmp(type, "ISO-6937")) {
-		/*
-		 * Handles the ISO/IEC 10646 1-byte control codes
-		 * (EN 300 468 v1.11.1 Table A.1)
-		 * Emphasis will be represented as: *emphased*
-		 */
-		tmp = malloc(len + 2);
-		p = (char *)tmp;
-		s = src;
-		for (i = 0; i < len; i++, s++) {
-			if (*s >= 0x20 && (*s < 0x80 || *s > 0x9f))
-				*p++ = *s;
-			else if (*s == 0x86) {
-				*p++ = '*';
-				emphasis = 1;
-			} else if (*s == 0x87 && emphasis) {
-				*p++ = '*';
-				emphasis = 0;
-			}
-		}
-		if (emphasis)
-			*p++ = '*';
-		*p = '\0';
-	} else {
-		/*
-		 * FIXME: need to handle the ISO/IEC 10646 2-byte control codes
-		 * (EN 300 468 v1.11.1 Table A.2)
-		 */
+	utf8 = malloc(destlen);
+	utf8len = dvb_text_decode(text_decoder, src, len, utf8, destlen,
+				  DVB_TEXT_FLAG_EMPHASIS);
+	if (utf8len < 0) {
+		warning("Unsupported character table 0x%02x\n", *src);
+		memcpy(utf8, src, len);
+		utf8[len] = '\0';
+		utf8len = len;
 	}
 
-	if (tmp)
-		s = tmp;
-	else
-		s = src;
-
-	p = *dest;
-	if (!strcasecmp(type, "ISO-6937")) {
-		unsigned char *p1, *p2;
-
-		/* Convert charset to UTF-8 using Code table 00 - Latin */
-		for (p1 = (unsigned char *)s; p1 < s + len; p1++)
-			for (p2 = en300468_latin_00_to_utf8[*p1].data;
-			     p2 < en300468_latin_00_to_utf8[*p1].data + en300468_latin_00_to_utf8[*p1].len;
-			     p2++)
-				*p++ = *p2;
-		*p = '\0';
-
-		/* If desired charset is not UTF-8, prepare for conversion */
-		if (strcasecmp(output_charset, "UTF-8")) {
-			if (tmp)
-				free(tmp);
-			tmp = (unsigned char *)*dest;
-			len = p - *dest;
-
-			*dest = malloc(destlen + 1);
-			type = "UTF-8";
-			s = tmp;
-		} else
-			need_conversion = 0;
-
+	if (output_is_utf8) {
+		*dest = utf8;
+		return;
 	}
 
-	/* Convert from original charset to the desired one */
-	if (need_conversion) {
+	/* Convert from UTF-8 to the desired charset */
+	if (output_cd == (iconv_t) -1) {
 		char out_cs[strlen(output_charset) + 1 + sizeof(CS_OPTIONS)];
 
-		p = *dest;
 		strcpy(out_cs, output_charset);
 		strcat(out_cs, CS_OPTIONS);
-
-		iconv_t cd = iconv_open(out_cs, type);
-		if (cd == (iconv_t)(-1)) {
-			memcpy(p, s, len);
-			p[len] = '\0';
-			warning("Conversion from %s to %s not supported\n",
-				 type, output_charset);
-		} else {
-			iconv(cd, (char **)&s, &len, &p, &destlen);
-			iconv_close(cd);
-			*p = '\0';
+		output_cd = iconv_open(out_cs, "UTF-8");
+		if (output_cd == (iconv_t) -1) {
+			warning("Conversion from UTF-8 to %s not supported\n",
+				output_charset);
+			output_is_utf8 = 1;
+			*dest = utf8;
+			return;
 		}
-	}
+	} else
+		iconv(output_cd, NULL, NULL, NULL, NULL);
+
+	in = utf8;
+	inlen = utf8len;
+	*dest = malloc(destlen);
+	p = *dest;
+	destlen--;
+	iconv(output_cd, &in, &inlen, &p, &destlen);
+	*p = '\0';
 
-	if (tmp)
-		free(tmp);
+	free(utf8);
 }
 
 static void parse_service_descriptor (const unsigned char *buf, struct service *s)
@@ -1001,101 +697,70 @@ static void parse_service_descriptor (const unsigned char *buf, struct service *
 	    s->scrambled ? ", scrambled" : "");
 }
 
-static int find_descriptor(uint8_t tag, const unsigned char *buf,
-		int descriptors_loop_len,
-		const unsigned char **desc, int *desc_len)
+/*
+ * The descriptor loop is only scanned on the first lookup, so streams and
+ * services whose descriptors are never looked at cost nothing.
+ */
+static const unsigned char *index_find(struct descriptor_index *idx, int tag)
 {
-	while (descriptors_loop_len > 0) {
-		unsigned char descriptor_tag = buf[0];
-		unsigned char descriptor_len = buf[1] + 2;
-
-		if (!descriptor_len) {
-			warning("descriptor_tag == 0x%02x, len is 0\n", descriptor_tag);
-			break;
-		}
-
-		if (tag == descriptor_tag) {
-			if (desc)
-				*desc = buf;
-			if (desc_len)
-				*desc_len = descriptor_len;
-			return 1;
-		}
+	if ((idx->state == DESCRIPTOR_INDEX_UNBUILT) && descriptor_index_build(idx))
+		warning("bad descriptor loop, %i bytes, %i descriptors used\n",
+			(int) idx->len, descriptor_index_count(idx));
 
-		buf += descriptor_len;
-		descriptors_loop_len -= descriptor_len;
-	}
-	return 0;
+	return (const unsigned char *) descriptor_index_find(idx, tag);
 }
 
-static void parse_descriptors(enum table_type t, const unsigned char *buf,
-			      int descriptors_loop_len, void *data)
-{
-	while (descriptors_loop_len > 0) {
-		unsigned char descriptor_tag = buf[0];
-		unsigned char descriptor_len = buf[1] + 2;
-
-		if (!descriptor_len) {
-			warning("descriptor_tag == 0x%02x, len is 0\n", descriptor_tag);
-			break;
-		}
-
-		switch (descriptor_tag) {
-		case 0x0a:
-			if (t == PMT)
-				parse_iso639_language_descriptor (buf, data);
-			break;
-
-		case 0x40:
-			if (t == NIT)
-				parse_network_name_descriptor (buf, data);
-			break;
-
-		case 0x43:
-			if (t == NIT)
-				parse_satellite_delivery_system_descriptor (buf, data);
-			break;
-
-		case 0x44:
-			if (t == NIT)
-				parse_cable_delivery_system_descriptor (buf, data);
-			break;
-
-		case 0x48:
-			if (t == SDT)
-				parse_service_descriptor (buf, data);
-			break;
-
-		case 0x53:
-			if (t == SDT)
-				parse_ca_identifier_descriptor (buf, data);
-			break;
+#define index_for_each(idx, tag, d) \
+	for ((d) = index_find(idx, tag); \
+	     (d); \
+	     (d) = (const unsigned char *) descriptor_index_next(idx, (const struct descriptor *) (d)))
 
-		case 0x5a:
-			if (t == NIT)
-				parse_terrestrial_delivery_system_descriptor (buf, data);
-			break;
+/*
+ * Each table only looks up the descriptor tags it handles, so the loop is
+ * walked once (on the first lookup) however many tags are wanted.
+ */
+static void parse_descriptors(enum table_type t, struct descriptor_index *idx,
+			      void *data)
+{
+	const unsigned char *d;
 
-		case 0x62:
-			if (t == NIT)
-				parse_frequency_list_descriptor (buf, data);
-			break;
+	switch (t) {
+	case PMT:
+		index_for_each(idx, 0x0a, d)
+			parse_iso639_language_descriptor (d, data);
+		break;
 
-		case 0x83:
-			/* 0x83 is in the privately defined range of descriptor tags,
-			 * so we parse this only if the user says so to avoid
-			 * problems when 0x83 is something entirely different... */
-			if (t == NIT && vdr_dump_channum)
-				parse_terrestrial_uk_channel_number (buf, data);
-			break;
+	case NIT:
+		index_for_each(idx, 0x40, d)
+			parse_network_name_descriptor (d, data);
+		index_for_each(idx, 0x43, d)
+			parse_satellite_delivery_system_descriptor (d, data);
+		index_for_each(idx, 0x44, d)
+			parse_cable_delivery_system_descriptor (d, data);
+		index_for_each(idx, 0x5a, d)
+			parse_terrestrial_delivery_system_descriptor (d, data);
+		index_for_each(idx, 0x62, d)
+			parse_frequency_list_descriptor (d, data);
+		/* 0x83 is in the privately defined range of descriptor tags,
+		 * so we parse this only if the user says so to avoid
+		 * problems when 0x83 is something entirely different... */
+		if (vdr_dump_channum)
+			index_for_each(idx, 0x83, d)
+				parse_terrestrial_uk_channel_number (d, data);
+		break;
 
-		default:
-			verbosedebug("skip descriptor 0x%02x\n", descriptor_tag);
-		};
+	case SDT:
+		index_for_each(idx, 0x48, d)
+			parse_service_descriptor (d, data);
+		index_for_each(idx, 0x53, d)
+			parse_ca_identifier_descriptor (d, data);
+		break;
 
-		buf += descriptor_len;
-		descriptors_loop_len -= descriptor_len;
+	default:
+		break;
 	}
+
+	verbosedebug("%i descriptors\n", descriptor_index_count(idx));
 }
 
 
@@ -1118,7 +783,8 @@ static void parse_pat(const unsigned char *buf, int section_length,
 		s->pmt_pid = ((buf[2] & 0x1f) << 8) | buf[3];
 		if (!s->priv && s->pmt_pid) {
 			s->priv = malloc(sizeof(struct section_buf));
-			setup_filter(s->priv, demux_devname,
+			setup_filter(s->priv,
+				     current_tuner ? current_tuner->demux_devname : demux_devname,
 				     s->pmt_pid, 0x02, s->service_id, 1, 0, 5);
 
 			add_filter (s->priv);
@@ -1155,6 +821,9 @@ static void parse_pmt (const unsigned char *buf, int section_length, int service
 	while (section_length >= 5) {
 		int ES_info_len = ((buf[3] & 0x0f) << 8) | buf[4];
 		int elementary_pid = ((buf[1] & 0x1f) << 8) | buf[2];
+		struct descriptor_index idx;
+
+		descriptor_index_init(&idx, buf + 5, ES_info_len);
 
 		switch (buf[0]) {
 		case 0x01:
@@ -1172,7 +841,7 @@ static void parse_pmt (const unsigned char *buf, int section_length, int service
 			moreverbose("  AUDIO     : PID 0x%04x\n", elementary_pid);
 			if (s->audio_num < AUDIO_CHAN_MAX) {
 				s->audio_pid[s->audio_num] = elementary_pid;
-				parse_descriptors (PMT, buf + 5, ES_info_len, s);
+				parse_descriptors (PMT, &idx, s);
 				s->audio_num++;
 			}
 			else
@@ -1186,12 +855,12 @@ static void parse_pmt (const unsigned char *buf, int section_length, int service
 			moreverbose("  DSM-CC    : PID 0x%04x\n", elementary_pid);
 			break;
 		case 0x06:
-			if (find_descriptor(0x56, buf + 5, ES_info_len, NULL, NULL)) {
+			if (index_find(&idx, 0x56)) {
 				moreverbose("  TELETEXT  : PID 0x%04x\n", elementary_pid);
 				s->teletext_pid = elementary_pid;
 				break;
 			}
-			else if (find_descriptor(0x59, buf + 5, ES_info_len, NULL, NULL)) {
+			else if (index_find(&idx, 0x59)) {
 				/* Note: The subtitling descriptor can also signal
 				 * teletext subtitling, but then the teletext descriptor
 				 * will also be present; so we can be quite confident
@@ -1201,7 +870,7 @@ static void parse_pmt (const unsigned char *buf, int section_length, int service
 				s->subtitling_pid = elementary_pid;
 				break;
 			}
-			else if (find_descriptor(0x6a, buf + 5, ES_info_len, NULL, NULL)) {
+			else if (index_find(&idx, 0x6a)) {
 				moreverbose("  AC3       : PID 0x%04x\n", elementary_pid);
 				s->ac3_pid = elementary_pid;
 				break;
@@ -1239,6 +908,7 @@ static void parse_pmt (const unsigned char *buf, int section_length, int service
 static void parse_nit (const unsigned char *buf, int section_length, int network_id)
 {
 	int descriptors_loop_len = ((buf[0] & 0x0f) << 8) | buf[1];
+	struct descriptor_index idx;
 
 	if (section_length < descriptors_loop_len + 4)
 	{
@@ -1248,7 +918,8 @@ static void parse_nit (const unsigned char *buf, int section_length, int network
 		return;
 	}
 
-	parse_descriptors (NIT, buf + 2, descriptors_loop_len, NULL);
+	descriptor_index_init(&idx, buf + 2, descriptors_loop_len);
+	parse_descriptors (NIT, &idx, NULL);
 
 	section_length -= descriptors_loop_len + 4;
 	buf += descriptors_loop_len + 4;
@@ -1276,7 +947,8 @@ static void parse_nit (const unsigned char *buf, int section_length, int network
 		tn.original_network_id = (buf[2] << 8) | buf[3];
 		tn.transport_stream_id = transport_stream_id;
 
-		parse_descriptors (NIT, buf + 6, descriptors_loop_len, &tn);
+		descriptor_index_init(&idx, buf + 6, descriptors_loop_len);
+		parse_descriptors (NIT, &idx, &tn);
 
 		if (tn.type == fe_info.type) {
 			/* only add if develivery_descriptor matches FE type */
@@ -1302,6 +974,7 @@ static void parse_sdt (const unsigned char *buf, int section_length,
 	while (section_length >= 5) {
 		int service_id = (buf[0] << 8) | buf[1];
 		int descriptors_loop_len = ((buf[3] & 0x0f) << 8) | buf[4];
+		struct descriptor_index idx;
 		struct service *s;
 
 		if (section_length < descriptors_loop_len)
@@ -1321,7 +994,8 @@ static void parse_sdt (const unsigned char *buf, int section_length,
 		s->running = (buf[3] >> 5) & 0x7;
 		s->scrambled = (buf[3] >> 4) & 1;
 
-		parse_descriptors (SDT, buf + 5, descriptors_loop_len, s);
+		descriptor_index_init(&idx, buf + 5, descriptors_loop_len);
+		parse_descriptors (SDT, &idx, s);
 
 		section_length -= descriptors_loop_len + 5;
 		buf += descriptors_loop_len + 5;
@@ -1675,6 +1349,7 @@ static void setup_filter (struct section_buf* s, const char *dmx_devname,
 
 	s->fd = -1;
 	s->dmx_devname = dmx_devname;
+	s->tuner = current_tuner;
 	s->pid = pid;
 	s->table_id = tid;
 
@@ -1789,6 +1464,8 @@ static void stop_filter (struct section_buf *s)
 static void add_filter (struct section_buf *s)
 {
 	verbosedebug("add filter pid 0x%04x\n", s->pid);
+	if (s->tuner)
+		s->tuner->n_filters++;
 	if (start_filter (s))
 		list_add_tail (&s->list, &waiting_filters);
 }
@@ -1797,6 +1474,8 @@ static void add_filter (struct section_buf *s)
 static void remove_filter (struct section_buf *s)
 {
 	verbosedebug("remove filter pid 0x%04x\n", s->pid);
+	if (s->tuner)
+		s->tuner->n_filters--;
 	stop_filter (s);
 
 	while (!list_empty(&waiting_filters)) {
@@ -1813,7 +1492,7 @@ static void read_filters (void)
 	struct section_buf *s;
 	int i, n, done;
 
-	n = poll(poll_fds, n_running, 1000);
+	n = poll(poll_fds, n_running, poll_timeout);
 	if (n == -1)
 		errorn("poll");
 
@@ -1821,6 +1500,10 @@ static void read_filters (void)
 		s = poll_section_bufs[i];
 		if (!s)
 			fatal("poll_section_bufs[%d] is NULL\n", i);
+		if (s->tuner) {
+			current_tuner = s->tuner;
+			current_tp = s->tuner->tp;
+		}
 		if (poll_fds[i].revents)
 			done = read_sections (s) == 1;
 		else
@@ -1854,13 +1537,9 @@ static int mem_is_zero (const void *mem, int size)
 
 static int switch_pos = 0;
 
-static int __tune_to_transponder (int frontend_fd, struct transponder *t)
+static int start_tuning (int frontend_fd, struct transponder *t)
 {
 	struct dvb_frontend_parameters p;
-	fe_status_t s;
-	int i;
-
-	current_tp = t;
 
 	if (mem_is_zero (&t->param, sizeof(struct dvb_frontend_parameters)))
 		return -1;
@@ -1868,7 +1547,10 @@ static int __tune_to_transponder (int frontend_fd, struct transponder *t)
 	memcpy (&p, &t->param, sizeof(struct dvb_frontend_parameters));
 
 	if (verbosity >= 1) {
-		dprintf(1, ">>> tune to: ");
+		if (current_tuner)
+			dprintf(1, ">>> tuner %d: tune to: ", current_tuner->index);
+		else
+			dprintf(1, ">>> tune to: ");
 		dump_dvb_parameters (stderr, t);
 		if (t->last_tuning_failed)
 			dprintf(1, " (tuning failed)");
@@ -1911,20 +1593,43 @@ static int __tune_to_transponder (int frontend_fd, struct transponder *t)
 		return -1;
 	}
 
-	for (i = 0; i < 10; i++) {
-		usleep (200000);
+	return 0;
+}
 
-		if (ioctl(frontend_fd, FE_READ_STATUS, &s) == -1) {
-			errorn("FE_READ_STATUS failed");
-			return -1;
-		}
+/* returns 1 on lock, 0 if not (yet) locked, -1 on error */
+static int check_lock (int frontend_fd, struct transponder *t)
+{
+	fe_status_t s;
 
-		verbose(">>> tuning status == 0x%02x\n", s);
+	if (ioctl(frontend_fd, FE_READ_STATUS, &s) == -1) {
+		errorn("FE_READ_STATUS failed");
+		return -1;
+	}
 
-		if (s & FE_HAS_LOCK) {
-			t->last_tuning_failed = 0;
-			return 0;
-		}
+	verbose(">>> tuning status == 0x%02x\n", s);
+
+	if (s & FE_HAS_LOCK) {
+		t->last_tuning_failed = 0;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int __tune_to_transponder (int frontend_fd, struct transponder *t)
+{
+	int i, rc;
+
+	current_tp = t;
+
+	if (start_tuning (frontend_fd, t))
+		return -1;
+
+	for (i = 0; i < TUNE_TIMEOUT_MS / 200; i++) {
+		usleep (200000);
+
+		if ((rc = check_lock (frontend_fd, t)) != 0)
+			return rc == 1 ? 0 : -1;
 	}
 
 	warning(">>> tuning failed!!!\n");
@@ -1996,38 +1701,48 @@ static int tune_to_transponder (int frontend_fd, struct transponder *t)
 }
 
 
+/* switch a transponder which failed to tune to its next alternative
+ * frequency (DVB-T frequency_list_descriptor); returns 0 if there is one
+ */
+static int next_other_frequency (struct transponder *t)
+{
+	struct transponder *to;
+	uint32_t freq;
+
+	while (t->other_frequency_flag && t->other_f && t->n_other_f) {
+		/* check if the alternate freqeuncy is really new to us */
+		freq = t->other_f[t->n_other_f - 1];
+		t->n_other_f--;
+		if (find_transponder(freq))
+			continue;
+
+		/* remember tuning to the old frequency failed */
+		to = calloc(1, sizeof(*to));
+		to->param.frequency = t->param.frequency;
+		to->wrong_frequency = 1;
+		INIT_LIST_HEAD(&to->list);
+		INIT_LIST_HEAD(&to->services);
+		list_add_tail(&to->list, &scanned_transponders);
+		copy_transponder(to, t);
+
+		t->param.frequency = freq;
+		info("retrying with f=%d\n", t->param.frequency);
+		return 0;
+	}
+	return -1;
+}
+
 static int tune_to_next_transponder (int frontend_fd)
 {
 	struct list_head *pos, *tmp;
-	struct transponder *t, *to;
-	uint32_t freq;
+	struct transponder *t;
 
 	list_for_each_safe(pos, tmp, &new_transponders) {
 		t = list_entry (pos, struct transponder, list);
-retry:
-		if (tune_to_transponder (frontend_fd, t) == 0)
-			return 0;
-next:
-		if (t->other_frequency_flag && t->other_f && t->n_other_f) {
-			/* check if the alternate freqeuncy is really new to us */
-			freq = t->other_f[t->n_other_f - 1];
-			t->n_other_f--;
-			if (find_transponder(freq))
-				goto next;
-
-			/* remember tuning to the old frequency failed */
-			to = calloc(1, sizeof(*to));
-			to->param.frequency = t->param.frequency;
-			to->wrong_frequency = 1;
-			INIT_LIST_HEAD(&to->list);
-			INIT_LIST_HEAD(&to->services);
-			list_add_tail(&to->list, &scanned_transponders);
-			copy_transponder(to, t);
-
-			t->param.frequency = freq;
-			info("retrying with f=%d\n", t->param.frequency);
-			goto retry;
-		}
+		do {
+			if (tune_to_transponder (frontend_fd, t) == 0)
+				return 0;
+		} while (next_other_frequency (t) == 0);
 	}
 	return -1;
 }
@@ -2155,7 +1870,7 @@ static const char * fe_type2str(fe_type_t t)
 	return enum2str(t, typetab, "UNK");
 }
 
-static int tune_initial (int frontend_fd, const char *initial)
+static int read_initial (const char *initial)
 {
 	FILE *inif;
 	unsigned int f, sr;
@@ -2241,87 +1956,92 @@ static int tune_initial (int frontend_fd, const char *initial)
 
 	fclose(inif);
 
+	return 0;
+}
+
+static int tune_initial (int frontend_fd, const char *initial)
+{
+	if (read_initial (initial) < 0)
+		return -1;
+
 	return tune_to_next_transponder(frontend_fd);
 }
 
 
-static void scan_tp_atsc(void)
+static void add_tp_filters_atsc(struct section_buf *s, const char *dmx_devname)
 {
-	struct section_buf s0,s1,s2;
-
 	if (no_ATSC_PSIP) {
-		setup_filter(&s0, demux_devname, 0x00, 0x00, -1, 1, 0, 5); /* PAT */
-		add_filter(&s0);
+		setup_filter(&s[0], dmx_devname, 0x00, 0x00, -1, 1, 0, 5); /* PAT */
+		add_filter(&s[0]);
 	} else {
 		if (ATSC_type & 0x1) {
-			setup_filter(&s0, demux_devname, 0x1ffb, 0xc8, -1, 1, 0, 5); /* terrestrial VCT */
-			add_filter(&s0);
+			setup_filter(&s[0], dmx_devname, 0x1ffb, 0xc8, -1, 1, 0, 5); /* terrestrial VCT */
+			add_filter(&s[0]);
 		}
 		if (ATSC_type & 0x2) {
-			setup_filter(&s1, demux_devname, 0x1ffb, 0xc9, -1, 1, 0, 5); /* cable VCT */
-			add_filter(&s1);
+			setup_filter(&s[1], dmx_devname, 0x1ffb, 0xc9, -1, 1, 0, 5); /* cable VCT */
+			add_filter(&s[1]);
 		}
-		setup_filter(&s2, demux_devname, 0x00, 0x00, -1, 1, 0, 5); /* PAT */
-		add_filter(&s2);
+		setup_filter(&s[2], dmx_devname, 0x00, 0x00, -1, 1, 0, 5); /* PAT */
+		add_filter(&s[2]);
 	}
-
-	do {
-		read_filters ();
-	} while (!(list_empty(&running_filters) &&
-		   list_empty(&waiting_filters)));
 }
 
-static void scan_tp_dvb (void)
+static void add_tp_filters_dvb(struct section_buf *s, const char *dmx_devname)
 {
-	struct section_buf s0;
-	struct section_buf s1;
-	struct section_buf s2;
-	struct section_buf s3;
-
 	/**
 	 *  filter timeouts > min repetition rates specified in ETR211
 	 */
-	setup_filter (&s0, demux_devname, 0x00, 0x00, -1, 1, 0, 5); /* PAT */
-	setup_filter (&s1, demux_devname, 0x11, 0x42, -1, 1, 0, 5); /* SDT */
+	setup_filter (&s[0], dmx_devname, 0x00, 0x00, -1, 1, 0, 5); /* PAT */
+	setup_filter (&s[1], dmx_devname, 0x11, 0x42, -1, 1, 0, 5); /* SDT */
 
-	add_filter (&s0);
-	add_filter (&s1);
+	add_filter (&s[0]);
+	add_filter (&s[1]);
 
 	if (!current_tp_only || output_format != OUTPUT_PIDS) {
-		setup_filter (&s2, demux_devname, 0x10, 0x40, -1, 1, 0, 15); /* NIT */
-		add_filter (&s2);
+		setup_filter (&s[2], dmx_devname, 0x10, 0x40, -1, 1, 0, 15); /* NIT */
+		add_filter (&s[2]);
 		if (get_other_nits) {
 			/* get NIT-others
 			 * Note: There is more than one NIT-other: one per
 			 * network, separated by the network_id.
 			 */
-			setup_filter (&s3, demux_devname, 0x10, 0x41, -1, 1, 1, 15);
-			add_filter (&s3);
+			setup_filter (&s[3], dmx_devname, 0x10, 0x41, -1, 1, 1, 15);
+			add_filter (&s[3]);
 		}
 	}
-
-	do {
-		read_filters ();
-	} while (!(list_empty(&running_filters) &&
-		   list_empty(&waiting_filters)));
 }
 
-static void scan_tp(void)
+/* s must have room for 4 filters */
+static int add_tp_filters(struct section_buf *s, const char *dmx_devname)
 {
 	switch(fe_info.type) {
 		case FE_QPSK:
 		case FE_QAM:
 		case FE_OFDM:
-			scan_tp_dvb();
-			break;
+			add_tp_filters_dvb(s, dmx_devname);
+			return 0;
 		case FE_ATSC:
-			scan_tp_atsc();
-			break;
+			add_tp_filters_atsc(s, dmx_devname);
+			return 0;
 		default:
-			break;
+			return -1;
 	}
 }
 
+static void scan_tp(void)
+{
+	struct section_buf s[4];
+
+	if (add_tp_filters(s, demux_devname))
+		return;
+
+	do {
+		read_filters ();
+	} while (!(list_empty(&running_filters) &&
+		   list_empty(&waiting_filters)));
+}
+
 static void scan_network (int frontend_fd, const char *initial)
 {
 	if (tune_initial (frontend_fd, initial) < 0) {
@@ -2334,6 +2054,227 @@ static void scan_network (int frontend_fd, const char *initial)
 	} while (tune_to_next_transponder(frontend_fd) == 0);
 }
 
+static long long now_ms(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec * 1000LL) + (tv.tv_usec / 1000);
+}
+
+/* parse "adapter[:frontend[:demux]],..." for -m */
+static int parse_tuners(const char *list)
+{
+	const char *p = list;
+	int adapter, frontend, demux, n;
+
+	while (*p) {
+		if (n_tuners >= MAX_TUNERS)
+			return -1;
+
+		frontend = demux = 0;
+		if (sscanf(p, "%i%n", &adapter, &n) != 1)
+			return -1;
+		p += n;
+		if (*p == ':') {
+			if (sscanf(++p, "%i%n", &frontend, &n) != 1)
+				return -1;
+			p += n;
+			if (*p == ':') {
+				if (sscanf(++p, "%i%n", &demux, &n) != 1)
+					return -1;
+				p += n;
+			}
+		}
+		if (*p == ',')
+			p++;
+		else if (*p)
+			return -1;
+
+		tuners[n_tuners].index = n_tuners;
+		tuners[n_tuners].frontend_fd = -1;
+		snprintf(tuners[n_tuners].frontend_devname, sizeof(tuners[0].frontend_devname),
+			 "/dev/dvb/adapter%i/frontend%i", adapter, frontend);
+		snprintf(tuners[n_tuners].demux_devname, sizeof(tuners[0].demux_devname),
+			 "/dev/dvb/adapter%i/demux%i", adapter, demux);
+		n_tuners++;
+	}
+
+	return n_tuners ? 0 : -1;
+}
+
+/* a pending transponder which is already scanned or being scanned under a
+ * (slightly) different frequency, e.g. listed twice in the initial file
+ */
+static int is_duplicate_transponder(struct transponder *t)
+{
+	struct list_head *pos;
+	struct transponder *tp;
+
+	list_for_each(pos, &scanned_transponders) {
+		tp = list_entry(pos, struct transponder, list);
+		if (tp->wrong_frequency || tp->last_tuning_failed)
+			continue;
+		if ((tp->type == t->type) && (tp->polarisation == t->polarisation) &&
+		    is_same_transponder(tp->param.frequency, t->param.frequency))
+			return 1;
+	}
+	return 0;
+}
+
+static void tuner_progress(struct scan_tuner *tuner, const char *what)
+{
+	int pending = 0;
+	struct list_head *pos;
+
+	list_for_each(pos, &new_transponders)
+		pending++;
+
+	info("tuner %d: %s %u (%d scanned, %d failed by this tuner, %d pending)\n",
+	     tuner->index, what, tuner->tp->param.frequency,
+	     tuner->scanned, tuner->failed, pending);
+}
+
+static void tuner_next(struct scan_tuner *tuner)
+{
+	struct transponder *t;
+
+	current_tuner = tuner;
+
+	while (!list_empty(&new_transponders)) {
+		t = list_entry(new_transponders.next, struct transponder, list);
+
+		/* move TP from "new" to "scanned" list */
+		list_del_init(&t->list);
+		if (is_duplicate_transponder(t)) {
+			verbose("tuner %d: skipping duplicate transponder %u\n",
+				tuner->index, t->param.frequency);
+			free(t->other_f);
+			free(t);
+			continue;
+		}
+		list_add_tail(&t->list, &scanned_transponders);
+		t->scan_done = 1;
+
+		if (t->type != fe_info.type) {
+			/* ignore cable descriptors in sat NIT and vice versa */
+			warning("frontend type (%s) is not compatible with requested tuning type (%s)\n",
+				fe_type2str(fe_info.type), fe_type2str(t->type));
+			t->last_tuning_failed = 1;
+			continue;
+		}
+
+		tuner->tp = t;
+		tuner->tune_attempts = 0;
+		tuner->state = TUNER_TUNING;
+		tuner->tune_deadline = 0;
+		return;
+	}
+
+	tuner->tp = NULL;
+	tuner->state = TUNER_IDLE;
+}
+
+static void tuner_poll(struct scan_tuner *tuner)
+{
+	struct transponder *t = tuner->tp;
+	int rc;
+
+	current_tuner = tuner;
+	current_tp = t;
+
+	switch (tuner->state) {
+	case TUNER_IDLE:
+		tuner_next(tuner);
+		break;
+
+	case TUNER_TUNING:
+		if (tuner->tune_deadline == 0) {
+			tuner->tune_attempts++;
+			tuner->tune_deadline = now_ms() + TUNE_TIMEOUT_MS;
+			if (start_tuning(tuner->frontend_fd, t) == 0)
+				break;
+			rc = -1;
+		} else {
+			rc = check_lock(tuner->frontend_fd, t);
+		}
+
+		if (rc == 1) {
+			tuner->state = TUNER_SCANNING;
+			add_tp_filters(tuner->filters, tuner->demux_devname);
+			break;
+		}
+		if ((rc == 0) && (now_ms() < tuner->tune_deadline))
+			break;
+
+		/* failed: retry, then try any alternative frequency */
+		tuner->tune_deadline = 0;
+		if ((rc == 0) && (tuner->tune_attempts < TUNE_ATTEMPTS))
+			break;
+		if (next_other_frequency(t) == 0) {
+			tuner->tune_attempts = 0;
+			break;
+		}
+
+		warning(">>> tuner %d: tuning failed!!!\n", tuner->index);
+		t->last_tuning_failed = 1;
+		tuner->failed++;
+		tuner_progress(tuner, "failed");
+		tuner_next(tuner);
+		break;
+
+	case TUNER_SCANNING:
+		if (tuner->n_filters)
+			break;
+
+		tuner->scanned++;
+		tuner_progress(tuner, "done");
+		tuner_next(tuner);
+		break;
+
+	case TUNER_DONE:
+		break;
+	}
+}
+
+static void scan_network_multi (const char *initial)
+{
+	int i, busy;
+
+	if (read_initial (initial) < 0) {
+		error("reading initial tuning data failed\n");
+		return;
+	}
+
+	poll_timeout = 200;
+	for (i = 0; i < n_tuners; i++)
+		time(&tuners[i].start_time);
+
+	do {
+		busy = 0;
+		for (i = 0; i < n_tuners; i++) {
+			tuner_poll(&tuners[i]);
+			if (tuners[i].state != TUNER_IDLE)
+				busy = 1;
+		}
+		if (!busy)
+			break;
+
+		if (n_running)
+			read_filters ();
+		else
+			usleep (poll_timeout * 1000);
+	} while (1);
+
+	for (i = 0; i < n_tuners; i++) {
+		tuners[i].state = TUNER_DONE;
+		info("tuner %d (%s): %d transponders scanned, %d failed in %lis\n",
+		     i, tuners[i].frontend_devname, tuners[i].scanned, tuners[i].failed,
+		     (long) (time(NULL) - tuners[i].start_time));
+	}
+	current_tuner = NULL;
+}
+
 
 static void pids_dump_service_parameter_set(FILE *f, struct service *s)
 {
@@ -2527,6 +2468,9 @@ static const char *usage = "\n"
 	"	-a N	use DVB /dev/dvb/adapterN/\n"
 	"	-f N	use DVB /dev/dvb/adapter?/frontendN\n"
 	"	-d N	use DVB /dev/dvb/adapter?/demuxN\n"
+	"	-m A[:F[:D]],...\n"
+	"		scan in parallel with several frontends on the same\n"
+	"		feed, given as adapter[:frontend[:demux]] (max %d)\n"
 	"	-s N	use DiSEqC switch position N (DVB-S only)\n"
 	"	-i N	spectral inversion setting (0: off, 1: on, 2: auto [default])\n"
 	"	-n	evaluate NIT-other for full network scan (slow!)\n"
@@ -2564,7 +2508,7 @@ bad_usage(char *pname, int problem)
 	switch (problem) {
 	default:
 	case 0:
-		fprintf (stderr, usage, pname, output_charset);
+		fprintf (stderr, usage, pname, MAX_TUNERS, output_charset);
 		break;
 	case 1:
 		i = 0;
@@ -2580,7 +2524,7 @@ bad_usage(char *pname, int problem)
 		break;
 	case 2:
 		show_existing_tuning_data_files();
-		fprintf (stderr, usage, pname);
+		fprintf (stderr, usage, pname, MAX_TUNERS, output_charset);
 	}
 }
 
@@ -2621,7 +2565,7 @@ int main (int argc, char **argv)
 
 	/* start with default lnb type */
 	lnb_type = *lnb_enum(0);
-	while ((opt = getopt(argc, argv, "5cnpa:f:d:s:o:x:e:t:i:l:vquPA:UC:D:")) != -1) {
+	while ((opt = getopt(argc, argv, "5cnpa:f:d:m:s:o:x:e:t:i:l:vquPA:UC:D:")) != -1) {
 		switch (opt) {
 		case 'a':
 			adapter = strtoul(optarg, NULL, 0);
@@ -2640,6 +2584,12 @@ int main (int argc, char **argv)
 		case 'f':
 			frontend = strtoul(optarg, NULL, 0);
 			break;
+		case 'm':
+			if (parse_tuners(optarg) < 0) {
+				bad_usage(argv[0], 0);
+				return -1;
+			}
+			break;
 		case 'p':
 			vdr_dump_provider = 1;
 			break;
@@ -2716,7 +2666,7 @@ int main (int argc, char **argv)
 	if (optind < argc)
 		initial = argv[optind];
 	if ((!initial && !current_tp_only) || (initial && current_tp_only) ||
-			(spectral_inversion > 2)) {
+			(spectral_inversion > 2) || (n_tuners && current_tp_only)) {
 		bad_usage(argv[0], 0);
 		return -1;
 	}
@@ -2730,6 +2680,47 @@ int main (int argc, char **argv)
 	if (initial)
 		info("scanning %s\n", initial);
 
+	for (i = 0; i < MAX_RUNNING; i++)
+		poll_fds[i].fd = -1;
+
+	if (n_tuners) {
+		for (i = 0; i < n_tuners; i++) {
+			struct dvb_frontend_info fei;
+
+			if ((tuners[i].frontend_fd = open (tuners[i].frontend_devname, O_RDWR)) < 0)
+				fatal("failed to open '%s': %d %m\n", tuners[i].frontend_devname, errno);
+			if (ioctl(tuners[i].frontend_fd, FE_GET_INFO, &fei) == -1)
+				fatal("FE_GET_INFO failed: %d %m\n", errno);
+			if (i == 0)
+				fe_info = fei;
+			else if (fei.type != fe_info.type)
+				fatal("'%s' is a %s frontend, '%s' is %s\n",
+				      tuners[i].frontend_devname, fe_type2str(fei.type),
+				      tuners[0].frontend_devname, fe_type2str(fe_info.type));
+			else
+				fe_info.caps &= fei.caps;
+			info("tuner %d: using '%s' and '%s'\n", i,
+			     tuners[i].frontend_devname, tuners[i].demux_devname);
+		}
+
+		if ((spectral_inversion == INVERSION_AUTO ) &&
+		    !(fe_info.caps & FE_CAN_INVERSION_AUTO)) {
+			info("Frontend can not do INVERSION_AUTO, trying INVERSION_OFF instead\n");
+			spectral_inversion = INVERSION_OFF;
+		}
+
+		signal(SIGINT, handle_sigint);
+
+		scan_network_multi (initial);
+
+		for (i = 0; i < n_tuners; i++)
+			close (tuners[i].frontend_fd);
+
+		dump_lists ();
+
+		return 0;
+	}
+
 	snprintf (frontend_devname, sizeof(frontend_devname),
 		  "/dev/dvb/adapter%i/frontend%i", adapter, frontend);
 
@@ -2737,9 +2728,6 @@ int main (int argc, char **argv)
 		  "/dev/dvb/adapter%i/demux%i", adapter, demux);
 	info("using '%s' and '%s'\n", frontend_devname, demux_devname);
 
-	for (i = 0; i < MAX_RUNNING; i++)
-		poll_fds[i].fd = -1;
-
 	fe_open_mode = current_tp_only ? O_RDONLY : O_RDWR;
 	if ((frontend_fd = open (frontend_devname, fe_open_mode)) < 0)
 		fatal("failed to open '%s': %d %m\n", frontend_devname, errno);
@@ -19,6 +19,7 @@
 */
 
 #include <linux/delay.h>
+#include <linux/err.h>
 #include <linux/videodev2.h>
 #include "tda18271-priv.h"
 #include "tda8290.h"
@@ -251,32 +252,36 @@ static int tda18271_read_thermometer(struct dvb_frontend *fe)
 
 /* ------------------------------------------------------------------ */
 
-static int tda18271c2_rf_tracking_filters_correction(struct dvb_frontend *fe,
-						     u32 freq)
+/*
+ * The frequency dependent part of the correction only changes when the
+ * tracking filters are calibrated again, so it is kept for the last few
+ * channels tuned.
+ */
+static struct tda18271_rf_cal_cache *
+tda18271c2_rf_cal_cache(struct dvb_frontend *fe, u32 freq)
 {
 	struct tda18271_priv *priv = fe->tuner_priv;
 	struct tda18271_rf_tracking_filter_cal *map = priv->rf_cal_state;
+	struct tda18271_rf_cal_cache *cache;
 	unsigned char *regs = priv->tda18271_regs;
 	int i, ret;
-	u8 tm_current, dc_over_dt, rf_tab;
-	s32 rfcal_comp, approx;
-
-	/* power up */
-	ret = tda18271_set_standby_mode(fe, 0, 0, 0);
-	if (tda_fail(ret))
-		goto fail;
+	u8 dc_over_dt, rf_tab;
+	s32 approx;
 
-	/* read die current temperature */
-	tm_current = tda18271_read_thermometer(fe);
-
-	/* frequency dependent parameters */
+	for (i = 0; i < TDA18271_RF_CAL_CACHE; i++) {
+		if (priv->rf_cal_cache[i].freq == freq) {
+			tda_cal("freq = %d, cached\n", freq);
+			return &priv->rf_cal_cache[i];
+		}
+	}
 
-	tda18271_calc_rf_cal(fe, &freq);
+	/* out of range of the rf_cal map leaves the last RF_CAL byte */
+	ret = tda18271_calc_rf_cal(fe, &freq);
 	rf_tab = regs[R_EB14];
 
 	i = tda18271_lookup_rf_band(fe, &freq, NULL);
 	if (tda_fail(i))
-		return i;
+		return ERR_PTR(i);
 
 	if ((0 == map[i].rf3) || (freq / 1000 < map[i].rf2)) {
 		approx = map[i].rf_a1 * (s32)(freq / 1000 - map[i].rf1) +
@@ -293,10 +298,47 @@ static int tda18271c2_rf_tracking_filters_correction(struct dvb_frontend *fe,
 
 	tda18271_lookup_map(fe, RF_CAL_DC_OVER_DT, &freq, &dc_over_dt);
 
+	cache = &priv->rf_cal_cache[priv->rf_cal_cache_next];
+	cache->approx     = approx;
+	cache->dc_over_dt = dc_over_dt;
+	cache->freq       = 0;
+
+	if (ret >= 0) {
+		cache->freq = freq;
+		priv->rf_cal_cache_next = (priv->rf_cal_cache_next + 1) %
+					  TDA18271_RF_CAL_CACHE;
+	}
+	return cache;
+}
+
+static int tda18271c2_rf_tracking_filters_correction(struct dvb_frontend *fe,
+						     u32 freq)
+{
+	struct tda18271_priv *priv = fe->tuner_priv;
+	struct tda18271_rf_cal_cache *cache;
+	unsigned char *regs = priv->tda18271_regs;
+	int ret;
+	u8 tm_current;
+	s32 rfcal_comp;
+
+	/* power up */
+	ret = tda18271_set_standby_mode(fe, 0, 0, 0);
+	if (tda_fail(ret))
+		goto fail;
+
+	/* read die current temperature */
+	tm_current = tda18271_read_thermometer(fe);
+
+	/* frequency dependent parameters */
+	cache = tda18271c2_rf_cal_cache(fe, freq);
+	if (IS_ERR(cache))
+		return PTR_ERR(cache);
+
 	/* calculate temperature compensation */
-	rfcal_comp = dc_over_dt * (s32)(tm_current - priv->tm_rfcal) / 1000;
+	rfcal_comp = cache->dc_over_dt *
+		(s32)(tm_current - priv->tm_rfcal) / 1000;
 
-	regs[R_EB14] = (unsigned char)(approx + rfcal_comp);
+	regs[R_EB14] = (unsigned char)(cache->approx + rfcal_comp);
 	ret = tda18271_write_regs(fe, R_EB14, 1);
 fail:
 	return ret;
@@ -651,6 +693,9 @@ static int tda18271_calc_rf_filter_curve(struct dvb_frontend *fe)
 	/* wait for die temperature stabilization */
 	msleep(200);
 
+	/* the corrections depend on the filter curve */
+	memset(priv->rf_cal_cache, 0, sizeof(priv->rf_cal_cache));
+
 	ret = tda18271_powerscan_init(fe);
 	if (tda_fail(ret))
 		goto fail;
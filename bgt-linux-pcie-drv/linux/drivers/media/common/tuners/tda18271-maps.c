@@ -31,6 +31,39 @@ struct tda18271_map {
 	u8  val;
 };
 
+/*
+ * The maps are sorted on their maximum frequency, so finding the first
+ * entry that covers freq is a binary search.  It returns the number of
+ * entries if freq is above all of them.
+ */
+#define tda18271_search_map(map, max, entries, freq)			\
+({									\
+	unsigned int __lo = 0, __hi = (entries), __mid;			\
+	while (__lo < __hi) {						\
+		__mid = (__lo + __hi) / 2;				\
+		if (((map)[__mid].max * 1000) < (freq))			\
+			__lo = __mid + 1;				\
+		else							\
+			__hi = __mid;					\
+	}								\
+	__lo;								\
+})
+
+/* entries of a map, or 0 if it is missing or unsorted */
+#define tda18271_count_map(map, max, map_name)				\
+({									\
+	unsigned int __n = 0;						\
+	while ((map) && (map)[__n].max) {				\
+		if (__n && ((map)[__n].max < (map)[__n - 1].max)) {	\
+			tda_warn("%s map is not sorted\n", map_name);	\
+			__n = 0;					\
+			break;						\
+		}							\
+		__n++;							\
+	}								\
+	__n;								\
+})
+
 /*---------------------------------------------------------------------*/
 
 static struct tda18271_pll_map tda18271c1_main_pll[] = {
@@ -979,13 +1012,12 @@ int tda18271_lookup_cid_target(struct dvb_frontend *fe,
 			       u32 *freq, u8 *cid_target, u16 *count_limit)
 {
 	struct tda18271_priv *priv = fe->tuner_priv;
-	int i = 0;
+	unsigned int entries = ARRAY_SIZE(tda18271_cid_target) - 1;
+	int i;
 
-	while ((tda18271_cid_target[i].rfmax * 1000) < *freq) {
-		if (tda18271_cid_target[i + 1].rfmax == 0)
-			break;
-		i++;
-	}
+	i = tda18271_search_map(tda18271_cid_target, rfmax, entries, *freq);
+	if (i == entries)
+		i--;
 	*cid_target  = tda18271_cid_target[i].target;
 	*count_limit = tda18271_cid_target[i].limit;
 
@@ -1020,24 +1052,24 @@ int tda18271_lookup_rf_band(struct dvb_frontend *fe, u32 *freq, u8 *rf_band)
 {
 	struct tda18271_priv *priv = fe->tuner_priv;
 	struct tda18271_rf_tracking_filter_cal *map = priv->rf_cal_state;
-	int i = 0;
-
-	while ((map[i].rfmax * 1000) < *freq) {
-		if (tda18271_debug & DBG_ADV)
-			tda_map("(%d) rfmax = %d < freq = %d, "
-				"rf1_def = %d, rf2_def = %d, rf3_def = %d, "
-				"rf1 = %d, rf2 = %d, rf3 = %d, "
-				"rf_a1 = %d, rf_a2 = %d, "
-				"rf_b1 = %d, rf_b2 = %d\n",
-				i, map[i].rfmax * 1000, *freq,
-				map[i].rf1_def, map[i].rf2_def, map[i].rf3_def,
-				map[i].rf1, map[i].rf2, map[i].rf3,
-				map[i].rf_a1, map[i].rf_a2,
-				map[i].rf_b1, map[i].rf_b2);
-		if (map[i].rfmax == 0)
-			return -EINVAL;
-		i++;
-	}
+	unsigned int entries = ARRAY_SIZE(tda18271_rf_band_template) - 1;
+	int i;
+
+	i = tda18271_search_map(map, rfmax, entries, *freq);
+	if (i == entries)
+		return -EINVAL;
+
+	if (tda18271_debug & DBG_ADV)
+		tda_map("(%d) rfmax = %d >= freq = %d, "
+			"rf1_def = %d, rf2_def = %d, rf3_def = %d, "
+			"rf1 = %d, rf2 = %d, rf3 = %d, "
+			"rf_a1 = %d, rf_a2 = %d, "
+			"rf_b1 = %d, rf_b2 = %d\n",
+			i, map[i].rfmax * 1000, *freq,
+			map[i].rf1_def, map[i].rf2_def, map[i].rf3_def,
+			map[i].rf1, map[i].rf2, map[i].rf3,
+			map[i].rf_a1, map[i].rf_a2,
+			map[i].rf_b1, map[i].rf_b2);
 	if (rf_band)
 		*rf_band = map[i].rfband;
 
@@ -1070,7 +1102,7 @@ int tda18271_lookup_pll_map(struct dvb_frontend *fe,
 {
 	struct tda18271_priv *priv = fe->tuner_priv;
 	struct tda18271_pll_map *map = NULL;
-	unsigned int i = 0;
+	unsigned int i = 0, entries;
 	char *map_name;
 	int ret = 0;
 
@@ -1097,15 +1129,25 @@ int tda18271_lookup_pll_map(struct dvb_frontend *fe,
 		goto fail;
 	}
 
-	while ((map[i].lomax * 1000) < *freq) {
-		if (map[i + 1].lomax == 0) {
-			tda_map("%s: frequency (%d) out of range\n",
-				map_name, *freq);
+	entries = priv->map_entries[map_type];
+	if (entries) {
+		i = tda18271_search_map(map, lomax, entries, *freq);
+		if (i == entries) {
+			i--;
 			ret = -ERANGE;
-			break;
 		}
-		i++;
+	} else {
+		while ((map[i].lomax * 1000) < *freq) {
+			if (map[i + 1].lomax == 0) {
+				ret = -ERANGE;
+				break;
+			}
+			i++;
+		}
 	}
+	if (ret == -ERANGE)
+		tda_map("%s: frequency (%d) out of range\n",
+			map_name, *freq);
 	*post_div = map[i].pd;
 	*div      = map[i].d;
 
@@ -1121,7 +1163,7 @@ int tda18271_lookup_map(struct dvb_frontend *fe,
 {
 	struct tda18271_priv *priv = fe->tuner_priv;
 	struct tda18271_map *map = NULL;
-	unsigned int i = 0;
+	unsigned int i = 0, entries;
 	char *map_name;
 	int ret = 0;
 
@@ -1168,15 +1210,25 @@ int tda18271_lookup_map(struct dvb_frontend *fe,
 		goto fail;
 	}
 
-	while ((map[i].rfmax * 1000) < *freq) {
-		if (map[i + 1].rfmax == 0) {
-			tda_map("%s: frequency (%d) out of range\n",
-				map_name, *freq);
+	entries = priv->map_entries[map_type];
+	if (entries) {
+		i = tda18271_search_map(map, rfmax, entries, *freq);
+		if (i == entries) {
+			i--;
 			ret = -ERANGE;
-			break;
 		}
-		i++;
+	} else {
+		while ((map[i].rfmax * 1000) < *freq) {
+			if (map[i + 1].rfmax == 0) {
+				ret = -ERANGE;
+				break;
+			}
+			i++;
+		}
 	}
+	if (ret == -ERANGE)
+		tda_map("%s: frequency (%d) out of range\n",
+			map_name, *freq);
 	*val = map[i].val;
 
 	tda_map("(%d) %s: 0x%02x\n", i, map_name, *val);
@@ -1303,5 +1355,31 @@ int tda18271_assign_map_layout(struct dvb_frontend *fe)
 	memcpy(priv->rf_cal_state, &tda18271_rf_band_template,
 	       sizeof(tda18271_rf_band_template));
 
-	return ret;
+	if (ret < 0)
+		return ret;
+
+	/* size the maps once, so that lookups can search them */
+	priv->map_entries[MAIN_PLL] =
+		tda18271_count_map(priv->maps->main_pll, lomax, "main_pll");
+	priv->map_entries[CAL_PLL] =
+		tda18271_count_map(priv->maps->cal_pll, lomax, "cal_pll");
+	priv->map_entries[RF_CAL] =
+		tda18271_count_map(priv->maps->rf_cal, rfmax, "rf_cal");
+	priv->map_entries[RF_CAL_KMCO] =
+		tda18271_count_map(priv->maps->rf_cal_kmco, rfmax, "km");
+	priv->map_entries[RF_CAL_DC_OVER_DT] =
+		tda18271_count_map(priv->maps->rf_cal_dc_over_dt, rfmax,
+				   "rf_cal_dc_over_dt");
+	priv->map_entries[BP_FILTER] =
+		tda18271_count_map(priv->maps->bp_filter, rfmax, "bp_filter");
+	priv->map_entries[RF_BAND] =
+		tda18271_count_map(priv->maps->rf_band, rfmax, "rf_band");
+	priv->map_entries[GAIN_TAPER] =
+		tda18271_count_map(priv->maps->gain_taper, rfmax,
+				   "gain_taper");
+	priv->map_entries[IR_MEASURE] =
+		tda18271_count_map(priv->maps->ir_measure, rfmax,
+				   "ir_measure");
+
+	return 0;
 }
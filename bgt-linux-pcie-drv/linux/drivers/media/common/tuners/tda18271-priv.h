@@ -93,6 +93,29 @@ enum tda18271_pll {
 
 struct tda18271_map_layout;
 
+enum tda18271_map_type {
+	/* tda18271_pll_map */
+	MAIN_PLL,
+	CAL_PLL,
+	/* tda18271_map */
+	RF_CAL,
+	RF_CAL_KMCO,
+	RF_CAL_DC_OVER_DT,
+	BP_FILTER,
+	RF_BAND,
+	GAIN_TAPER,
+	IR_MEASURE,
+};
+
+/* RF tracking filter correction of a channel, less temperature compensation */
+struct tda18271_rf_cal_cache {
+	u32 freq; /* 0 if unused */
+	u8  approx;
+	u8  dc_over_dt;
+};
+
+#define TDA18271_RF_CAL_CACHE 8
+
 enum tda18271_ver {
 	TDA18271HDC1,
 	TDA18271HDC2,
@@ -117,9 +140,13 @@ struct tda18271_priv {
 	u8 tm_rfcal;
 
 	struct tda18271_map_layout *maps;
+	u16 map_entries[IR_MEASURE + 1]; /* 0: walk the map */
 	struct tda18271_std_map std;
 	struct tda18271_rf_tracking_filter_cal rf_cal_state[8];
 
+	struct tda18271_rf_cal_cache rf_cal_cache[TDA18271_RF_CAL_CACHE];
+	unsigned int rf_cal_cache_next;
+
 	struct mutex lock;
 
 	u16 if_freq;
@@ -171,20 +198,6 @@ do {								\
 
 /*---------------------------------------------------------------------*/
 
-enum tda18271_map_type {
-	/* tda18271_pll_map */
-	MAIN_PLL,
-	CAL_PLL,
-	/* tda18271_map */
-	RF_CAL,
-	RF_CAL_KMCO,
-	RF_CAL_DC_OVER_DT,
-	BP_FILTER,
-	RF_BAND,
-	GAIN_TAPER,
-	IR_MEASURE,
-};
-
 extern int tda18271_lookup_pll_map(struct dvb_frontend *fe,
 				   enum tda18271_map_type map_type,
 				   u32 *freq, u8 *post_div, u8 *div);
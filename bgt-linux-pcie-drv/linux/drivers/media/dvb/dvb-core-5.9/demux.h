@@ -236,6 +236,9 @@ struct dmx_demux {
 
 	int (*get_stc) (struct dmx_demux* demux, unsigned int num,
 			u64 *stc, unsigned int *base);
+
+	int (*get_pid_stats) (struct dmx_demux* demux,
+			      struct dmx_pid_stats *stats);
 };
 
 #endif /* #ifndef __DEMUX_H */
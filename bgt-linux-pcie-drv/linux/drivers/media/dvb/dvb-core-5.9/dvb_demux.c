@@ -50,6 +50,11 @@ module_param(dvb_demux_speedcheck, int, 0644);
 MODULE_PARM_DESC(dvb_demux_speedcheck,
 		"enable transport stream speed check");
 
+static int dvb_demux_secstats;
+module_param(dvb_demux_secstats, int, 0644);
+MODULE_PARM_DESC(dvb_demux_secstats,
+		"log sections assembled/delivered when a section feed is released");
+
 static int dvb_demux_feed_err_pkts = 1;
 module_param(dvb_demux_feed_err_pkts, int, 0644);
 MODULE_PARM_DESC(dvb_demux_feed_err_pkts,
@@ -151,6 +156,7 @@ static int dvb_dmx_swfilter_sectionfilter(struct dvb_demux_feed *feed,
 	if (f->doneq && !neq)
 		return 0;
 
+	feed->sections_delivered++;
 	return feed->cb.sec(feed->feed.sec.secbuf, feed->feed.sec.seclen,
 			    NULL, 0, &f->filter, DMX_OK);
 }
@@ -168,11 +174,14 @@ static inline int dvb_dmx_swfilter_section_feed(struct dvb_demux_feed *feed)
 	if (!f)
 		return 0;
 
+	feed->sections_assembled++;
 	if (sec->check_crc) {
 		section_syntax_indicator = ((sec->secbuf[1] & 0x80) != 0);
 		if (section_syntax_indicator &&
-		    demux->check_crc32(feed, sec->secbuf, sec->seclen))
+		    demux->check_crc32(feed, sec->secbuf, sec->seclen)) {
+			feed->sections_crc_errors++;
 			return -1;
+		}
 	}
 
 	do {
@@ -392,12 +401,55 @@ static inline void dvb_dmx_swfilter_packet_type(struct dvb_demux_feed *feed,
 	((f)->feed.ts.is_filtering) &&					\
 	(((f)->ts_type & (TS_PACKET | TS_DEMUX)) == TS_PACKET))
 
+static inline void dvb_dmx_count_packet(struct dvb_demux *demux,
+					const u8 *buf, u16 pid)
+{
+	struct dvb_demux_pid_stats *stats = &demux->pid_stats[pid];
+	u8 cc = buf[3] & 0x0f;
+
+	demux->stats_packets++;
+	if (time_after_eq(jiffies, demux->stats_rate_jiffies + HZ)) {
+		unsigned long delta = jiffies - demux->stats_rate_jiffies;
+		u64 bits = (demux->stats_packets - demux->stats_rate_packets) *
+			   188 * 8 * HZ;
+
+		demux->stats_bitrate = div64_u64(bits, delta);
+		demux->stats_rate_jiffies = jiffies;
+		demux->stats_rate_packets = demux->stats_packets;
+	}
+
+	stats->packets++;
+	/* with TEI set, the rest of the header can't be trusted either */
+	if (buf[1] & 0x80) {
+		stats->tei++;
+		return;
+	}
+	if (buf[3] & 0xc0)
+		stats->scrambled++;
+
+	/* the counter only advances on packets with payload, and a packet may
+	 * be sent twice; the discontinuity_indicator allows anything */
+	if (stats->cc != 0xff && pid != 0x1fff &&
+	    !((buf[3] & 0x20) && buf[4] && (buf[5] & 0x80))) {
+		if (buf[3] & 0x10) {
+			if (cc != ((stats->cc + 1) & 0x0f) && cc != stats->cc)
+				stats->cc_errors++;
+		} else if (cc != stats->cc) {
+			stats->cc_errors++;
+		}
+	}
+	stats->cc = cc;
+}
+
 static void dvb_dmx_swfilter_packet(struct dvb_demux *demux, const u8 *buf)
 {
 	struct dvb_demux_feed *feed;
 	u16 pid = ts_pid(buf);
 	int dvr_done = 0;
 
+	if (demux->pid_stats)
+		dvb_dmx_count_packet(demux, buf, pid);
+
 	if (dvb_demux_speedcheck) {
 		struct timespec cur_time, delta_time;
 		u64 speed_bytes, speed_timedelta;
@@ -1081,6 +1133,9 @@ static int dvbdmx_allocate_section_feed(struct dmx_demux *demux,
 	dvbdmxfeed->feed.sec.tsfeedp = 0;
 	dvbdmxfeed->filter = NULL;
 	dvbdmxfeed->buffer = NULL;
+	dvbdmxfeed->sections_assembled = 0;
+	dvbdmxfeed->sections_crc_errors = 0;
+	dvbdmxfeed->sections_delivered = 0;
 
 	(*feed) = &dvbdmxfeed->feed.sec;
 	(*feed)->is_filtering = 0;
@@ -1115,6 +1170,13 @@ static int dvbdmx_release_section_feed(struct dmx_demux *demux,
 #endif
 	dvbdmxfeed->state = DMX_STATE_FREE;
 
+	if (dvb_demux_secstats)
+		printk(KERN_INFO "dvb_demux: PID 0x%04x: %u sections assembled, "
+		       "%u CRC errors, %u delivered\n", dvbdmxfeed->pid,
+		       dvbdmxfeed->sections_assembled,
+		       dvbdmxfeed->sections_crc_errors,
+		       dvbdmxfeed->sections_delivered);
+
 	dvb_demux_feed_del(dvbdmxfeed);
 
 	dvbdmxfeed->pid = 0xffff;
@@ -1245,12 +1307,64 @@ static int dvbdmx_get_pes_pids(struct dmx_demux *demux, u16 * pids)
 	return 0;
 }
 
+static int dvbdmx_get_pid_stats(struct dmx_demux *demux,
+				struct dmx_pid_stats *stats)
+{
+	struct dvb_demux *dvbdemux = (struct dvb_demux *)demux;
+	struct dmx_pid_stats_entry batch[32];
+	struct dmx_pid_stats_entry __user *entries;
+	u32 count = 0;
+	int n = 0;
+	int pid;
+
+	if (!dvbdemux->pid_stats)
+		return -EINVAL;
+
+	/* no locking: each counter is read once, which is as consistent as a
+	 * snapshot of a running stream gets */
+	entries = (struct dmx_pid_stats_entry __user *)(unsigned long)stats->entries;
+	stats->packets = dvbdemux->stats_packets;
+	stats->bitrate = dvbdemux->stats_bitrate;
+	stats->msecs = jiffies_to_msecs(jiffies);
+	stats->pids = 0;
+
+	for (pid = 0; pid < MAX_PID + 1; pid++) {
+		struct dvb_demux_pid_stats *s = &dvbdemux->pid_stats[pid];
+		u32 packets = s->packets;
+
+		if (!packets)
+			continue;
+		stats->pids++;
+		if (count + n >= stats->count)
+			continue;
+
+		batch[n].pid = pid;
+		batch[n].reserved = 0;
+		batch[n].packets = packets;
+		batch[n].cc_errors = s->cc_errors;
+		batch[n].tei = s->tei;
+		batch[n].scrambled = s->scrambled;
+		if (++n == ARRAY_SIZE(batch)) {
+			if (copy_to_user(entries + count, batch, sizeof(batch)))
+				return -EFAULT;
+			count += n;
+			n = 0;
+		}
+	}
+	if (n && copy_to_user(entries + count, batch, n * sizeof(batch[0])))
+		return -EFAULT;
+
+	stats->count = count + n;
+	return 0;
+}
+
 int dvb_dmx_init(struct dvb_demux *dvbdemux)
 {
 	int i;
 	struct dmx_demux *dmx = &dvbdemux->dmx;
 
 	dvbdemux->cnt_storage = NULL;
+	dvbdemux->pid_stats = NULL;
 	dvbdemux->users = 0;
 	dvbdemux->filter = vmalloc(dvbdemux->filternum * sizeof(struct dvb_demux_filter));
 
@@ -1276,6 +1390,20 @@ int dvb_dmx_init(struct dvb_demux *dvbdemux)
 	if (!dvbdemux->cnt_storage)
 		printk(KERN_WARNING "Couldn't allocate memory for TS/TEI check. Disabling it\n");
 
+	dvbdemux->pid_stats = vmalloc((MAX_PID + 1) *
+				      sizeof(struct dvb_demux_pid_stats));
+	if (dvbdemux->pid_stats) {
+		memset(dvbdemux->pid_stats, 0,
+		       (MAX_PID + 1) * sizeof(struct dvb_demux_pid_stats));
+		for (i = 0; i < MAX_PID + 1; i++)
+			dvbdemux->pid_stats[i].cc = 0xff;
+	} else
+		printk(KERN_WARNING "Couldn't allocate memory for PID statistics. Disabling them\n");
+	dvbdemux->stats_packets = 0;
+	dvbdemux->stats_rate_packets = 0;
+	dvbdemux->stats_rate_jiffies = jiffies;
+	dvbdemux->stats_bitrate = 0;
+
 	INIT_LIST_HEAD(&dvbdemux->frontend_list);
 
 	for (i = 0; i < DMX_PES_OTHER; i++) {
@@ -1311,6 +1439,7 @@ int dvb_dmx_init(struct dvb_demux *dvbdemux)
 	dmx->connect_frontend = dvbdmx_connect_frontend;
 	dmx->disconnect_frontend = dvbdmx_disconnect_frontend;
 	dmx->get_pes_pids = dvbdmx_get_pes_pids;
+	dmx->get_pid_stats = dvbdmx_get_pid_stats;
 
 	mutex_init(&dvbdemux->mutex);
 	spin_lock_init(&dvbdemux->lock);
@@ -1323,6 +1452,7 @@ EXPORT_SYMBOL(dvb_dmx_init);
 void dvb_dmx_release(struct dvb_demux *dvbdemux)
 {
 	vfree(dvbdemux->cnt_storage);
+	vfree(dvbdemux->pid_stats);
 	vfree(dvbdemux->filter);
 	vfree(dvbdemux->feed);
 }
@@ -24,6 +24,7 @@
 #include <linux/spinlock.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/poll.h>
 #include <linux/ioctl.h>
@@ -149,12 +150,13 @@ static int dvb_dvr_open(struct inode *inode, struct file *file)
 			mutex_unlock(&dmxdev->mutex);
 			return -EBUSY;
 		}
-		mem = vmalloc(DVR_BUFFER_SIZE);
+		mem = vmalloc(roundup_pow_of_two(DVR_BUFFER_SIZE));
 		if (!mem) {
 			mutex_unlock(&dmxdev->mutex);
 			return -ENOMEM;
 		}
-		dvb_ringbuffer_init(&dmxdev->dvr_buffer, mem, DVR_BUFFER_SIZE);
+		dvb_ringbuffer_init(&dmxdev->dvr_buffer, mem,
+				    roundup_pow_of_two(DVR_BUFFER_SIZE));
 		dvbdev->readers--;
 	}
 
@@ -262,10 +264,11 @@ static int dvb_dvr_set_buffer_size(struct dmxdev *dmxdev,
 
 	dprintk("function : %s\n", __func__);
 
+	if (!size || size > INT_MAX)
+		return -EINVAL;
+	size = roundup_pow_of_two(size);
 	if (buf->size == size)
 		return 0;
-	if (!size)
-		return -EINVAL;
 
 	newmem = vmalloc(size);
 	if (!newmem)
@@ -273,12 +276,9 @@ static int dvb_dvr_set_buffer_size(struct dmxdev *dmxdev,
 
 	oldmem = buf->data;
 
-	spin_lock_irq(&dmxdev->lock);
-	buf->data = newmem;
-	buf->size = size;
-
 	/* reset and not flush in case the buffer shrinks */
-	dvb_ringbuffer_reset(buf);
+	spin_lock_irq(&dmxdev->lock);
+	dvb_ringbuffer_set_data(buf, newmem, size);
 	spin_unlock_irq(&dmxdev->lock);
 
 	vfree(oldmem);
@@ -301,10 +301,11 @@ static int dvb_dmxdev_set_buffer_size(struct dmxdev_filter *dmxdevfilter,
 	void *newmem;
 	void *oldmem;
 
+	if (!size || size > INT_MAX)
+		return -EINVAL;
+	size = roundup_pow_of_two(size);
 	if (buf->size == size)
 		return 0;
-	if (!size)
-		return -EINVAL;
 	if (dmxdevfilter->state >= DMXDEV_STATE_GO)
 		return -EBUSY;
 
@@ -314,12 +315,9 @@ static int dvb_dmxdev_set_buffer_size(struct dmxdev_filter *dmxdevfilter,
 
 	oldmem = buf->data;
 
-	spin_lock_irq(&dmxdevfilter->dev->lock);
-	buf->data = newmem;
-	buf->size = size;
-
 	/* reset and not flush in case the buffer shrinks */
-	dvb_ringbuffer_reset(buf);
+	spin_lock_irq(&dmxdevfilter->dev->lock);
+	dvb_ringbuffer_set_data(buf, newmem, size);
 	spin_unlock_irq(&dmxdevfilter->dev->lock);
 
 	vfree(oldmem);
@@ -364,11 +362,16 @@ static int dvb_dmxdev_section_callback(const u8 *buffer1, size_t buffer1_len,
 		wake_up(&dmxdevfilter->buffer.queue);
 		return 0;
 	}
-	spin_lock(&dmxdevfilter->dev->lock);
-	if (dmxdevfilter->state != DMXDEV_STATE_GO) {
-		spin_unlock(&dmxdevfilter->dev->lock);
+
+	/*
+	 * A filter's own buffer has a single reader, as reads of the filter
+	 * hold dmxdevfilter->mutex, and a single writer, as the demux
+	 * serializes the callbacks of its feeds. Its memory and the filter
+	 * parameters only change while the filter is stopped. So it is
+	 * filled without dmxdev->lock.
+	 */
+	if (ACCESS_ONCE(dmxdevfilter->state) != DMXDEV_STATE_GO)
 		return 0;
-	}
 	del_timer(&dmxdevfilter->timer);
 	dprintk("dmxdev: section callback %*ph\n", 6, buffer1);
 	ret = dvb_dmxdev_buffer_write(&dmxdevfilter->buffer, buffer1,
@@ -377,13 +380,13 @@ static int dvb_dmxdev_section_callback(const u8 *buffer1, size_t buffer1_len,
 		ret = dvb_dmxdev_buffer_write(&dmxdevfilter->buffer, buffer2,
 					      buffer2_len);
 	}
-	if (ret < 0) {
-		dvb_ringbuffer_flush(&dmxdevfilter->buffer);
+	if (ret < 0)
 		dmxdevfilter->buffer.error = ret;
-	}
-	if (dmxdevfilter->params.sec.flags & DMX_ONESHOT)
+	if (dmxdevfilter->params.sec.flags & DMX_ONESHOT) {
+		spin_lock(&dmxdevfilter->dev->lock);
 		dmxdevfilter->state = DMXDEV_STATE_DONE;
-	spin_unlock(&dmxdevfilter->dev->lock);
+		spin_unlock(&dmxdevfilter->dev->lock);
+	}
 	wake_up(&dmxdevfilter->buffer.queue);
 	return 0;
 }
@@ -395,32 +398,39 @@ static int dvb_dmxdev_ts_callback(const u8 *buffer1, size_t buffer1_len,
 {
 	struct dmxdev_filter *dmxdevfilter = feed->priv;
 	struct dvb_ringbuffer *buffer;
+	int lock;
 	int ret;
 
-	spin_lock(&dmxdevfilter->dev->lock);
-	if (dmxdevfilter->params.pes.output == DMX_OUT_DECODER) {
-		spin_unlock(&dmxdevfilter->dev->lock);
+	if (dmxdevfilter->params.pes.output == DMX_OUT_DECODER)
 		return 0;
-	}
 
-	if (dmxdevfilter->params.pes.output == DMX_OUT_TAP
-	    || dmxdevfilter->params.pes.output == DMX_OUT_TSDEMUX_TAP)
-		buffer = &dmxdevfilter->buffer;
-	else
+	/*
+	 * The filter's own buffer is filled without dmxdev->lock, see
+	 * dvb_dmxdev_section_callback(). The DVR buffer can be replaced or
+	 * freed by the DVR device while the feed runs, so it needs the lock.
+	 */
+	lock = !(dmxdevfilter->params.pes.output == DMX_OUT_TAP
+		 || dmxdevfilter->params.pes.output == DMX_OUT_TSDEMUX_TAP);
+	if (lock) {
 		buffer = &dmxdevfilter->dev->dvr_buffer;
+		spin_lock(&dmxdevfilter->dev->lock);
+	} else {
+		buffer = &dmxdevfilter->buffer;
+	}
+
 	if (buffer->error) {
-		spin_unlock(&dmxdevfilter->dev->lock);
+		if (lock)
+			spin_unlock(&dmxdevfilter->dev->lock);
 		wake_up(&buffer->queue);
 		return 0;
 	}
 	ret = dvb_dmxdev_buffer_write(buffer, buffer1, buffer1_len);
 	if (ret == buffer1_len)
 		ret = dvb_dmxdev_buffer_write(buffer, buffer2, buffer2_len);
-	if (ret < 0) {
-		dvb_ringbuffer_flush(buffer);
+	if (ret < 0)
 		buffer->error = ret;
-	}
-	spin_unlock(&dmxdevfilter->dev->lock);
+	if (lock)
+		spin_unlock(&dmxdevfilter->dev->lock);
 	wake_up(&buffer->queue);
 	return 0;
 }
@@ -474,18 +484,37 @@ static int dvb_dmxdev_feed_start(struct dmxdev_filter *filter)
 	return 0;
 }
 
+/* find an active section feed which can be shared by a new filter: sections
+   are assembled and CRC checked once per feed, then passed to all of the
+   feed's filters, so the PID and the CRC check must both match */
+static struct dmx_section_feed *
+dvb_dmxdev_find_section_feed(struct dmxdev *dmxdev,
+			     struct dmx_sct_filter_params *para)
+{
+	int i;
+
+	for (i = 0; i < dmxdev->filternum; i++)
+		if (dmxdev->filter[i].state >= DMXDEV_STATE_GO &&
+		    dmxdev->filter[i].type == DMXDEV_TYPE_SEC &&
+		    dmxdev->filter[i].params.sec.pid == para->pid &&
+		    !((dmxdev->filter[i].params.sec.flags ^ para->flags) &
+		      DMX_CHECK_CRC))
+			return dmxdev->filter[i].feed.sec;
+
+	return NULL;
+}
+
 /* restart section feed if it has filters left associated with it,
    otherwise release the feed */
 static int dvb_dmxdev_feed_restart(struct dmxdev_filter *filter)
 {
 	int i;
 	struct dmxdev *dmxdev = filter->dev;
-	u16 pid = filter->params.sec.pid;
 
 	for (i = 0; i < dmxdev->filternum; i++)
 		if (dmxdev->filter[i].state >= DMXDEV_STATE_GO &&
 		    dmxdev->filter[i].type == DMXDEV_TYPE_SEC &&
-		    dmxdev->filter[i].params.sec.pid == pid) {
+		    dmxdev->filter[i].feed.sec == filter->feed.sec) {
 			dvb_dmxdev_feed_start(&dmxdev->filter[i]);
 			return 0;
 		}
@@ -617,7 +646,7 @@ static int dvb_dmxdev_filter_start(struct dmxdev_filter *filter)
 	struct dmxdev *dmxdev = filter->dev;
 	struct dmxdev_feed *feed;
 	void *mem;
-	int ret, i;
+	int ret;
 
 	if (filter->state < DMXDEV_STATE_SET)
 		return -EINVAL;
@@ -644,18 +673,9 @@ static int dvb_dmxdev_filter_start(struct dmxdev_filter *filter)
 		struct dmx_section_feed **secfeed = &filter->feed.sec;
 
 		*secfilter = NULL;
-		*secfeed = NULL;
-
 
-		/* find active filter/feed with same PID */
-		for (i = 0; i < dmxdev->filternum; i++) {
-			if (dmxdev->filter[i].state >= DMXDEV_STATE_GO &&
-			    dmxdev->filter[i].type == DMXDEV_TYPE_SEC &&
-			    dmxdev->filter[i].params.sec.pid == para->pid) {
-				*secfeed = dmxdev->filter[i].feed.sec;
-				break;
-			}
-		}
+		/* share an active feed with the same PID and CRC check */
+		*secfeed = dvb_dmxdev_find_section_feed(dmxdev, para);
 
 		/* if no feed found, try to allocate new one */
 		if (!*secfeed) {
@@ -1056,6 +1076,14 @@ static int dvb_demux_do_ioctl(struct file *file,
 					     &((struct dmx_stc *)parg)->base);
 		break;
 
+	case DMX_GET_PID_STATS:
+		if (!dmxdev->demux->get_pid_stats) {
+			ret = -EINVAL;
+			break;
+		}
+		ret = dmxdev->demux->get_pid_stats(dmxdev->demux, parg);
+		break;
+
 	case DMX_ADD_PID:
 		if (mutex_lock_interruptible(&dmxdevfilter->mutex)) {
 			ret = -ERESTARTSYS;
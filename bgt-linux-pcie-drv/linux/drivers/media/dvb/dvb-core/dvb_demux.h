@@ -96,6 +96,19 @@ struct dvb_demux_feed {
 
 	struct list_head list_head;
 	unsigned int index;	/* a unique index for each feed (can be used as hardware pid filter index) */
+
+	/* section feeds: sections assembled once vs. passed to filters */
+	u32 sections_assembled;
+	u32 sections_crc_errors;
+	u32 sections_delivered;
+};
+
+struct dvb_demux_pid_stats {
+	u32 packets;
+	u32 cc_errors;
+	u32 tei;
+	u32 scrambled;
+	u8 cc;		/* last continuity counter, 0xff before the first packet */
 };
 
 struct dvb_demux {
@@ -134,6 +147,13 @@ struct dvb_demux {
 
 	uint8_t *cnt_storage; /* for TS continuity check */
 
+	/* always on, updated on the packet path under lock */
+	struct dvb_demux_pid_stats *pid_stats;
+	u64 stats_packets;
+	u64 stats_rate_packets;
+	unsigned long stats_rate_jiffies;
+	u32 stats_bitrate;
+
 	struct timespec speed_last_time; /* for TS speed check */
 	uint32_t speed_pkts_cnt; /* for TS speed check */
 };
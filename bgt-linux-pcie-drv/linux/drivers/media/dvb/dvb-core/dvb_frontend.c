@@ -52,6 +52,8 @@ static int dvb_force_auto_inversion;
 static int dvb_override_tune_delay;
 static int dvb_powerdown_on_sleep = 1;
 static int dvb_mfe_wait_time = 5;
+static int dvb_adaptive_poll;
+static int dvb_adaptive_poll_max = 4000;
 
 module_param_named(frontend_debug, dvb_frontend_debug, int, 0644);
 MODULE_PARM_DESC(frontend_debug, "Turn on/off frontend core debugging (default:off).");
@@ -65,6 +67,10 @@ module_param(dvb_powerdown_on_sleep, int, 0644);
 MODULE_PARM_DESC(dvb_powerdown_on_sleep, "0: do not power down, 1: turn LNB voltage off on sleep (default)");
 module_param(dvb_mfe_wait_time, int, 0644);
 MODULE_PARM_DESC(dvb_mfe_wait_time, "Wait up to <mfe_wait_time> seconds on open() for multi-frontend to become available (default:5 seconds)");
+module_param(dvb_adaptive_poll, int, 0644);
+MODULE_PARM_DESC(dvb_adaptive_poll, "0: fixed status polling (default), 1: adapt the polling interval to lock stability and answer FE_READ_STATUS from the frontend thread");
+module_param(dvb_adaptive_poll_max, int, 0644);
+MODULE_PARM_DESC(dvb_adaptive_poll_max, "longest status polling interval in ms while locked, with dvb_adaptive_poll (default:4000)");
 
 #define FESTATE_IDLE 1
 #define FESTATE_RETUNE 2
@@ -136,6 +142,19 @@ struct dvb_frontend_private {
 	int quality;
 	unsigned int check_wrapped;
 	enum dvbfe_search algo_status;
+
+	/* adaptive status polling */
+	fe_status_t adapt_status;
+	unsigned int stable_polls;	/* polls since the status last changed */
+	unsigned long lock_lost_jiffies;
+	unsigned int algo_delay;	/* last delay chosen by the tuning algorithm */
+	unsigned int adapt_delay;	/* last delay chosen here, 0 if none */
+	int adapting;			/* the delay is adapted, and status kept current */
+
+	/* status reads, counted per minute */
+	unsigned long reads_jiffies;
+	unsigned int reads;
+	unsigned int reads_last;
 };
 
 static void dvb_frontend_wakeup(struct dvb_frontend *fe);
@@ -295,6 +314,112 @@ static void dvb_frontend_init(struct dvb_frontend *fe)
 	}
 }
 
+static void dvb_frontend_roll_reads(struct dvb_frontend_private *fepriv)
+{
+	if (time_before(jiffies, fepriv->reads_jiffies + 60 * HZ))
+		return;
+
+	/* a minute without any reads in it counts as zero */
+	if (time_before(jiffies, fepriv->reads_jiffies + 120 * HZ))
+		fepriv->reads_last = fepriv->reads;
+	else
+		fepriv->reads_last = 0;
+	fepriv->reads = 0;
+	fepriv->reads_jiffies = jiffies;
+}
+
+/*
+ * All status polls of the hardware go through here, so that they can be
+ * counted; with DVBFE_ALGO_HW a tune() call without re_tune is the poll.
+ */
+static int dvb_frontend_read_status(struct dvb_frontend *fe, fe_status_t *status)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+
+	if (!fe->ops.read_status)
+		return -EOPNOTSUPP;
+
+	dvb_frontend_roll_reads(fepriv);
+	fepriv->reads++;
+	return fe->ops.read_status(fe, status);
+}
+
+/*
+ * With dvb_adaptive_poll, the interval between polls while locked starts
+ * at 100ms after any status change and doubles every four unchanged polls,
+ * up to dvb_adaptive_poll_max; a quarter of that for a minute after a lock
+ * loss. Frontends that call dvb_frontend_status_changed() on lock changes
+ * are only polled every minute, as a safety net. While searching, the
+ * delay of the tuning algorithm is left alone.
+ *
+ * The adapted delay only ever lengthens the one the tuning algorithm chose,
+ * and frontends whose algorithm already polls less often than
+ * dvb_adaptive_poll_max while locked (DVBFE_ALGO_CUSTOM uses a minute) are
+ * not adapted at all, and have FE_READ_STATUS read from the hardware.
+ */
+static void dvb_frontend_adapt_delay(struct dvb_frontend *fe)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+	unsigned int delay, max_delay;
+
+	/* anything but the delay set here last time is the algorithm's choice */
+	if (fepriv->delay != fepriv->adapt_delay)
+		fepriv->algo_delay = fepriv->delay;
+	fepriv->adapt_delay = 0;
+	fepriv->adapting = 0;
+
+	if (fepriv->status != fepriv->adapt_status) {
+		if ((fepriv->adapt_status & FE_HAS_LOCK) && !(fepriv->status & FE_HAS_LOCK))
+			fepriv->lock_lost_jiffies = jiffies;
+		fepriv->adapt_status = fepriv->status;
+		fepriv->stable_polls = 0;
+	}
+
+	if (!(fepriv->status & FE_HAS_LOCK) ||
+	    (fepriv->state & (FESTATE_RETUNE | FESTATE_IDLE)) ||
+	    (fepriv->tune_mode_flags & FE_TUNE_MODE_ONESHOT))
+		return;
+
+	if (fe->status_irq) {
+		max_delay = 60 * HZ;
+	} else {
+		max_delay = msecs_to_jiffies(dvb_adaptive_poll_max);
+		if (fepriv->lock_lost_jiffies &&
+		    time_before(jiffies, fepriv->lock_lost_jiffies + 60 * HZ))
+			max_delay /= 4;
+	}
+
+	if (fepriv->algo_delay >= max_delay)
+		return;
+
+	delay = (HZ / 10) << min(fepriv->stable_polls / 4, 16U);
+	fepriv->stable_polls++;
+	delay = max_t(unsigned int, HZ / 10, min(delay, max_delay));
+	fepriv->delay = max(delay, fepriv->algo_delay);
+	fepriv->adapt_delay = fepriv->delay;
+	fepriv->adapting = 1;
+
+	dev_dbg(fe->dvb->device, "%s: status 0x%02x stable for %u polls, next in %ums\n",
+		__func__, fepriv->status, fepriv->stable_polls, jiffies_to_msecs(fepriv->delay));
+}
+
+/*
+ * For drivers that get an interrupt (or GPIO edge) when the lock changes:
+ * wakes the frontend thread to read the status and queue the event. May be
+ * called from interrupt context. Drivers using it set fe->status_irq.
+ */
+void dvb_frontend_status_changed(struct dvb_frontend *fe)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+
+	if (fepriv == NULL)
+		return;
+
+	fepriv->stable_polls = 0;
+	dvb_frontend_wakeup(fe);
+}
+EXPORT_SYMBOL(dvb_frontend_status_changed);
+
 void dvb_frontend_reinitialise(struct dvb_frontend *fe)
 {
 	struct dvb_frontend_private *fepriv = fe->frontend_priv;
@@ -462,8 +587,7 @@ static void dvb_frontend_swzigzag(struct dvb_frontend *fe)
 	if (fepriv->state & FESTATE_RETUNE) {
 		s = 0;
 	} else {
-		if (fe->ops.read_status)
-			fe->ops.read_status(fe, &s);
+		dvb_frontend_read_status(fe, &s);
 		if (s != fepriv->status) {
 			dvb_frontend_add_event(fe, s);
 			fepriv->status = s;
@@ -613,6 +737,15 @@ static int dvb_frontend_thread(void *data)
 	fepriv->status = 0;
 	fepriv->wakeup = 0;
 	fepriv->reinitialise = 0;
+	fepriv->adapt_status = 0;
+	fepriv->stable_polls = 0;
+	fepriv->lock_lost_jiffies = 0;
+	fepriv->algo_delay = 0;
+	fepriv->adapt_delay = 0;
+	fepriv->adapting = 0;
+	fepriv->reads_jiffies = jiffies;
+	fepriv->reads = 0;
+	fepriv->reads_last = 0;
 
 	dvb_frontend_init(fe);
 
@@ -663,8 +796,13 @@ restart:
 					re_tune = false;
 				}
 
-				if (fe->ops.tune)
+				if (fe->ops.tune) {
+					if (!re_tune) {
+						dvb_frontend_roll_reads(fepriv);
+						fepriv->reads++;
+					}
 					fe->ops.tune(fe, re_tune, fepriv->tune_mode_flags, &fepriv->delay, &s);
+				}
 
 				if (s != fepriv->status && !(fepriv->tune_mode_flags & FE_TUNE_MODE_ONESHOT)) {
 					dev_dbg(fe->dvb->device, "%s: state changed, adding current state\n", __func__);
@@ -702,7 +840,7 @@ restart:
 					fepriv->delay = HZ / 2;
 				}
 				dtv_property_legacy_params_sync(fe, &fepriv->parameters_out);
-				fe->ops.read_status(fe, &s);
+				dvb_frontend_read_status(fe, &s);
 				if (s != fepriv->status) {
 					dvb_frontend_add_event(fe, s); /* update event list */
 					fepriv->status = s;
@@ -721,6 +859,9 @@ restart:
 		} else {
 			dvb_frontend_swzigzag(fe);
 		}
+
+		if (dvb_adaptive_poll)
+			dvb_frontend_adapt_delay(fe);
 	}
 
 	if (dvb_powerdown_on_sleep) {
@@ -1065,20 +1206,44 @@ static struct dtv_cmds_h dtv_cmds[DTV_MAX_COMMAND + 1] = {
 	_DTV_CMD(DTV_STAT_TOTAL_BLOCK_COUNT, 0, 0),
 };
 
+#define _DTV_PRIVATE_CMD(n, s, b) \
+[(n) - DTV_PRIVATE_BASE] = { \
+	.name = #n, \
+	.cmd  = n, \
+	.set  = s,\
+	.buffer = b \
+}
+
+static struct dtv_cmds_h dtv_private_cmds[DTV_PRIVATE_MAX_COMMAND - DTV_PRIVATE_BASE + 1] = {
+	/* Statistics */
+	_DTV_PRIVATE_CMD(DTV_STAT_LOCK_TIME, 0, 0),
+	_DTV_PRIVATE_CMD(DTV_STAT_STATUS_READS, 0, 0),
+};
+
+static struct dtv_cmds_h *dtv_cmd_lookup(u32 cmd)
+{
+	if (cmd > 0 && cmd <= DTV_MAX_COMMAND)
+		return &dtv_cmds[cmd];
+	if (cmd >= DTV_PRIVATE_BASE && cmd <= DTV_PRIVATE_MAX_COMMAND)
+		return &dtv_private_cmds[cmd - DTV_PRIVATE_BASE];
+	return NULL;
+}
+
 static void dtv_property_dump(struct dvb_frontend *fe, struct dtv_property *tvp)
 {
+	struct dtv_cmds_h *cmd = dtv_cmd_lookup(tvp->cmd);
 	int i;
 
-	if (tvp->cmd <= 0 || tvp->cmd > DTV_MAX_COMMAND) {
+	if (!cmd) {
 		dev_warn(fe->dvb->device, "%s: tvp.cmd = 0x%08x undefined\n",
 				__func__, tvp->cmd);
 		return;
 	}
 
 	dev_dbg(fe->dvb->device, "%s: tvp.cmd    = 0x%08x (%s)\n", __func__,
-			tvp->cmd, dtv_cmds[tvp->cmd].name);
+			tvp->cmd, cmd->name);
 
-	if (dtv_cmds[tvp->cmd].buffer) {
+	if (cmd->buffer) {
 		dev_dbg(fe->dvb->device, "%s: tvp.u.buffer.len = 0x%02x\n",
 			__func__, tvp->u.buffer.len);
 
@@ -1478,6 +1643,19 @@ static int dtv_property_process_get(struct dvb_frontend *fe,
 	case DTV_STAT_TOTAL_BLOCK_COUNT:
 		tvp->u.st = c->block_count;
 		break;
+	case DTV_STAT_LOCK_TIME:
+		tvp->u.st = c->lock_time;
+		break;
+	case DTV_STAT_STATUS_READS: {
+		struct dvb_frontend_private *fepriv = fe->frontend_priv;
+
+		/* only counted while the frontend thread runs */
+		dvb_frontend_roll_reads(fepriv);
+		tvp->u.st.len = 1;
+		tvp->u.st.stat[0].scale = FE_SCALE_COUNTER;
+		tvp->u.st.stat[0].uvalue = fepriv->reads_last;
+		break;
+	}
 	default:
 		dev_dbg(fe->dvb->device,
 			"%s: FE property %d doesn't exist\n",
@@ -2146,6 +2324,34 @@ static int dtv_set_frontend(struct dvb_frontend *fe)
 }
 
 
+static int dvb_frontend_blind_scan(struct dvb_frontend *fe, struct dvb_blindscan *scan)
+{
+	struct dvb_frontend_private *fepriv = fe->frontend_priv;
+	int err;
+
+	if (!fe->ops.blind_scan)
+		return -EOPNOTSUPP;
+
+	if ((scan->frequency_min > scan->frequency_max) ||
+	    (scan->frequency_step == 0) ||
+	    (scan->symbol_rate_min > scan->symbol_rate_max))
+		return -EINVAL;
+
+	/* the frontend thread cannot run while we hold fepriv->sem */
+	scan->count = 0;
+	err = fe->ops.blind_scan(fe, scan);
+
+	/* the demodulator was left on the last carrier, so retune */
+	fepriv->status = 0;
+	if (!(fepriv->state & FESTATE_IDLE)) {
+		fepriv->state = FESTATE_RETUNE;
+		fepriv->algo_status |= DVBFE_ALGO_SEARCH_AGAIN;
+		dvb_frontend_wakeup(fe);
+	}
+
+	return err;
+}
+
 static int dvb_frontend_ioctl_legacy(struct file *file,
 			unsigned int cmd, void *parg)
 {
@@ -2214,8 +2420,17 @@ static int dvb_frontend_ioctl_legacy(struct file *file,
 			break;
 		}
 
+		/* the thread keeps the status current and queues its changes */
+		if (dvb_adaptive_poll && fepriv->thread && fepriv->adapting &&
+		    !(fepriv->tune_mode_flags & FE_TUNE_MODE_ONESHOT) &&
+		    !(fepriv->state & FESTATE_IDLE)) {
+			err = 0;
+			*status = fepriv->status;
+			break;
+		}
+
 		if (fe->ops.read_status)
-			err = fe->ops.read_status(fe, status);
+			err = dvb_frontend_read_status(fe, status);
 		break;
 	}
 
@@ -2391,6 +2606,10 @@ static int dvb_frontend_ioctl_legacy(struct file *file,
 		fepriv->tune_mode_flags = (unsigned long) parg;
 		err = 0;
 		break;
+
+	case FE_BLIND_SCAN:
+		err = dvb_frontend_blind_scan(fe, parg);
+		break;
 	}
 
 	return err;
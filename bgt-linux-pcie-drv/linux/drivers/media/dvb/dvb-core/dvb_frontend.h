@@ -310,6 +310,9 @@ struct dvb_frontend_ops {
 	 */
 	enum dvbfe_search (*search)(struct dvb_frontend *fe);
 
+	/* sweep a frequency range for carriers, see FE_BLIND_SCAN */
+	int (*blind_scan)(struct dvb_frontend *fe, struct dvb_blindscan *scan);
+
 	struct dvb_tuner_ops tuner_ops;
 	struct analog_demod_ops analog_ops;
 
@@ -403,6 +406,7 @@ struct dtv_frontend_properties {
 	struct dtv_fe_stats	post_bit_count;
 	struct dtv_fe_stats	block_error;
 	struct dtv_fe_stats	block_count;
+	struct dtv_fe_stats	lock_time;
 };
 
 struct dvb_frontend {
@@ -418,6 +422,7 @@ struct dvb_frontend {
 #define DVB_FRONTEND_COMPONENT_DEMOD 1
 	int (*callback)(void *adapter_priv, int component, int cmd, int arg);
 	int id;
+	bool status_irq;	/* dvb_frontend_status_changed() is called on lock changes */
 };
 
 extern int dvb_register_frontend(struct dvb_adapter *dvb,
@@ -428,6 +433,7 @@ extern int dvb_unregister_frontend(struct dvb_frontend *fe);
 extern void dvb_frontend_detach(struct dvb_frontend *fe);
 
 extern void dvb_frontend_reinitialise(struct dvb_frontend *fe);
+extern void dvb_frontend_status_changed(struct dvb_frontend *fe);
 extern int dvb_frontend_suspend(struct dvb_frontend *fe);
 extern int dvb_frontend_resume(struct dvb_frontend *fe);
 
@@ -35,15 +35,54 @@
 
 #include "dvb_ringbuffer.h"
 
+#ifndef smp_load_acquire
+#define smp_load_acquire(p)						\
+({									\
+	typeof(*p) ___p = ACCESS_ONCE(*p);				\
+	smp_mb();							\
+	___p;								\
+})
+#define smp_store_release(p, v)						\
+do {									\
+	smp_mb();							\
+	ACCESS_ONCE(*p) = (v);						\
+} while (0)
+#endif
+
 #define PKT_READY 0
 #define PKT_DISPOSED 1
 
+/*
+ * The reader owns pread and the writer owns pwrite. Each side publishes its
+ * index with a store-release after touching the data, and reads the other
+ * side's index with a load-acquire before touching the data, so one reader
+ * and one writer need no lock (see note (2) in dvb_ringbuffer.h).
+ */
+
+/* advance pos by len, where pos + len never passes the end of the buffer */
+static inline ssize_t dvb_ringbuffer_advance(struct dvb_ringbuffer *rbuf,
+					     ssize_t pos, size_t len)
+{
+	pos += len;
+	if (rbuf->mask)
+		return pos & rbuf->mask;
+	if (pos >= rbuf->size)
+		pos -= rbuf->size;
+	return pos;
+}
+
+static inline ssize_t dvb_ringbuffer_mask(size_t len)
+{
+	return (len && !(len & (len - 1))) ? len - 1 : 0;
+}
+
 
 void dvb_ringbuffer_init(struct dvb_ringbuffer *rbuf, void *data, size_t len)
 {
 	rbuf->pread=rbuf->pwrite=0;
 	rbuf->data=data;
 	rbuf->size=len;
+	rbuf->mask=dvb_ringbuffer_mask(len);
 	rbuf->error=0;
 
 	init_waitqueue_head(&rbuf->queue);
@@ -51,11 +90,19 @@ void dvb_ringbuffer_init(struct dvb_ringbuffer *rbuf, void *data, size_t len)
 	spin_lock_init(&(rbuf->lock));
 }
 
+void dvb_ringbuffer_set_data(struct dvb_ringbuffer *rbuf, void *data, size_t len)
+{
+	rbuf->data = data;
+	rbuf->size = len;
+	rbuf->mask = dvb_ringbuffer_mask(len);
+	dvb_ringbuffer_reset(rbuf);
+}
+
 
 
 int dvb_ringbuffer_empty(struct dvb_ringbuffer *rbuf)
 {
-	return (rbuf->pread==rbuf->pwrite);
+	return (rbuf->pread == smp_load_acquire(&rbuf->pwrite));
 }
 
 
@@ -64,7 +111,10 @@ ssize_t dvb_ringbuffer_free(struct dvb_ringbuffer *rbuf)
 {
 	ssize_t free;
 
-	free = rbuf->pread - rbuf->pwrite;
+	if (rbuf->mask)
+		return (smp_load_acquire(&rbuf->pread) - rbuf->pwrite - 1) & rbuf->mask;
+
+	free = smp_load_acquire(&rbuf->pread) - rbuf->pwrite;
 	if (free <= 0)
 		free += rbuf->size;
 	return free-1;
@@ -76,7 +126,10 @@ ssize_t dvb_ringbuffer_avail(struct dvb_ringbuffer *rbuf)
 {
 	ssize_t avail;
 
-	avail = rbuf->pwrite - rbuf->pread;
+	if (rbuf->mask)
+		return (smp_load_acquire(&rbuf->pwrite) - rbuf->pread) & rbuf->mask;
+
+	avail = smp_load_acquire(&rbuf->pwrite) - rbuf->pread;
 	if (avail < 0)
 		avail += rbuf->size;
 	return avail;
@@ -86,14 +139,15 @@ ssize_t dvb_ringbuffer_avail(struct dvb_ringbuffer *rbuf)
 
 void dvb_ringbuffer_flush(struct dvb_ringbuffer *rbuf)
 {
-	rbuf->pread = rbuf->pwrite;
+	smp_store_release(&rbuf->pread, smp_load_acquire(&rbuf->pwrite));
 	rbuf->error = 0;
 }
 EXPORT_SYMBOL(dvb_ringbuffer_flush);
 
 void dvb_ringbuffer_reset(struct dvb_ringbuffer *rbuf)
 {
-	rbuf->pread = rbuf->pwrite = 0;
+	smp_store_release(&rbuf->pread, 0);
+	smp_store_release(&rbuf->pwrite, 0);
 	rbuf->error = 0;
 }
 
@@ -119,12 +173,12 @@ ssize_t dvb_ringbuffer_read_user(struct dvb_ringbuffer *rbuf, u8 __user *buf, si
 			return -EFAULT;
 		buf += split;
 		todo -= split;
-		rbuf->pread = 0;
+		smp_store_release(&rbuf->pread, 0);
 	}
 	if (copy_to_user(buf, rbuf->data+rbuf->pread, todo))
 		return -EFAULT;
 
-	rbuf->pread = (rbuf->pread + todo) % rbuf->size;
+	smp_store_release(&rbuf->pread, dvb_ringbuffer_advance(rbuf, rbuf->pread, todo));
 
 	return len;
 }
@@ -139,11 +193,11 @@ void dvb_ringbuffer_read(struct dvb_ringbuffer *rbuf, u8 *buf, size_t len)
 		memcpy(buf, rbuf->data+rbuf->pread, split);
 		buf += split;
 		todo -= split;
-		rbuf->pread = 0;
+		smp_store_release(&rbuf->pread, 0);
 	}
 	memcpy(buf, rbuf->data+rbuf->pread, todo);
 
-	rbuf->pread = (rbuf->pread + todo) % rbuf->size;
+	smp_store_release(&rbuf->pread, dvb_ringbuffer_advance(rbuf, rbuf->pread, todo));
 }
 
 
@@ -158,26 +212,39 @@ ssize_t dvb_ringbuffer_write(struct dvb_ringbuffer *rbuf, const u8 *buf, size_t
 		memcpy(rbuf->data+rbuf->pwrite, buf, split);
 		buf += split;
 		todo -= split;
-		rbuf->pwrite = 0;
+		smp_store_release(&rbuf->pwrite, 0);
 	}
 	memcpy(rbuf->data+rbuf->pwrite, buf, todo);
-	rbuf->pwrite = (rbuf->pwrite + todo) % rbuf->size;
+	smp_store_release(&rbuf->pwrite, dvb_ringbuffer_advance(rbuf, rbuf->pwrite, todo));
 
 	return len;
 }
 
 ssize_t dvb_ringbuffer_pkt_write(struct dvb_ringbuffer *rbuf, u8* buf, size_t len)
 {
-	int status;
-	ssize_t oldpwrite = rbuf->pwrite;
+	ssize_t pwrite = rbuf->pwrite;
+	size_t todo = len;
+	size_t split;
 
-	DVB_RINGBUFFER_WRITE_BYTE(rbuf, len >> 8);
-	DVB_RINGBUFFER_WRITE_BYTE(rbuf, len & 0xff);
-	DVB_RINGBUFFER_WRITE_BYTE(rbuf, PKT_READY);
-	status = dvb_ringbuffer_write(rbuf, buf, len);
+	rbuf->data[pwrite] = len >> 8;
+	pwrite = dvb_ringbuffer_advance(rbuf, pwrite, 1);
+	rbuf->data[pwrite] = len & 0xff;
+	pwrite = dvb_ringbuffer_advance(rbuf, pwrite, 1);
+	rbuf->data[pwrite] = PKT_READY;
+	pwrite = dvb_ringbuffer_advance(rbuf, pwrite, 1);
 
-	if (status < 0) rbuf->pwrite = oldpwrite;
-	return status;
+	/* header and payload become visible together */
+	split = (pwrite + len > rbuf->size) ? rbuf->size - pwrite : 0;
+	if (split > 0) {
+		memcpy(rbuf->data+pwrite, buf, split);
+		buf += split;
+		todo -= split;
+		pwrite = 0;
+	}
+	memcpy(rbuf->data+pwrite, buf, todo);
+	smp_store_release(&rbuf->pwrite, dvb_ringbuffer_advance(rbuf, pwrite, todo));
+
+	return len;
 }
 
 ssize_t dvb_ringbuffer_pkt_read_user(struct dvb_ringbuffer *rbuf, size_t idx,
@@ -290,6 +357,7 @@ ssize_t dvb_ringbuffer_pkt_next(struct dvb_ringbuffer *rbuf, size_t idx, size_t*
 
 
 EXPORT_SYMBOL(dvb_ringbuffer_init);
+EXPORT_SYMBOL(dvb_ringbuffer_set_data);
 EXPORT_SYMBOL(dvb_ringbuffer_empty);
 EXPORT_SYMBOL(dvb_ringbuffer_free);
 EXPORT_SYMBOL(dvb_ringbuffer_avail);
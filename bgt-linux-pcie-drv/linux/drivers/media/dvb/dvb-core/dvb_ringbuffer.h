@@ -33,6 +33,7 @@
 struct dvb_ringbuffer {
 	u8               *data;
 	ssize_t           size;
+	ssize_t           mask;		/* size - 1 for power-of-two sizes, else 0 */
 	ssize_t           pread;
 	ssize_t           pwrite;
 	int               error;
@@ -71,11 +72,25 @@ struct dvb_ringbuffer {
 **     Flushing the buffer counts as a read operation.
 **     Resetting the buffer counts as a read and write operation.
 **     Two or more writers must be locked against each other.
+**     The read and write routines order the index updates against the data
+**     copies (store-release / load-acquire), so this holds on SMP as well.
+**     The writer must never move pread itself: on overflow it should set
+**     <error> and leave the flush to the reader.
+**
+** (3) A buffer whose size is a power of two wraps its indices with a mask
+**     instead of a compare. Users which own the allocation, such as
+**     dmxdev, should round their sizes up with roundup_pow_of_two().
 */
 
 /* initialize ring buffer, lock and queue */
 extern void dvb_ringbuffer_init(struct dvb_ringbuffer *rbuf, void *data, size_t len);
 
+/*
+** Switch to new buffer memory of <len> bytes, emptying the buffer
+** This counts as a read and write operation
+*/
+extern void dvb_ringbuffer_set_data(struct dvb_ringbuffer *rbuf, void *data, size_t len);
+
 /* test whether buffer is empty */
 extern int dvb_ringbuffer_empty(struct dvb_ringbuffer *rbuf);
 
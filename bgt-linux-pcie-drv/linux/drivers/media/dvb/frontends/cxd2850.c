@@ -24,6 +24,8 @@
 #include <linux/string.h>
 #include <linux/slab.h>
 #include <linux/mutex.h>
+#include <linux/delay.h>
+#include <linux/jiffies.h>
 
 #include "compat.h"
 #include <linux/dvb/frontend.h>
@@ -1681,20 +1683,85 @@ out:
 	return ret;
 }
 
+/*
+ * Time allowed for TS lock after the demodulator is tuned. Timing and
+ * carrier recovery take a number of symbols, so low symbol rates need
+ * longer, and in AUTO mode the demodulator tries both DVB-S and DVB-S2.
+ */
+static u32 cxd2850_lock_budget(u32 srate, enum cxd2850_delsys delsys)
+{
+	u32 budget;
+
+	if (srate <= 2000)
+		budget = 2000;
+	else if (srate <= 5000)
+		budget = 1200;
+	else if (srate <= 10000)
+		budget = 800;
+	else if (srate <= 20000)
+		budget = 600;
+	else
+		budget = 500;
+
+	if (delsys == CXD2850_AUTO)
+		budget += budget / 2;
+
+	return budget;
+}
+
+/*
+ * Poll for TS lock, often at first, since a good carrier locks in a few
+ * tens of ms, then less often. Give up early when there is still no
+ * carrier after a quarter of the budget.
+ */
+static int cxd2850_wait_lock(struct cxd2850_dev *cxd2850, u32 budget)
+{
+	unsigned long start = jiffies;
+	u32 elapsed = 0, carrier_budget;
+	u8 data[2];
+	int ret;
+
+	carrier_budget = max_t(u32, budget / 4, 100);
+
+	while (elapsed < budget) {
+		if (elapsed < 100)
+			msleep(10);
+		else if (elapsed < 300)
+			msleep(20);
+		else
+			msleep(50);
+		elapsed = jiffies_to_msecs(jiffies - start);
+
+		ret = cxd2850_rd_regs(cxd2850, 0x0010, data, 2);
+		if (ret)
+			return ret;
+		if (data[1] & 0x04)
+			return 1;
+		if (!(data[0] & 0x20) && (elapsed >= carrier_budget)) {
+			dprintk(FE_DEBUG, 1, "No carrier after %d ms", elapsed);
+			break;
+		}
+	}
+	return 0;
+}
+
 static enum dvbfe_search cxd2850_search(struct dvb_frontend *fe)
 {
 	struct cxd2850_dev *cxd2850		= fe->demodulator_priv;
 	struct dtv_frontend_properties *props	= &fe->dtv_property_cache;
 	enum cxd2850_delsys delsys		= props->delivery_system;
 
-	u32 srate;
-	u8 ts_lock = 0;
-	int i, ret;
+	unsigned long start = jiffies;
+	u32 srate, budget;
+	int ret;
 
 	dprintk(FE_DEBUG, 1, " ");
 	srate  = props->symbol_rate / 1000;
 	delsys = CXD2850_AUTO;
 
+	props->lock_time.len = 1;
+	props->lock_time.stat[0].scale = FE_SCALE_NOT_AVAILABLE;
+
 	if (!props->frequency)
 		return DVBFE_ALGO_SEARCH_INVALID;
 
@@ -1730,13 +1797,17 @@ static enum dvbfe_search cxd2850_search(struct dvb_frontend *fe)
 	}
 	cxd2850->delsys = delsys;
 
-	for (i = 0; i < 10; i++) {
-		msleep(100);
-		ret = cxd2850_rd_reg(cxd2850, 0x0011, &ts_lock);
-		if (ret)
-			goto err;
-		if (ts_lock & 0x04)
-			return DVBFE_ALGO_SEARCH_SUCCESS;
+	budget = cxd2850_lock_budget(srate, delsys);
+	ret = cxd2850_wait_lock(cxd2850, budget);
+	if (ret < 0)
+		goto err;
+	if (ret) {
+		props->lock_time.stat[0].scale  = FE_SCALE_COUNTER;
+		props->lock_time.stat[0].uvalue = jiffies_to_msecs(jiffies - start);
+		dprintk(FE_DEBUG, 1, "TS Lock in %llu ms (budget %d ms)",
+			props->lock_time.stat[0].uvalue, budget);
+
+		return DVBFE_ALGO_SEARCH_SUCCESS;
 	}
 	goto out;
 err:
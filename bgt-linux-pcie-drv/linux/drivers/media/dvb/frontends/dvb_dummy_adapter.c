@@ -0,0 +1,499 @@
+/*
+ *  Dummy DVB adapter, replaying a Transport Stream into the software demux
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.=
+ */
+
+/*
+ * Registers one or more complete DVB adapters (frontend, demux, dvr, net)
+ * without any hardware, so demux, dmxdev, dvb_net and the userspace tools
+ * can be benchmarked on any machine.
+ *
+ * While at least one feed is running, a kernel thread hands buffers of
+ * buffer_packets TS packets to dvb_dmx_swfilter_packets() at the configured
+ * bitrate, the same way the SAA7231 DMA interrupt hands over its 348 packet
+ * buffers. The packets are read from replay_file, restarting at the end, or
+ * are synthesized: synth_pids PIDs from synth_pid_base with valid continuity
+ * counters. Synthetic streams carry no PSI, so use a capture for gnutv/scan.
+ *
+ * Throughput is logged when the last feed stops.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/fs.h>
+#include <linux/kthread.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/version.h>
+
+#include "dvbdev.h"
+#include "dvb_demux.h"
+#include "dmxdev.h"
+#include "dvb_frontend.h"
+#include "dvb_net.h"
+
+#include "dvb_dummy_fe.h"
+
+#define TS_PACKET_SIZE		188
+#define MAX_ADAPTERS		4
+#define MAX_SYNTH_PIDS		256
+
+DVB_DEFINE_MOD_OPT_ADAPTER_NR(adapter_nr);
+
+static unsigned int adapters = 1;
+module_param(adapters, uint, 0444);
+MODULE_PARM_DESC(adapters, "Number of adapters to register (1-4, default 1)");
+
+static unsigned int fe_type;
+module_param(fe_type, uint, 0444);
+MODULE_PARM_DESC(fe_type, "Frontend: 0=DVB-T (default), 1=DVB-S, 2=DVB-C");
+
+static char *replay_file;
+module_param(replay_file, charp, 0644);
+MODULE_PARM_DESC(replay_file, "TS capture to replay (default: synthetic stream)");
+
+static unsigned int bitrate = 38000;
+module_param(bitrate, uint, 0644);
+MODULE_PARM_DESC(bitrate, "Stream bitrate in kbit/s, 0 = as fast as possible (default 38000)");
+
+static unsigned int buffer_packets = 348;
+module_param(buffer_packets, uint, 0644);
+MODULE_PARM_DESC(buffer_packets, "TS packets per buffer (default 348, as SAA7231 DMA)");
+
+static unsigned int synth_pids = 16;
+module_param(synth_pids, uint, 0644);
+MODULE_PARM_DESC(synth_pids, "PIDs in the synthetic stream (default 16)");
+
+static unsigned int synth_pid_base = 0x100;
+module_param(synth_pid_base, uint, 0644);
+MODULE_PARM_DESC(synth_pid_base, "First PID of the synthetic stream (default 0x100)");
+
+struct dvb_dummy_adapter {
+	int			index;
+	char			name[32];
+
+	struct dvb_adapter	dvb_adapter;
+	struct dvb_frontend	*fe;
+	struct dvb_demux	demux;
+	struct dmxdev		dmxdev;
+	struct dmx_frontend	fe_hw;
+	struct dmx_frontend	fe_mem;
+	struct dvb_net		dvb_net;
+
+	struct mutex		feedlock;
+	int			feeds;
+	struct task_struct	*thread;
+
+	/* TS source */
+	u8			*buf;
+	unsigned int		packets;	/* buffer size, in packets */
+	struct file		*file;
+	loff_t			pos;
+	u8			cc[MAX_SYNTH_PIDS];
+	u32			seq;
+
+	/* statistics */
+	u64			sent;
+	u32			buffers;
+	u32			late;
+	ktime_t			start;
+};
+
+static struct dvb_dummy_adapter *dummy;
+
+static int dvb_dummy_adapter_read(struct dvb_dummy_adapter *adap, u8 *buf, size_t len)
+{
+	ssize_t ret;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
+	ret = kernel_read(adap->file, buf, len, &adap->pos);
+#else
+	ret = kernel_read(adap->file, adap->pos, buf, len);
+	if (ret > 0)
+		adap->pos += ret;
+#endif
+	return ret;
+}
+
+/* returns the number of packets in the buffer, or < 0 on error */
+static int dvb_dummy_adapter_fill(struct dvb_dummy_adapter *adap)
+{
+	size_t len = adap->packets * TS_PACKET_SIZE;
+	size_t done = 0;
+	ssize_t ret;
+	unsigned int i;
+	int wrapped = 0;
+
+	if (adap->file) {
+		while (done < len) {
+			ret = dvb_dummy_adapter_read(adap, adap->buf + done, len - done);
+			if (ret < 0)
+				return ret;
+			if (ret == 0) {
+				/* loop the capture; an empty file is an error */
+				if (wrapped++)
+					return -EINVAL;
+				adap->pos = 0;
+				continue;
+			}
+			wrapped = 0;
+			done += ret;
+		}
+		return adap->packets;
+	}
+
+	for (i = 0; i < adap->packets; i++) {
+		u8 *p = adap->buf + (i * TS_PACKET_SIZE);
+		unsigned int n = adap->seq++ % synth_pids;
+		u16 pid = (synth_pid_base + n) & 0x1fff;
+
+		p[0] = 0x47;
+		p[1] = pid >> 8;
+		p[2] = pid & 0xff;
+		p[3] = 0x10 | adap->cc[n];
+		adap->cc[n] = (adap->cc[n] + 1) & 0x0f;
+
+		/* sequence number, so dropped packets can be detected */
+		p[4] = adap->seq >> 24;
+		p[5] = adap->seq >> 16;
+		p[6] = adap->seq >> 8;
+		p[7] = adap->seq;
+		memset(p + 8, 0xff, TS_PACKET_SIZE - 8);
+	}
+	return adap->packets;
+}
+
+static int dvb_dummy_adapter_thread(void *data)
+{
+	struct dvb_dummy_adapter *adap = data;
+	u64 buffer_ns = 0;
+	ktime_t next;
+	int count;
+
+	if (bitrate)
+		buffer_ns = div_u64((u64) adap->packets * TS_PACKET_SIZE * 8 * 1000000ULL, bitrate);
+
+	adap->start = ktime_get();
+	next = adap->start;
+
+	while (!kthread_should_stop()) {
+		count = dvb_dummy_adapter_fill(adap);
+		if (count < 0) {
+			printk(KERN_ERR "%s: reading %s failed (%d), stream stopped\n",
+			       adap->name, replay_file, count);
+			break;
+		}
+		if (adap->buf[0] != 0x47 && !adap->buffers)
+			printk(KERN_WARNING "%s: stream is not packet aligned\n", adap->name);
+
+		dvb_dmx_swfilter_packets(&adap->demux, adap->buf, count);
+		adap->sent += count;
+		adap->buffers++;
+
+		if (!buffer_ns) {
+			cond_resched();
+			continue;
+		}
+
+		/* like the hardware, a late buffer is not made up for */
+		next = ktime_add_ns(next, buffer_ns);
+		if (ktime_compare(ktime_get(), next) > 0) {
+			adap->late++;
+			next = ktime_get();
+			cond_resched();
+			continue;
+		}
+		set_current_state(TASK_INTERRUPTIBLE);
+		schedule_hrtimeout(&next, HRTIMER_MODE_ABS);
+	}
+
+	/* wait for kthread_stop() if the stream failed */
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+	}
+	return 0;
+}
+
+static int dvb_dummy_adapter_stream_start(struct dvb_dummy_adapter *adap)
+{
+	int ret;
+
+	adap->packets = clamp(buffer_packets, 1U, 4096U);
+	adap->buf = vmalloc(adap->packets * TS_PACKET_SIZE);
+	if (!adap->buf)
+		return -ENOMEM;
+
+	adap->file = NULL;
+	adap->pos = 0;
+	if (replay_file && replay_file[0]) {
+		adap->file = filp_open(replay_file, O_RDONLY | O_LARGEFILE, 0);
+		if (IS_ERR(adap->file)) {
+			ret = PTR_ERR(adap->file);
+			printk(KERN_ERR "%s: cannot open %s (%d)\n", adap->name, replay_file, ret);
+			adap->file = NULL;
+			goto err;
+		}
+	}
+	if (synth_pids < 1 || synth_pids > MAX_SYNTH_PIDS)
+		synth_pids = 16;
+
+	adap->sent = 0;
+	adap->buffers = 0;
+	adap->late = 0;
+
+	adap->thread = kthread_run(dvb_dummy_adapter_thread, adap, "dvb_dummy%d", adap->index);
+	if (IS_ERR(adap->thread)) {
+		ret = PTR_ERR(adap->thread);
+		adap->thread = NULL;
+		goto err;
+	}
+	return 0;
+err:
+	if (adap->file)
+		filp_close(adap->file, NULL);
+	adap->file = NULL;
+	vfree(adap->buf);
+	adap->buf = NULL;
+	return ret;
+}
+
+static void dvb_dummy_adapter_stream_stop(struct dvb_dummy_adapter *adap)
+{
+	s64 ms;
+
+	if (!adap->thread)
+		return;
+
+	kthread_stop(adap->thread);
+	adap->thread = NULL;
+
+	ms = ktime_to_ms(ktime_sub(ktime_get(), adap->start));
+	printk(KERN_INFO "%s: %llu packets in %lld ms (%llu kbit/s), %u buffers, %u late\n",
+	       adap->name,
+	       (unsigned long long) adap->sent,
+	       (long long) ms,
+	       ms ? (unsigned long long) div64_s64((s64) adap->sent * TS_PACKET_SIZE * 8, ms) : 0ULL,
+	       adap->buffers,
+	       adap->late);
+
+	if (adap->file)
+		filp_close(adap->file, NULL);
+	adap->file = NULL;
+	vfree(adap->buf);
+	adap->buf = NULL;
+}
+
+static int dvb_dummy_adapter_start_feed(struct dvb_demux_feed *dvbdmxfeed)
+{
+	struct dvb_demux *dvbdmx = dvbdmxfeed->demux;
+	struct dvb_dummy_adapter *adap = dvbdmx->priv;
+	int ret = 0;
+
+	if (!dvbdmx->dmx.frontend)
+		return -EINVAL;
+
+	mutex_lock(&adap->feedlock);
+	if (++adap->feeds == 1) {
+		ret = dvb_dummy_adapter_stream_start(adap);
+		if (ret < 0)
+			adap->feeds--;
+	}
+	mutex_unlock(&adap->feedlock);
+
+	return ret;
+}
+
+static int dvb_dummy_adapter_stop_feed(struct dvb_demux_feed *dvbdmxfeed)
+{
+	struct dvb_demux *dvbdmx = dvbdmxfeed->demux;
+	struct dvb_dummy_adapter *adap = dvbdmx->priv;
+
+	if (!dvbdmx->dmx.frontend)
+		return -EINVAL;
+
+	mutex_lock(&adap->feedlock);
+	if (--adap->feeds == 0)
+		dvb_dummy_adapter_stream_stop(adap);
+	mutex_unlock(&adap->feedlock);
+
+	return 0;
+}
+
+static int dvb_dummy_adapter_register(struct dvb_dummy_adapter *adap)
+{
+	int ret;
+
+	snprintf(adap->name, sizeof (adap->name), "dvb_dummy_adapter%d", adap->index);
+	mutex_init(&adap->feedlock);
+
+	ret = dvb_register_adapter(&adap->dvb_adapter, adap->name, THIS_MODULE, NULL, adapter_nr);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: error registering adapter (%d)\n", adap->name, ret);
+		return ret;
+	}
+	adap->dvb_adapter.priv		= adap;
+
+	adap->demux.dmx.capabilities	= DMX_TS_FILTERING	|
+					  DMX_SECTION_FILTERING	|
+					  DMX_MEMORY_BASED_FILTERING;
+	adap->demux.priv		= adap;
+	adap->demux.filternum		= 256;
+	adap->demux.feednum		= 256;
+	adap->demux.start_feed		= dvb_dummy_adapter_start_feed;
+	adap->demux.stop_feed		= dvb_dummy_adapter_stop_feed;
+	adap->demux.write_to_decoder	= NULL;
+
+	ret = dvb_dmx_init(&adap->demux);
+	if (ret < 0)
+		goto err0;
+
+	adap->dmxdev.filternum		= 256;
+	adap->dmxdev.demux		= &adap->demux.dmx;
+	adap->dmxdev.capabilities	= 0;
+
+	ret = dvb_dmxdev_init(&adap->dmxdev, &adap->dvb_adapter);
+	if (ret < 0)
+		goto err1;
+
+	adap->fe_hw.source = DMX_FRONTEND_0;
+	ret = adap->demux.dmx.add_frontend(&adap->demux.dmx, &adap->fe_hw);
+	if (ret < 0)
+		goto err2;
+
+	adap->fe_mem.source = DMX_MEMORY_FE;
+	ret = adap->demux.dmx.add_frontend(&adap->demux.dmx, &adap->fe_mem);
+	if (ret < 0)
+		goto err3;
+
+	ret = adap->demux.dmx.connect_frontend(&adap->demux.dmx, &adap->fe_hw);
+	if (ret < 0)
+		goto err4;
+
+	ret = dvb_net_init(&adap->dvb_adapter, &adap->dvb_net, &adap->demux.dmx);
+	if (ret < 0) {
+		printk(KERN_ERR "%s: dvb_net_init failed (%d)\n", adap->name, ret);
+		goto err5;
+	}
+
+	switch (fe_type) {
+	case 1:
+		adap->fe = dvb_attach(dvb_dummy_fe_qpsk_attach);
+		break;
+	case 2:
+		adap->fe = dvb_attach(dvb_dummy_fe_qam_attach);
+		break;
+	default:
+		adap->fe = dvb_attach(dvb_dummy_fe_ofdm_attach);
+		break;
+	}
+	if (!adap->fe) {
+		ret = -ENODEV;
+		goto err6;
+	}
+
+	ret = dvb_register_frontend(&adap->dvb_adapter, adap->fe);
+	if (ret < 0) {
+		dvb_frontend_detach(adap->fe);
+		adap->fe = NULL;
+		goto err6;
+	}
+
+	return 0;
+
+err6:
+	dvb_net_release(&adap->dvb_net);
+err5:
+	adap->demux.dmx.disconnect_frontend(&adap->demux.dmx);
+err4:
+	adap->demux.dmx.remove_frontend(&adap->demux.dmx, &adap->fe_mem);
+err3:
+	adap->demux.dmx.remove_frontend(&adap->demux.dmx, &adap->fe_hw);
+err2:
+	dvb_dmxdev_release(&adap->dmxdev);
+err1:
+	dvb_dmx_release(&adap->demux);
+err0:
+	dvb_unregister_adapter(&adap->dvb_adapter);
+	printk(KERN_ERR "%s: initialization failed (%d)\n", adap->name, ret);
+	return ret;
+}
+
+static void dvb_dummy_adapter_unregister(struct dvb_dummy_adapter *adap)
+{
+	if (adap->fe) {
+		dvb_unregister_frontend(adap->fe);
+		dvb_frontend_detach(adap->fe);
+	}
+
+	/* in case a feed was left running: the stream thread feeds the demux */
+	mutex_lock(&adap->feedlock);
+	dvb_dummy_adapter_stream_stop(adap);
+	mutex_unlock(&adap->feedlock);
+
+	dvb_net_release(&adap->dvb_net);
+	adap->demux.dmx.remove_frontend(&adap->demux.dmx, &adap->fe_mem);
+	adap->demux.dmx.remove_frontend(&adap->demux.dmx, &adap->fe_hw);
+	dvb_dmxdev_release(&adap->dmxdev);
+	dvb_dmx_release(&adap->demux);
+	dvb_unregister_adapter(&adap->dvb_adapter);
+}
+
+static int __init dvb_dummy_adapter_init(void)
+{
+	int i, ret;
+
+	adapters = clamp(adapters, 1U, (unsigned int) MAX_ADAPTERS);
+
+	dummy = kcalloc(adapters, sizeof (struct dvb_dummy_adapter), GFP_KERNEL);
+	if (!dummy)
+		return -ENOMEM;
+
+	for (i = 0; i < adapters; i++) {
+		dummy[i].index = i;
+		ret = dvb_dummy_adapter_register(&dummy[i]);
+		if (ret < 0)
+			goto err;
+	}
+	return 0;
+err:
+	while (--i >= 0)
+		dvb_dummy_adapter_unregister(&dummy[i]);
+	kfree(dummy);
+	return ret;
+}
+
+static void __exit dvb_dummy_adapter_exit(void)
+{
+	int i;
+
+	for (i = 0; i < adapters; i++)
+		dvb_dummy_adapter_unregister(&dummy[i]);
+	kfree(dummy);
+}
+
+module_init(dvb_dummy_adapter_init);
+module_exit(dvb_dummy_adapter_exit);
+
+MODULE_DESCRIPTION("DVB Dummy Adapter (TS replay)");
+MODULE_LICENSE("GPL");
@@ -23,13 +23,55 @@
 #include <linux/init.h>
 #include <linux/string.h>
 #include <linux/slab.h>
+#include <linux/jiffies.h>
+#include <linux/delay.h>
 
 #include "dvb_frontend.h"
 #include "dvb_dummy_fe.h"
 
+/*
+ * Lock delay and statistics are module parameters, so that tools and the
+ * dvb_dummy_adapter can be exercised against a frontend which behaves
+ * like real hardware.
+ */
+static unsigned int lock_delay;
+module_param(lock_delay, uint, 0644);
+MODULE_PARM_DESC(lock_delay, "Delay in ms from tuning to lock (default 0)");
+
+static unsigned int signal_strength = 0xc000;
+module_param(signal_strength, uint, 0644);
+MODULE_PARM_DESC(signal_strength, "Reported signal strength (0-0xffff)");
+
+static unsigned int snr = 0xa000;
+module_param(snr, uint, 0644);
+MODULE_PARM_DESC(snr, "Reported SNR (0-0xffff)");
+
+static unsigned int ber;
+module_param(ber, uint, 0644);
+MODULE_PARM_DESC(ber, "Reported bit error rate");
+
+static unsigned int ucblocks;
+module_param(ucblocks, uint, 0644);
+MODULE_PARM_DESC(ucblocks, "Uncorrected blocks added per status read");
+
+#define DVB_DUMMY_FE_MAX_CARRIERS	32
+
+static unsigned int blind_frequency[DVB_DUMMY_FE_MAX_CARRIERS];
+static unsigned int blind_frequency_count;
+module_param_array(blind_frequency, uint, &blind_frequency_count, 0644);
+MODULE_PARM_DESC(blind_frequency, "DVB-S carriers reported by a blind scan, IF in kHz "
+		 "(default: one every 40 MHz)");
+
+static unsigned int blind_symbol_rate[DVB_DUMMY_FE_MAX_CARRIERS];
+static unsigned int blind_symbol_rate_count;
+module_param_array(blind_symbol_rate, uint, &blind_symbol_rate_count, 0644);
+MODULE_PARM_DESC(blind_symbol_rate, "Symbol rate of each blind scan carrier (default 27500000)");
 
 struct dvb_dummy_fe_state {
 	struct dvb_frontend frontend;
+
+	unsigned long	tune_time;	/* jiffies at the last set_frontend */
+	u32		ucblocks;
 };
 
 
@@ -39,36 +81,44 @@ static int dvb_dummy_fe_read_status(struct dvb_frontend* fe, enum fe_status* sta
 static int dvb_dummy_fe_read_status(struct dvb_frontend* fe, fe_status_t* status)
 #endif
 {
-	*status = FE_HAS_SIGNAL
-		| FE_HAS_CARRIER
-		| FE_HAS_VITERBI
-		| FE_HAS_SYNC
-		| FE_HAS_LOCK;
+	struct dvb_dummy_fe_state* state = fe->demodulator_priv;
+
+	*status = FE_HAS_SIGNAL | FE_HAS_CARRIER;
+
+	if (time_before(jiffies, state->tune_time + msecs_to_jiffies(lock_delay)))
+		return 0;
 
+	*status |= FE_HAS_VITERBI
+		|  FE_HAS_SYNC
+		|  FE_HAS_LOCK;
+
+	state->ucblocks += ucblocks;
 	return 0;
 }
 
-static int dvb_dummy_fe_read_ber(struct dvb_frontend* fe, u32* ber)
+static int dvb_dummy_fe_read_ber(struct dvb_frontend* fe, u32* _ber)
 {
-	*ber = 0;
+	*_ber = ber;
 	return 0;
 }
 
 static int dvb_dummy_fe_read_signal_strength(struct dvb_frontend* fe, u16* strength)
 {
-	*strength = 0;
+	*strength = signal_strength;
 	return 0;
 }
 
-static int dvb_dummy_fe_read_snr(struct dvb_frontend* fe, u16* snr)
+static int dvb_dummy_fe_read_snr(struct dvb_frontend* fe, u16* _snr)
 {
-	*snr = 0;
+	*_snr = snr;
 	return 0;
 }
 
-static int dvb_dummy_fe_read_ucblocks(struct dvb_frontend* fe, u32* ucblocks)
+static int dvb_dummy_fe_read_ucblocks(struct dvb_frontend* fe, u32* _ucblocks)
 {
-	*ucblocks = 0;
+	struct dvb_dummy_fe_state* state = fe->demodulator_priv;
+
+	*_ucblocks = state->ucblocks;
 	return 0;
 }
 
@@ -82,6 +132,10 @@ static int dvb_dummy_fe_get_frontend(struct dvb_frontend *fe)
 
 static int dvb_dummy_fe_set_frontend(struct dvb_frontend *fe)
 {
+	struct dvb_dummy_fe_state* state = fe->demodulator_priv;
+
+	state->tune_time = jiffies;
+
 	if (fe->ops.tuner_ops.set_params) {
 		fe->ops.tuner_ops.set_params(fe);
 		if (fe->ops.i2c_gate_ctrl)
@@ -91,6 +145,53 @@ static int dvb_dummy_fe_set_frontend(struct dvb_frontend *fe)
 	return 0;
 }
 
+static void dvb_dummy_fe_add_carrier(struct dvb_blindscan *scan, u32 frequency, u32 srate)
+{
+	struct dvb_blindscan_carrier *carrier;
+
+	if ((frequency < scan->frequency_min) || (frequency > scan->frequency_max))
+		return;
+	if ((srate < scan->symbol_rate_min) || (srate > scan->symbol_rate_max))
+		return;
+	if (scan->count == DVB_BLINDSCAN_MAX_CARRIERS)
+		return;
+
+	carrier = &scan->carriers[scan->count++];
+	carrier->frequency	 = frequency;
+	carrier->symbol_rate	 = srate;
+	carrier->delivery_system = SYS_DVBS;
+	carrier->modulation	 = QPSK;
+	carrier->fec_inner	 = FEC_3_4;
+	carrier->inversion	 = INVERSION_OFF;
+}
+
+/*
+ * Report the carriers given as module parameters, or a fixed raster, after
+ * the time a real demodulator would take to step through the range.
+ */
+static int dvb_dummy_fe_blind_scan(struct dvb_frontend *fe, struct dvb_blindscan *scan)
+{
+	unsigned int steps = (scan->frequency_max - scan->frequency_min) / scan->frequency_step;
+	u32 frequency;
+	unsigned int i;
+
+	if (lock_delay && msleep_interruptible(min(steps + 1, 100U) * lock_delay))
+		return -EINTR;
+
+	if (blind_frequency_count) {
+		for (i = 0; i < blind_frequency_count; i++)
+			dvb_dummy_fe_add_carrier(scan, blind_frequency[i],
+						 i < blind_symbol_rate_count ?
+						 blind_symbol_rate[i] : 27500000);
+		return 0;
+	}
+
+	for (frequency = 970000; frequency <= scan->frequency_max; frequency += 40000)
+		dvb_dummy_fe_add_carrier(scan, frequency, 27500000);
+
+	return 0;
+}
+
 static int dvb_dummy_fe_sleep(struct dvb_frontend* fe)
 {
 	return 0;
@@ -98,6 +199,10 @@ static int dvb_dummy_fe_sleep(struct dvb_frontend* fe)
 
 static int dvb_dummy_fe_init(struct dvb_frontend* fe)
 {
+	struct dvb_dummy_fe_state* state = fe->demodulator_priv;
+
+	/* no lock until the first tune */
+	state->tune_time = jiffies;
 	return 0;
 }
 
@@ -268,6 +373,8 @@ static struct dvb_frontend_ops dvb_dummy_fe_qpsk_ops = {
 
 	.set_voltage = dvb_dummy_fe_set_voltage,
 	.set_tone = dvb_dummy_fe_set_tone,
+
+	.blind_scan = dvb_dummy_fe_blind_scan,
 };
 
 MODULE_DESCRIPTION("DVB DUMMY Frontend");
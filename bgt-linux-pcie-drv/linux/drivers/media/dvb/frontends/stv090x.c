@@ -4317,6 +4317,125 @@ static enum dvbfe_search stv090x_search(struct dvb_frontend *fe)
 	return DVBFE_ALGO_SEARCH_ERROR;
 }
 
+static const struct {
+	fe_modulation_t	modulation;
+	fe_code_rate_t	fec;
+} stv090x_modcod_params[] = {
+	[STV090x_DUMMY_PLF]	= { QPSK,    FEC_AUTO },
+	[STV090x_QPSK_14]	= { QPSK,    FEC_AUTO },
+	[STV090x_QPSK_13]	= { QPSK,    FEC_AUTO },
+	[STV090x_QPSK_25]	= { QPSK,    FEC_2_5  },
+	[STV090x_QPSK_12]	= { QPSK,    FEC_1_2  },
+	[STV090x_QPSK_35]	= { QPSK,    FEC_3_5  },
+	[STV090x_QPSK_23]	= { QPSK,    FEC_2_3  },
+	[STV090x_QPSK_34]	= { QPSK,    FEC_3_4  },
+	[STV090x_QPSK_45]	= { QPSK,    FEC_4_5  },
+	[STV090x_QPSK_56]	= { QPSK,    FEC_5_6  },
+	[STV090x_QPSK_89]	= { QPSK,    FEC_8_9  },
+	[STV090x_QPSK_910]	= { QPSK,    FEC_9_10 },
+	[STV090x_8PSK_35]	= { PSK_8,   FEC_3_5  },
+	[STV090x_8PSK_23]	= { PSK_8,   FEC_2_3  },
+	[STV090x_8PSK_34]	= { PSK_8,   FEC_3_4  },
+	[STV090x_8PSK_56]	= { PSK_8,   FEC_5_6  },
+	[STV090x_8PSK_89]	= { PSK_8,   FEC_8_9  },
+	[STV090x_8PSK_910]	= { PSK_8,   FEC_9_10 },
+	[STV090x_16APSK_23]	= { APSK_16, FEC_2_3  },
+	[STV090x_16APSK_34]	= { APSK_16, FEC_3_4  },
+	[STV090x_16APSK_45]	= { APSK_16, FEC_4_5  },
+	[STV090x_16APSK_56]	= { APSK_16, FEC_5_6  },
+	[STV090x_16APSK_89]	= { APSK_16, FEC_8_9  },
+	[STV090x_16APSK_910]	= { APSK_16, FEC_9_10 },
+	[STV090x_32APSK_34]	= { APSK_32, FEC_3_4  },
+	[STV090x_32APSK_45]	= { APSK_32, FEC_4_5  },
+	[STV090x_32APSK_56]	= { APSK_32, FEC_5_6  },
+	[STV090x_32APSK_89]	= { APSK_32, FEC_8_9  },
+	[STV090x_32APSK_910]	= { APSK_32, FEC_9_10 },
+};
+
+static const fe_code_rate_t stv090x_fec_params[] = {
+	[STV090x_PR12]		= FEC_1_2,
+	[STV090x_PR23]		= FEC_2_3,
+	[STV090x_PR34]		= FEC_3_4,
+	[STV090x_PR45]		= FEC_4_5,
+	[STV090x_PR56]		= FEC_5_6,
+	[STV090x_PR67]		= FEC_6_7,
+	[STV090x_PR78]		= FEC_7_8,
+	[STV090x_PR89]		= FEC_8_9,
+	[STV090x_PR910]		= FEC_9_10,
+	[STV090x_PRERR]		= FEC_AUTO,
+};
+
+/*
+ * Blind scan: run the hardware blind search at each step of the range. A
+ * carrier found is recorded and the sweep continues beyond its occupied
+ * bandwidth, so a wide carrier is not found again from the next step.
+ */
+static int stv090x_blind_scan(struct dvb_frontend *fe, struct dvb_blindscan *scan)
+{
+	struct stv090x_state *state = fe->demodulator_priv;
+	struct dvb_blindscan_carrier *carrier;
+	u32 frequency = scan->frequency_min;
+	u32 srate, width;
+
+	while ((frequency <= scan->frequency_max) &&
+	       (scan->count < DVB_BLINDSCAN_MAX_CARRIERS)) {
+		if (signal_pending(current))
+			return -EINTR;
+
+		state->frequency	= frequency;
+		state->srate		= scan->symbol_rate_max;
+		state->search_mode	= STV090x_SEARCH_AUTO;
+		state->algo		= STV090x_BLIND_SEARCH;
+		state->fec		= STV090x_PRERR;
+		state->search_range	= scan->frequency_step * 1000;
+
+		if (stv090x_algo(state) != STV090x_RANGEOK) {
+			frequency += scan->frequency_step;
+			continue;
+		}
+
+		srate = stv090x_get_srate(state, state->internal->mclk);
+		width = stv090x_car_width(srate, state->rolloff) / 1000;
+		dprintk(FE_DEBUG, 1, "Blind scan: carrier at %d kHz, %d sym/s",
+			state->frequency, srate);
+
+		if ((srate >= scan->symbol_rate_min) && (srate <= scan->symbol_rate_max)) {
+			carrier = &scan->carriers[scan->count++];
+			carrier->frequency	= state->frequency;
+			carrier->symbol_rate	= srate;
+			carrier->inversion	= state->inversion == STV090x_IQ_SWAP ?
+						  INVERSION_ON : INVERSION_OFF;
+
+			switch (state->delsys) {
+			case STV090x_DVBS2:
+				carrier->delivery_system = SYS_DVBS2;
+				if (state->modcod < ARRAY_SIZE(stv090x_modcod_params)) {
+					carrier->modulation = stv090x_modcod_params[state->modcod].modulation;
+					carrier->fec_inner  = stv090x_modcod_params[state->modcod].fec;
+				} else {
+					carrier->modulation = QPSK;
+					carrier->fec_inner  = FEC_AUTO;
+				}
+				break;
+			case STV090x_DSS:
+			case STV090x_DVBS1:
+			default:
+				carrier->delivery_system = (state->delsys == STV090x_DSS) ? SYS_DSS : SYS_DVBS;
+				carrier->modulation	 = QPSK;
+				carrier->fec_inner	 = stv090x_fec_params[state->fec];
+				break;
+			}
+		}
+
+		/* continue from the upper edge of this carrier */
+		if ((state->frequency + (width / 2)) > frequency)
+			frequency = state->frequency + (width / 2);
+		frequency += scan->frequency_step;
+	}
+
+	return 0;
+}
+
 static int stv090x_read_status(struct dvb_frontend *fe, enum fe_status *status)
 {
 	struct stv090x_state *state = fe->demodulator_priv;
@@ -5642,6 +5761,7 @@ static struct dvb_frontend_ops stv090x_ops = {
 	.set_tone			= stv090x_set_tone,
 
 	.search				= stv090x_search,
+	.blind_scan			= stv090x_blind_scan,
 	.read_status			= stv090x_read_status,
 	.read_ber			= stv090x_read_per,
 	.read_signal_strength		= stv090x_read_signal_strength,
@@ -26,6 +26,7 @@
 #include <linux/slab.h>
 #include <linux/delay.h>
 #include <linux/math64.h>
+#include <linux/jiffies.h>
 #include <asm/div64.h>
 #include "dvb_frontend.h"
 #include "dvb_math.h"
@@ -145,6 +146,7 @@ struct tda10048_state {
 	struct dvb_frontend frontend;
 
 	int fwloaded;
+	u16 fwtag;	/* checksum of the running image, 0 if unknown */
 
 	u32 freq_if_hz;
 	u32 xtal_hz;
@@ -474,18 +476,77 @@ static int tda10048_set_if(struct dvb_frontend *fe, u32 bw)
 	return 0;
 }
 
-static int tda10048_firmware_upload(struct dvb_frontend *fe)
+/* Fletcher-16 of the image, never 0 so that 0 can mean "unknown" */
+static u16 tda10048_firmware_tag(const u8 *data, size_t size)
+{
+	u16 sum1 = 0, sum2 = 0;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		sum1 = (sum1 + data[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return ((sum2 << 8) | sum1) ? ((sum2 << 8) | sum1) : 1;
+}
+
+/*
+ * The DSP reports a successful boot in SYNC_STATUS; after an upload the
+ * image's tag is left in the spare FREE_REG registers, so a DSP that kept
+ * running (warm boot, resume without power loss) can be recognised.
+ * Returns the tag of the running image, or 0 if the DSP is not running.
+ */
+static u16 tda10048_firmware_running(struct tda10048_state *state)
+{
+	if (!(tda10048_readreg(state, TDA10048_SYNC_STATUS) & 0x40))
+		return 0;
+
+	return tda10048_readreg(state, TDA10048_FREE_REG_1) |
+	       (tda10048_readreg(state, TDA10048_FREE_REG_2) << 8);
+}
+
+/* Firmware bytes per I2C message */
+static u16 tda10048_firmware_wlen(struct tda10048_state *state, size_t size)
 {
-	struct tda10048_state *state = fe->demodulator_priv;
 	struct tda10048_config *config = &state->config;
+	u16 max = 0;
+	size_t wlen;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 1, 0)
+	/* one byte of each message is the register address */
+	if (state->i2c->quirks && (state->i2c->quirks->max_write_len > 1))
+		max = state->i2c->quirks->max_write_len - 1;
+#endif
+	switch (config->fwbulkwritelen) {
+	case TDA10048_BULKWRITE_200:
+	case TDA10048_BULKWRITE_50:
+		wlen = config->fwbulkwritelen;
+		break;
+	case TDA10048_BULKWRITE_MAX:
+		wlen = size;
+		break;
+	default:
+		wlen = max ? size : TDA10048_BULKWRITE_200;
+		break;
+	}
+	if (max && (wlen > max))
+		wlen = max;
+	if (wlen > size)
+		wlen = size;
+
+	return wlen;
+}
+
+/* running: tag of the image found running by tda10048_init() */
+static int tda10048_firmware_upload(struct dvb_frontend *fe, u16 running)
+{
+	struct tda10048_state *state = fe->demodulator_priv;
 	const struct firmware *fw;
+	unsigned long start;
 	int ret;
 	int pos = 0;
 	int cnt;
-	u8 wlen = config->fwbulkwritelen;
-
-	if ((wlen != TDA10048_BULKWRITE_200) && (wlen != TDA10048_BULKWRITE_50))
-		wlen = TDA10048_BULKWRITE_200;
+	u16 wlen;
+	u16 tag;
 
 	/* request the firmware, this will block and timeout */
 	printk(KERN_INFO "%s: waiting for firmware upload (%s)...\n",
@@ -508,8 +569,15 @@ static int tda10048_firmware_upload(struct dvb_frontend *fe)
 	if (fw->size != TDA10048_DEFAULT_FIRMWARE_SIZE) {
 		printk(KERN_ERR "%s: firmware incorrect size\n", __func__);
 		ret = -EIO;
+	} else if ((tag = tda10048_firmware_tag(fw->data, fw->size)) == running) {
+		printk(KERN_INFO "%s: firmware already running, upload skipped\n",
+			__func__);
+		state->fwtag = tag;
 	} else {
-		printk(KERN_INFO "%s: firmware uploading\n", __func__);
+		wlen  = tda10048_firmware_wlen(state, fw->size);
+		start = jiffies;
+		printk(KERN_INFO "%s: firmware uploading (%d byte messages)\n",
+			__func__, wlen);
 
 		/* Soft reset */
 		tda10048_writereg(state, TDA10048_CONF_TRISTATE1,
@@ -556,14 +624,22 @@ static int tda10048_firmware_upload(struct dvb_frontend *fe)
 				break;
 			}
 		}
+		if (ret == 0) {
+			/* tag the running image, see tda10048_firmware_running() */
+			tda10048_writereg(state, TDA10048_FREE_REG_1, tag & 0xff);
+			tda10048_writereg(state, TDA10048_FREE_REG_2, tag >> 8);
+			state->fwtag = tag;
+
+			printk(KERN_INFO "%s: firmware uploaded in %u ms\n",
+				__func__, jiffies_to_msecs(jiffies - start));
+		}
 	}
 
 	release_firmware(fw);
 
-	if (ret == 0) {
-		printk(KERN_INFO "%s: firmware uploaded\n", __func__);
+	if (ret == 0)
 		state->fwloaded = 1;
-	} else
+	else
 		printk(KERN_ERR "%s: firmware upload failed\n", __func__);
 
 	return ret;
@@ -762,9 +838,20 @@ static int tda10048_init(struct dvb_frontend *fe)
 	struct tda10048_state *state = fe->demodulator_priv;
 	struct tda10048_config *config = &state->config;
 	int ret = 0, i;
+	u16 running;
 
 	dprintk(1, "%s()\n", __func__);
 
+	/* Look for a running image before the defaults are applied */
+	running = tda10048_firmware_running(state);
+
+	/* The DSP may have lost its image over a suspend or a power cycle */
+	if (state->fwloaded && state->fwtag && (running != state->fwtag)) {
+		printk(KERN_INFO "%s: DSP not running, reloading firmware\n",
+			__func__);
+		state->fwloaded = 0;
+	}
+
 	/* PLL */
 	init_tab[4].data = (u8)(state->pll_mfactor);
 	init_tab[5].data = (u8)(state->pll_nfactor) | 0x40;
@@ -774,7 +861,7 @@ static int tda10048_init(struct dvb_frontend *fe)
 		tda10048_writereg(state, init_tab[i].reg, init_tab[i].data);
 
 	if (state->fwloaded == 0)
-		ret = tda10048_firmware_upload(fe);
+		ret = tda10048_firmware_upload(fe, running);
 
 	/* Set either serial or parallel */
 	tda10048_output_mode(fe, config->output_mode);
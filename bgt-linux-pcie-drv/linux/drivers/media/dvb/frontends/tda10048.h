@@ -36,8 +36,14 @@ struct tda10048_config {
 #define TDA10048_SERIAL_OUTPUT   1
 	u8 output_mode;
 
+	/*
+	 * Firmware bytes per I2C message. With TDA10048_BULKWRITE_MAX, or when
+	 * unset on an adapter advertising a maximum write length, the image
+	 * goes out in the largest messages the adapter allows.
+	 */
 #define TDA10048_BULKWRITE_200	200
 #define TDA10048_BULKWRITE_50	50
+#define TDA10048_BULKWRITE_MAX	0xff
 	u8 fwbulkwritelen;
 
 	/* Spectral Inversion */
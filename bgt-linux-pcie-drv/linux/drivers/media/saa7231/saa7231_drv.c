@@ -55,6 +55,7 @@
 
 #include "saa7231_mod.h"
 #include "saa7231_priv.h"
+#include "saa7231_pidf.h"
 #include "saa7231_dvb.h"
 #include "saa7231_cgu.h"
 #include "saa7231_cgu_reg.h"
@@ -43,6 +43,7 @@
 #include "saa7231_stream.h"
 #include "saa7231_ring.h"
 #include "saa7231_ts2dtl.h"
+#include "saa7231_pidf.h"
 #include "saa7231_dvb.h"
 
 #include "saa7231_mod.h"
@@ -100,7 +101,7 @@ static int saa7231_dvbts2d0_evhandler(struct saa7231_dev *saa7231, int vector)
 			dprintk(SAA7231_DEBUG, 0, "%02x ", dbuf[i]);
 		}
 #endif
-		dvb_dmx_swfilter_packets(&dvb->demux, dmabuf->virt, 348);
+		saa7231_pidf_feed(&dvb->pidf, &dvb->demux, dmabuf->virt, 348);
 	}
 	spin_unlock_irqrestore(&ring->lock, flags);
 	return 0;
@@ -144,7 +145,7 @@ static int saa7231_dvbts2d1_evhandler(struct saa7231_dev *saa7231, int vector)
 			dprintk(SAA7231_DEBUG, 0, "%02x ", dbuf[i]);
 		}
 #endif
-		dvb_dmx_swfilter_packets(&dvb->demux, dmabuf->virt, 348);
+		saa7231_pidf_feed(&dvb->pidf, &dvb->demux, dmabuf->virt, 348);
 	}
 	spin_unlock_irqrestore(&ring->lock, flags);
 	return 0;
@@ -253,6 +254,10 @@ static int saa7231_dma_stop(struct saa7231_dvb *dvb)
 			goto exit;
 		} else {
 			dprintk(SAA7231_INFO, 1, "INFO: Stream Stopped, Adapter:%d", dvb->adapter);
+			dprintk(SAA7231_INFO, 1, "INFO: Adapter:%d DMA %llu bytes, delivered %llu bytes",
+				dvb->adapter,
+				(unsigned long long) dvb->pidf.bytes_dma,
+				(unsigned long long) dvb->pidf.bytes_delivered);
 			ret = 0;
 			goto exit;
 		}
@@ -277,11 +282,20 @@ static int saa7231_dvb_start_feed(struct dvb_demux_feed *dvbdmxfeed)
 		goto exit;
 	}
 	mutex_lock(&dvb->feedlock);
+	ret = saa7231_pidf_add(&dvb->pidf, dvbdmxfeed->pid);
+	if (ret < 0) {
+		dprintk(SAA7231_ERROR, 1, "ERROR: PID filter, pid=0x%04x ret=%d",
+			dvbdmxfeed->pid, ret);
+		mutex_unlock(&dvb->feedlock);
+		goto exit;
+	}
 	dvb->feeds++;
 	dprintk(SAA7231_DEBUG, 1, "SAA7231 start feed, feeds=%d", dvb->feeds);
 
 	if (dvb->feeds == 1) {
 		dprintk(SAA7231_DEBUG, 1, "SAA7231 start feed & dma");
+		dvb->pidf.bytes_dma	  = 0;
+		dvb->pidf.bytes_delivered = 0;
 		ret = saa7231_dma_start(dvb);
 		if (ret < 0) {
 			dprintk(SAA7231_ERROR, 1, "ERROR: DMA START, ret=%d", ret);
@@ -313,6 +327,7 @@ static int saa7231_dvb_stop_feed(struct dvb_demux_feed *dvbdmxfeed)
 		goto exit;
 	}
 	mutex_lock(&dvb->feedlock);
+	saa7231_pidf_remove(&dvb->pidf, dvbdmxfeed->pid);
 	dvb->feeds--;
 
 	if (!dvb->feeds) {
@@ -505,6 +520,7 @@ int saa7231_dvb_init(struct saa7231_dev *saa7231)
 		dvb->stream = stream;
 		dprintk(SAA7231_INFO, 1, "INFO: Registered Stream for Adapter:%d", i);
 		mutex_init(&dvb->feedlock);
+		saa7231_pidf_init(&dvb->pidf);
 #if 0
 		tasklet_init(&dvb->tasklet, saa7231_dvb_xfer, (unsigned long) dvb);
 		tasklet_disable(&dvb->tasklet);
@@ -38,6 +38,7 @@ struct saa7231_dvb {
 	struct tasklet_struct	tasklet;
 
 	u8			feeds;
+	struct saa7231_pidf	pidf;
 
 	struct saa7231_stream	*stream;
 
@@ -0,0 +1,171 @@
+/*
+ *	SAA7231xx PCI/PCI Express bridge driver
+ *
+ *	Copyright (C) Manu Abraham <abraham.manu@gmail.com>
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the Free Software
+ *	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/bitops.h>
+
+#include "dvb_demux.h"
+
+#include "saa7231_pidf.h"
+
+static unsigned int pid_filter;
+
+module_param(pid_filter, int, 0644);
+MODULE_PARM_DESC(pid_filter, "drop unwanted PIDs in software when the stream port has no PID filter, default is 0 (count only)");
+
+#define TS_SIZE		188
+
+static void saa7231_pidf_update(struct saa7231_pidf *pidf)
+{
+	struct saa7231_pidf_ops *ops = pidf->ops;
+	u16 pids[SAA7231_PIDF_MAX];
+	bool bypass;
+	int i;
+
+	bypass = pidf->all || (pidf->entries > SAA7231_PIDF_MAX);
+
+	if (ops && !bypass) {
+		for (i = 0; i < pidf->entries; i++)
+			pids[i] = pidf->entry[i].pid;
+
+		/* program the list before leaving bypass */
+		if (ops->set_pids(pidf, pids, pidf->entries) < 0)
+			bypass = true;
+	}
+	if (ops && ops->set_bypass && (bypass != pidf->bypass))
+		ops->set_bypass(pidf, bypass);
+
+	pidf->bypass = bypass;
+}
+
+void saa7231_pidf_init(struct saa7231_pidf *pidf)
+{
+	memset(pidf->entry, 0, sizeof (pidf->entry));
+	bitmap_zero(pidf->map, SAA7231_PIDF_PIDS);
+
+	pidf->entries		= 0;
+	pidf->all		= 0;
+	pidf->bypass		= true;
+	pidf->bytes_dma		= 0;
+	pidf->bytes_delivered	= 0;
+
+	if (pidf->ops && pidf->ops->set_bypass)
+		pidf->ops->set_bypass(pidf, true);
+}
+EXPORT_SYMBOL(saa7231_pidf_init);
+
+int saa7231_pidf_add(struct saa7231_pidf *pidf, u16 pid)
+{
+	int i;
+
+	if (pid >= SAA7231_PIDF_PIDS) {
+		pidf->all++;
+		goto update;
+	}
+	for (i = 0; i < pidf->entries; i++) {
+		if (pidf->entry[i].pid == pid) {
+			pidf->entry[i].users++;
+			return 0;
+		}
+	}
+	if (pidf->entries == ARRAY_SIZE(pidf->entry))
+		return -ENOSPC;
+
+	pidf->entry[pidf->entries].pid	 = pid;
+	pidf->entry[pidf->entries].users = 1;
+	pidf->entries++;
+	set_bit(pid, pidf->map);
+update:
+	saa7231_pidf_update(pidf);
+	return 0;
+}
+EXPORT_SYMBOL(saa7231_pidf_add);
+
+int saa7231_pidf_remove(struct saa7231_pidf *pidf, u16 pid)
+{
+	int i;
+
+	if (pid >= SAA7231_PIDF_PIDS) {
+		if (!pidf->all)
+			return -EINVAL;
+		pidf->all--;
+		goto update;
+	}
+	for (i = 0; i < pidf->entries; i++) {
+		if (pidf->entry[i].pid == pid)
+			break;
+	}
+	if (i == pidf->entries)
+		return -EINVAL;
+
+	if (--pidf->entry[i].users)
+		return 0;
+
+	pidf->entries--;
+	pidf->entry[i] = pidf->entry[pidf->entries];
+	clear_bit(pid, pidf->map);
+update:
+	saa7231_pidf_update(pidf);
+	return 0;
+}
+EXPORT_SYMBOL(saa7231_pidf_remove);
+
+/*
+ * Pass a DMA buffer of count packets to the demux. Packets the filter would
+ * not have let through are counted as DMA'd but not delivered, and with
+ * pid_filter set they are also dropped here, the runs in between going to
+ * the demux unchanged.
+ */
+void saa7231_pidf_feed(struct saa7231_pidf *pidf,
+		       struct dvb_demux *demux,
+		       const u8 *buf,
+		       size_t count)
+{
+	size_t i, start = 0;
+	const u8 *p;
+	u16 pid;
+
+	pidf->bytes_dma += count * TS_SIZE;
+
+	if (pidf->bypass) {
+		pidf->bytes_delivered += count * TS_SIZE;
+		dvb_dmx_swfilter_packets(demux, buf, count);
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		p   = buf + i * TS_SIZE;
+		pid = ((p[1] & 0x1f) << 8) | p[2];
+
+		if (test_bit(pid, pidf->map)) {
+			pidf->bytes_delivered += TS_SIZE;
+			continue;
+		}
+		if (!pid_filter)
+			continue;
+
+		if (i > start)
+			dvb_dmx_swfilter_packets(demux, buf + start * TS_SIZE, i - start);
+		start = i + 1;
+	}
+	if (count > start)
+		dvb_dmx_swfilter_packets(demux, buf + start * TS_SIZE, count - start);
+}
+EXPORT_SYMBOL(saa7231_pidf_feed);
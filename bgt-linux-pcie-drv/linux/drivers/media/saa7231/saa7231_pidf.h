@@ -0,0 +1,71 @@
+/*
+ *	SAA7231xx PCI/PCI Express bridge driver
+ *
+ *	Copyright (C) Manu Abraham <abraham.manu@gmail.com>
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the Free Software
+ *	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __SAA7231_PIDF_H
+#define __SAA7231_PIDF_H
+
+#define SAA7231_PIDF_MAX		32	/* enable list entries per stream port */
+#define SAA7231_PIDF_PIDS		0x2000
+#define SAA7231_PIDF_ALL		0x2000	/* feed wanting the full TS */
+
+struct saa7231_pidf;
+
+/*
+ * Stream port PID filter, programmed by saa7231_pidf_update() with the
+ * enable list or, when the list does not fit or a full TS feed is open,
+ * with bypass. A port without ops uses the software model, which drops
+ * unwanted packets in front of the demux, so that the saving can be
+ * measured before the hardware does the filtering.
+ */
+struct saa7231_pidf_ops {
+	int (*set_pids)(struct saa7231_pidf *pidf, const u16 *pids, int count);
+	int (*set_bypass)(struct saa7231_pidf *pidf, bool bypass);
+};
+
+struct saa7231_pidf_entry {
+	u16				pid;
+	u16				users;
+};
+
+struct saa7231_pidf {
+	struct saa7231_pidf_entry	entry[256];	/* one per demux feed at most */
+	int				entries;
+	int				all;		/* open SAA7231_PIDF_ALL feeds */
+	bool				bypass;
+
+	/* software model, read from the stream event handler */
+	unsigned long			map[BITS_TO_LONGS(SAA7231_PIDF_PIDS)];
+
+	u64				bytes_dma;
+	u64				bytes_delivered;
+
+	struct saa7231_pidf_ops		*ops;
+	void				*priv;
+};
+
+extern void saa7231_pidf_init(struct saa7231_pidf *pidf);
+extern int saa7231_pidf_add(struct saa7231_pidf *pidf, u16 pid);
+extern int saa7231_pidf_remove(struct saa7231_pidf *pidf, u16 pid);
+extern void saa7231_pidf_feed(struct saa7231_pidf *pidf,
+			      struct dvb_demux *demux,
+			      const u8 *buf,
+			      size_t count);
+
+#endif /* __SAA7231_PIDF_H */
@@ -139,6 +139,24 @@ struct dmx_stc {
 	__u64 stc;		/* output: stc in 'base'*90 kHz units */
 };
 
+struct dmx_pid_stats_entry {
+	__u16 pid;
+	__u16 reserved;
+	__u32 packets;
+	__u32 cc_errors;	/* continuity counter errors */
+	__u32 tei;		/* packets with transport_error_indicator set */
+	__u32 scrambled;	/* packets with scrambling control set */
+};
+
+struct dmx_pid_stats {
+	__u64 packets;		/* output: packets seen by the demux */
+	__u32 bitrate;		/* output: bits/s, measured over about a second */
+	__u32 msecs;		/* output: time of the snapshot, in ms */
+	__u32 count;		/* input : room in entries, output: entries used */
+	__u32 pids;		/* output: PIDs seen, may be more than count */
+	__u64 entries;		/* input : struct dmx_pid_stats_entry[count] */
+};
+
 
 #define DMX_START                _IO('o', 41)
 #define DMX_STOP                 _IO('o', 42)
@@ -151,5 +169,6 @@ struct dmx_stc {
 #define DMX_GET_STC              _IOWR('o', 50, struct dmx_stc)
 #define DMX_ADD_PID              _IOW('o', 51, __u16)
 #define DMX_REMOVE_PID           _IOW('o', 52, __u16)
+#define DMX_GET_PID_STATS        _IOWR('o', 53, struct dmx_pid_stats)
 
 #endif /* _UAPI_DVBDMX_H_ */
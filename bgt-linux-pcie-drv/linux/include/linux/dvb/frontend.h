@@ -377,6 +377,17 @@ struct dvb_frontend_event {
 
 #define DTV_MAX_COMMAND		DTV_STAT_TOTAL_BLOCK_COUNT
 
+/*
+ * Commands private to this driver tree. They are numbered well above the
+ * upstream ones, so that new upstream commands never reuse their numbers.
+ */
+#define DTV_PRIVATE_BASE		0x10000
+
+#define DTV_STAT_LOCK_TIME		(DTV_PRIVATE_BASE + 0)	/* ms from tuning to lock, FE_SCALE_COUNTER */
+#define DTV_STAT_STATUS_READS		(DTV_PRIVATE_BASE + 1)	/* status reads in the last minute, FE_SCALE_COUNTER */
+
+#define DTV_PRIVATE_MAX_COMMAND	DTV_STAT_STATUS_READS
+
 typedef enum fe_pilot {
 	PILOT_ON,
 	PILOT_OFF,
@@ -556,6 +567,38 @@ struct dtv_properties {
 #define FE_GET_PROPERTY		   _IOR('o', 83, struct dtv_properties)
 
 
+/**
+ * Blind scan: the frontend sweeps frequency_min..frequency_max (tuner/IF
+ * frequencies in kHz, as for FE_SET_FRONTEND on satellite) in steps of
+ * frequency_step, searching for carriers with a symbol rate between
+ * symbol_rate_min and symbol_rate_max, and returns what it found in
+ * carriers[0..count-1]. The normal tuning loop is suspended while the scan
+ * runs, and the last tuned channel is restored afterwards.
+ */
+#define DVB_BLINDSCAN_MAX_CARRIERS 128
+
+struct dvb_blindscan_carrier {
+	__u32 frequency;	/* kHz */
+	__u32 symbol_rate;	/* symbols/s */
+	__u32 delivery_system;	/* fe_delivery_system_t */
+	__u32 modulation;	/* fe_modulation_t */
+	__u32 fec_inner;	/* fe_code_rate_t */
+	__u32 inversion;	/* fe_spectral_inversion_t */
+};
+
+struct dvb_blindscan {
+	__u32 frequency_min;
+	__u32 frequency_max;
+	__u32 frequency_step;
+	__u32 symbol_rate_min;
+	__u32 symbol_rate_max;
+	__u32 count;
+	struct dvb_blindscan_carrier carriers[DVB_BLINDSCAN_MAX_CARRIERS];
+};
+
+#define FE_BLIND_SCAN		   _IOWR('o', 84, struct dvb_blindscan)
+
+
 /**
  * When set, this flag will disable any zigzagging or other "normal" tuning
  * behaviour. Additionally, there will be no automatic monitoring of the lock